@@ -0,0 +1,81 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bufpool.h
+ *
+ *    Description:  Pool of fixed size buffer chunks.  Response bodies are held as a
+ *                  chain of chunks rather than a single realloc'd buffer, chunks are
+ *                  recycled through a per thread free list backed by a global one and
+ *                  the pool will never allocate more than its memory cap.
+ *
+ *        Version:  1.0
+ *        Created:  20/10/2026 19:32:10
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_BUFPOOL_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef _SYS_UIO_H_
+#include <sys/uio.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define BP_CHUNK_SIZE  65536  /* default chunk size */
+#define BP_CACHE_MAX   16     /* chunks kept on a thread's own free list */
+#define BP_BATCH       8      /* chunks moved between a thread and the global list */
+
+/*****************************************************************************************
+ * Iterate over the chunks of a chain,  the parser and storage stages read the body
+ * chunk by chunk with this rather than concatenating it.
+ *****************************************************************************************/
+#define bp_chain_for_each(pos, chain) \
+	for (pos = (chain)->ch_head; pos; pos = pos->bc_next)
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct bp_chunk_s {
+	struct bp_chunk_s *bc_next;   /* next chunk in the chain or free list */
+	size_t             bc_len;    /* bytes of bc_data in use */
+	char               bc_data[]; /* chunk data, bp_size bytes */
+} typedef bp_chunk_t;
+
+struct bp_chain_s {
+	bp_chunk_t *ch_head;          /* first chunk of the body */
+	bp_chunk_t *ch_tail;          /* chunk currently being filled */
+	size_t      ch_len;           /* total bytes in the chain */
+	int         ch_count;         /* number of chunks in the chain */
+} typedef bp_chain_t;
+
+struct bufpool_s {
+	size_t          bp_size;      /* size of each chunk */
+	size_t          bp_max;       /* most chunks that may be allocated */
+	size_t          bp_alloc;     /* chunks allocated */
+	size_t          bp_nfree;     /* chunks on the global free list */
+	long            bp_waits;     /* times a caller found the pool exhausted */
+	bp_chunk_t     *bp_free;      /* global free list */
+	pthread_mutex_t bp_lock;      /* protects the global free list and counters */
+	pthread_cond_t  bp_cond;      /* signalled when chunks are returned */
+	pthread_key_t   bp_key;       /* per thread free list */
+	int             bp_nwait;     /* callers about to wait,  puts then skip their own list */
+	struct list_head bp_caches;   /* every thread's free list,  so idle chunks can be taken back */
+} typedef bufpool_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int         bp_init( bufpool_t *bp, size_t size, size_t cap);
+extern bp_chunk_t *bp_get( bufpool_t *bp, bool wait);
+extern void        bp_put( bufpool_t *bp, bp_chunk_t *chunk);
+extern bool        bp_avail( bufpool_t *bp, size_t len);
+extern void        bp_flush( bufpool_t *bp);
+extern void        bp_destroy( bufpool_t *bp);
+extern void        bp_chain_init( bp_chain_t *chain);
+extern int         bp_chain_write( bufpool_t *bp, bp_chain_t *chain, const char *buf, size_t len, bool wait);
+extern int         bp_chain_iov( bp_chain_t *chain, struct iovec *iov, int n);
+extern void        bp_chain_release( bufpool_t *bp, bp_chain_t *chain);
@@ -0,0 +1,100 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ckpt.h
+ *
+ *    Description:  Checkpoints of the crawler's state.  Each checkpoint is a
+ *                  generation of files in one directory,  the seen filter,  the host
+ *                  politeness state and the frontier's queued URLs,  each in a layout
+ *                  that is mapped rather than parsed when it is loaded.  A generation
+ *                  only exists once its manifest,  listing every file with its size
+ *                  and CRC-32,  has been renamed into place after the files were
+ *                  synced,  so a crash part way through leaves the previous one.  On
+ *                  start the newest generation whose manifest and files check out is
+ *                  restored.
+ *
+ *        Version:  1.0
+ *        Created:  01/11/2026 19:22:08
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_CKPT_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_SEEN_H__
+#include <azzmos/seen.h>
+#endif
+#ifndef __AZZMOS_POLITE_H__
+#include <azzmos/polite.h>
+#endif
+#ifndef __AZZMOS_FRONTIER_H__
+#include <azzmos/frontier.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define CK_MAGIC        "AZCKPT01"   /* first bytes of a manifest */
+#define CK_NAME_MAX     32           /* longest file name in a manifest,  with the '\0' */
+#define CK_FILES_MAX    16           /* most files in a generation */
+#define CK_KEEP         2            /* generations kept,  the newest first */
+#define CK_INTERVAL_MS  300000       /* default milliseconds between checkpoints */
+
+/*****************************************************************************************
+ * Names of the files ck_save writes.
+ *****************************************************************************************/
+#define CK_SEEN      "seen"
+#define CK_HOSTS     "hosts"
+#define CK_FRONTIER  "frontier"
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct ck_entry_s {
+	char             ce_name[CK_NAME_MAX];
+	uint64_t         ce_size;     /* bytes in the file */
+	uint32_t         ce_crc;      /* CRC-32 of the file */
+	uint32_t         ce_pad;
+} typedef ck_entry_t;
+
+/*****************************************************************************************
+ * A manifest file,  MANIFEST.<gen>.  cm_crc is the CRC-32 of the manifest with cm_crc
+ * zero.  The files of the generation are ck.<gen>.<name>.
+ *****************************************************************************************/
+struct ck_manifest_s {
+	char             cm_magic[8]; /* CK_MAGIC */
+	uint64_t         cm_gen;      /* generation,  counting from 1 */
+	uint64_t         cm_time;     /* wall clock seconds it was written */
+	uint32_t         cm_files;    /* entries of cm_file in use */
+	uint32_t         cm_crc;
+	ck_entry_t       cm_file[CK_FILES_MAX];
+} typedef ck_manifest_t;
+
+struct ckpt_s {
+	char            *ck_dir;
+	uint64_t         ck_gen;      /* newest complete generation,  0 for none */
+	ck_manifest_t    ck_cur;      /* its manifest */
+	ck_manifest_t    ck_next;     /* the generation being written */
+	long             ck_interval; /* milliseconds between checkpoints */
+	uint64_t         ck_last;     /* pl_now of the last checkpoint */
+} typedef ckpt_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int    ck_init( ckpt_t *ck, const char *dir, long interval);
+extern char  *ck_path( ckpt_t *ck, const char *name);
+extern char  *ck_file( ckpt_t *ck, const char *name);
+extern int    ck_add( ckpt_t *ck, const char *name);
+extern int    ck_commit( ckpt_t *ck);
+extern void   ck_abort( ckpt_t *ck);
+extern bool   ck_due( ckpt_t *ck);
+extern int    ck_save( ckpt_t *ck, seen_t *sn, polite_t *pl, frontier_t *fr);
+extern int    ck_restore( ckpt_t *ck, seen_t *sn, polite_t *pl, frontier_t *fr,
+                          uriobj_t *(*parse)( void *arg, const char *url), void *arg);
+extern void   ck_free( ckpt_t *ck);
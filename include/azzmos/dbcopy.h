@@ -0,0 +1,112 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbcopy.h
+ *
+ *    Description:  Batched URI persistence.  Normalized URIs are encoded as rows of
+ *                  PostgreSQL's binary COPY format as they are added and a batch is
+ *                  sent with one COPY once it has enough rows or bytes,  or once its
+ *                  oldest row has waited long enough.  A batch that fails is kept and
+ *                  sent again with a growing delay,  after DC_RETRIES attempts it is
+ *                  handed to the reject callback and dropped.  The rows go through a
+ *                  temporary table and are inserted from it,  a URI already stored
+ *                  only having its validators updated,  so a batch that was committed
+ *                  but not acknowledged can be sent again safely.  The table written
+ *                  to is
+ *
+ *                    CREATE SEQUENCE uri_uri_id_seq INCREMENT BY 10000;
+ *                    CREATE TABLE uri (
+ *                        uri_id    int8 PRIMARY KEY DEFAULT nextval('uri_uri_id_seq'),
+ *                        uri_fp    int8 NOT NULL UNIQUE,
+ *                        uri_host  text NOT NULL,
+ *                        uri_url   text NOT NULL,
+ *                        uri_etag  text,
+ *                        uri_mdate timestamptz);
+ *
+ *                  where uri_fp is the sn_fingerprint of the URI and uri_url the
+ *                  string it is taken from.  uri_etag and uri_mdate are the validators
+ *                  of the last fetch,  NULL until the URI has been fetched,  and are
+ *                  what the downloader's conditional requests are made from.  The
+ *                  increment is the size of the ranges idalloc reserves.
+ *
+ *        Version:  1.0
+ *        Created:  02/11/2026 18:55:31
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_DBCOPY_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define DC_TABLE        "uri"              /* table the URIs are stored in */
+#define DC_SEQ          "uri_uri_id_seq"   /* sequence for URIs added without a id */
+#define DC_ROWS         5000               /* default rows per batch */
+#define DC_BYTES        (1024 * 1024)      /* default bytes per batch */
+#define DC_DEADLINE_MS  1000               /* default longest a row waits to be sent */
+#define DC_RETRIES      5                  /* attempts before a batch is rejected */
+#define DC_BACKOFF_MS   500                /* delay before the first retry,  doubling */
+#define DC_FAILED_MAX   16                 /* failed batches held before dc_add refuses rows */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct dc_batch_s {
+	char            *cb_buf;     /* rows in COPY binary format,  no header or trailer */
+	size_t           cb_len;
+	size_t           cb_size;
+	long             cb_rows;
+	uint64_t         cb_first;   /* pl_now the first row was added */
+	int              cb_tries;   /* attempts to send it */
+	uint64_t         cb_retry;   /* pl_now it may be sent again */
+	struct list_head cb_list;    /* dc_failed */
+} typedef dc_batch_t;
+
+/*****************************************************************************************
+ * Called with a batch that failed DC_RETRIES times,  before it is freed.  buf holds
+ * rows tuples in COPY binary format.
+ *****************************************************************************************/
+typedef void (*dc_reject_t)( void *arg, const char *buf, size_t len, long rows);
+
+struct dbcopy_s {
+	pthread_mutex_t  dc_lock;      /* protects the batches and counters */
+	pthread_mutex_t  dc_send;      /* held while the connection is in use */
+	char            *dc_conninfo;
+	PGconn          *dc_conn;      /* opened when the first batch is sent */
+	bool             dc_staged;    /* the temporary table exists on dc_conn */
+	dc_batch_t      *dc_cur;       /* batch rows are added to */
+	struct list_head dc_failed;    /* batches waiting to be sent again,  oldest first */
+	int              dc_nfailed;
+	long             dc_rows;      /* rows per batch */
+	size_t           dc_bytes;     /* bytes per batch */
+	long             dc_deadline;  /* milliseconds */
+	long             dc_backoff;   /* milliseconds before the first retry */
+	dc_reject_t      dc_reject;
+	void            *dc_arg;
+	long             dc_sent;      /* rows sent */
+	long             dc_batches;   /* batches sent */
+	long             dc_retried;   /* failed attempts */
+	long             dc_dropped;   /* rows in rejected batches */
+} typedef dbcopy_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int   dc_init( dbcopy_t *dc, const char *conninfo, long rows, size_t bytes, long deadline);
+extern void  dc_set_reject( dbcopy_t *dc, dc_reject_t fn, void *arg);
+extern int   dc_add( dbcopy_t *dc, int64_t id, uint64_t fp, const char *host, const char *url, size_t len,
+                     const char *etag, time_t mdate);
+extern int   dc_add_uri( dbcopy_t *dc, uriobj_t *uri);
+extern int   dc_poll( dbcopy_t *dc);
+extern int   dc_flush( dbcopy_t *dc);
+extern int   dc_close( dbcopy_t *dc);
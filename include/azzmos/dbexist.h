@@ -0,0 +1,99 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbexist.h
+ *
+ *    Description:  Batched check of whether URIs are already stored.  Fingerprints
+ *                  are answered from a in-process LRU of recent answers when they can
+ *                  be,  the rest are gathered into batches of up to dx_batch and
+ *                  looked up with one uri_fp = ANY($1) query each on the asynchronous
+ *                  writer.  A fingerprint already waiting in a batch is not asked for
+ *                  again,  the new caller is just added to its waiters.
+ *
+ *        Version:  1.0
+ *        Created:  05/11/2026 19:36:18
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_DBEXIST_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_DBWRITER_H__
+#include <azzmos/dbwriter.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define DX_CACHE        (1 << 20)   /* default answers kept */
+#define DX_BATCH        4096        /* default fingerprints per query */
+#define DX_DEADLINE_MS  50          /* default longest a fingerprint waits to be sent */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * Given the answer for fp,  on the writer thread or in the thread that filled or
+ * flushed the batch.  err is 0,  the error the query failed with or the error
+ * dw_submit gave.  exists is then meaningless and nothing is cached.  A batch the
+ * writer's queue has no room for is held and sent again,  it is not failed with
+ * EAGAIN.  It may check more fingerprints.
+ *****************************************************************************************/
+typedef void (*dx_done_t)( void *arg, uint64_t fp, bool exists, int err);
+
+struct dx_waiter_s {
+	dx_done_t        xw_fn;
+	void            *xw_arg;
+	uint64_t         xw_fp;      /* copied from the entry once answered */
+	bool             xw_exists;
+	struct list_head xw_list;    /* xe_waiters */
+} typedef dx_waiter_t;
+
+struct dx_entry_s {
+	uint64_t         xe_fp;
+	bool             xe_exists;
+	bool             xe_pending; /* in a batch rather than the LRU */
+	struct list_head xe_waiters; /* callers waiting on a pending answer */
+	struct list_head xe_hash;    /* dx_table bucket */
+	struct list_head xe_list;    /* dx_lru,  most recent first,  or its batch */
+} typedef dx_entry_t;
+
+struct dx_batch_s {
+	struct dbexist_s *xb_dx;
+	struct list_head  xb_entries;
+	int               xb_count;
+	uint64_t          xb_first;   /* pl_now the first fingerprint was added */
+	struct list_head  xb_list;    /* dx_held */
+} typedef dx_batch_t;
+
+struct dbexist_s {
+	dbwriter_t      *dx_dw;      /* queries run through this writer */
+	pthread_mutex_t  dx_lock;    /* protects everything below */
+	pthread_cond_t   dx_cond;    /* signalled when a batch completes */
+	struct list_head *dx_table;  /* answers and pending fingerprints by fingerprint */
+	uint64_t         dx_mask;    /* buckets - 1 */
+	struct list_head dx_lru;     /* cached answers */
+	long             dx_cached;  /* entries on dx_lru */
+	long             dx_cap;     /* most kept */
+	int              dx_batch;   /* fingerprints per query */
+	long             dx_deadline;/* milliseconds before a part filled batch is sent */
+	dx_batch_t      *dx_cur;     /* batch being filled,  NULL if empty */
+	struct list_head dx_held;    /* batches dw_submit had no room for */
+	int              dx_inflight;/* batches sent or held and not yet answered */
+	long             dx_hits;    /* checks answered from the LRU */
+	long             dx_misses;  /* checks that waited on a query */
+	long             dx_queries; /* batches sent */
+} typedef dbexist_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  dx_init( dbexist_t *dx, dbwriter_t *dw, long cap, int batch, long deadline);
+extern int  dx_check( dbexist_t *dx, uint64_t fp, bool *exists, dx_done_t fn, void *arg);
+extern void dx_note( dbexist_t *dx, uint64_t fp, bool exists);
+extern void dx_poll( dbexist_t *dx);
+extern void dx_flush( dbexist_t *dx);
+extern void dx_free( dbexist_t *dx);
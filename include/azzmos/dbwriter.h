@@ -0,0 +1,104 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbwriter.h
+ *
+ *    Description:  Asynchronous database writer.  A dedicated thread owns a few
+ *                  connections in non-blocking mode and runs the statements workers
+ *                  submit through a lock free queue.  Where libpq has pipeline mode
+ *                  each connection keeps up to dw_depth statements in flight,  each
+ *                  followed by its own sync so a failing statement affects no other,
+ *                  otherwise it runs one at a time.  When a statement completes its
+ *                  callback is run on the writer thread,  so a worker never waits on a
+ *                  round trip.
+ *
+ *        Version:  1.0
+ *        Created:  03/11/2026 19:14:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_DBWRITER_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_MPMC_H__
+#include <azzmos/mpmc.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define DW_CONNS         2        /* default connections */
+#define DW_DEPTH         64       /* default statements in flight on a pipelined connection */
+#define DW_QUEUE         4096     /* default statements queued for the writer thread */
+#define DW_RECONNECT_MS  1000     /* least time between attempts to connect */
+#define DW_CONNECT_MS    10000    /* longest a attempt to connect is given */
+#define DW_HOLD_MS       30000    /* longest a statement waits for a connection */
+#define DW_POLL_MS       250      /* longest the writer thread sleeps */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * Run on the writer thread when a statement completes.  err is 0 if res is a command
+ * or tuples result,  EIO if it is any other result or NULL when the connection was
+ * lost,  ENOTCONN if the database could not be reached within dw_hold_ms,  or by the
+ * time the writer closed,  and ECANCELED if the writer closed before it was taken.
+ * res is cleared when the callback returns.  It must not block,  it may submit more
+ * statements.
+ *****************************************************************************************/
+typedef void (*dw_done_t)( void *arg, PGresult *res, int err);
+
+struct dw_req_s {
+	const char      *dr_sql;
+	int              dr_nparams;
+	const char     **dr_values;  /* parameters,  copied with the request */
+	int             *dr_lengths;
+	int             *dr_formats;
+	dw_done_t        dr_fn;
+	void            *dr_arg;
+	bool             dr_done;    /* its callback has run */
+	uint64_t         dr_since;   /* pl_now it was moved to dw_backlog */
+	struct list_head dr_list;    /* dw_backlog or the connection's wc_sent */
+} typedef dw_req_t;
+
+struct dw_conn_s {
+	PGconn          *wc_conn;    /* NULL while down */
+	bool             wc_polling; /* connecting,  PQconnectPoll has not said it is up */
+	int              wc_wait;    /* PGRES_POLLING_READING or _WRITING while polling */
+	bool             wc_pipeline;/* in pipeline mode */
+	bool             wc_flush;   /* output is waiting to be sent */
+	int              wc_inflight;
+	uint64_t         wc_retry;   /* pl_now to next try to connect,  or to give up polling */
+	struct list_head wc_sent;    /* statements sent,  in order */
+} typedef dw_conn_t;
+
+struct dbwriter_s {
+	char            *dw_conninfo;
+	dw_conn_t       *dw_conns;
+	int              dw_nconns;
+	int              dw_depth;    /* statements in flight per pipelined connection */
+	mpmc_t           dw_queue;    /* submitted requests */
+	int              dw_wake[2];  /* pipe the thread polls to be woken */
+	int              dw_sleeping; /* the thread is,  or is about to be,  in poll */
+	int              dw_closed;
+	pthread_t        dw_thread;
+	struct list_head dw_backlog;  /* taken from the queue,  waiting for a connection */
+	int              dw_held;     /* requests in dw_backlog,  at most the queue's size */
+	long             dw_hold_ms;  /* longest a request is held while nothing is up */
+	long             dw_sent;     /* statements sent */
+	long             dw_failed;   /* statements completed with a error */
+} typedef dbwriter_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int   dw_init( dbwriter_t *dw, const char *conninfo, int conns, int depth, size_t queue);
+extern int   dw_submit( dbwriter_t *dw, const char *sql, int nparams, const char * const *values,
+                        const int *lengths, const int *formats, dw_done_t fn, void *arg);
+extern int   dw_close( dbwriter_t *dw);
@@ -0,0 +1,121 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  frontier.h
+ *
+ *    Description:  Two level frontier after Mercator.  URIs are pushed onto one of
+ *                  FR_PRIORITIES front queues by priority.  A bounded number of back
+ *                  queues each hold the URIs of one host,  and a min heap orders the
+ *                  back queues with URIs by their host's next allowed time.  Taking a
+ *                  URI looks only at the top of the heap,  so it is O(log hosts) and
+ *                  idle hosts are never looked at.
+ *
+ *        Version:  1.0
+ *        Created:  26/10/2026 19:05:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_FRONTIER_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef __AZZMOS_HOSTID_H__
+#include <azzmos/hostid.h>
+#endif
+#ifndef __AZZMOS_POLITE_H__
+#include <azzmos/polite.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define FR_PRIORITIES    4       /* front queues,  0 is the highest priority */
+#define FR_BACKS         1024    /* default back queues with URIs at once */
+#define FR_DELAY_MS      1000    /* default time between requests to a host */
+#define FR_BUCKETS       4096    /* hash buckets for the host table */
+#define FR_MAGIC         "AZFRNT01" /* first bytes of a saved frontier */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct fr_back_s {
+	uint32_t         fb_id;      /* interned host id,  the table key */
+	const char      *fb_key;     /* interned host name or IP literal */
+	long             fb_delay;   /* milliseconds between request starts */
+	uint64_t         fb_next;    /* next allowed start, milliseconds */
+	int              fb_heap;    /* index in fr_heap,  -1 when not in it */
+	bool             fb_busy;    /* a URI of the host is being fetched */
+	struct fr_url_s *fb_fetch;   /* that URI */
+	long             fb_queued;  /* URIs on fb_urls */
+	struct list_head fb_urls;    /* queued URIs */
+	struct list_head fb_hash;    /* host table bucket */
+} typedef fr_back_t;
+
+struct fr_url_s {
+	uriobj_t        *fu_uri;     /* URI to fetch */
+	void            *fu_data;    /* caller data */
+	int              fu_prio;    /* front queue it was pushed to */
+	fr_back_t       *fu_back;    /* back queue,  NULL while on a front queue */
+	struct list_head fu_list;    /* front or back queue */
+} typedef fr_url_t;
+
+/*****************************************************************************************
+ * A saved frontier,  a header,  fs_hosts host records,  fs_urls URL records and the
+ * '\0' terminated names and URLs they point at.  URLs being fetched are saved with
+ * the queued ones so a restart fetches them again.
+ *****************************************************************************************/
+struct fr_shead_s {
+	char             fs_magic[8];   /* FR_MAGIC */
+	uint64_t         fs_hosts;
+	uint64_t         fs_urls;
+	uint64_t         fs_strings;    /* offset of the names and URLs */
+	uint64_t         fs_size;       /* bytes in the file */
+} typedef fr_shead_t;
+
+struct fr_shost_s {
+	uint64_t         fh_name;       /* offset from fs_strings */
+	uint32_t         fh_len;
+	uint32_t         fh_pad;
+	int64_t          fh_delay;
+	uint64_t         fh_wait;       /* milliseconds until fb_next */
+} typedef fr_shost_t;
+
+struct fr_surl_s {
+	uint64_t         su_url;        /* offset from fs_strings */
+	uint32_t         su_len;
+	int32_t          su_prio;
+} typedef fr_surl_t;
+
+struct frontier_s {
+	pthread_mutex_t  fr_lock;                   /* protects everything below */
+	pthread_cond_t   fr_cond;                   /* signalled when the heap's top changes */
+	long             fr_delay;                  /* default fb_delay */
+	int              fr_max;                    /* back queues with URIs allowed at once */
+	int              fr_active;                 /* back queues with URIs or busy */
+	int              fr_hosts;                  /* hosts in the table */
+	long             fr_queued;                 /* URIs on front and back queues */
+	bool             fr_closed;                 /* waiters should give up */
+	struct list_head fr_front[FR_PRIORITIES];   /* front queues */
+	int              fr_credit[FR_PRIORITIES];  /* weighted round robin over fr_front */
+	fr_back_t      **fr_heap;                   /* back queues with URIs by fb_next */
+	int              fr_heapn;                  /* back queues in fr_heap */
+	struct list_head fr_table[FR_BUCKETS];      /* host table */
+} typedef frontier_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  fr_init( frontier_t *fr, long delay, int backs);
+extern int  fr_push( frontier_t *fr, uriobj_t *uri, int prio, void *data);
+extern int  fr_pop( frontier_t *fr, bool wait, fr_url_t **url);
+extern void fr_done( frontier_t *fr, fr_url_t *url);
+extern int  fr_set_host( frontier_t *fr, const char *host, long delay);
+extern int  fr_save( frontier_t *fr, const char *path);
+extern int  fr_load( frontier_t *fr, const char *path,
+                     uriobj_t *(*parse)( void *arg, const char *url), void *arg);
+extern void fr_close( frontier_t *fr);
+extern void fr_destroy( frontier_t *fr);
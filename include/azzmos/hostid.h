@@ -0,0 +1,46 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  hostid.h
+ *
+ *    Description:  Host interning.  Every normalized host name or IP literal is
+ *                  mapped to a stable 32 bit id and one shared copy of the string,
+ *                  so per host state can be keyed on a integer rather than compared
+ *                  as a string.  There is one table for the process and ids are never
+ *                  reused,  0 is never a id.  Lookups take no lock.
+ *
+ *        Version:  1.0
+ *        Created:  29/10/2026 19:22:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_HOSTID_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define HI_NONE        0         /* not a host id */
+#define HI_MIN_SLOTS   4096      /* starting size of the hash table */
+#define HI_CHUNK_BITS  16        /* ids per chunk of the id to name directory */
+#define HI_ARENA       65536     /* bytes in each block the names are copied into */
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern uint32_t    hi_intern( const char *host, size_t len);
+extern uint32_t    hi_lookup( const char *host, size_t len);
+extern const char *hi_name( uint32_t id);
+extern uint32_t    hi_count( void);
+extern uint32_t    hi_uri( uriobj_t *uri);
@@ -0,0 +1,70 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  idalloc.h
+ *
+ *    Description:  uri_id allocator.  Ranges of ids are reserved from a database
+ *                  sequence through the asynchronous writer and handed out without a
+ *                  round trip.  Each thread takes IA_LOCAL ids at a time into its own
+ *                  cache and assigns from it without locking,  and the next range is
+ *                  requested while half of the current one is still left so a worker
+ *                  does not wait on the database.
+ *
+ *                  A range is one nextval of the sequence,  so it must be created with
+ *                  its increment set to the range size,  for example
+ *
+ *                      CREATE SEQUENCE uri_uri_id_seq INCREMENT BY 10000;
+ *
+ *                  Every nextval,  the allocator's or anyone else's,  then takes a whole
+ *                  range and no id is given out twice.
+ *
+ *        Version:  1.0
+ *        Created:  04/11/2026 18:22:37
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_IDALLOC_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_DBWRITER_H__
+#include <azzmos/dbwriter.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define IA_LOCAL   256      /* ids a thread takes into its own cache at a time */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct idalloc_s {
+	dbwriter_t      *ia_dw;       /* ranges are reserved through this writer */
+	char            *ia_seq;      /* sequence name */
+	pthread_mutex_t  ia_lock;     /* protects everything below */
+	pthread_cond_t   ia_cond;     /* signalled when a range arrives or its request fails */
+	int64_t          ia_next;     /* next id of the current range */
+	int64_t          ia_end;      /* one past the current range */
+	int64_t          ia_spare;    /* first id of the range after it */
+	int64_t          ia_spare_end;/* one past it,  equal to ia_spare when there is none */
+	int64_t          ia_size;     /* size of the last range */
+	bool             ia_pending;  /* a range has been requested */
+	int              ia_err;      /* error the last request failed with,  EAGAIN is retried */
+	long             ia_ranges;   /* ranges reserved */
+	long             ia_waits;    /* times a thread found no ids left */
+	pthread_key_t    ia_key;      /* per thread cache */
+} typedef idalloc_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  ia_init( idalloc_t *ia, dbwriter_t *dw, const char *seq);
+extern int  ia_next( idalloc_t *ia, bool wait, int64_t *id);
+extern int  ia_assign( idalloc_t *ia, uriobj_t *uri, bool wait);
+extern int  ia_add_range( idalloc_t *ia, int64_t first, int64_t count);
+extern void ia_free( idalloc_t *ia);
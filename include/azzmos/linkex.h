@@ -0,0 +1,65 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  linkex.h
+ *
+ *    Description:  Incremental link extractor.  HTML is fed in chunks as it arrives
+ *                  and link attribute values are handed to a callback as soon as the
+ *                  attribute is closed,  the whole page is never held in memory.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 21:02:45
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_LINKEX_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define LX_NAME_MAX   16    /* tag and attribute names longer than this are ignored */
+#define LX_VALUE_MAX  2048  /* attribute values longer than this are dropped */
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+/*****************************************************************************************
+ * Called for every href,  src and action attribute found,  tag is the name of the tag
+ * it is on.  value is len bytes with entities decoded,  it is not '\0' terminated and
+ * may point into the buffer given to lx_feed,  so it is only valid for the duration of
+ * the call.  Returning non zero stops the extractor and the value is returned from
+ * lx_feed.
+ *****************************************************************************************/
+typedef int (*lx_emit_f)( const char *tag, const char *value, size_t len, void *arg);
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct linkex_s {
+	int       lx_state;                  /* tokenizer state */
+	int       lx_match;                  /* characters matched of a closing sequence */
+	char      lx_quote;                  /* quote character of the current value */
+	bool      lx_want;                   /* current attribute is a link attribute */
+	bool      lx_drop;                   /* current value is being dropped */
+	bool      lx_skip;                   /* current tag has no link attributes */
+	int       lx_taglen;
+	int       lx_namelen;
+	size_t    lx_vallen;
+	char      lx_tag[LX_NAME_MAX + 1];   /* name of the current tag */
+	char      lx_name[LX_NAME_MAX + 1];  /* name of the current attribute */
+	char      lx_value[LX_VALUE_MAX + 1];/* link value split across chunks or decoded */
+	long      lx_links;                  /* number of links emitted */
+	long      lx_dropped;                /* number of link values dropped for length */
+	lx_emit_f lx_emit;                   /* link callback */
+	void     *lx_arg;                    /* argument to lx_emit */
+} typedef linkex_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern void lx_init( linkex_t *lx, lx_emit_f emit, void *arg);
+extern int  lx_feed( linkex_t *lx, const char *buf, size_t len);
+extern void lx_reset( linkex_t *lx);
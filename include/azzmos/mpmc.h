@@ -0,0 +1,67 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mpmc.h
+ *
+ *    Description:  Bounded lock free multi producer multi consumer queue of pointers
+ *                  for handing URIs and buffers between thread pools.  It is a ring
+ *                  of cells each carrying a sequence number,  after Dmitry Vyukov,  so
+ *                  producers and consumers only contend on their own index and a
+ *                  batch of items moves with one compare and swap.  Callers that want
+ *                  to block on a empty or full queue sleep on a futex.
+ *
+ *        Version:  1.0
+ *        Created:  27/10/2026 19:31:08
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_MPMC_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define MQ_CACHELINE  64        /* indices written by different threads are this apart */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct mq_cell_s {
+	uint64_t         mc_seq;     /* position the cell is next pushed at,  plus one once full */
+	void            *mc_data;    /* item */
+} typedef mq_cell_t;
+
+struct mpmc_s {
+	mq_cell_t       *mq_cells;   /* the ring,  mq_mask + 1 cells */
+	uint64_t         mq_mask;    /* cells - 1,  the number of cells is a power of two */
+	char             mq_pad0[MQ_CACHELINE];
+	uint64_t         mq_tail;    /* next position pushed to */
+	char             mq_pad1[MQ_CACHELINE - sizeof(uint64_t)];
+	uint64_t         mq_head;    /* next position popped from */
+	char             mq_pad2[MQ_CACHELINE - sizeof(uint64_t)];
+	uint32_t         mq_notempty;/* futex consumers sleep on,  bit 0 set while they do */
+	uint32_t         mq_notfull; /* futex producers sleep on,  bit 0 set while they do */
+	int              mq_closed;  /* waiters should give up */
+	char             mq_pad3[MQ_CACHELINE];
+#ifndef __linux__
+	pthread_mutex_t  mq_lock;    /* stands in for the futex */
+	pthread_cond_t   mq_cond;
+#endif
+} typedef mpmc_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  mq_init( mpmc_t *mq, size_t size);
+extern int  mq_push_n( mpmc_t *mq, void **items, int n, bool wait);
+extern int  mq_pop_n( mpmc_t *mq, void **items, int n, bool wait);
+extern int  mq_push( mpmc_t *mq, void *item, bool wait);
+extern int  mq_pop( mpmc_t *mq, void **item, bool wait);
+extern void mq_close( mpmc_t *mq);
+extern void mq_destroy( mpmc_t *mq);
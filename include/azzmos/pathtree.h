@@ -0,0 +1,94 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pathtree.h
+ *
+ *    Description:  The paths crawled on each host,  kept in a adaptive radix tree per
+ *                  host so shared prefixes are stored once.  Besides insert and lookup
+ *                  the tree answers how many paths start with a prefix and walks them
+ *                  in order,  for analytics and spotting crawler traps such as a
+ *                  calendar that generates URLs without end.
+ *
+ *        Version:  1.0
+ *        Created:  30/10/2026 19:05:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_PATHTREE_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef __AZZMOS_HOSTID_H__
+#include <azzmos/hostid.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define PT_BUCKETS      4096    /* hash buckets for the host table */
+#define PT_SORTED_MAX   128     /* most children of a PT_NODE */
+
+/*****************************************************************************************
+ * Node kinds.  A PT_NODE keeps its children in a sorted array sized to fit,  grown by
+ * half as it fills,  and becomes a PT_NODE256 with a slot per byte past PT_SORTED_MAX.
+ * A leaf only holds the rest of its path.
+ *****************************************************************************************/
+#define PT_LEAF         0
+#define PT_NODE         1
+#define PT_NODE256      2
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * Every node starts with this header and ends with its pn_plen prefix bytes,  the
+ * bytes shared by every path below the node after the byte that led to it.  A leaf's
+ * prefix runs to the end of its path including the NUL,  which is never part of a
+ * path,  so a path that is a prefix of another still ends in its own leaf.  A leaf
+ * short enough to fit is not allocated at all but packed into its parent's child
+ * pointer,  tagged by the low bit.
+ *****************************************************************************************/
+struct pt_node_s {
+	uint8_t          pn_type;    /* PT_ kind */
+	uint8_t          pn_cap;     /* children a PT_NODE has room for */
+	uint16_t         pn_n;       /* children in use */
+	uint32_t         pn_plen;    /* prefix bytes */
+} typedef pt_node_t;
+
+struct pt_root_s {
+	uint32_t         pr_host;    /* interned host id */
+	pt_node_t       *pr_root;    /* NULL while the host has no paths */
+	uint64_t         pr_paths;   /* paths in the tree */
+	struct list_head pr_hash;    /* host table bucket */
+} typedef pt_root_t;
+
+struct pathtree_s {
+	pthread_mutex_t  pt_lock;                 /* protects everything below */
+	int              pt_hosts;                /* hosts in the table */
+	uint64_t         pt_paths;                /* paths on all hosts */
+	uint64_t         pt_bytes;                /* bytes of nodes allocated */
+	struct list_head pt_table[PT_BUCKETS];    /* host table */
+} typedef pathtree_t;
+
+/*****************************************************************************************
+ * Called by pt_iter for each path in byte order.  path is NUL terminated and only
+ * valid for the call.  A non zero return stops the walk and is returned by pt_iter.
+ *****************************************************************************************/
+typedef int (*pt_fn_t)( void *arg, const char *path, size_t len);
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int       pt_init( pathtree_t *pt);
+extern int       pt_insert( pathtree_t *pt, uint32_t host, const char *path);
+extern int       pt_insert_uri( pathtree_t *pt, uriobj_t *uri);
+extern bool      pt_lookup( pathtree_t *pt, uint32_t host, const char *path);
+extern uint64_t  pt_count( pathtree_t *pt, uint32_t host, const char *prefix);
+extern int       pt_iter( pathtree_t *pt, uint32_t host, const char *prefix, pt_fn_t fn,
+                          void *arg);
+extern void      pt_destroy( pathtree_t *pt);
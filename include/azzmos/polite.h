@@ -0,0 +1,201 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  polite.h
+ *
+ *    Description:  Per host politeness scheduler.  URIs are queued on their host,
+ *                  each host has a next allowed time and a concurrency cap and a
+ *                  timer wheel releases hosts onto a ready list as their time comes.
+ *                  Workers take the next eligible URI from the head of that list
+ *                  without scanning idle hosts.  Hosts that resolve to the same
+ *                  address, or address prefix, also share a IP group with its own
+ *                  time and cap so shared hosting servers are not overloaded through
+ *                  many names.  Optionally each host's concurrency adapts,  growing
+ *                  additively while its latency is steady and being cut back
+ *                  multiplicatively on 429,  503,  timeouts or rising latency.  A
+ *                  host that keeps failing to connect has its circuit breaker opened
+ *                  and its URIs are held until a single probe is let through.
+ *
+ *        Version:  1.0
+ *        Created:  21/10/2026 19:48:20
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_POLITE_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef __AZZMOS_HOSTID_H__
+#include <azzmos/hostid.h>
+#endif
+#ifndef __AZZMOS_TWHEEL_H__
+#include <azzmos/twheel.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define PL_TICK_MS       10     /* resolution of the wheel in milliseconds */
+#define PL_DELAY_MS      1000   /* default time between requests to a host */
+#define PL_MAX_ACTIVE    1      /* default requests in flight per host */
+#define PL_HOST_BUCKETS  4096   /* hash buckets for the host table */
+#define PL_IP_DELAY_MS   250    /* default time between requests to a IP group */
+#define PL_IP_MAX        4      /* default requests in flight per IP group */
+#define PL_IP_BUCKETS    1024   /* hash buckets for the IP group table */
+#define PL_IP_KEY_MAX    (INET6_ADDRSTRLEN + 5)
+#define PL_MAGIC         "AZHOST01" /* first bytes of saved host state */
+
+/*****************************************************************************************
+ * Adaptive concurrency.  The window grows by PL_AIMD_INC each window's worth of good
+ * responses and is multiplied by PL_AIMD_DEC at most once per round trip on overload.
+ * Latency is overload once the smoothed latency is PL_AIMD_RISE times the lowest
+ * seen,  errors once more than PL_AIMD_ERRATE of the recent responses failed.
+ *****************************************************************************************/
+#define PL_AIMD_INC      1.0
+#define PL_AIMD_DEC      0.5
+#define PL_AIMD_RISE     2.0
+#define PL_AIMD_ERRATE   0.2
+#define PL_AIMD_GAIN     8      /* weight of a new sample is 1 / PL_AIMD_GAIN */
+#define PL_AIMD_DRIFT    64     /* the lowest latency drifts up by 1 / PL_AIMD_DRIFT */
+
+/*****************************************************************************************
+ * Status passed to pl_finish when there is no HTTP status.
+ *****************************************************************************************/
+#define PL_S_NONE     0     /* no feedback,  what pl_done passes */
+#define PL_S_TIMEOUT  -1    /* the request timed out */
+#define PL_S_FAILED   -2    /* the connection or transfer failed */
+#define PL_S_RESOLVE  -3    /* uri_resolve could not resolve the host */
+
+/*****************************************************************************************
+ * Circuit breaker.  PL_CB_FAILS failures in a row open it for PL_CB_COOLDOWN_MS,  the
+ * cooldown doubling up to PL_CB_COOLDOWN_MAX each time the probe after it fails.
+ *****************************************************************************************/
+#define PL_CB_FAILS         5
+#define PL_CB_COOLDOWN_MS   30000
+#define PL_CB_COOLDOWN_MAX  1800000
+
+#define PL_CB_CLOSED  0   /* requests flow normally */
+#define PL_CB_OPEN    1   /* URIs are held until ph_open */
+#define PL_CB_HALF    2   /* one probe request may be in flight */
+
+/*****************************************************************************************
+ * A host is in exactly one of these states.
+ *****************************************************************************************/
+#define PL_IDLE   0   /* no URIs queued */
+#define PL_WAIT   1   /* URIs queued,  waiting in the wheel for its next allowed time */
+#define PL_READY  2   /* on the ready list */
+#define PL_BUSY   3   /* URIs queued but at its concurrency cap */
+#define PL_IPWAIT 4   /* URIs queued but its IP group is at its cap */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct pl_ipgrp_s {
+	char             pg_key[PL_IP_KEY_MAX]; /* masked address and prefix length */
+	int              pg_active;  /* requests in flight to hosts in the group */
+	uint64_t         pg_next;    /* next allowed start, milliseconds */
+	struct list_head pg_hosts;   /* hosts waiting for the group's cap */
+	struct list_head pg_hash;    /* IP group table bucket */
+} typedef pl_ipgrp_t;
+
+struct pl_host_s {
+	uint32_t         ph_id;      /* interned host id,  the table key */
+	const char      *ph_key;     /* interned host name or IP literal */
+	int              ph_state;   /* PL_ state */
+	int              ph_active;  /* requests in flight */
+	int              ph_max;     /* concurrency cap */
+	long             ph_delay;   /* milliseconds between request starts */
+	uint64_t         ph_next;    /* next allowed start, milliseconds */
+	long             ph_queued;  /* URIs waiting on ph_urls */
+	pl_ipgrp_t      *ph_ip;      /* IP group, NULL until the host has been resolved */
+	double           ph_window;  /* adaptive concurrency,  never above ph_max */
+	double           ph_srtt;    /* smoothed latency,  milliseconds */
+	double           ph_minrtt;  /* lowest latency seen,  slowly drifting up */
+	double           ph_errate;  /* smoothed share of failed responses */
+	uint64_t         ph_cut;     /* the window is not cut again before this */
+	int              ph_breaker; /* PL_CB_ state */
+	int              ph_fails;   /* connect failures and timeouts in a row */
+	long             ph_cooldown;/* milliseconds the breaker was last opened for */
+	uint64_t         ph_open;    /* the breaker lets a probe through from this time */
+	struct list_head ph_urls;    /* queued URIs */
+	struct list_head ph_ready;   /* ready list or IP group wait list */
+	struct list_head ph_hash;    /* host table bucket */
+	tw_timer_t       ph_timer;   /* release timer */
+} typedef pl_host_t;
+
+struct pl_url_s {
+	uriobj_t        *pu_uri;     /* URI to fetch */
+	void            *pu_data;    /* caller data */
+	pl_host_t       *pu_host;    /* host the URI is queued on */
+	pl_ipgrp_t      *pu_ip;      /* IP group charged by pl_pop,  NULL if none */
+	struct list_head pu_list;    /* host queue */
+} typedef pl_url_t;
+
+/*****************************************************************************************
+ * Saved host state,  a header,  ps_count records and the host names they point at.
+ * Times are saved as milliseconds from the save as the clock does not survive a
+ * restart.  ps_size is the whole file so a truncated file is not loaded.
+ *****************************************************************************************/
+struct pl_shead_s {
+	char             ps_magic[8];   /* PL_MAGIC */
+	uint64_t         ps_count;      /* records */
+	uint64_t         ps_names;      /* offset of the names */
+	uint64_t         ps_size;       /* bytes in the file */
+} typedef pl_shead_t;
+
+struct pl_srec_s {
+	uint64_t         pr_name;       /* offset of the name from ps_names */
+	uint32_t         pr_len;        /* length of the name */
+	int32_t          pr_max;
+	int64_t          pr_delay;
+	uint64_t         pr_wait;       /* until ph_next */
+	double           pr_window;
+	double           pr_srtt;
+	double           pr_minrtt;
+	double           pr_errate;
+	int32_t          pr_breaker;
+	int32_t          pr_fails;
+	int64_t          pr_cooldown;
+	uint64_t         pr_open;       /* until ph_open */
+	char             pr_ip[PL_IP_KEY_MAX + 1]; /* IP group key,  empty for none */
+} typedef pl_srec_t;
+
+struct polite_s {
+	pthread_mutex_t  pl_lock;                        /* protects everything below */
+	pthread_cond_t   pl_cond;                        /* signalled when a host is ready */
+	twheel_t         pl_wheel;                       /* release timers, in ticks */
+	long             pl_delay;                       /* default ph_delay */
+	int              pl_max;                         /* default ph_max */
+	int              pl_hosts;                       /* hosts in the table */
+	int              pl_ip4bits;                     /* IPv4 prefix length grouped on */
+	int              pl_ip6bits;                     /* IPv6 prefix length grouped on */
+	long             pl_ip_delay;                    /* milliseconds between starts per group */
+	int              pl_ip_max;                      /* requests in flight per group */
+	bool             pl_adaptive;                    /* hosts are capped by ph_window */
+	long             pl_queued;                      /* URIs queued on all hosts */
+	bool             pl_closed;                      /* waiters should give up */
+	struct list_head pl_ready;                       /* hosts that may start a request */
+	struct list_head pl_table[PL_HOST_BUCKETS];      /* host table */
+	struct list_head pl_iptable[PL_IP_BUCKETS];      /* IP group table */
+} typedef polite_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int       pl_init( polite_t *pl, long delay, int max);
+extern int       pl_push( polite_t *pl, uriobj_t *uri, void *data);
+extern int       pl_pop( polite_t *pl, bool wait, pl_url_t **url);
+extern void      pl_done( polite_t *pl, pl_url_t *url);
+extern void      pl_finish( polite_t *pl, pl_url_t *url, long status, long latency);
+extern int       pl_set_host( polite_t *pl, const char *host, long delay, int max);
+extern void      pl_set_ipgroup( polite_t *pl, int ip4bits, int ip6bits, long delay, int max);
+extern void      pl_set_adaptive( polite_t *pl, int max);
+extern void      pl_close( polite_t *pl);
+extern int       pl_save( polite_t *pl, const char *path);
+extern int       pl_load( polite_t *pl, const char *path);
+extern void      pl_destroy( polite_t *pl);
+extern uint64_t  pl_now( void);
@@ -0,0 +1,105 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  robots.h
+ *
+ *    Description:  robots.txt rules and the per host cache of them.  The rules that
+ *                  apply to our user agent are compiled into a trie of path patterns
+ *                  so checking a URI is one walk over its normalized path.  Cache
+ *                  entries expire after a TTL and only one caller fetches a host's
+ *                  robots.txt at a time.
+ *
+ *        Version:  1.0
+ *        Created:  22/10/2026 20:14:37
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_ROBOTS_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef __AZZMOS_HOSTID_H__
+#include <azzmos/hostid.h>
+#endif
+#ifndef __AZZMOS_POLITE_H__
+#include <azzmos/polite.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define RB_TTL           86400     /* seconds a fetched robots.txt is kept */
+#define RB_ERROR_TTL     3600      /* seconds a failed fetch is kept */
+#define RB_FETCH_MS      60000     /* a fetch not stored by then is handed to another caller */
+#define RB_BODY_MAX      512000    /* bytes of robots.txt that are parsed */
+#define RB_DELAY_MAX     60000     /* longest Crawl-delay honoured, milliseconds */
+#define RB_ACTIVE_MAX    64        /* trie nodes tracked at once while matching */
+#define RB_BUCKETS       4096      /* hash buckets for the cache */
+
+/*****************************************************************************************
+ * Rule kinds,  a allow beats a disallow of the same length.
+ *****************************************************************************************/
+#define RB_NONE      0
+#define RB_DISALLOW  1
+#define RB_ALLOW     2
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct rb_node_s {
+	int           rn_child;   /* first child,  0 for none */
+	int           rn_next;    /* next sibling,  0 for none */
+	unsigned char rn_ch;      /* byte on the edge into the node,  '*' matches any run */
+	char          rn_rule;    /* RB_ kind of a pattern ending here */
+	char          rn_erule;   /* RB_ kind of a pattern ending here with $ */
+	int           rn_len;     /* length of the pattern for rn_rule */
+	int           rn_elen;    /* length of the pattern for rn_erule */
+} typedef rb_node_t;
+
+struct rb_rules_s {
+	rb_node_t    *rr_nodes;   /* node 0 is the root */
+	int           rr_count;   /* nodes in use */
+	int           rr_size;    /* nodes allocated */
+	int           rr_rules;   /* patterns compiled */
+	long          rr_delay;   /* Crawl-delay in milliseconds,  -1 if not given */
+} typedef rb_rules_t;
+
+struct rb_entry_s {
+	uint32_t         re_id;       /* interned host id,  the cache key */
+	const char      *re_key;      /* interned host name or IP literal */
+	bool             re_ready;    /* re_rules hold a fetched robots.txt */
+	bool             re_fetching; /* a caller has been told to fetch it */
+	uint64_t         re_started;  /* pl_now() when that caller was told */
+	time_t           re_expires;  /* when re_rules should be fetched again */
+	rb_rules_t       re_rules;    /* compiled rules */
+	struct list_head re_hash;     /* cache bucket */
+} typedef rb_entry_t;
+
+struct robots_s {
+	pthread_mutex_t  rc_lock;                 /* protects everything below */
+	pthread_cond_t   rc_cond;                 /* signalled when a fetch is stored */
+	char            *rc_agent;                /* product token we obey rules for */
+	long             rc_ttl;                  /* seconds a fetched robots.txt is kept */
+	polite_t        *rc_pl;                   /* Crawl-delay is passed on to this */
+	int              rc_entries;              /* hosts in the cache */
+	struct list_head rc_table[RB_BUCKETS];    /* the cache */
+} typedef robots_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int   rb_rules_init( rb_rules_t *rr);
+extern int   rb_rules_parse( rb_rules_t *rr, const char *agent, const char *text, size_t len);
+extern int   rb_rules_add( rb_rules_t *rr, int kind, const char *pattern, size_t len);
+extern bool  rb_rules_match( rb_rules_t *rr, const char *path, const char *query);
+extern void  rb_rules_free( rb_rules_t *rr);
+extern int   rb_init( robots_t *rc, const char *agent, long ttl, polite_t *pl);
+extern int   rb_check( robots_t *rc, uriobj_t *uri, bool wait, bool *allowed);
+extern int   rb_store( robots_t *rc, const char *host, long status, const char *body, size_t len);
+extern char *rb_url( uriobj_t *uri);
+extern int   rb_expire( robots_t *rc);
+extern void  rb_destroy( robots_t *rc);
@@ -0,0 +1,74 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  seen.h
+ *
+ *    Description:  The URL seen set.  Normalized URIs are reduced to a 64 bit
+ *                  fingerprint and kept in a blocked Bloom filter,  every key's bits
+ *                  are in one 64 byte block so a test or insert touches one cache
+ *                  line.  Inserts are a atomic OR of each word so any number of
+ *                  threads may insert and test without a lock.  The filter can be
+ *                  saved to a file and mapped back in on restart.
+ *
+ *        Version:  1.0
+ *        Created:  24/10/2026 19:36:12
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_SEEN_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define SN_BLOCK_WORDS  8            /* 64 bit words in a block,  one cache line */
+#define SN_BLOCK_BITS   (SN_BLOCK_WORDS * 64)
+#define SN_K_MAX        16           /* most bits set per key */
+#define SN_FP_RATE      0.01         /* default false positive rate */
+#define SN_MAGIC        "AZSEEN01"   /* first bytes of a saved filter */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * Start of a saved filter,  the blocks follow it.  sh_size is the whole file so a
+ * truncated file is not loaded.  The header is one block long.
+ *****************************************************************************************/
+struct sn_header_s {
+	char     sh_magic[8];   /* SN_MAGIC */
+	uint64_t sh_blocks;     /* blocks in the filter */
+	uint64_t sh_k;          /* bits set per key */
+	uint64_t sh_count;      /* keys inserted */
+	uint64_t sh_size;       /* bytes in the file */
+	char     sh_pad[24];    /* keeps the blocks on a cache line boundary */
+} typedef sn_header_t;
+
+struct seen_s {
+	uint64_t *sn_bits;      /* sn_blocks * SN_BLOCK_WORDS words */
+	uint64_t  sn_blocks;    /* blocks in the filter */
+	int       sn_k;         /* bits set per key */
+	uint64_t  sn_count;     /* keys inserted,  updated atomically */
+	void     *sn_map;       /* mapping sn_bits lives in */
+	size_t    sn_maplen;    /* length of sn_map */
+} typedef seen_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int       sn_init( seen_t *sn, uint64_t n, double rate);
+extern bool      sn_insert( seen_t *sn, uint64_t fp);
+extern bool      sn_test( seen_t *sn, uint64_t fp);
+extern uint64_t  sn_fingerprint( uriobj_t *uri);
+extern int       sn_save( seen_t *sn, const char *path);
+extern int       sn_load( seen_t *sn, const char *path);
+extern void      sn_free( seen_t *sn);
@@ -0,0 +1,102 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  segq.h
+ *
+ *    Description:  Disk backed queues for the frontier.  Each queue,  normally one per
+ *                  host,  keeps a head it is read from and a tail it is appended to in
+ *                  memory.  When a tail fills,  or the memory budget is exceeded,  it
+ *                  is written as one page to the end of a shared append only segment
+ *                  file and the queue remembers where.  The page is mapped back in
+ *                  when the head reaches it.  Segments whose pages have all been read
+ *                  are truncated and reused,  so the only I/O is a append of a page
+ *                  or a read of one.
+ *
+ *        Version:  1.0
+ *        Created:  25/10/2026 19:14:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_SEGQ_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define SQ_PAGE_SIZE     65536               /* largest page spilled from a tail */
+#define SQ_RECORD_MAX    (SQ_PAGE_SIZE - 8)  /* largest record,  less its length */
+#define SQ_TAIL_MIN      1024                /* bytes first allocated for a tail */
+#define SQ_SEG_SIZE      (64 * 1024 * 1024)  /* default segment file size */
+#define SQ_BUDGET        (256 * 1024 * 1024) /* default memory budget */
+
+/*****************************************************************************************
+ * First byte of a serialized URI.  The authority is only stored when it is not the
+ * queue's key.
+ *****************************************************************************************/
+#define SQ_HTTPS   0x01
+#define SQ_AUTH    0x02
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct sq_seg_s {
+	int              ss_id;      /* segment file is <dir>/seg.<id> */
+	int              ss_fd;      /* open for reading and writing */
+	off_t            ss_size;    /* bytes appended */
+	long             ss_live;    /* pages not yet read */
+	struct list_head ss_free;    /* segments that can be reused */
+} typedef sq_seg_t;
+
+struct sq_page_s {
+	sq_seg_t        *sp_seg;     /* segment the page is in */
+	off_t            sp_off;     /* offset of the page in the segment */
+	size_t           sp_len;     /* bytes in the page */
+	struct list_head sp_list;    /* queue's pages in order */
+} typedef sq_page_t;
+
+struct sq_queue_s {
+	char            *sq_key;     /* host the queue is for */
+	long             sq_count;   /* records in the queue */
+	char            *sq_head;    /* records being read */
+	size_t           sq_hlen;    /* bytes in sq_head */
+	size_t           sq_hpos;    /* next record in sq_head */
+	void            *sq_hmap;    /* mapping of sq_head,  NULL if it was a tail */
+	size_t           sq_hsize;   /* bytes sq_head holds in memory */
+	sq_page_t       *sq_hpage;   /* page sq_head is mapped from */
+	char            *sq_tail;    /* records being appended */
+	size_t           sq_tlen;    /* bytes in sq_tail */
+	size_t           sq_tsize;   /* bytes allocated for sq_tail */
+	struct list_head sq_pages;   /* pages written to segments,  oldest first */
+	struct list_head sq_lru;     /* queues with a tail,  least recently pushed first */
+} typedef sq_queue_t;
+
+struct segq_s {
+	char            *sq_dir;     /* directory the segments are in */
+	off_t            sq_seg_size;/* a segment is full at this size */
+	size_t           sq_budget;  /* bytes of heads and tails kept in memory */
+	size_t           sq_mem;     /* bytes of heads and tails in memory */
+	sq_seg_t       **sq_segs;    /* every segment,  by ss_id */
+	int              sq_nsegs;   /* segments created */
+	sq_seg_t        *sq_cur;     /* segment being appended to */
+	long             sq_spills;  /* pages written */
+	struct list_head sq_free;    /* empty segments */
+	struct list_head sq_tails;   /* queues with a tail,  least recently pushed first */
+} typedef segq_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  sq_init( segq_t *sq, const char *dir, off_t seg_size, size_t budget);
+extern int  sq_queue_init( sq_queue_t *q, const char *key);
+extern int  sq_push( segq_t *sq, sq_queue_t *q, const void *data, size_t len);
+extern int  sq_pop( segq_t *sq, sq_queue_t *q, const char **data, size_t *len);
+extern int  sq_push_uri( segq_t *sq, sq_queue_t *q, uriobj_t *uri);
+extern int  sq_pop_uri( segq_t *sq, sq_queue_t *q, char **url);
+extern void sq_queue_free( segq_t *sq, sq_queue_t *q);
+extern void sq_destroy( segq_t *sq);
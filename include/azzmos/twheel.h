@@ -0,0 +1,54 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  twheel.h
+ *
+ *    Description:  Hierarchical timer wheel.  Timers are embedded in the structure
+ *                  that owns them,  the same way list_head is,  and are released in
+ *                  O(1) amortized time as the wheel is advanced.
+ *
+ *        Version:  1.0
+ *        Created:  21/10/2026 19:05:51
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_TWHEEL_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define TW_BITS    6                     /* slots per level are 1 << TW_BITS */
+#define TW_SIZE    (1 << TW_BITS)
+#define TW_MASK    (TW_SIZE - 1)
+#define TW_LEVELS  4                     /* the wheel spans TW_SIZE ^ TW_LEVELS ticks */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct tw_timer_s {
+	uint64_t         tt_expires;  /* tick the timer expires on */
+	struct list_head tt_list;     /* wheel slot, empty when the timer is not pending */
+} typedef tw_timer_t;
+
+struct twheel_s {
+	uint64_t         tw_now;                        /* next tick to be processed */
+	long             tw_count;                      /* pending timers */
+	struct list_head tw_slots[TW_LEVELS][TW_SIZE];  /* the wheel */
+} typedef twheel_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern void tw_init( twheel_t *tw, uint64_t now);
+extern void tw_timer_init( tw_timer_t *timer);
+extern void tw_add( twheel_t *tw, tw_timer_t *timer, uint64_t expires);
+extern void tw_del( twheel_t *tw, tw_timer_t *timer);
+extern bool tw_pending( tw_timer_t *timer);
+extern int  tw_advance( twheel_t *tw, uint64_t now, struct list_head *expired);
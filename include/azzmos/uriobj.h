@@ -50,7 +50,9 @@ struct uriobj_s {
 	char **uri_port;            /* uri port number */
 	char **uri_ip;              /* IP address */
 	time_t uri_mdate;           /* time that URI was last modified */
+	char **uri_etag;            /* entity tag returned with the last fetch */
 	long   uri_flags;           /* various flags for the uri */
+	uint32_t uri_hostid;        /* interned host,  0 until normalized or hi_uri */
 	struct addrinfo **uri_addr; /* list of the URI resolved addresses */
 } typedef uriobj_t;
 
@@ -60,6 +62,8 @@ extern char *shift_segment( char **path, const int offset);
 extern char *get_next_segment( char **path);
 extern char *replace_prefix( char **path);
 extern void  init_uriobj_str( uriobj_t *uri);
+extern void  free_uriobj( uriobj_t *uri);
+extern size_t uri_url_str( uriobj_t *uri, char *buf);
 extern char *uri_strcpy( char **s1, const char *s2);
 extern char *uri_strcat( char *s1, const char *format, const char *s2);
 
@@ -0,0 +1,154 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  urlrun.h
+ *
+ *    Description:  The exact seen store.  Canonical URLs are kept on disk in runs,
+ *                  files of sorted blocks in which each URL is front coded against the
+ *                  one before it and every block is compressed with zlib.  A open run
+ *                  keeps only the first URL of each block in memory and maps the file,
+ *                  so a lookup is a binary search of that index and one block to
+ *                  inflate,  and a bloom filter per run turns away most misses before
+ *                  the search.  New URLs collect in a in memory table until it is full,
+ *                  are written out as a new run and runs of a similar size are merged,
+ *                  so a store holds a few runs whatever its size.
+ *
+ *        Version:  1.0
+ *        Created:  31/10/2026 18:47:03
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_URLRUN_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define UR_MAGIC       "AZRUN002"            /* first and last bytes of a run */
+#define UR_BLOCK       16384                 /* front coded bytes per block before it is compressed */
+#define UR_BUDGET      (64 * 1024 * 1024)    /* default bytes of URLs held in memory */
+#define UR_RATIO       2                     /* runs are merged while the older is at most this times larger */
+#define UR_RUNS_MAX    64                    /* most runs in a store */
+#define UR_BLOOM_BITS  10                    /* bloom filter bits per URL in a run */
+#define UR_BLOOM_K     7                     /* bits set and tested per URL */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * The last bytes of a run.  The blocks follow a 8 byte copy of UR_MAGIC,  the index
+ * follows the blocks: for each block its offset,  compressed and inflated lengths as
+ * 64,  32 and 32 bits and its first URL as a 32 bit length and the bytes.  A bloom
+ * filter of the run's URLs follows the index,  8 byte aligned.
+ *****************************************************************************************/
+struct ur_footer_s {
+	uint64_t         uf_index;    /* offset of the index */
+	uint64_t         uf_blocks;   /* blocks in the run */
+	uint64_t         uf_count;    /* URLs in the run */
+	uint64_t         uf_rmax;     /* largest inflated block */
+	uint64_t         uf_bloom;    /* offset of the bloom filter */
+	uint64_t         uf_bwords;   /* 64 bit words in the bloom filter */
+	char             uf_magic[8]; /* UR_MAGIC */
+} typedef ur_footer_t;
+
+struct ur_index_s {
+	uint64_t         ui_offset;   /* where the compressed block starts */
+	uint32_t         ui_clen;     /* compressed length */
+	uint32_t         ui_rlen;     /* inflated length */
+	const char      *ui_key;      /* first URL of the block,  in ur_keys */
+	uint32_t         ui_klen;
+} typedef ur_index_t;
+
+struct ur_run_s {
+	char            *ur_path;
+	void            *ur_map;      /* the file,  read only */
+	size_t           ur_maplen;
+	uint64_t         ur_count;    /* URLs in the run */
+	uint64_t         ur_blocks;
+	uint64_t         ur_rmax;     /* largest inflated block */
+	ur_index_t      *ur_index;    /* one per block */
+	char            *ur_keys;     /* the first URLs */
+	const uint64_t  *ur_bloom;    /* the bloom filter,  in the map */
+	uint64_t         ur_bbits;    /* bits in it */
+	pthread_mutex_t  ur_lock;     /* protects ur_buf and ur_cached */
+	char            *ur_buf;      /* the last block inflated */
+	int64_t          ur_cached;   /* which block that is,  -1 for none */
+} typedef ur_run_t;
+
+struct ur_writer_s {
+	char            *uw_path;     /* the run being written */
+	char            *uw_tmp;      /* written here and renamed over uw_path */
+	int              uw_fd;
+	uint64_t         uw_offset;   /* bytes written */
+	uint64_t         uw_count;    /* URLs added */
+	uint64_t         uw_rmax;
+	char            *uw_raw;      /* front coded block being built */
+	size_t           uw_rlen;
+	size_t           uw_rsize;
+	char            *uw_zbuf;     /* compressed block */
+	size_t           uw_zsize;
+	char            *uw_last;     /* last URL added */
+	size_t           uw_lastlen;
+	size_t           uw_lastsize;
+	char            *uw_index;    /* index written after the blocks */
+	size_t           uw_ilen;
+	size_t           uw_isize;
+	uint64_t         uw_blocks;
+	uint64_t        *uw_hash;     /* mem_hash64 of each URL added,  for the bloom filter */
+	size_t           uw_hsize;    /* bytes allocated for uw_hash */
+} typedef ur_writer_t;
+
+struct ur_iter_s {
+	ur_run_t        *it_run;
+	uint64_t         it_block;    /* next block to inflate */
+	char            *it_raw;      /* current block inflated */
+	size_t           it_rlen;
+	size_t           it_pos;      /* next entry in it_raw */
+	char            *it_key;      /* current URL */
+	size_t           it_klen;
+	size_t           it_ksize;
+} typedef ur_iter_t;
+
+struct ur_store_s {
+	pthread_mutex_t  us_lock;                 /* protects everything below */
+	pthread_cond_t   us_merged;               /* signalled when a compaction ends */
+	bool             us_compacting;           /* a merge is running outside us_lock */
+	char            *us_dir;                  /* the runs are run.N in here */
+	uint64_t         us_seq;                  /* N of the next run written */
+	ur_run_t        *us_runs[UR_RUNS_MAX];    /* newest first */
+	int              us_nruns;
+	size_t           us_budget;               /* memtable bytes that force a flush */
+	char            *us_mem;                  /* memtable URLs,  a varint length and bytes */
+	size_t           us_memlen;
+	size_t           us_memsize;
+	size_t          *us_slots;                /* offset + 1 of each memtable URL,  0 for none */
+	size_t           us_nslots;
+	size_t           us_nmem;                 /* URLs in the memtable */
+} typedef ur_store_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int   ur_write_open( ur_writer_t *uw, const char *path);
+extern int   ur_write_add( ur_writer_t *uw, const char *url, size_t len);
+extern int   ur_write_close( ur_writer_t *uw);
+extern void  ur_write_abort( ur_writer_t *uw);
+extern int   ur_open( ur_run_t *run, const char *path);
+extern int   ur_contains( ur_run_t *run, const char *url, size_t len);
+extern void  ur_close( ur_run_t *run);
+extern int   ur_iter_init( ur_iter_t *it, ur_run_t *run);
+extern int   ur_iter_next( ur_iter_t *it, const char **url, size_t *len);
+extern void  ur_iter_free( ur_iter_t *it);
+extern int   ur_merge( ur_run_t **runs, int n, const char *path);
+extern int   ur_store_open( ur_store_t *us, const char *dir, size_t budget);
+extern int   ur_store_insert( ur_store_t *us, const char *url, size_t len);
+extern int   ur_store_contains( ur_store_t *us, const char *url, size_t len);
+extern int   ur_store_flush( ur_store_t *us);
+extern int   ur_store_close( ur_store_t *us);
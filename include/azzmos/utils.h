@@ -22,12 +22,23 @@
 #ifndef __AZZMOS_COMMON_H__
 #include <azzmos/common.h>
 #endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+#ifndef _SYS_UIO_H
+#include <sys/uio.h>
+#endif
 
 /* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
 char * usplice( const char *in, unsigned int start, unsigned int end);
 char * _macitoa_( int num );
 extern void _syslog_print_error( unsigned int tid, char *fname, int lineno, char *m1, char *m2, int pri );
 inline void  reset_file ( FILE *fh );
+extern unsigned int str_hash( const char *s);
+extern uint64_t     mem_hash64( const void *p, size_t len);
+extern int          write_all( int fd, const void *p, size_t len);
+extern int          file_replace( const char *path, const struct iovec *iov, int n);
+extern char        *put_netorder( char *p, uint64_t v, int bytes);
 
 
 /* #####   EXPORTED MACROS   ######################################################## */
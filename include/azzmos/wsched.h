@@ -0,0 +1,94 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  wsched.h
+ *
+ *    Description:  Work stealing scheduler for the crawler's worker threads.  Each
+ *                  worker runs tasks from its own Chase-Lev deque,  newest first,  and
+ *                  when that is empty steals the oldest task of a randomly chosen
+ *                  worker,  so a page that yields thousands of links spreads them
+ *                  across every core.  Tasks spawned from outside the workers go
+ *                  through a shared MPMC queue.  Workers with nothing to do park until
+ *                  a task is spawned.
+ *
+ *        Version:  1.0
+ *        Created:  28/10/2026 19:12:40
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_WSCHED_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_MPMC_H__
+#include <azzmos/mpmc.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define WS_DEQUE_MIN   256     /* tasks a deque starts with room for */
+#define WS_INJECT      4096    /* tasks the queue from outside the workers holds */
+#define WS_STEALS      4       /* rounds of steal attempts over all workers before parking */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * A task is embedded in the caller's own structure,  as a list_head is,  and wt_fn gets
+ * the structure back with list_entry.  It must stay valid until wt_fn has been called.
+ *****************************************************************************************/
+struct ws_task_s;
+typedef void (*ws_fn_t)( struct ws_task_s *task);
+
+struct ws_task_s {
+	ws_fn_t          wt_fn;      /* run on a worker thread */
+} typedef ws_task_t;
+
+struct ws_array_s {
+	int64_t           wa_size;   /* slots,  a power of two */
+	struct ws_array_s *wa_prev;  /* array this one replaced,  freed with the deque */
+	ws_task_t        *wa_tasks[];
+} typedef ws_array_t;
+
+struct ws_deque_s {
+	int64_t          wd_top;     /* oldest task,  moved by thieves */
+	char             wd_pad0[MQ_CACHELINE - sizeof(int64_t)];
+	int64_t          wd_bottom;  /* one past the newest task,  moved by the owner */
+	char             wd_pad1[MQ_CACHELINE - sizeof(int64_t)];
+	ws_array_t      *wd_array;   /* current array */
+} typedef ws_deque_t;
+
+struct wsched_s;
+
+struct ws_worker_s {
+	struct wsched_s *ww_sched;   /* scheduler the worker belongs to */
+	int              ww_id;      /* index in ws_workers */
+	unsigned         ww_seed;    /* picks steal victims */
+	pthread_t        ww_thread;
+	ws_deque_t       ww_deque;   /* tasks spawned on this worker */
+} typedef ws_worker_t;
+
+struct wsched_s {
+	ws_worker_t     *ws_workers; /* one per thread */
+	int              ws_nworkers;
+	mpmc_t           ws_inject;  /* tasks spawned from outside the workers */
+	pthread_mutex_t  ws_lock;    /* parking */
+	pthread_cond_t   ws_cond;    /* signalled when a task is spawned */
+	pthread_cond_t   ws_idle;    /* broadcast when ws_pending reaches zero */
+	int              ws_sleepers;/* workers parked */
+	long             ws_pending; /* tasks spawned and not yet finished */
+	int              ws_stop;    /* workers should exit */
+} typedef wsched_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  ws_init( wsched_t *ws, int workers);
+extern void ws_task_init( ws_task_t *task, ws_fn_t fn);
+extern int  ws_spawn( wsched_t *ws, ws_task_t *task);
+extern void ws_wait( wsched_t *ws);
+extern int  ws_worker( wsched_t *ws);
+extern void ws_destroy( wsched_t *ws);
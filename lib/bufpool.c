@@ -0,0 +1,522 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bufpool.c
+ *
+ *    Description:  Buffer chunk pool.  A thread takes and returns chunks through its
+ *                  own free list without locking,  only when that list is empty or
+ *                  full are chunks moved in batches to or from the global list.  Once
+ *                  the memory cap is reached the chunks idle on every thread's list
+ *                  are taken back,  then callers either wait for a chunk to be
+ *                  returned or are told to back off with EAGAIN.  A thread's list is
+ *                  a stack it pushes and pops with compare and swap and others only
+ *                  ever empty in one exchange,  and while anyone waits chunks are put
+ *                  straight back on the global list.
+ *
+ *        Version:  1.0
+ *        Created:  20/10/2026 19:32:10
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/bufpool.h>
+#include <limits.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define BP_ALL  INT_MAX   /* bp_give count for the whole of a thread's list */
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct bp_tcache_s {
+	bufpool_t       *tc_pool;   /* pool the chunks belong to */
+	bp_chunk_t      *tc_head;   /* thread free list */
+	int              tc_count;  /* chunks on tc_head,  briefly behind a steal */
+	struct list_head tc_list;   /* bp_caches */
+} typedef bp_tcache_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static bp_tcache_t *bp_tcache( bufpool_t *bp);
+static void         bp_tcache_free( void *data);
+static void         bp_give( bufpool_t *bp, bp_tcache_t *tc, int count);
+static bp_chunk_t  *bp_tc_pop( bp_tcache_t *tc);
+static void         bp_tc_push( bp_tcache_t *tc, bp_chunk_t *chunk);
+static bool         bp_steal( bufpool_t *bp);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_init
+ *  Description:  Initilize a pool of size byte chunks that will never hold more than
+ *                cap bytes.  If size is zero BP_CHUNK_SIZE is used.  Returns 0 or a
+ *                errno value.
+ * =====================================================================================
+ */
+extern int
+bp_init( bufpool_t *bp, size_t size, size_t cap)
+{
+	int err = 0;
+	bzero(bp, sizeof(bufpool_t));
+	if( ! size ) {
+		size = BP_CHUNK_SIZE;
+	}
+	bp->bp_size = size;
+	bp->bp_max  = cap / size;
+	INIT_LIST_HEAD(&bp->bp_caches);
+	if( ! bp->bp_max ) {
+		bp->bp_max = 1;
+	}
+	if( (err = pthread_mutex_init(&bp->bp_lock, NULL)) ) {
+		return err;
+	}
+	if( (err = pthread_cond_init(&bp->bp_cond, NULL)) ) {
+		pthread_mutex_destroy(&bp->bp_lock);
+		return err;
+	}
+	if( (err = pthread_key_create(&bp->bp_key, bp_tcache_free)) ) {
+		pthread_cond_destroy(&bp->bp_cond);
+		pthread_mutex_destroy(&bp->bp_lock);
+	}
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_get
+ *  Description:  Take a empty chunk from the pool.  If the pool is at its cap and wait
+ *                is true the call blocks until a chunk is returned,  otherwise NULL is
+ *                returned with errno set to EAGAIN.  NULL with ENOMEM means malloc
+ *                failed.
+ * =====================================================================================
+ */
+extern bp_chunk_t *
+bp_get( bufpool_t *bp, bool wait)
+{
+	bp_tcache_t *tc = bp_tcache(bp);
+	bp_chunk_t  *chunk = NULL;
+	bool         waited = false;
+	int          n;
+	if( tc && (chunk = bp_tc_pop(tc)) ) {
+		chunk->bc_next = NULL;
+		chunk->bc_len  = 0;
+		return chunk;
+	}
+	pthread_mutex_lock(&bp->bp_lock);
+	for(;;) {
+		if( bp->bp_free ) {
+			chunk = bp->bp_free;
+			bp->bp_free = chunk->bc_next;
+			bp->bp_nfree --;
+			/* refill the thread list while the lock is held,  unless others wait */
+			for(n = 1; tc && ! bp->bp_nwait && bp->bp_free && n < BP_BATCH; n ++){
+				bp_chunk_t *c = bp->bp_free;
+				bp->bp_free = c->bc_next;
+				bp->bp_nfree --;
+				bp_tc_push(tc, c);
+			}
+			break;
+		}
+		if( bp->bp_alloc < bp->bp_max ) {
+			bp->bp_alloc ++;
+			pthread_mutex_unlock(&bp->bp_lock);
+			chunk = (bp_chunk_t *) malloc(sizeof(bp_chunk_t) + bp->bp_size);
+			if( ! chunk ) {
+				pthread_mutex_lock(&bp->bp_lock);
+				bp->bp_alloc --;
+				pthread_mutex_unlock(&bp->bp_lock);
+				errno = ENOMEM;
+				return NULL;
+			}
+			chunk->bc_next = NULL;
+			chunk->bc_len  = 0;
+			return chunk;
+		}
+		/* a put that misses bp_nwait pushed before the steal and is seen by it */
+		__atomic_add_fetch(&bp->bp_nwait, 1, __ATOMIC_SEQ_CST);
+		if( ! bp_steal(bp) ) {
+			if( ! waited ) {
+				bp->bp_waits ++;
+				waited = true;
+			}
+			if( ! wait ) {
+				__atomic_sub_fetch(&bp->bp_nwait, 1, __ATOMIC_SEQ_CST);
+				pthread_mutex_unlock(&bp->bp_lock);
+				errno = EAGAIN;
+				return NULL;
+			}
+			pthread_cond_wait(&bp->bp_cond, &bp->bp_lock);
+		}
+		__atomic_sub_fetch(&bp->bp_nwait, 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&bp->bp_lock);
+	chunk->bc_next = NULL;
+	chunk->bc_len  = 0;
+	return chunk;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_put
+ *  Description:  Return a chunk to the pool.  It goes on the calling thread's free
+ *                list,  if that is full a batch is handed back to the global list and
+ *                any waiters are woken.  While a caller waits for a chunk the whole
+ *                list is handed back.
+ * =====================================================================================
+ */
+extern void
+bp_put( bufpool_t *bp, bp_chunk_t *chunk)
+{
+	bp_tcache_t *tc = bp_tcache(bp);
+	if( ! tc ) {
+		pthread_mutex_lock(&bp->bp_lock);
+		chunk->bc_next = bp->bp_free;
+		bp->bp_free = chunk;
+		bp->bp_nfree ++;
+		pthread_cond_broadcast(&bp->bp_cond);
+		pthread_mutex_unlock(&bp->bp_lock);
+		return;
+	}
+	bp_tc_push(tc, chunk);
+	if( __atomic_load_n(&bp->bp_nwait, __ATOMIC_SEQ_CST) ) {
+		bp_give(bp, tc, BP_ALL);
+	}
+	else if( __atomic_load_n(&tc->tc_count, __ATOMIC_RELAXED) > BP_CACHE_MAX ) {
+		bp_give(bp, tc, BP_BATCH);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_avail
+ *  Description:  Can len bytes worth of chunks be taken from the pool without waiting.
+ *                Chunks idle on any thread's free list count as they can be taken
+ *                back.  This is only a hint,  other threads may take the chunks first.
+ * =====================================================================================
+ */
+extern bool
+bp_avail( bufpool_t *bp, size_t len)
+{
+	bp_tcache_t *tc;
+	size_t       need = (len + bp->bp_size - 1) / bp->bp_size,
+	             have;
+	int          n;
+	pthread_mutex_lock(&bp->bp_lock);
+	have = bp->bp_nfree + (bp->bp_max - bp->bp_alloc);
+	list_for_each_entry(tc, &bp->bp_caches, tc_list){
+		if( (n = __atomic_load_n(&tc->tc_count, __ATOMIC_RELAXED)) > 0 ) {
+			have += n;
+		}
+	}
+	pthread_mutex_unlock(&bp->bp_lock);
+	return have >= need;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_flush
+ *  Description:  Hand every chunk on the calling thread's free list back to the global
+ *                list.  Threads should call this before the pool is destroyed.
+ * =====================================================================================
+ */
+extern void
+bp_flush( bufpool_t *bp)
+{
+	bp_tcache_t *tc = (bp_tcache_t *) pthread_getspecific(bp->bp_key);
+	if( tc ) {
+		bp_give(bp, tc, BP_ALL);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_destroy
+ *  Description:  Release the pool.  Chunks on the free lists of other threads are
+ *                taken back,  those still held in chains are leaked as are the lists
+ *                of threads that have not exited.
+ * =====================================================================================
+ */
+extern void
+bp_destroy( bufpool_t *bp)
+{
+	bp_chunk_t  *chunk;
+	bp_tcache_t *tc = (bp_tcache_t *) pthread_getspecific(bp->bp_key);
+	pthread_mutex_lock(&bp->bp_lock);
+	bp_steal(bp);
+	if( tc ) {
+		list_del(&tc->tc_list);
+		pthread_setspecific(bp->bp_key, NULL);
+		free(tc);
+	}
+	pthread_mutex_unlock(&bp->bp_lock);
+	while( (chunk = bp->bp_free) ) {
+		bp->bp_free = chunk->bc_next;
+		free(chunk);
+	}
+	pthread_key_delete(bp->bp_key);
+	pthread_cond_destroy(&bp->bp_cond);
+	pthread_mutex_destroy(&bp->bp_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_chain_init
+ *  Description:  Initilize a empty chain.
+ * =====================================================================================
+ */
+extern void
+bp_chain_init( bp_chain_t *chain)
+{
+	chain->ch_head  = chain->ch_tail = NULL;
+	chain->ch_len   = 0;
+	chain->ch_count = 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_chain_write
+ *  Description:  Append len bytes to the chain.  Either all of buf is written or none
+ *                of it is,  the chunks needed are taken before anything is copied so
+ *                that a caller told EAGAIN can offer the same data again later.
+ * =====================================================================================
+ */
+extern int
+bp_chain_write( bufpool_t *bp, bp_chain_t *chain, const char *buf, size_t len, bool wait)
+{
+	bp_chunk_t *list = NULL,
+	           *chunk;
+	size_t      space = chain->ch_tail ? bp->bp_size - chain->ch_tail->bc_len : 0,
+	            need  = 0,
+	            n;
+	int         err = 0;
+	if( len > space ) {
+		need = (len - space + bp->bp_size - 1) / bp->bp_size;
+	}
+	for(n = 0; n < need; n ++){
+		if( ! (chunk = bp_get(bp, wait)) ) {
+			err = errno;
+			while( (chunk = list) ) {
+				list = chunk->bc_next;
+				bp_put(bp, chunk);
+			}
+			return err;
+		}
+		chunk->bc_next = list;
+		list = chunk;
+	}
+	while( len ) {
+		if( ! chain->ch_tail || chain->ch_tail->bc_len == bp->bp_size ) {
+			chunk = list;
+			list  = chunk->bc_next;
+			chunk->bc_next = NULL;
+			if( chain->ch_tail ) {
+				chain->ch_tail->bc_next = chunk;
+			}
+			else {
+				chain->ch_head = chunk;
+			}
+			chain->ch_tail = chunk;
+			chain->ch_count ++;
+		}
+		chunk = chain->ch_tail;
+		n = bp->bp_size - chunk->bc_len;
+		if( n > len ) {
+			n = len;
+		}
+		memcpy(chunk->bc_data + chunk->bc_len, buf, n);
+		chunk->bc_len += n;
+		chain->ch_len += n;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_chain_iov
+ *  Description:  Describe the chain in at most n iovec entries so it can be written
+ *                out with writev.  Returns the number of entries used.
+ * =====================================================================================
+ */
+extern int
+bp_chain_iov( bp_chain_t *chain, struct iovec *iov, int n)
+{
+	bp_chunk_t *chunk;
+	int         i = 0;
+	bp_chain_for_each(chunk, chain){
+		if( i == n ) {
+			break;
+		}
+		iov[i].iov_base = chunk->bc_data;
+		iov[i].iov_len  = chunk->bc_len;
+		i ++;
+	}
+	return i;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_chain_release
+ *  Description:  Return every chunk of the chain to the pool and empty the chain.
+ * =====================================================================================
+ */
+extern void
+bp_chain_release( bufpool_t *bp, bp_chain_t *chain)
+{
+	bp_chunk_t *chunk;
+	while( (chunk = chain->ch_head) ) {
+		chain->ch_head = chunk->bc_next;
+		bp_put(bp, chunk);
+	}
+	bp_chain_init(chain);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_tcache
+ *  Description:  Get the calling thread's free list,  creating it on first use.  NULL
+ *                is returned if it could not be created in which case the global list
+ *                is used directly.
+ * =====================================================================================
+ */
+static bp_tcache_t *
+bp_tcache( bufpool_t *bp)
+{
+	bp_tcache_t *tc = (bp_tcache_t *) pthread_getspecific(bp->bp_key);
+	if( tc ) {
+		return tc;
+	}
+	tc = (bp_tcache_t *) malloc(sizeof(bp_tcache_t));
+	if( ! tc ) {
+		return NULL;
+	}
+	tc->tc_pool  = bp;
+	tc->tc_head  = NULL;
+	tc->tc_count = 0;
+	if( pthread_setspecific(bp->bp_key, tc) ) {
+		free(tc);
+		return NULL;
+	}
+	pthread_mutex_lock(&bp->bp_lock);
+	list_add(&tc->tc_list, &bp->bp_caches);
+	pthread_mutex_unlock(&bp->bp_lock);
+	return tc;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_tcache_free
+ *  Description:  Thread exit destructor,  hand the thread's chunks back to the pool.
+ * =====================================================================================
+ */
+static void
+bp_tcache_free( void *data)
+{
+	bp_tcache_t *tc = (bp_tcache_t *) data;
+	bufpool_t   *bp = tc->tc_pool;
+	bp_give(bp, tc, BP_ALL);
+	pthread_mutex_lock(&bp->bp_lock);
+	list_del(&tc->tc_list);
+	pthread_mutex_unlock(&bp->bp_lock);
+	free(tc);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_give
+ *  Description:  Move count chunks from the thread's free list to the global list and
+ *                wake anyone waiting for them.
+ * =====================================================================================
+ */
+static void
+bp_give( bufpool_t *bp, bp_tcache_t *tc, int count)
+{
+	bp_chunk_t *chunk;
+	if( ! count ) {
+		return;
+	}
+	pthread_mutex_lock(&bp->bp_lock);
+	while( count -- && (chunk = bp_tc_pop(tc)) ) {
+		chunk->bc_next = bp->bp_free;
+		bp->bp_free = chunk;
+		bp->bp_nfree ++;
+	}
+	pthread_cond_broadcast(&bp->bp_cond);
+	pthread_mutex_unlock(&bp->bp_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_tc_pop
+ *  Description:  Pop a chunk from the thread's own free list,  NULL if it is empty.
+ *                Only the owner pushes so the head cannot come back once a steal
+ *                has emptied it,  a failed swap just means the list is gone.
+ * =====================================================================================
+ */
+static bp_chunk_t *
+bp_tc_pop( bp_tcache_t *tc)
+{
+	bp_chunk_t *chunk = __atomic_load_n(&tc->tc_head, __ATOMIC_SEQ_CST);
+	while( chunk && ! __atomic_compare_exchange_n(&tc->tc_head, &chunk, chunk->bc_next,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) );
+	if( chunk ) {
+		__atomic_sub_fetch(&tc->tc_count, 1, __ATOMIC_RELAXED);
+	}
+	return chunk;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_tc_push
+ *  Description:  Push a chunk on the thread's own free list.
+ * =====================================================================================
+ */
+static void
+bp_tc_push( bp_tcache_t *tc, bp_chunk_t *chunk)
+{
+	chunk->bc_next = __atomic_load_n(&tc->tc_head, __ATOMIC_SEQ_CST);
+	while( ! __atomic_compare_exchange_n(&tc->tc_head, &chunk->bc_next, chunk,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) );
+	__atomic_add_fetch(&tc->tc_count, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bp_steal
+ *  Description:  Move the chunks on every thread's free list to the global list,  so
+ *                chunks left idle by a thread that has stopped asking are not lost to
+ *                the others.  Returns true if any were taken.  Called with bp_lock
+ *                held.
+ * =====================================================================================
+ */
+static bool
+bp_steal( bufpool_t *bp)
+{
+	bp_tcache_t *tc;
+	bp_chunk_t  *chunk,
+	            *next;
+	int          n,
+	             total = 0;
+	list_for_each_entry(tc, &bp->bp_caches, tc_list){
+		chunk = __atomic_exchange_n(&tc->tc_head, NULL, __ATOMIC_SEQ_CST);
+		for(n = 0; chunk; n ++, chunk = next){
+			next = chunk->bc_next;
+			chunk->bc_next = bp->bp_free;
+			bp->bp_free    = chunk;
+			bp->bp_nfree ++;
+		}
+		__atomic_sub_fetch(&tc->tc_count, n, __ATOMIC_RELAXED);
+		total += n;
+	}
+	if( total ) {
+		pthread_cond_broadcast(&bp->bp_cond);
+	}
+	return total > 0;
+}
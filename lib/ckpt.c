@@ -0,0 +1,562 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ckpt.c
+ *
+ *    Description:  Checkpoints of the crawler's state.  A generation is written as
+ *                  ck.<gen>.<name> files,  each saved by its own module to a temporary
+ *                  file,  synced and renamed,  then checksummed into the manifest.
+ *                  The manifest is written the same way and the directory synced,
+ *                  which is the point the generation exists.  Nothing is updated in
+ *                  place so the previous generation stays whole until the new one is
+ *                  committed,  after which generations older than the last CK_KEEP are
+ *                  removed.
+ *
+ *                  The seen filter is saved before the frontier.  A URL found between
+ *                  the two is then in the saved frontier but maybe not the saved
+ *                  filter and may be queued twice after a restart,  while the other
+ *                  order could lose it.
+ *
+ *        Version:  1.0
+ *        Created:  01/11/2026 19:22:08
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/ckpt.h>
+#include <azzmos/utils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define CK_CRC_CHUNK  (1UL << 30)    /* bytes passed to crc32 at a time,  it takes a uInt */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static char *ck_name( ckpt_t *ck, uint64_t gen, const char *name);
+static bool  ck_gen_of( const char *name, uint64_t *gen);
+static int   ck_verify( ckpt_t *ck, uint64_t gen, ck_manifest_t *cm);
+static int   ck_crc_file( const char *path, uint64_t *size, uint32_t *crc);
+static void  ck_remove( ckpt_t *ck, uint64_t below, uint64_t above);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_init
+ *  Description:  Open the checkpoints in dir,  which must exist.  The newest generation
+ *                whose manifest and files all check out becomes ck_gen,  any newer
+ *                ones were not committed and are removed with any temporary files.
+ *                interval is the milliseconds ck_due waits,  zero or less picks
+ *                CK_INTERVAL_MS.  Returns 0,  with ck_gen 0 if there is no usable
+ *                checkpoint,  or a errno value.
+ * =====================================================================================
+ */
+extern int
+ck_init( ckpt_t *ck, const char *dir, long interval)
+{
+	DIR           *d;
+	struct dirent *de;
+	uint64_t      *gens = NULL,
+	              *g,
+	               gen,
+	               t;
+	size_t         n    = 0,
+	               size = 0,
+	               i,
+	               j;
+	int            err;
+	bzero(ck, sizeof(ckpt_t));
+	ck->ck_interval = (interval > 0) ? interval : CK_INTERVAL_MS;
+	ck->ck_last     = pl_now();
+	if( ! (ck->ck_dir = strdup(dir)) ) {
+		return ENOMEM;
+	}
+	if( ! (d = opendir(dir)) ) {
+		err = errno;
+		ck_free(ck);
+		return err;
+	}
+	while( (de = readdir(d)) ) {
+		if( strncmp(de->d_name, "MANIFEST.", 9) || ! ck_gen_of(de->d_name, &gen) ) {
+			continue;
+		}
+		if( n == size ) {
+			size = size ? 2 * size : 16;
+			if( ! (g = (uint64_t *) realloc(gens, size * sizeof(uint64_t))) ) {
+				closedir(d);
+				free(gens);
+				ck_free(ck);
+				return ENOMEM;
+			}
+			gens = g;
+		}
+		gens[n ++] = gen;
+	}
+	closedir(d);
+	/* newest first,  the first that checks out is used */
+	for(i = 1; i < n; i ++){
+		for(t = gens[i], j = i; j > 0 && gens[j - 1] < t; j --){
+			gens[j] = gens[j - 1];
+		}
+		gens[j] = t;
+	}
+	for(i = 0; i < n; i ++){
+		if( ck_verify(ck, gens[i], &ck->ck_cur) == 0 ) {
+			ck->ck_gen = gens[i];
+			break;
+		}
+	}
+	if( ! ck->ck_gen ) {
+		bzero(&ck->ck_cur, sizeof(ck_manifest_t));
+	}
+	free(gens);
+	ck_remove(ck, 0, ck->ck_gen);
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_path
+ *  Description:  The path to save name to in the generation being written,  to be
+ *                passed to ck_add once it is saved.  To be freed by the caller,  NULL
+ *                on ENOMEM.
+ * =====================================================================================
+ */
+extern char *
+ck_path( ckpt_t *ck, const char *name)
+{
+	return ck_name(ck, ck->ck_gen + 1, name);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_file
+ *  Description:  The path of name in the newest complete generation.  To be freed by
+ *                the caller,  NULL with errno ENOENT if there is none or ENOMEM.
+ * =====================================================================================
+ */
+extern char *
+ck_file( ckpt_t *ck, const char *name)
+{
+	uint32_t i = 0;
+	for(; ck->ck_gen && i < ck->ck_cur.cm_files; i ++){
+		if( strcmp(ck->ck_cur.cm_file[i].ce_name, name) == 0 ) {
+			return ck_name(ck, ck->ck_gen, name);
+		}
+	}
+	errno = ENOENT;
+	return NULL;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_add
+ *  Description:  Add the file saved to ck_path(name) to the generation being written,
+ *                taking its size and CRC-32.  Returns 0,  EINVAL if the name is too
+ *                long,  already added or the generation is full or a errno value.
+ * =====================================================================================
+ */
+extern int
+ck_add( ckpt_t *ck, const char *name)
+{
+	ck_manifest_t *cm = &ck->ck_next;
+	ck_entry_t    *ce;
+	char          *path;
+	uint32_t       i  = 0;
+	int            err;
+	if( strlen(name) >= CK_NAME_MAX || cm->cm_files == CK_FILES_MAX ) {
+		return EINVAL;
+	}
+	for(; i < cm->cm_files; i ++){
+		if( strcmp(cm->cm_file[i].ce_name, name) == 0 ) {
+			return EINVAL;
+		}
+	}
+	if( ! (path = ck_path(ck, name)) ) {
+		return ENOMEM;
+	}
+	ce = &cm->cm_file[cm->cm_files];
+	bzero(ce, sizeof(ck_entry_t));
+	strcpy(ce->ce_name, name);
+	if( ! (err = ck_crc_file(path, &ce->ce_size, &ce->ce_crc)) ) {
+		cm->cm_files ++;
+	}
+	free(path);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_commit
+ *  Description:  Write the manifest of the generation being written,  making it the
+ *                newest,  and remove generations older than the last CK_KEEP.  On
+ *                failure the generation is abandoned and its files removed.  Returns
+ *                0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ck_commit( ckpt_t *ck)
+{
+	ck_manifest_t *cm   = &ck->ck_next;
+	char          *path = ck_name(ck, ck->ck_gen + 1, NULL);
+	struct iovec   iov;
+	int            err;
+	if( ! path ) {
+		ck_abort(ck);
+		return ENOMEM;
+	}
+	memcpy(cm->cm_magic, CK_MAGIC, sizeof(cm->cm_magic));
+	cm->cm_gen  = ck->ck_gen + 1;
+	cm->cm_time = (uint64_t) time(NULL);
+	cm->cm_crc  = 0;
+	cm->cm_crc  = crc32(0L, (const Bytef *) cm, sizeof(ck_manifest_t));
+	iov.iov_base = cm;
+	iov.iov_len  = sizeof(ck_manifest_t);
+	if( (err = file_replace(path, &iov, 1)) ) {
+		unlink(path);
+		ck_abort(ck);
+	}
+	else {
+		memcpy(&ck->ck_cur, cm, sizeof(ck_manifest_t));
+		bzero(cm, sizeof(ck_manifest_t));
+		ck->ck_gen ++;
+		ck->ck_last = pl_now();
+		if( ck->ck_gen > CK_KEEP ) {
+			ck_remove(ck, ck->ck_gen - CK_KEEP + 1, ck->ck_gen);
+		}
+	}
+	free(path);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_abort
+ *  Description:  Abandon the generation being written and remove its files.
+ * =====================================================================================
+ */
+extern void
+ck_abort( ckpt_t *ck)
+{
+	bzero(&ck->ck_next, sizeof(ck_manifest_t));
+	ck_remove(ck, 0, ck->ck_gen);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_due
+ *  Description:  Has ck_interval passed since the last checkpoint,  or since ck_init.
+ * =====================================================================================
+ */
+extern bool
+ck_due( ckpt_t *ck)
+{
+	return pl_now() - ck->ck_last >= (uint64_t) ck->ck_interval;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_save
+ *  Description:  Write a checkpoint of whichever of the seen filter,  host state and
+ *                frontier are not NULL,  in that order,  and commit it.  Each keeps
+ *                working while it is saved.  Returns 0 or a errno value,  in which case
+ *                the previous checkpoint is still the newest.
+ * =====================================================================================
+ */
+extern int
+ck_save( ckpt_t *ck, seen_t *sn, polite_t *pl, frontier_t *fr)
+{
+	char *path;
+	int   err = 0;
+	bzero(&ck->ck_next, sizeof(ck_manifest_t));
+	if( sn && ! err ) {
+		if( ! (path = ck_path(ck, CK_SEEN)) ) {
+			err = ENOMEM;
+		}
+		else if( ! (err = sn_save(sn, path)) ) {
+			err = ck_add(ck, CK_SEEN);
+		}
+		free(path);
+	}
+	if( pl && ! err ) {
+		if( ! (path = ck_path(ck, CK_HOSTS)) ) {
+			err = ENOMEM;
+		}
+		else if( ! (err = pl_save(pl, path)) ) {
+			err = ck_add(ck, CK_HOSTS);
+		}
+		free(path);
+	}
+	if( fr && ! err ) {
+		if( ! (path = ck_path(ck, CK_FRONTIER)) ) {
+			err = ENOMEM;
+		}
+		else if( ! (err = fr_save(fr, path)) ) {
+			err = ck_add(ck, CK_FRONTIER);
+		}
+		free(path);
+	}
+	if( err ) {
+		ck_abort(ck);
+		return err;
+	}
+	return ck_commit(ck);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_restore
+ *  Description:  Restore from the newest checkpoint whichever of the seen filter,  host
+ *                state and frontier are not NULL.  sn is loaded as by sn_load while pl
+ *                and fr must be initilized and empty,  parse is as for fr_load.
+ *                Returns 0,  ENOENT if there is no checkpoint or it lacks one of them,
+ *                or a errno value from loading.
+ * =====================================================================================
+ */
+extern int
+ck_restore( ckpt_t *ck, seen_t *sn, polite_t *pl, frontier_t *fr,
+            uriobj_t *(*parse)( void *arg, const char *url), void *arg)
+{
+	char *path;
+	int   err = 0;
+	if( ! ck->ck_gen ) {
+		return ENOENT;
+	}
+	if( sn && ! err ) {
+		if( ! (path = ck_file(ck, CK_SEEN)) ) {
+			return errno;
+		}
+		err = sn_load(sn, path);
+		free(path);
+	}
+	if( pl && ! err ) {
+		if( ! (path = ck_file(ck, CK_HOSTS)) ) {
+			return errno;
+		}
+		err = pl_load(pl, path);
+		free(path);
+	}
+	if( fr && ! err ) {
+		if( ! (path = ck_file(ck, CK_FRONTIER)) ) {
+			return errno;
+		}
+		err = fr_load(fr, path, parse, arg);
+		free(path);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_free
+ *  Description:  Release the checkpoint handle,  the files are left.
+ * =====================================================================================
+ */
+extern void
+ck_free( ckpt_t *ck)
+{
+	free(ck->ck_dir);
+	bzero(ck, sizeof(ckpt_t));
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_name
+ *  Description:  The path of file name of a generation,  or of its manifest with name
+ *                NULL.  To be freed by the caller,  NULL on ENOMEM.
+ * =====================================================================================
+ */
+static char *
+ck_name( ckpt_t *ck, uint64_t gen, const char *name)
+{
+	size_t len  = strlen(ck->ck_dir) + (name ? strlen(name) : 0) + 40;
+	char  *path = (char *) malloc(len);
+	if( ! path ) {
+		errno = ENOMEM;
+	}
+	else if( name ) {
+		snprintf(path, len, "%s/ck.%llu.%s", ck->ck_dir, (unsigned long long) gen, name);
+	}
+	else {
+		snprintf(path, len, "%s/MANIFEST.%llu", ck->ck_dir, (unsigned long long) gen);
+	}
+	return path;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_gen_of
+ *  Description:  The generation of a checkpoint file name,  MANIFEST.<gen>,
+ *                ck.<gen>.<name> or either with .tmp.  false for any other name.
+ * =====================================================================================
+ */
+static bool
+ck_gen_of( const char *name, uint64_t *gen)
+{
+	const char *p;
+	char       *end;
+	if( strncmp(name, "MANIFEST.", 9) == 0 ) {
+		p = name + 9;
+	}
+	else if( strncmp(name, "ck.", 3) == 0 ) {
+		p = name + 3;
+	}
+	else {
+		return false;
+	}
+	if( ! isdigit((unsigned char) *p) ) {
+		return false;
+	}
+	*gen = strtoull(p, &end, 10);
+	if( *name == 'M' ) {
+		return *end == '\0' || strcmp(end, ".tmp") == 0;
+	}
+	return *end == '.' && end[1] != '\0';
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_verify
+ *  Description:  Read the manifest of a generation into cm and check it and every file
+ *                it lists.  Returns 0,  EINVAL if anything does not match or a errno
+ *                value.
+ * =====================================================================================
+ */
+static int
+ck_verify( ckpt_t *ck, uint64_t gen, ck_manifest_t *cm)
+{
+	ck_entry_t *ce;
+	char       *path = ck_name(ck, gen, NULL);
+	uint64_t    size;
+	uint32_t    crc,
+	            i    = 0;
+	ssize_t     n;
+	int         fd,
+	            err  = 0;
+	if( ! path ) {
+		return ENOMEM;
+	}
+	fd = open(path, O_RDONLY);
+	free(path);
+	if( fd == -1 ) {
+		return errno;
+	}
+	n = read(fd, cm, sizeof(ck_manifest_t));
+	close(fd);
+	if( n != sizeof(ck_manifest_t) ) {
+		return EINVAL;
+	}
+	crc        = cm->cm_crc;
+	cm->cm_crc = 0;
+	if( crc32(0L, (const Bytef *) cm, sizeof(ck_manifest_t)) != crc
+			|| memcmp(cm->cm_magic, CK_MAGIC, sizeof(cm->cm_magic)) != 0
+			|| cm->cm_gen != gen || cm->cm_files > CK_FILES_MAX ) {
+		return EINVAL;
+	}
+	cm->cm_crc = crc;
+	for(; ! err && i < cm->cm_files; i ++){
+		ce = &cm->cm_file[i];
+		if( ! memchr(ce->ce_name, '\0', CK_NAME_MAX) ) {
+			return EINVAL;
+		}
+		if( ! (path = ck_name(ck, gen, ce->ce_name)) ) {
+			return ENOMEM;
+		}
+		if( ! (err = ck_crc_file(path, &size, &crc)) && (size != ce->ce_size || crc != ce->ce_crc) ) {
+			err = EINVAL;
+		}
+		free(path);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_crc_file
+ *  Description:  The size and CRC-32 of a file,  read through a mapping.  Returns 0 or
+ *                a errno value.
+ * =====================================================================================
+ */
+static int
+ck_crc_file( const char *path, uint64_t *size, uint32_t *crc)
+{
+	struct stat  st;
+	const char  *map;
+	uLong        c   = crc32(0L, Z_NULL, 0);
+	size_t       off = 0,
+	             n;
+	int          fd,
+	             err = 0;
+	if( (fd = open(path, O_RDONLY)) == -1 ) {
+		return errno;
+	}
+	if( fstat(fd, &st) == -1 ) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	*size = st.st_size;
+	if( st.st_size ) {
+		map = (const char *) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if( map == MAP_FAILED ) {
+			err = errno;
+			close(fd);
+			return err;
+		}
+		for(; off < (size_t) st.st_size; off += n){
+			n = (size_t) st.st_size - off;
+			n = (n > CK_CRC_CHUNK) ? CK_CRC_CHUNK : n;
+			c = crc32(c, (const Bytef *) map + off, (uInt) n);
+		}
+		munmap((void *) map, st.st_size);
+	}
+	close(fd);
+	*crc = (uint32_t) c;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ck_remove
+ *  Description:  Remove every checkpoint file of a generation below below or above
+ *                above,  and every temporary file.
+ * =====================================================================================
+ */
+static void
+ck_remove( ckpt_t *ck, uint64_t below, uint64_t above)
+{
+	DIR           *d;
+	struct dirent *de;
+	uint64_t       gen;
+	size_t         len;
+	char          *path;
+	if( ! (d = opendir(ck->ck_dir)) ) {
+		return;
+	}
+	while( (de = readdir(d)) ) {
+		if( ! ck_gen_of(de->d_name, &gen) ) {
+			continue;
+		}
+		len = strlen(de->d_name);
+		if( gen < below || gen > above || (len > 4 && strcmp(de->d_name + len - 4, ".tmp") == 0) ) {
+			if( (path = (char *) malloc(strlen(ck->ck_dir) + len + 2)) ) {
+				sprintf(path, "%s/%s", ck->ck_dir, de->d_name);
+				unlink(path);
+				free(path);
+			}
+		}
+	}
+	closedir(d);
+}
@@ -0,0 +1,509 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbcopy.c
+ *
+ *    Description:  Batched URI persistence through COPY FROM STDIN (FORMAT binary).
+ *                  Rows are encoded into the current batch under dc_lock,  a batch that
+ *                  is full or due is swapped for a empty one and sent with only dc_send
+ *                  held so workers keep adding rows while it is on the wire.  A batch
+ *                  is sent in one transaction: COPY into a temporary table that empties
+ *                  on commit,  then INSERT ... ON CONFLICT into DC_TABLE,  giving URIs
+ *                  added without a id one from DC_SEQ.  A URI already stored only has
+ *                  its validators replaced,  and only by a row from a fetch.
+ *
+ *        Version:  1.0
+ *        Created:  02/11/2026 18:55:31
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/dbcopy.h>
+#include <azzmos/polite.h>
+#include <azzmos/seen.h>
+#include <azzmos/utils.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define DC_URI_BUF   2048         /* URIs longer than this are built in a malloc buffer */
+#define DC_CHUNK     65536        /* bytes passed to PQputCopyData at a time */
+#define DC_FIELDS    6            /* uri_id,  uri_fp,  uri_host,  uri_url,  uri_etag,  uri_mdate */
+#define DC_PG_EPOCH  946684800LL  /* 2000-01-01,  where timestamptz counts from */
+
+/*****************************************************************************************
+ * A batch may hold the same URI twice,  DISTINCT ON keeps the most recently fetched so
+ * ON CONFLICT DO UPDATE never meets a row twice.  A row without uri_mdate is a link
+ * that has not been fetched and leaves a stored URI's validators alone.
+ *****************************************************************************************/
+#define DC_STAGE_SQL  "CREATE TEMP TABLE IF NOT EXISTS dc_stage (uri_id int8, uri_fp int8, " \
+                      "uri_host text, uri_url text, uri_etag text, uri_mdate timestamptz) " \
+                      "ON COMMIT DELETE ROWS"
+#define DC_COPY_SQL   "COPY dc_stage FROM STDIN (FORMAT binary)"
+#define DC_INSERT_SQL "INSERT INTO " DC_TABLE " (uri_id, uri_fp, uri_host, uri_url, uri_etag, " \
+                      "uri_mdate) SELECT DISTINCT ON (uri_fp) coalesce(uri_id, nextval('" \
+                      DC_SEQ "')), uri_fp, uri_host, uri_url, uri_etag, uri_mdate FROM dc_stage " \
+                      "ORDER BY uri_fp, uri_mdate DESC NULLS LAST ON CONFLICT (uri_fp) DO UPDATE " \
+                      "SET uri_etag = EXCLUDED.uri_etag, uri_mdate = EXCLUDED.uri_mdate " \
+                      "WHERE EXCLUDED.uri_mdate IS NOT NULL"
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ################################ */
+
+/*****************************************************************************************
+ * The binary COPY signature,  then no flags and no header extension.
+ *****************************************************************************************/
+static const char dc_header[19] = "PGCOPY\n\377\r\n\0\0\0\0\0\0\0\0\0";
+static const char dc_trailer[2] = "\377\377";
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static dc_batch_t *dc_batch_new( void);
+static void        dc_batch_free( dc_batch_t *b);
+static int         dc_send_batch( dbcopy_t *dc, dc_batch_t *b);
+static int         dc_copy( dbcopy_t *dc, dc_batch_t *b);
+static bool        dc_exec( PGconn *conn, const char *sql, ExecStatusType want);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_init
+ *  Description:  Initilize a writer for the database conninfo names.  A batch is sent
+ *                at rows rows or bytes bytes or deadline milliseconds after its first
+ *                row was added,  zero or less picks DC_ROWS,  DC_BYTES and
+ *                DC_DEADLINE_MS.  Nothing is connected until a batch is sent.  Returns
+ *                0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+dc_init( dbcopy_t *dc, const char *conninfo, long rows, size_t bytes, long deadline)
+{
+	int err;
+	bzero(dc, sizeof(dbcopy_t));
+	dc->dc_rows     = (rows > 0) ? rows : DC_ROWS;
+	dc->dc_bytes    = (bytes > 0) ? bytes : DC_BYTES;
+	dc->dc_deadline = (deadline > 0) ? deadline : DC_DEADLINE_MS;
+	dc->dc_backoff  = DC_BACKOFF_MS;
+	INIT_LIST_HEAD(&dc->dc_failed);
+	if( ! (dc->dc_conninfo = strdup(conninfo)) || ! (dc->dc_cur = dc_batch_new()) ) {
+		free(dc->dc_conninfo);
+		return ENOMEM;
+	}
+	if( (err = pthread_mutex_init(&dc->dc_lock, NULL)) ) {
+		dc_batch_free(dc->dc_cur);
+		free(dc->dc_conninfo);
+		return err;
+	}
+	if( (err = pthread_mutex_init(&dc->dc_send, NULL)) ) {
+		pthread_mutex_destroy(&dc->dc_lock);
+		dc_batch_free(dc->dc_cur);
+		free(dc->dc_conninfo);
+		return err;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_set_reject
+ *  Description:  Set the function given batches that are dropped after DC_RETRIES
+ *                failed attempts,  for example to write them to a file.
+ * =====================================================================================
+ */
+extern void
+dc_set_reject( dbcopy_t *dc, dc_reject_t fn, void *arg)
+{
+	pthread_mutex_lock(&dc->dc_lock);
+	dc->dc_reject = fn;
+	dc->dc_arg    = arg;
+	pthread_mutex_unlock(&dc->dc_lock);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_add
+ *  Description:  Add a row,  id zero having one taken from DC_SEQ.  etag may be NULL
+ *                and mdate zero when the URI has not been fetched,  they are stored
+ *                as NULL.  If that fills the batch it is sent before returning,  a
+ *                batch that fails is kept and retried by dc_poll so the row is not
+ *                lost.  Returns 0,  ENOBUFS if DC_FAILED_MAX batches are waiting to
+ *                be retried or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+dc_add( dbcopy_t *dc, int64_t id, uint64_t fp, const char *host, const char *url, size_t len,
+		const char *etag, time_t mdate)
+{
+	dc_batch_t *b    = NULL,
+	           *cur;
+	size_t      hlen = strlen(host),
+	            elen = etag ? strlen(etag) : 0,
+	            need = 2 + (4 + 8) + (4 + 8) + (4 + hlen) + (4 + len) + (4 + elen) + (4 + 8),
+	            size;
+	char       *p;
+	pthread_mutex_lock(&dc->dc_lock);
+	if( dc->dc_nfailed >= DC_FAILED_MAX ) {
+		pthread_mutex_unlock(&dc->dc_lock);
+		return ENOBUFS;
+	}
+	cur = dc->dc_cur;
+	if( cur->cb_len + need > cur->cb_size ) {
+		for(size = cur->cb_size ? cur->cb_size : 4096; size < cur->cb_len + need; size *= 2);
+		if( ! (p = (char *) realloc(cur->cb_buf, size)) ) {
+			pthread_mutex_unlock(&dc->dc_lock);
+			return ENOMEM;
+		}
+		cur->cb_buf  = p;
+		cur->cb_size = size;
+	}
+	if( ! cur->cb_rows ) {
+		cur->cb_first = pl_now();
+	}
+	p = put_netorder(cur->cb_buf + cur->cb_len, DC_FIELDS, 2);
+	if( id ) {
+		p = put_netorder(p, 8, 4);
+		p = put_netorder(p, (uint64_t) id, 8);
+	}
+	else {
+		p = put_netorder(p, 0xffffffff, 4);
+	}
+	p = put_netorder(p, 8, 4);
+	p = put_netorder(p, fp, 8);
+	p = put_netorder(p, hlen, 4);
+	memcpy(p, host, hlen);
+	p = put_netorder(p + hlen, len, 4);
+	memcpy(p, url, len);
+	p += len;
+	if( etag ) {
+		p = put_netorder(p, elen, 4);
+		memcpy(p, etag, elen);
+		p += elen;
+	}
+	else {
+		p = put_netorder(p, 0xffffffff, 4);
+	}
+	if( mdate > 0 ) {
+		/* timestamptz is microseconds from DC_PG_EPOCH */
+		p = put_netorder(p, 8, 4);
+		p = put_netorder(p, (uint64_t) (((int64_t) mdate - DC_PG_EPOCH) * 1000000), 8);
+	}
+	else {
+		p = put_netorder(p, 0xffffffff, 4);
+	}
+	cur->cb_len = p - cur->cb_buf;
+	cur->cb_rows ++;
+	/* a full batch is swapped out,  if there is no memory for a new one it waits */
+	if( (cur->cb_rows >= dc->dc_rows || cur->cb_len >= dc->dc_bytes)
+			&& (dc->dc_cur = dc_batch_new()) ) {
+		b = cur;
+	}
+	else {
+		dc->dc_cur = cur;
+	}
+	pthread_mutex_unlock(&dc->dc_lock);
+	if( b ) {
+		dc_send_batch(dc, b);
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_add_uri
+ *  Description:  Add a normalized URI with its uri_id,  host,  sn_fingerprint,  the
+ *                uri_url_str the fingerprint is taken from and the uri_etag and
+ *                uri_mdate validators of its last fetch.  Returns as dc_add.
+ * =====================================================================================
+ */
+extern int
+dc_add_uri( dbcopy_t *dc, uriobj_t *uri)
+{
+	const char *host = (uri->uri_host && *uri->uri_host) ? *uri->uri_host
+	                 : (*uri->uri_auth ? *uri->uri_auth : "");
+	char        buf[DC_URI_BUF],
+	           *s    = buf;
+	size_t      len  = uri_url_str(uri, NULL);
+	uint64_t    fp   = sn_fingerprint(uri);
+	int         err;
+	if( ! fp || (len >= DC_URI_BUF && ! (s = (char *) malloc(len + 1))) ) {
+		return ENOMEM;
+	}
+	len = uri_url_str(uri, s);
+	err = dc_add(dc, uri->uri_id, fp, host, s, len,
+			uri->uri_etag ? *uri->uri_etag : NULL, uri->uri_mdate);
+	if( s != buf ) {
+		free(s);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_poll
+ *  Description:  Send the current batch if its deadline has passed and retry the
+ *                failed batches whose delay is over.  To be called every few hundred
+ *                milliseconds.  Returns 0 or EIO if a batch could not be sent.
+ * =====================================================================================
+ */
+extern int
+dc_poll( dbcopy_t *dc)
+{
+	dc_batch_t *b,
+	           *n;
+	uint64_t    now;
+	int         err = 0;
+	for(;;) {
+		pthread_mutex_lock(&dc->dc_lock);
+		now = pl_now();
+		b   = NULL;
+		if( dc->dc_cur->cb_rows && now - dc->dc_cur->cb_first >= (uint64_t) dc->dc_deadline
+				&& (n = dc_batch_new()) ) {
+			b          = dc->dc_cur;
+			dc->dc_cur = n;
+		}
+		else {
+			list_for_each_entry(n, &dc->dc_failed, cb_list){
+				if( n->cb_retry <= now ) {
+					list_del_init(&n->cb_list);
+					dc->dc_nfailed --;
+					b = n;
+					break;
+				}
+			}
+		}
+		pthread_mutex_unlock(&dc->dc_lock);
+		if( ! b ) {
+			return err;
+		}
+		if( dc_send_batch(dc, b) ) {
+			err = EIO;
+		}
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_flush
+ *  Description:  Send the current batch and make one more attempt at every failed one
+ *                whatever its delay.  Returns 0 once nothing is waiting or EIO.
+ * =====================================================================================
+ */
+extern int
+dc_flush( dbcopy_t *dc)
+{
+	struct list_head todo;
+	dc_batch_t      *b,
+	                *n;
+	int              err = 0;
+	INIT_LIST_HEAD(&todo);
+	pthread_mutex_lock(&dc->dc_lock);
+	list_splice_init(&dc->dc_failed, &todo);
+	dc->dc_nfailed = 0;
+	if( dc->dc_cur->cb_rows && (n = dc_batch_new()) ) {
+		list_add_tail(&dc->dc_cur->cb_list, &todo);
+		dc->dc_cur = n;
+	}
+	pthread_mutex_unlock(&dc->dc_lock);
+	list_for_each_entry_safe(b, n, &todo, cb_list){
+		list_del_init(&b->cb_list);
+		if( dc_send_batch(dc, b) ) {
+			err = EIO;
+		}
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_close
+ *  Description:  Flush and release the writer.  Batches that still fail are given to
+ *                the reject function and dropped.  Returns the result of the flush.
+ * =====================================================================================
+ */
+extern int
+dc_close( dbcopy_t *dc)
+{
+	dc_batch_t *b,
+	           *n;
+	int         err = dc_flush(dc);
+	list_for_each_entry_safe(b, n, &dc->dc_failed, cb_list){
+		if( dc->dc_reject ) {
+			dc->dc_reject(dc->dc_arg, b->cb_buf, b->cb_len, b->cb_rows);
+		}
+		dc->dc_dropped += b->cb_rows;
+		dc_batch_free(b);
+	}
+	dc_batch_free(dc->dc_cur);
+	if( dc->dc_conn ) {
+		PQfinish(dc->dc_conn);
+	}
+	free(dc->dc_conninfo);
+	pthread_mutex_destroy(&dc->dc_send);
+	pthread_mutex_destroy(&dc->dc_lock);
+	return err;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_batch_new
+ *  Description:  A empty batch,  NULL on ENOMEM.
+ * =====================================================================================
+ */
+static dc_batch_t *
+dc_batch_new( void)
+{
+	dc_batch_t *b = (dc_batch_t *) calloc(1, sizeof(dc_batch_t));
+	if( b ) {
+		INIT_LIST_HEAD(&b->cb_list);
+	}
+	return b;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_batch_free
+ *  Description:  Release a batch.
+ * =====================================================================================
+ */
+static void
+dc_batch_free( dc_batch_t *b)
+{
+	if( b ) {
+		free(b->cb_buf);
+		free(b);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_send_batch
+ *  Description:  Send a batch that is on no list.  It is freed once sent.  If it fails
+ *                it goes on dc_failed to be retried after dc_backoff doubled for each
+ *                earlier attempt,  or after DC_RETRIES attempts is rejected and
+ *                freed.  Returns 0 or EIO.
+ * =====================================================================================
+ */
+static int
+dc_send_batch( dbcopy_t *dc, dc_batch_t *b)
+{
+	dc_reject_t fn  = NULL;
+	void       *arg = NULL;
+	int         err;
+	pthread_mutex_lock(&dc->dc_send);
+	err = dc_copy(dc, b);
+	pthread_mutex_unlock(&dc->dc_send);
+	pthread_mutex_lock(&dc->dc_lock);
+	if( ! err ) {
+		dc->dc_sent += b->cb_rows;
+		dc->dc_batches ++;
+	}
+	else {
+		dc->dc_retried ++;
+		if( ++ b->cb_tries < DC_RETRIES ) {
+			b->cb_retry = pl_now() + ((uint64_t) dc->dc_backoff << (b->cb_tries - 1));
+			list_add_tail(&b->cb_list, &dc->dc_failed);
+			dc->dc_nfailed ++;
+			b = NULL;
+		}
+		else {
+			dc->dc_dropped += b->cb_rows;
+			fn  = dc->dc_reject;
+			arg = dc->dc_arg;
+		}
+	}
+	pthread_mutex_unlock(&dc->dc_lock);
+	if( b ) {
+		if( fn ) {
+			fn(arg, b->cb_buf, b->cb_len, b->cb_rows);
+		}
+		dc_batch_free(b);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_copy
+ *  Description:  Send a batch in one transaction,  connecting or reconnecting first as
+ *                needed.  Returns 0 or EIO.  Called with dc_send held.
+ * =====================================================================================
+ */
+static int
+dc_copy( dbcopy_t *dc, dc_batch_t *b)
+{
+	PGresult *res;
+	size_t    off = 0,
+	          n;
+	bool      ok;
+	if( ! dc->dc_conn ) {
+		dc->dc_conn   = PQconnectdb(dc->dc_conninfo);
+		dc->dc_staged = false;
+	}
+	else if( PQstatus(dc->dc_conn) != CONNECTION_OK ) {
+		PQreset(dc->dc_conn);
+		dc->dc_staged = false;
+	}
+	if( ! dc->dc_conn || PQstatus(dc->dc_conn) != CONNECTION_OK ) {
+		return EIO;
+	}
+	if( ! dc->dc_staged ) {
+		if( ! dc_exec(dc->dc_conn, DC_STAGE_SQL, PGRES_COMMAND_OK) ) {
+			return EIO;
+		}
+		dc->dc_staged = true;
+	}
+	if( ! dc_exec(dc->dc_conn, "BEGIN", PGRES_COMMAND_OK) ) {
+		return EIO;
+	}
+	ok = dc_exec(dc->dc_conn, DC_COPY_SQL, PGRES_COPY_IN)
+			&& PQputCopyData(dc->dc_conn, dc_header, sizeof(dc_header)) == 1;
+	for(; ok && off < b->cb_len; off += n){
+		n  = (b->cb_len - off > DC_CHUNK) ? DC_CHUNK : b->cb_len - off;
+		ok = PQputCopyData(dc->dc_conn, b->cb_buf + off, (int) n) == 1;
+	}
+	if( ok ) {
+		ok = PQputCopyData(dc->dc_conn, dc_trailer, sizeof(dc_trailer)) == 1
+				&& PQputCopyEnd(dc->dc_conn, NULL) == 1;
+	}
+	else if( PQresultStatus(res = PQgetResult(dc->dc_conn)) == PGRES_COPY_IN ) {
+		PQputCopyEnd(dc->dc_conn, "batch abandoned");
+		PQclear(res);
+	}
+	else {
+		PQclear(res);
+	}
+	/* the COPY's own result,  then the NULL that ends it */
+	while( (res = PQgetResult(dc->dc_conn)) ) {
+		if( PQresultStatus(res) != PGRES_COMMAND_OK ) {
+			ok = false;
+		}
+		PQclear(res);
+	}
+	ok = ok && dc_exec(dc->dc_conn, DC_INSERT_SQL, PGRES_COMMAND_OK)
+			&& dc_exec(dc->dc_conn, "COMMIT", PGRES_COMMAND_OK);
+	if( ! ok ) {
+		dc_exec(dc->dc_conn, "ROLLBACK", PGRES_COMMAND_OK);
+		return EIO;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dc_exec
+ *  Description:  Run a statement,  true if its result has the status want.
+ * =====================================================================================
+ */
+static bool
+dc_exec( PGconn *conn, const char *sql, ExecStatusType want)
+{
+	PGresult *res = PQexec(conn, sql);
+	bool      ok  = res && PQresultStatus(res) == want;
+	PQclear(res);
+	return ok;
+}
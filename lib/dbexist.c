@@ -0,0 +1,483 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbexist.c
+ *
+ *    Description:  Batched existence check.  Cached answers and pending fingerprints
+ *                  share one hash table so a fingerprint is either answered,  waiting
+ *                  in a batch or unknown.  A batch is sent as a single binary int8[]
+ *                  parameter and when its result arrives every entry in it moves to
+ *                  the front of the LRU and its waiters are called outside dx_lock.
+ *
+ *        Version:  1.0
+ *        Created:  05/11/2026 19:36:18
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/dbexist.h>
+#include <azzmos/dbcopy.h>
+#include <azzmos/polite.h>
+#include <azzmos/utils.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define DX_SQL       "SELECT uri_fp FROM " DC_TABLE " WHERE uri_fp = ANY($1::int8[])"
+#define DX_INT8_OID  20           /* element type of the array parameter */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static dx_entry_t *dx_find( dbexist_t *dx, uint64_t fp);
+static dx_entry_t *dx_entry_new( dbexist_t *dx, uint64_t fp);
+static void        dx_evict( dbexist_t *dx);
+static int         dx_send( dbexist_t *dx, dx_batch_t *b);
+static void        dx_resend( dbexist_t *dx);
+static void        dx_done( void *arg, PGresult *res, int err);
+static void        dx_answer( dx_batch_t *b, PGresult *res, int err);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_init
+ *  Description:  Initilize a checker that keeps cap answers and sends batch
+ *                fingerprints per query through dw,  a batch that is not full being
+ *                sent by dx_poll deadline milliseconds after its first fingerprint.
+ *                Zero or less picks DX_CACHE,  DX_BATCH and DX_DEADLINE_MS.  Returns 0
+ *                or a errno value.
+ * =====================================================================================
+ */
+extern int
+dx_init( dbexist_t *dx, dbwriter_t *dw, long cap, int batch, long deadline)
+{
+	uint64_t buckets = 1024,
+	         i;
+	int      err;
+	bzero(dx, sizeof(dbexist_t));
+	dx->dx_dw       = dw;
+	dx->dx_cap      = (cap > 0) ? cap : DX_CACHE;
+	dx->dx_batch    = (batch > 0) ? batch : DX_BATCH;
+	dx->dx_deadline = (deadline > 0) ? deadline : DX_DEADLINE_MS;
+	INIT_LIST_HEAD(&dx->dx_lru);
+	INIT_LIST_HEAD(&dx->dx_held);
+	while( buckets < (uint64_t) dx->dx_cap ) {
+		buckets <<= 1;
+	}
+	if( ! (dx->dx_table = (struct list_head *) malloc(buckets * sizeof(struct list_head))) ) {
+		return ENOMEM;
+	}
+	for(i = 0; i < buckets; i ++){
+		INIT_LIST_HEAD(&dx->dx_table[i]);
+	}
+	dx->dx_mask = buckets - 1;
+	if( (err = pthread_mutex_init(&dx->dx_lock, NULL)) ) {
+		free(dx->dx_table);
+		return err;
+	}
+	if( (err = pthread_cond_init(&dx->dx_cond, NULL)) ) {
+		pthread_mutex_destroy(&dx->dx_lock);
+		free(dx->dx_table);
+		return err;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_check
+ *  Description:  Is the URI with fingerprint fp stored.  If the LRU has the answer it
+ *                is set in exists and 0 returned.  Otherwise the fingerprint joins the
+ *                current batch,  or the batch it is already waiting in,  fn is called
+ *                with arg once it is answered and EINPROGRESS is returned.  A batch
+ *                this fills is sent before returning.  Returns ENOMEM if the check
+ *                could not be queued.
+ * =====================================================================================
+ */
+extern int
+dx_check( dbexist_t *dx, uint64_t fp, bool *exists, dx_done_t fn, void *arg)
+{
+	dx_entry_t  *e;
+	dx_waiter_t *w;
+	dx_batch_t  *b = NULL;
+	pthread_mutex_lock(&dx->dx_lock);
+	if( (e = dx_find(dx, fp)) && ! e->xe_pending ) {
+		list_move(&e->xe_list, &dx->dx_lru);
+		*exists = e->xe_exists;
+		dx->dx_hits ++;
+		pthread_mutex_unlock(&dx->dx_lock);
+		return 0;
+	}
+	if( ! (w = (dx_waiter_t *) calloc(1, sizeof(dx_waiter_t))) ) {
+		pthread_mutex_unlock(&dx->dx_lock);
+		return ENOMEM;
+	}
+	/* a fingerprint already pending joins its batch,  only a new one needs dx_cur */
+	if( ! e ) {
+		if( ! dx->dx_cur && (dx->dx_cur = (dx_batch_t *) calloc(1, sizeof(dx_batch_t))) ) {
+			dx->dx_cur->xb_dx = dx;
+			INIT_LIST_HEAD(&dx->dx_cur->xb_entries);
+			INIT_LIST_HEAD(&dx->dx_cur->xb_list);
+		}
+		if( ! dx->dx_cur || ! (e = dx_entry_new(dx, fp)) ) {
+			if( dx->dx_cur && ! dx->dx_cur->xb_count ) {
+				free(dx->dx_cur);
+				dx->dx_cur = NULL;
+			}
+			pthread_mutex_unlock(&dx->dx_lock);
+			free(w);
+			return ENOMEM;
+		}
+		e->xe_pending = true;
+		if( ! dx->dx_cur->xb_count ++ ) {
+			dx->dx_cur->xb_first = pl_now();
+		}
+		list_add_tail(&e->xe_list, &dx->dx_cur->xb_entries);
+	}
+	w->xw_fn  = fn;
+	w->xw_arg = arg;
+	list_add_tail(&w->xw_list, &e->xe_waiters);
+	dx->dx_misses ++;
+	if( dx->dx_cur && dx->dx_cur->xb_count >= dx->dx_batch ) {
+		b          = dx->dx_cur;
+		dx->dx_cur = NULL;
+		dx->dx_inflight ++;
+	}
+	pthread_mutex_unlock(&dx->dx_lock);
+	if( b ) {
+		dx_send(dx, b);
+	}
+	return EINPROGRESS;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_note
+ *  Description:  Record a answer learnt elsewhere,  for example that a URI was just
+ *                written.  A pending fingerprint can only be marked as existing,  the
+ *                query's answer is still given for it otherwise.
+ * =====================================================================================
+ */
+extern void
+dx_note( dbexist_t *dx, uint64_t fp, bool exists)
+{
+	dx_entry_t *e;
+	pthread_mutex_lock(&dx->dx_lock);
+	if( (e = dx_find(dx, fp)) ) {
+		if( e->xe_pending ) {
+			e->xe_exists = e->xe_exists || exists;
+		}
+		else {
+			e->xe_exists = exists;
+			list_move(&e->xe_list, &dx->dx_lru);
+		}
+	}
+	else if( (e = dx_entry_new(dx, fp)) ) {
+		e->xe_exists = exists;
+		list_add(&e->xe_list, &dx->dx_lru);
+		dx->dx_cached ++;
+		dx_evict(dx);
+	}
+	pthread_mutex_unlock(&dx->dx_lock);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_poll
+ *  Description:  Send the batches the writer had no room for and the current batch if
+ *                its deadline has passed.  To be called every few tens of
+ *                milliseconds.
+ * =====================================================================================
+ */
+extern void
+dx_poll( dbexist_t *dx)
+{
+	dx_batch_t *b = NULL;
+	dx_resend(dx);
+	pthread_mutex_lock(&dx->dx_lock);
+	if( dx->dx_cur && pl_now() - dx->dx_cur->xb_first >= (uint64_t) dx->dx_deadline ) {
+		b          = dx->dx_cur;
+		dx->dx_cur = NULL;
+		dx->dx_inflight ++;
+	}
+	pthread_mutex_unlock(&dx->dx_lock);
+	if( b ) {
+		dx_send(dx, b);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_flush
+ *  Description:  Send the current batch whatever its deadline,  for example once the
+ *                links of a page have all been checked,  after any the writer had no
+ *                room for.
+ * =====================================================================================
+ */
+extern void
+dx_flush( dbexist_t *dx)
+{
+	dx_batch_t *b;
+	dx_resend(dx);
+	pthread_mutex_lock(&dx->dx_lock);
+	if( (b = dx->dx_cur) ) {
+		dx->dx_cur = NULL;
+		dx->dx_inflight ++;
+	}
+	pthread_mutex_unlock(&dx->dx_lock);
+	if( b ) {
+		dx_send(dx, b);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_free
+ *  Description:  Send the current batch,  wait for every batch to be answered and
+ *                release the checker.  Held batches are sent again every
+ *                DX_DEADLINE_MS until the writer takes them.  The writer must still
+ *                be open or its close must already have run.
+ * =====================================================================================
+ */
+extern void
+dx_free( dbexist_t *dx)
+{
+	struct timespec ts;
+	dx_entry_t     *e,
+	               *n;
+	dx_flush(dx);
+	pthread_mutex_lock(&dx->dx_lock);
+	while( dx->dx_inflight ) {
+		if( list_empty(&dx->dx_held) ) {
+			pthread_cond_wait(&dx->dx_cond, &dx->dx_lock);
+			continue;
+		}
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += DX_DEADLINE_MS * 1000000L;
+		if( ts.tv_nsec >= 1000000000L ) {
+			ts.tv_sec  ++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&dx->dx_cond, &dx->dx_lock, &ts);
+		pthread_mutex_unlock(&dx->dx_lock);
+		dx_resend(dx);
+		pthread_mutex_lock(&dx->dx_lock);
+	}
+	pthread_mutex_unlock(&dx->dx_lock);
+	list_for_each_entry_safe(e, n, &dx->dx_lru, xe_list){
+		free(e);
+	}
+	free(dx->dx_table);
+	pthread_cond_destroy(&dx->dx_cond);
+	pthread_mutex_destroy(&dx->dx_lock);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_find
+ *  Description:  The entry for fp,  NULL if there is none.  Called with dx_lock held.
+ * =====================================================================================
+ */
+static dx_entry_t *
+dx_find( dbexist_t *dx, uint64_t fp)
+{
+	dx_entry_t *e;
+	list_for_each_entry(e, &dx->dx_table[fp & dx->dx_mask], xe_hash){
+		if( e->xe_fp == fp ) {
+			return e;
+		}
+	}
+	return NULL;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_entry_new
+ *  Description:  A entry for fp in the table and on no list,  NULL on ENOMEM.  Called
+ *                with dx_lock held.
+ * =====================================================================================
+ */
+static dx_entry_t *
+dx_entry_new( dbexist_t *dx, uint64_t fp)
+{
+	dx_entry_t *e = (dx_entry_t *) calloc(1, sizeof(dx_entry_t));
+	if( e ) {
+		e->xe_fp = fp;
+		INIT_LIST_HEAD(&e->xe_waiters);
+		INIT_LIST_HEAD(&e->xe_list);
+		list_add(&e->xe_hash, &dx->dx_table[fp & dx->dx_mask]);
+	}
+	return e;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_evict
+ *  Description:  Drop the least recently used answers over dx_cap.  Called with
+ *                dx_lock held.
+ * =====================================================================================
+ */
+static void
+dx_evict( dbexist_t *dx)
+{
+	dx_entry_t *e;
+	while( dx->dx_cached > dx->dx_cap ) {
+		e = list_entry(dx->dx_lru.prev, dx_entry_t, xe_list);
+		list_del(&e->xe_list);
+		list_del(&e->xe_hash);
+		free(e);
+		dx->dx_cached --;
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_send
+ *  Description:  Submit a batch that has been taken off dx_cur and counted in
+ *                dx_inflight.  Its fingerprints are passed as one binary int8[],  the
+ *                header being the dimensions,  no nulls,  the element type and the
+ *                length and lower bound,  then each element's length and value.  If
+ *                the writer's queue is full the batch goes on dx_held and EAGAIN is
+ *                returned,  if it cannot be submitted for any other reason its
+ *                waiters are given the error.
+ * =====================================================================================
+ */
+static int
+dx_send( dbexist_t *dx, dx_batch_t *b)
+{
+	dx_entry_t *e;
+	const int   format = 1;
+	int         len    = 20 + b->xb_count * 12,
+	            err    = ENOMEM;
+	char       *buf    = (char *) malloc(len),
+	           *p      = buf;
+	if( buf ) {
+		p = put_netorder(p, 1, 4);
+		p = put_netorder(p, 0, 4);
+		p = put_netorder(p, DX_INT8_OID, 4);
+		p = put_netorder(p, b->xb_count, 4);
+		p = put_netorder(p, 1, 4);
+		/* the fingerprints of a sent batch do not change,  no lock is needed */
+		list_for_each_entry(e, &b->xb_entries, xe_list){
+			p = put_netorder(p, 8, 4);
+			p = put_netorder(p, e->xe_fp, 8);
+		}
+		err = dw_submit(dx->dx_dw, DX_SQL, 1, (const char * const *) &buf, &len, &format,
+				dx_done, b);
+		free(buf);
+	}
+	if( err == EAGAIN ) {
+		pthread_mutex_lock(&dx->dx_lock);
+		list_add_tail(&b->xb_list, &dx->dx_held);
+		pthread_mutex_unlock(&dx->dx_lock);
+	}
+	else if( err ) {
+		dx_answer(b, NULL, err);
+	}
+	else {
+		pthread_mutex_lock(&dx->dx_lock);
+		dx->dx_queries ++;
+		pthread_mutex_unlock(&dx->dx_lock);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_resend
+ *  Description:  Send the batches on dx_held again,  oldest first,  stopping at the
+ *                first the writer still has no room for.
+ * =====================================================================================
+ */
+static void
+dx_resend( dbexist_t *dx)
+{
+	dx_batch_t *b;
+	for(;;) {
+		pthread_mutex_lock(&dx->dx_lock);
+		if( list_empty(&dx->dx_held) ) {
+			pthread_mutex_unlock(&dx->dx_lock);
+			return;
+		}
+		b = list_entry(dx->dx_held.next, dx_batch_t, xb_list);
+		list_del_init(&b->xb_list);
+		pthread_mutex_unlock(&dx->dx_lock);
+		if( dx_send(dx, b) == EAGAIN ) {
+			return;
+		}
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_done
+ *  Description:  A batch's query completed on the writer thread.
+ * =====================================================================================
+ */
+static void
+dx_done( void *arg, PGresult *res, int err)
+{
+	dx_answer((dx_batch_t *) arg, res, err);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dx_answer
+ *  Description:  Answer every fingerprint of a batch,  those res returned exist.  On
+ *                success the answers go on the LRU,  on err the entries are dropped so
+ *                the next check asks again.  The waiters are called once dx_lock is
+ *                released,  then the batch is freed and no longer counted in flight.
+ * =====================================================================================
+ */
+static void
+dx_answer( dx_batch_t *b, PGresult *res, int err)
+{
+	dbexist_t       *dx = b->xb_dx;
+	struct list_head waiters;
+	dx_entry_t      *e,
+	                *n;
+	dx_waiter_t     *w,
+	                *wn;
+	int              i;
+	INIT_LIST_HEAD(&waiters);
+	pthread_mutex_lock(&dx->dx_lock);
+	for(i = 0; ! err && i < PQntuples(res); i ++){
+		e = dx_find(dx, (uint64_t) strtoll(PQgetvalue(res, i, 0), NULL, 10));
+		if( e && e->xe_pending ) {
+			e->xe_exists = true;
+		}
+	}
+	list_for_each_entry_safe(e, n, &b->xb_entries, xe_list){
+		list_for_each_entry(w, &e->xe_waiters, xw_list){
+			w->xw_fp     = e->xe_fp;
+			w->xw_exists = e->xe_exists;
+		}
+		list_splice_init(&e->xe_waiters, waiters.prev);
+		if( err ) {
+			list_del(&e->xe_list);
+			list_del(&e->xe_hash);
+			free(e);
+			continue;
+		}
+		e->xe_pending = false;
+		list_move(&e->xe_list, &dx->dx_lru);
+		dx->dx_cached ++;
+	}
+	dx_evict(dx);
+	pthread_mutex_unlock(&dx->dx_lock);
+	list_for_each_entry_safe(w, wn, &waiters, xw_list){
+		w->xw_fn(w->xw_arg, w->xw_fp, w->xw_exists, err);
+		free(w);
+	}
+	free(b);
+	/* only now may dx_free go ahead */
+	pthread_mutex_lock(&dx->dx_lock);
+	dx->dx_inflight --;
+	pthread_cond_broadcast(&dx->dx_cond);
+	pthread_mutex_unlock(&dx->dx_lock);
+}
@@ -0,0 +1,596 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dbwriter.c
+ *
+ *    Description:  Asynchronous database writer.  Workers copy a statement and its
+ *                  parameters into a request and push it on dw_queue,  waking the
+ *                  writer thread through a pipe only when it is asleep in poll.  The
+ *                  thread hands requests to the connection with the fewest in flight,
+ *                  sends them with PQsendQueryParams on non-blocking connections and
+ *                  reads results as the sockets become readable,  running each
+ *                  request's callback in the order it was sent.
+ *
+ *        Version:  1.0
+ *        Created:  03/11/2026 19:14:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/dbwriter.h>
+#include <azzmos/polite.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define DW_BATCH  64              /* requests taken from the queue at a time */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static void     *dw_run( void *arg);
+static int       dw_take( dbwriter_t *dw);
+static void      dw_dispatch( dbwriter_t *dw);
+static void      dw_connect( dbwriter_t *dw, dw_conn_t *c);
+static void      dw_poll( dbwriter_t *dw, dw_conn_t *c);
+static void      dw_send( dbwriter_t *dw, dw_conn_t *c, dw_req_t *r);
+static void      dw_results( dbwriter_t *dw, dw_conn_t *c);
+static void      dw_reset( dbwriter_t *dw, dw_conn_t *c);
+static void      dw_finish( dbwriter_t *dw, dw_req_t *r, PGresult *res, int err);
+static bool      dw_idle( dbwriter_t *dw);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_init
+ *  Description:  Initilize a writer for the database conninfo names and start its
+ *                thread.  It keeps conns connections with up to depth statements in
+ *                flight on each and queue statements waiting,  zero or less picks
+ *                DW_CONNS,  DW_DEPTH and DW_QUEUE.  Connections are made by the
+ *                thread as statements arrive,  without blocking it.  Statements are
+ *                held for up to DW_HOLD_MS while none is up.  Returns 0 or a errno
+ *                value.
+ * =====================================================================================
+ */
+extern int
+dw_init( dbwriter_t *dw, const char *conninfo, int conns, int depth, size_t queue)
+{
+	int err = ENOMEM,
+	    i;
+	bzero(dw, sizeof(dbwriter_t));
+	dw->dw_nconns = (conns > 0) ? conns : DW_CONNS;
+	dw->dw_depth  = (depth > 0) ? depth : DW_DEPTH;
+	dw->dw_hold_ms = DW_HOLD_MS;
+	INIT_LIST_HEAD(&dw->dw_backlog);
+	if( ! (dw->dw_conninfo = strdup(conninfo))
+			|| ! (dw->dw_conns = (dw_conn_t *) calloc(dw->dw_nconns, sizeof(dw_conn_t))) ) {
+		goto fail;
+	}
+	for(i = 0; i < dw->dw_nconns; i ++){
+		INIT_LIST_HEAD(&dw->dw_conns[i].wc_sent);
+	}
+	if( (err = mq_init(&dw->dw_queue, (queue > 0) ? queue : DW_QUEUE)) ) {
+		goto fail;
+	}
+	if( pipe(dw->dw_wake) == -1 ) {
+		err = errno;
+		mq_destroy(&dw->dw_queue);
+		goto fail;
+	}
+	fcntl(dw->dw_wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(dw->dw_wake[1], F_SETFL, O_NONBLOCK);
+	if( (err = pthread_create(&dw->dw_thread, NULL, dw_run, dw)) ) {
+		close(dw->dw_wake[0]);
+		close(dw->dw_wake[1]);
+		mq_destroy(&dw->dw_queue);
+		goto fail;
+	}
+	return 0;
+fail:
+	free(dw->dw_conns);
+	free(dw->dw_conninfo);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_submit
+ *  Description:  Queue sql with nparams parameters,  as PQexecParams takes them,  to
+ *                be run on the writer thread.  The statement and parameters are copied
+ *                so the caller's may be reused as soon as this returns.  fn is called
+ *                with arg once it completes,  unless this fails.  Returns 0,  EAGAIN if
+ *                the queue is full,  ECANCELED once the writer is closing or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+dw_submit( dbwriter_t *dw, const char *sql, int nparams, const char * const *values,
+		const int *lengths, const int *formats, dw_done_t fn, void *arg)
+{
+	dw_req_t *r;
+	size_t    size = sizeof(dw_req_t) + nparams * (sizeof(char *) + 2 * sizeof(int))
+	               + strlen(sql) + 1,
+	          len;
+	char     *p;
+	int       i,
+	          err;
+	if( __atomic_load_n(&dw->dw_closed, __ATOMIC_ACQUIRE) ) {
+		return ECANCELED;
+	}
+	/* text parameters are copied with their terminator,  binary ones by length */
+	for(i = 0; i < nparams; i ++){
+		if( values[i] ) {
+			size += (formats && formats[i]) ? (size_t) lengths[i] : strlen(values[i]) + 1;
+		}
+	}
+	if( ! (r = (dw_req_t *) malloc(size)) ) {
+		return ENOMEM;
+	}
+	bzero(r, sizeof(dw_req_t));
+	r->dr_nparams = nparams;
+	r->dr_fn      = fn;
+	r->dr_arg     = arg;
+	r->dr_values  = (const char **) (r + 1);
+	r->dr_lengths = (int *) (r->dr_values + nparams);
+	r->dr_formats = r->dr_lengths + nparams;
+	p             = (char *) (r->dr_formats + nparams);
+	for(i = 0; i < nparams; i ++){
+		r->dr_formats[i] = formats ? formats[i] : 0;
+		r->dr_lengths[i] = 0;
+		r->dr_values[i]  = NULL;
+		if( ! values[i] ) {
+			continue;
+		}
+		len = r->dr_formats[i] ? (size_t) lengths[i] : strlen(values[i]) + 1;
+		memcpy(p, values[i], len);
+		r->dr_values[i]  = p;
+		r->dr_lengths[i] = (int) len;
+		p += len;
+	}
+	strcpy(p, sql);
+	r->dr_sql = p;
+	INIT_LIST_HEAD(&r->dr_list);
+	if( (err = mq_push(&dw->dw_queue, r, false)) ) {
+		free(r);
+		return err;
+	}
+	/* the thread sets dw_sleeping before its last look at the queue */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if( __atomic_exchange_n(&dw->dw_sleeping, 0, __ATOMIC_SEQ_CST) ) {
+		if( write(dw->dw_wake[1], "", 1) == -1 && errno != EAGAIN ) {
+			/* the thread wakes on its own within DW_POLL_MS */
+		}
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_close
+ *  Description:  Stop taking statements,  wait for the thread to run those already
+ *                queued and release the writer.  Statements that could not be run
+ *                have their callbacks given ECANCELED,  or ENOTCONN if they were
+ *                held for a connection that can not be made.  Returns 0 or the
+ *                error pthread_join gave.
+ * =====================================================================================
+ */
+extern int
+dw_close( dbwriter_t *dw)
+{
+	void *item;
+	int   err,
+	      i;
+	__atomic_store_n(&dw->dw_closed, 1, __ATOMIC_SEQ_CST);
+	mq_close(&dw->dw_queue);
+	if( write(dw->dw_wake[1], "", 1) == -1 && errno != EAGAIN ) {
+		/* the thread wakes on its own within DW_POLL_MS */
+	}
+	err = pthread_join(dw->dw_thread, NULL);
+	/* a submit that raced the close */
+	while( mq_pop(&dw->dw_queue, &item, false) == 0 ) {
+		dw_finish(dw, (dw_req_t *) item, NULL, ECANCELED);
+	}
+	for(i = 0; i < dw->dw_nconns; i ++){
+		if( dw->dw_conns[i].wc_conn ) {
+			PQfinish(dw->dw_conns[i].wc_conn);
+		}
+	}
+	close(dw->dw_wake[0]);
+	close(dw->dw_wake[1]);
+	mq_destroy(&dw->dw_queue);
+	free(dw->dw_conns);
+	free(dw->dw_conninfo);
+	return err;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_run
+ *  Description:  The writer thread.  Runs until the writer is closed and nothing is
+ *                queued or in flight.
+ * =====================================================================================
+ */
+static void *
+dw_run( void *arg)
+{
+	dbwriter_t   *dw = (dbwriter_t *) arg;
+	struct pollfd fds[1 + dw->dw_nconns];
+	dw_conn_t    *map[1 + dw->dw_nconns];
+	dw_conn_t    *c;
+	char          buf[64];
+	int           n,
+	              i,
+	              r;
+	for(;;) {
+		dw_take(dw);
+		dw_dispatch(dw);
+		for(i = 0; i < dw->dw_nconns; i ++){
+			c = &dw->dw_conns[i];
+			if( c->wc_polling && c->wc_retry <= pl_now() ) {
+				dw_reset(dw, c);
+			}
+			if( c->wc_conn && c->wc_flush ) {
+				if( (r = PQflush(c->wc_conn)) == -1 ) {
+					dw_reset(dw, c);
+				}
+				c->wc_flush = (r == 1);
+			}
+		}
+		if( __atomic_load_n(&dw->dw_closed, __ATOMIC_ACQUIRE) && dw_idle(dw) ) {
+			break;
+		}
+		fds[0].fd     = dw->dw_wake[0];
+		fds[0].events = POLLIN;
+		for(n = 1, i = 0; i < dw->dw_nconns; i ++){
+			c = &dw->dw_conns[i];
+			if( c->wc_conn ) {
+				fds[n].fd      = PQsocket(c->wc_conn);
+				fds[n].events  = POLLIN | (c->wc_flush ? POLLOUT : 0);
+				fds[n].revents = 0;
+				map[n ++]      = c;
+				if( c->wc_polling ) {
+					fds[n - 1].events = (c->wc_wait == PGRES_POLLING_READING) ? POLLIN : POLLOUT;
+				}
+			}
+		}
+		/* a submit after this sees the flag and writes to the pipe */
+		__atomic_store_n(&dw->dw_sleeping, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if( ! dw_take(dw) ) {
+			poll(fds, n, DW_POLL_MS);
+		}
+		__atomic_store_n(&dw->dw_sleeping, 0, __ATOMIC_SEQ_CST);
+		while( read(dw->dw_wake[0], buf, sizeof(buf)) > 0 );
+		for(i = 1; i < n; i ++){
+			c = map[i];
+			if( c->wc_polling ) {
+				if( fds[i].revents ) {
+					dw_poll(dw, c);
+				}
+				continue;
+			}
+			if( fds[i].revents & (POLLIN | POLLERR | POLLHUP) ) {
+				if( ! PQconsumeInput(c->wc_conn) ) {
+					dw_reset(dw, c);
+					continue;
+				}
+				dw_results(dw, c);
+			}
+			if( c->wc_conn && (fds[i].revents & POLLOUT) ) {
+				c->wc_flush = true;
+			}
+		}
+	}
+	return NULL;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_take
+ *  Description:  Move what is queued to the end of dw_backlog,  returns how many.  The
+ *                backlog holds at most as many as the queue,  past that the queue
+ *                fills and dw_submit pushes back with EAGAIN.
+ * =====================================================================================
+ */
+static int
+dw_take( dbwriter_t *dw)
+{
+	void     *items[DW_BATCH];
+	uint64_t  now   = pl_now();
+	int       limit = (int) (dw->dw_queue.mq_mask + 1),
+	          total = 0,
+	          n,
+	          i;
+	while( (n = limit - dw->dw_held) > 0 ) {
+		if( (n = mq_pop_n(&dw->dw_queue, items, (n < DW_BATCH) ? n : DW_BATCH, false)) <= 0 ) {
+			break;
+		}
+		for(i = 0; i < n; i ++){
+			((dw_req_t *) items[i])->dr_since = now;
+			list_add_tail(&((dw_req_t *) items[i])->dr_list, &dw->dw_backlog);
+		}
+		dw->dw_held += n;
+		total       += n;
+	}
+	return total;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_dispatch
+ *  Description:  Send requests from dw_backlog,  each to the connected connection with
+ *                the fewest in flight that has room,  starting to connect those that
+ *                are down when they are due.  While none is up the backlog is held,
+ *                failing with ENOTCONN only the requests held for dw_hold_ms,  or all
+ *                of them once the writer is closing and no connection is being made.
+ * =====================================================================================
+ */
+static void
+dw_dispatch( dbwriter_t *dw)
+{
+	dw_req_t  *r;
+	dw_conn_t *c,
+	          *best;
+	uint64_t   now;
+	bool       up,
+	           polling,
+	           drop;
+	int        i;
+	while( ! list_empty(&dw->dw_backlog) ) {
+		r       = list_entry(dw->dw_backlog.next, dw_req_t, dr_list);
+		best    = NULL;
+		up      = false;
+		polling = false;
+		now     = pl_now();
+		for(i = 0; i < dw->dw_nconns; i ++){
+			c = &dw->dw_conns[i];
+			if( ! c->wc_conn && c->wc_retry <= now ) {
+				dw_connect(dw, c);
+			}
+			if( ! c->wc_conn ) {
+				continue;
+			}
+			if( c->wc_polling ) {
+				polling = true;
+				continue;
+			}
+			up = true;
+			if( c->wc_inflight < (c->wc_pipeline ? dw->dw_depth : 1)
+					&& (! best || c->wc_inflight < best->wc_inflight) ) {
+				best = c;
+			}
+		}
+		if( best ) {
+			list_del_init(&r->dr_list);
+			dw->dw_held --;
+			dw_send(dw, best, r);
+			continue;
+		}
+		if( up ) {
+			return;
+		}
+		drop = __atomic_load_n(&dw->dw_closed, __ATOMIC_ACQUIRE) && ! polling;
+		while( ! list_empty(&dw->dw_backlog) ) {
+			r = list_entry(dw->dw_backlog.next, dw_req_t, dr_list);
+			if( ! drop && now - r->dr_since < (uint64_t) dw->dw_hold_ms ) {
+				break;
+			}
+			list_del_init(&r->dr_list);
+			dw->dw_held --;
+			dw_finish(dw, r, NULL, ENOTCONN);
+		}
+		return;
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_connect
+ *  Description:  Start connecting c.  dw_run polls its socket and hands it to dw_poll
+ *                until it is up,  fails or DW_CONNECT_MS pass.  A attempt that fails
+ *                is not tried again for DW_RECONNECT_MS.
+ * =====================================================================================
+ */
+static void
+dw_connect( dbwriter_t *dw, dw_conn_t *c)
+{
+	c->wc_conn     = PQconnectStart(dw->dw_conninfo);
+	c->wc_polling  = true;
+	c->wc_wait     = PGRES_POLLING_WRITING;
+	c->wc_pipeline = false;
+	c->wc_flush    = false;
+	c->wc_inflight = 0;
+	c->wc_retry    = pl_now() + DW_CONNECT_MS;
+	if( ! c->wc_conn || PQstatus(c->wc_conn) == CONNECTION_BAD ) {
+		dw_reset(dw, c);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_poll
+ *  Description:  Advance the connection c is making once its socket is ready.  When it
+ *                is up put it in non-blocking and where libpq has it pipeline mode.
+ * =====================================================================================
+ */
+static void
+dw_poll( dbwriter_t *dw, dw_conn_t *c)
+{
+	switch( PQconnectPoll(c->wc_conn) ) {
+		case PGRES_POLLING_READING:
+			c->wc_wait = PGRES_POLLING_READING;
+			break;
+		case PGRES_POLLING_WRITING:
+			c->wc_wait = PGRES_POLLING_WRITING;
+			break;
+		case PGRES_POLLING_OK:
+			c->wc_polling = false;
+			if( PQsetnonblocking(c->wc_conn, 1) != 0 ) {
+				dw_reset(dw, c);
+				break;
+			}
+#ifdef LIBPQ_HAS_PIPELINING
+			if( dw->dw_depth > 1 ) {
+				c->wc_pipeline = PQenterPipelineMode(c->wc_conn) == 1;
+			}
+#endif
+			break;
+		default:
+			dw_reset(dw, c);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_send
+ *  Description:  Send a request on c,  in pipeline mode followed by a sync so it is
+ *                its own transaction and a error in it aborts nothing else.
+ * =====================================================================================
+ */
+static void
+dw_send( dbwriter_t *dw, dw_conn_t *c, dw_req_t *r)
+{
+	bool ok = PQsendQueryParams(c->wc_conn, r->dr_sql, r->dr_nparams, NULL, r->dr_values,
+			r->dr_lengths, r->dr_formats, 0) == 1;
+#ifdef LIBPQ_HAS_PIPELINING
+	if( ok && c->wc_pipeline ) {
+		ok = PQpipelineSync(c->wc_conn) == 1;
+	}
+#endif
+	list_add_tail(&r->dr_list, &c->wc_sent);
+	c->wc_inflight ++;
+	dw->dw_sent ++;
+	if( ! ok ) {
+		dw_reset(dw, c);
+		return;
+	}
+	c->wc_flush = true;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_results
+ *  Description:  Hand the results that have arrived on c to their requests.  A request
+ *                is released at the end of its results,  the NULL PQgetResult gives or
+ *                in pipeline mode its sync.  A request ended without a result of its
+ *                own,  one skipped after a earlier error,  is given EIO.
+ * =====================================================================================
+ */
+static void
+dw_results( dbwriter_t *dw, dw_conn_t *c)
+{
+	dw_req_t      *r;
+	PGresult      *res;
+	ExecStatusType st;
+	while( c->wc_conn && ! list_empty(&c->wc_sent) && ! PQisBusy(c->wc_conn) ) {
+		r   = list_entry(c->wc_sent.next, dw_req_t, dr_list);
+		res = PQgetResult(c->wc_conn);
+		if( ! res ) {
+			if( c->wc_pipeline ) {
+				/* between a statement's results and its sync */
+				if( r->dr_done ) {
+					continue;
+				}
+				break;
+			}
+			list_del_init(&r->dr_list);
+			c->wc_inflight --;
+			dw_finish(dw, r, NULL, EIO);
+			continue;
+		}
+		st = PQresultStatus(res);
+#ifdef LIBPQ_HAS_PIPELINING
+		if( st == PGRES_PIPELINE_SYNC ) {
+			PQclear(res);
+			list_del_init(&r->dr_list);
+			c->wc_inflight --;
+			dw_finish(dw, r, NULL, EIO);
+			continue;
+		}
+#endif
+		if( ! r->dr_done ) {
+			r->dr_done = true;
+			if( st != PGRES_COMMAND_OK && st != PGRES_TUPLES_OK ) {
+				dw->dw_failed ++;
+			}
+			r->dr_fn(r->dr_arg, res, (st == PGRES_COMMAND_OK || st == PGRES_TUPLES_OK) ? 0 : EIO);
+		}
+		PQclear(res);
+	}
+	if( c->wc_conn && PQstatus(c->wc_conn) != CONNECTION_OK ) {
+		dw_reset(dw, c);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_reset
+ *  Description:  Drop a broken connection,  or one that could not be made,  failing
+ *                what was in flight on it with EIO.  It is reconnected once a request
+ *                needs it and DW_RECONNECT_MS passed.
+ * =====================================================================================
+ */
+static void
+dw_reset( dbwriter_t *dw, dw_conn_t *c)
+{
+	dw_req_t *r,
+	         *n;
+	list_for_each_entry_safe(r, n, &c->wc_sent, dr_list){
+		list_del_init(&r->dr_list);
+		dw_finish(dw, r, NULL, EIO);
+	}
+	if( c->wc_conn ) {
+		PQfinish(c->wc_conn);
+	}
+	c->wc_conn     = NULL;
+	c->wc_polling  = false;
+	c->wc_inflight = 0;
+	c->wc_flush    = false;
+	c->wc_retry    = pl_now() + DW_RECONNECT_MS;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_finish
+ *  Description:  Release a request on no list,  first giving its callback err if it
+ *                has not yet run.
+ * =====================================================================================
+ */
+static void
+dw_finish( dbwriter_t *dw, dw_req_t *r, PGresult *res, int err)
+{
+	if( ! r->dr_done ) {
+		dw->dw_failed ++;
+		r->dr_fn(r->dr_arg, res, err);
+	}
+	free(r);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dw_idle
+ *  Description:  True if nothing is queued,  waiting or in flight.
+ * =====================================================================================
+ */
+static bool
+dw_idle( dbwriter_t *dw)
+{
+	int i;
+	dw_take(dw);
+	if( ! list_empty(&dw->dw_backlog) ) {
+		return false;
+	}
+	for(i = 0; i < dw->dw_nconns; i ++){
+		if( dw->dw_conns[i].wc_inflight ) {
+			return false;
+		}
+	}
+	return true;
+}
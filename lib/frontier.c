@@ -0,0 +1,653 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  frontier.c
+ *
+ *    Description:  Two level frontier.  A pushed URI goes on the front queue for its
+ *                  priority.  While fewer than fr_max hosts are active,  URIs are moved
+ *                  from the front queues,  chosen by weighted round robin so higher
+ *                  priorities drain faster without starving the rest,  to the back
+ *                  queue of their host.  A host becomes active when its back queue
+ *                  gets a URI and stays active until it is empty and not being fetched.
+ *                  Active hosts with URIs are in a min heap on their next allowed time,
+ *                  a host being fetched leaves the heap until fr_done.  Hosts that go
+ *                  idle stay in the table so their next allowed time is kept.
+ *
+ *        Version:  1.0
+ *        Created:  26/10/2026 19:05:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/frontier.h>
+#include <azzmos/utils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static fr_back_t *fr_back( frontier_t *fr, uint32_t id, bool create);
+static bool       fr_refill( frontier_t *fr);
+static fr_url_t  *fr_front_take( frontier_t *fr);
+static void       fr_heap_push( frontier_t *fr, fr_back_t *b);
+static fr_back_t *fr_heap_pop( frontier_t *fr);
+static void       fr_heap_up( frontier_t *fr, int i);
+static void       fr_heap_down( frontier_t *fr, int i);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_init
+ *  Description:  Initilize the frontier.  delay is the default number of milliseconds
+ *                between requests to a host and backs the number of hosts that may
+ *                have back queues at once,  zero or less picks FR_DELAY_MS and
+ *                FR_BACKS.  A few back queues per worker keeps every worker busy.
+ *                Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+fr_init( frontier_t *fr, long delay, int backs)
+{
+	int err = 0,
+	    i   = 0;
+	bzero(fr, sizeof(frontier_t));
+	fr->fr_delay = (delay > 0) ? delay : FR_DELAY_MS;
+	fr->fr_max   = (backs > 0) ? backs : FR_BACKS;
+	if( ! (fr->fr_heap = (fr_back_t **) malloc(fr->fr_max * sizeof(fr_back_t *))) ) {
+		return ENOMEM;
+	}
+	if( (err = pthread_mutex_init(&fr->fr_lock, NULL)) ) {
+		free(fr->fr_heap);
+		return err;
+	}
+	if( (err = pthread_cond_init(&fr->fr_cond, NULL)) ) {
+		pthread_mutex_destroy(&fr->fr_lock);
+		free(fr->fr_heap);
+		return err;
+	}
+	for(; i < FR_PRIORITIES; i ++){
+		INIT_LIST_HEAD(&fr->fr_front[i]);
+	}
+	for(i = 0; i < FR_BUCKETS; i ++){
+		INIT_LIST_HEAD(&fr->fr_table[i]);
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_push
+ *  Description:  Queue a normalized URI at priority prio,  0 being the highest and
+ *                anything past the last front queue going on it.  data is handed back
+ *                in fu_data when the URI is taken.  Returns 0,  EINVAL if the URI has
+ *                no host or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+fr_push( frontier_t *fr, uriobj_t *uri, int prio, void *data)
+{
+	fr_url_t *u;
+	if( ! hi_uri(uri) ) {
+		return EINVAL;
+	}
+	if( ! (u = (fr_url_t *) malloc(sizeof(fr_url_t))) ) {
+		return ENOMEM;
+	}
+	u->fu_uri  = uri;
+	u->fu_data = data;
+	u->fu_prio = (prio < 0) ? 0 : (prio >= FR_PRIORITIES) ? FR_PRIORITIES - 1 : prio;
+	u->fu_back = NULL;
+	pthread_mutex_lock(&fr->fr_lock);
+	list_add_tail(&u->fu_list, &fr->fr_front[u->fu_prio]);
+	fr->fr_queued ++;
+	if( fr_refill(fr) ) {
+		pthread_cond_signal(&fr->fr_cond);
+	}
+	pthread_mutex_unlock(&fr->fr_lock);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_pop
+ *  Description:  Take the next URI whose host may be fetched now,  the first of the
+ *                host at the top of the heap.  If that host's time has not come and
+ *                wait is true the call sleeps until it has,  or until the top
+ *                changes,  otherwise EAGAIN is returned.  ECANCELED is returned once
+ *                the frontier is closed.  The host is not offered again until fr_done
+ *                is called with the URI.
+ * =====================================================================================
+ */
+extern int
+fr_pop( frontier_t *fr, bool wait, fr_url_t **url)
+{
+	struct timespec ts;
+	fr_back_t      *b;
+	fr_url_t       *u;
+	uint64_t        now,
+	                ms;
+	pthread_mutex_lock(&fr->fr_lock);
+	for(;;) {
+		if( fr->fr_closed ) {
+			pthread_mutex_unlock(&fr->fr_lock);
+			return ECANCELED;
+		}
+		now = pl_now();
+		if( fr->fr_heapn && fr->fr_heap[0]->fb_next <= now ) {
+			break;
+		}
+		if( ! wait ) {
+			pthread_mutex_unlock(&fr->fr_lock);
+			return EAGAIN;
+		}
+		if( ! fr->fr_heapn ) {
+			pthread_cond_wait(&fr->fr_cond, &fr->fr_lock);
+			continue;
+		}
+		ms = fr->fr_heap[0]->fb_next - now;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec  += ms / 1000;
+		ts.tv_nsec += (ms % 1000) * 1000000L;
+		if( ts.tv_nsec >= 1000000000L ) {
+			ts.tv_sec  ++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&fr->fr_cond, &fr->fr_lock, &ts);
+	}
+	b = fr_heap_pop(fr);
+	u = list_entry(b->fb_urls.next, fr_url_t, fu_list);
+	list_del_init(&u->fu_list);
+	b->fb_queued --;
+	b->fb_busy  = true;
+	b->fb_fetch = u;
+	b->fb_next = now + b->fb_delay;
+	fr->fr_queued --;
+	pthread_mutex_unlock(&fr->fr_lock);
+	*url = u;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_done
+ *  Description:  The fetch of a URI taken with fr_pop has finished,  free url.  The
+ *                URI itself is not freed.  The host goes back in the heap if it has
+ *                URIs queued,  otherwise it goes idle and its slot is used to move
+ *                more URIs off the front queues.
+ * =====================================================================================
+ */
+extern void
+fr_done( frontier_t *fr, fr_url_t *url)
+{
+	fr_back_t *b = url->fu_back;
+	free(url);
+	pthread_mutex_lock(&fr->fr_lock);
+	b->fb_busy  = false;
+	b->fb_fetch = NULL;
+	if( b->fb_queued ) {
+		fr_heap_push(fr, b);
+	}
+	else {
+		fr->fr_active --;
+		fr_refill(fr);
+	}
+	pthread_cond_broadcast(&fr->fr_cond);
+	pthread_mutex_unlock(&fr->fr_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_set_host
+ *  Description:  Set the milliseconds between requests to host,  for a Crawl-delay.
+ *                Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+fr_set_host( frontier_t *fr, const char *host, long delay)
+{
+	fr_back_t *b  = NULL;
+	uint32_t   id = hi_intern(host, strlen(host));
+	pthread_mutex_lock(&fr->fr_lock);
+	if( id && (b = fr_back(fr, id, true)) ) {
+		b->fb_delay = (delay > 0) ? delay : fr->fr_delay;
+	}
+	pthread_mutex_unlock(&fr->fr_lock);
+	return b ? 0 : ENOMEM;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_save
+ *  Description:  Write the hosts,  with their delays and next allowed times,  and every
+ *                URI queued or being fetched to path.  URIs are saved as strings with
+ *                their priority,  caller data is not saved.  It replaces path
+ *                atomically with file_replace.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+fr_save( frontier_t *fr, const char *path)
+{
+	fr_shead_t   fs;
+	fr_shost_t  *hosts;
+	fr_surl_t   *urls;
+	fr_back_t   *b;
+	fr_url_t    *u;
+	char        *strs = NULL;
+	struct iovec iov[4];
+	size_t       slen = 0,
+	             nh   = 0,
+	             nu   = 0;
+	uint64_t     now;
+	int          err  = 0,
+	             i    = 0;
+	pthread_mutex_lock(&fr->fr_lock);
+	hosts = (fr_shost_t *) calloc(fr->fr_hosts + 1, sizeof(fr_shost_t));
+	urls  = (fr_surl_t *) calloc(fr->fr_queued + fr->fr_active + 1, sizeof(fr_surl_t));
+	/* the sizes first so the strings are one allocation */
+	for(; i < FR_BUCKETS; i ++){
+		list_for_each_entry(b, &fr->fr_table[i], fb_hash){
+			slen += strlen(b->fb_key) + 1;
+			if( b->fb_fetch ) {
+				slen += uri_url_str(b->fb_fetch->fu_uri, NULL) + 1;
+			}
+			list_for_each_entry(u, &b->fb_urls, fu_list){
+				slen += uri_url_str(u->fu_uri, NULL) + 1;
+			}
+		}
+	}
+	for(i = 0; i < FR_PRIORITIES; i ++){
+		list_for_each_entry(u, &fr->fr_front[i], fu_list){
+			slen += uri_url_str(u->fu_uri, NULL) + 1;
+		}
+	}
+	if( ! hosts || ! urls || ! (strs = (char *) malloc(slen + 1)) ) {
+		pthread_mutex_unlock(&fr->fr_lock);
+		free(hosts);
+		free(urls);
+		return ENOMEM;
+	}
+	now  = pl_now();
+	slen = 0;
+	for(i = 0; i < FR_BUCKETS; i ++){
+		list_for_each_entry(b, &fr->fr_table[i], fb_hash){
+			hosts[nh].fh_name  = slen;
+			hosts[nh].fh_len   = strlen(b->fb_key);
+			hosts[nh].fh_delay = b->fb_delay;
+			hosts[nh].fh_wait  = (b->fb_next > now) ? b->fb_next - now : 0;
+			memcpy(strs + slen, b->fb_key, hosts[nh].fh_len + 1);
+			slen += hosts[nh ++].fh_len + 1;
+			/* the URI being fetched goes back first,  it was taken first */
+			if( (u = b->fb_fetch) ) {
+				urls[nu].su_url  = slen;
+				urls[nu].su_len  = uri_url_str(u->fu_uri, strs + slen);
+				urls[nu].su_prio = u->fu_prio;
+				slen += urls[nu ++].su_len + 1;
+			}
+			list_for_each_entry(u, &b->fb_urls, fu_list){
+				urls[nu].su_url  = slen;
+				urls[nu].su_len  = uri_url_str(u->fu_uri, strs + slen);
+				urls[nu].su_prio = u->fu_prio;
+				slen += urls[nu ++].su_len + 1;
+			}
+		}
+	}
+	for(i = 0; i < FR_PRIORITIES; i ++){
+		list_for_each_entry(u, &fr->fr_front[i], fu_list){
+			urls[nu].su_url  = slen;
+			urls[nu].su_len  = uri_url_str(u->fu_uri, strs + slen);
+			urls[nu].su_prio = i;
+			slen += urls[nu ++].su_len + 1;
+		}
+	}
+	pthread_mutex_unlock(&fr->fr_lock);
+	bzero(&fs, sizeof(fr_shead_t));
+	memcpy(fs.fs_magic, FR_MAGIC, sizeof(fs.fs_magic));
+	fs.fs_hosts   = nh;
+	fs.fs_urls    = nu;
+	fs.fs_strings = sizeof(fr_shead_t) + nh * sizeof(fr_shost_t) + nu * sizeof(fr_surl_t);
+	fs.fs_size    = fs.fs_strings + slen;
+	iov[0].iov_base = &fs;
+	iov[0].iov_len  = sizeof(fr_shead_t);
+	iov[1].iov_base = hosts;
+	iov[1].iov_len  = nh * sizeof(fr_shost_t);
+	iov[2].iov_base = urls;
+	iov[2].iov_len  = nu * sizeof(fr_surl_t);
+	iov[3].iov_base = strs;
+	iov[3].iov_len  = slen;
+	err = file_replace(path, iov, 4);
+	free(hosts);
+	free(urls);
+	free(strs);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_load
+ *  Description:  Restore a frontier saved by fr_save into a initilized one.  The file
+ *                is mapped and read in place,  each URL is passed to parse which
+ *                returns a normalized URI to push,  or NULL to drop the URL.  The URIs
+ *                are pushed with no caller data.  Returns 0,  EINVAL if the file is not
+ *                a complete save or a errno value.
+ * =====================================================================================
+ */
+extern int
+fr_load( frontier_t *fr, const char *path,
+         uriobj_t *(*parse)( void *arg, const char *url), void *arg)
+{
+	struct stat       st;
+	const fr_shead_t *fs;
+	const fr_shost_t *h;
+	const fr_surl_t  *su;
+	const char       *strs;
+	fr_back_t        *b;
+	uriobj_t         *uri;
+	void             *map;
+	uint64_t          slen,
+	                  now,
+	                  i   = 0;
+	uint32_t          id;
+	int               fd,
+	                  err = 0;
+	if( (fd = open(path, O_RDONLY)) == -1 ) {
+		return errno;
+	}
+	if( fstat(fd, &st) == -1 ) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	if( (size_t) st.st_size < sizeof(fr_shead_t) ) {
+		close(fd);
+		return EINVAL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	err = (map == MAP_FAILED) ? errno : 0;
+	close(fd);
+	if( err ) {
+		return err;
+	}
+	fs = (const fr_shead_t *) map;
+	if( memcmp(fs->fs_magic, FR_MAGIC, sizeof(fs->fs_magic)) != 0
+			|| fs->fs_size != (uint64_t) st.st_size
+			|| fs->fs_hosts > fs->fs_size / sizeof(fr_shost_t)
+			|| fs->fs_urls > fs->fs_size / sizeof(fr_surl_t)
+			|| fs->fs_strings != sizeof(fr_shead_t) + fs->fs_hosts * sizeof(fr_shost_t)
+					+ fs->fs_urls * sizeof(fr_surl_t)
+			|| fs->fs_strings > fs->fs_size ) {
+		munmap(map, st.st_size);
+		return EINVAL;
+	}
+	h    = (const fr_shost_t *) (fs + 1);
+	su   = (const fr_surl_t *) (h + fs->fs_hosts);
+	strs = (const char *) map + fs->fs_strings;
+	slen = fs->fs_size - fs->fs_strings;
+	pthread_mutex_lock(&fr->fr_lock);
+	now = pl_now();
+	for(; ! err && i < fs->fs_hosts; i ++, h ++){
+		if( h->fh_name >= slen || h->fh_len >= slen - h->fh_name
+				|| strs[h->fh_name + h->fh_len] != '\0' ) {
+			err = EINVAL;
+		}
+		else if( ! (id = hi_intern(strs + h->fh_name, h->fh_len))
+				|| ! (b = fr_back(fr, id, true)) ) {
+			err = ENOMEM;
+		}
+		else {
+			b->fb_delay = (h->fh_delay > 0) ? h->fh_delay : fr->fr_delay;
+			b->fb_next  = now + h->fh_wait;
+		}
+	}
+	pthread_mutex_unlock(&fr->fr_lock);
+	for(i = 0; ! err && i < fs->fs_urls; i ++, su ++){
+		if( su->su_url >= slen || su->su_len >= slen - su->su_url
+				|| strs[su->su_url + su->su_len] != '\0' ) {
+			err = EINVAL;
+		}
+		else if( (uri = parse(arg, strs + su->su_url)) ) {
+			err = fr_push(fr, uri, su->su_prio, NULL);
+		}
+	}
+	munmap(map, st.st_size);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_close
+ *  Description:  Wake every waiting fr_pop and make them return ECANCELED.
+ * =====================================================================================
+ */
+extern void
+fr_close( frontier_t *fr)
+{
+	pthread_mutex_lock(&fr->fr_lock);
+	fr->fr_closed = true;
+	pthread_cond_broadcast(&fr->fr_cond);
+	pthread_mutex_unlock(&fr->fr_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_destroy
+ *  Description:  Release the frontier,  its hosts and any URIs queued.  URIs taken with
+ *                fr_pop and not yet returned must not be passed to fr_done afterwards.
+ * =====================================================================================
+ */
+extern void
+fr_destroy( frontier_t *fr)
+{
+	fr_back_t *b,
+	          *bn;
+	fr_url_t  *u,
+	          *un;
+	int        i = 0;
+	for(; i < FR_PRIORITIES; i ++){
+		list_for_each_entry_safe(u, un, &fr->fr_front[i], fu_list){
+			free(u);
+		}
+	}
+	for(i = 0; i < FR_BUCKETS; i ++){
+		list_for_each_entry_safe(b, bn, &fr->fr_table[i], fb_hash){
+			list_for_each_entry_safe(u, un, &b->fb_urls, fu_list){
+				free(u);
+			}
+			free(b);
+		}
+	}
+	free(fr->fr_heap);
+	pthread_cond_destroy(&fr->fr_cond);
+	pthread_mutex_destroy(&fr->fr_lock);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_back
+ *  Description:  Find the host id in the table,  adding it idle if create is true.
+ *                Called with fr_lock held.
+ * =====================================================================================
+ */
+static fr_back_t *
+fr_back( frontier_t *fr, uint32_t id, bool create)
+{
+	struct list_head *bucket = &fr->fr_table[id % FR_BUCKETS];
+	fr_back_t        *b;
+	list_for_each_entry(b, bucket, fb_hash){
+		if( b->fb_id == id ) {
+			return b;
+		}
+	}
+	if( ! create ) {
+		return NULL;
+	}
+	if( ! (b = (fr_back_t *) malloc(sizeof(fr_back_t))) ) {
+		return NULL;
+	}
+	bzero(b, sizeof(fr_back_t));
+	b->fb_id    = id;
+	b->fb_key   = hi_name(id);
+	b->fb_delay = fr->fr_delay;
+	b->fb_heap  = -1;
+	INIT_LIST_HEAD(&b->fb_urls);
+	list_add(&b->fb_hash, bucket);
+	fr->fr_hosts ++;
+	return b;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_refill
+ *  Description:  Move URIs from the front queues to their hosts' back queues while
+ *                fewer than fr_max hosts are active.  A URI whose host is already
+ *                active joins its queue without using a slot.  If a host can not be
+ *                added for lack of memory its URI is put back and moving stops.
+ *                Returns true if a host was added to the heap.  Called with fr_lock
+ *                held.
+ * =====================================================================================
+ */
+static bool
+fr_refill( frontier_t *fr)
+{
+	fr_back_t *b;
+	fr_url_t  *u;
+	bool       added = false;
+	while( fr->fr_active < fr->fr_max && (u = fr_front_take(fr)) ) {
+		if( ! (b = fr_back(fr, hi_uri(u->fu_uri), true)) ) {
+			list_add(&u->fu_list, &fr->fr_front[u->fu_prio]);
+			break;
+		}
+		u->fu_back = b;
+		list_add_tail(&u->fu_list, &b->fb_urls);
+		if( ! b->fb_queued ++ && ! b->fb_busy ) {
+			fr->fr_active ++;
+			fr_heap_push(fr, b);
+			added = true;
+		}
+	}
+	return added;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_front_take
+ *  Description:  Take the first URI of a front queue picked by smooth weighted round
+ *                robin,  queue i having weight FR_PRIORITIES - i among those that are
+ *                not empty.  NULL if every front queue is empty.
+ * =====================================================================================
+ */
+static fr_url_t *
+fr_front_take( frontier_t *fr)
+{
+	fr_url_t *u;
+	int       total = 0,
+	          best  = -1,
+	          i     = 0;
+	for(; i < FR_PRIORITIES; i ++){
+		if( list_empty(&fr->fr_front[i]) ) {
+			continue;
+		}
+		fr->fr_credit[i] += FR_PRIORITIES - i;
+		total            += FR_PRIORITIES - i;
+		if( best < 0 || fr->fr_credit[i] > fr->fr_credit[best] ) {
+			best = i;
+		}
+	}
+	if( best < 0 ) {
+		return NULL;
+	}
+	fr->fr_credit[best] -= total;
+	u = list_entry(fr->fr_front[best].next, fr_url_t, fu_list);
+	list_del_init(&u->fu_list);
+	return u;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_heap_push
+ *  Description:  Add a host to the heap on its fb_next.
+ * =====================================================================================
+ */
+static void
+fr_heap_push( frontier_t *fr, fr_back_t *b)
+{
+	b->fb_heap = fr->fr_heapn;
+	fr->fr_heap[fr->fr_heapn ++] = b;
+	fr_heap_up(fr, b->fb_heap);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_heap_pop
+ *  Description:  Remove and return the host with the earliest fb_next.
+ * =====================================================================================
+ */
+static fr_back_t *
+fr_heap_pop( frontier_t *fr)
+{
+	fr_back_t *b = fr->fr_heap[0];
+	b->fb_heap = -1;
+	if( -- fr->fr_heapn ) {
+		fr->fr_heap[0] = fr->fr_heap[fr->fr_heapn];
+		fr->fr_heap[0]->fb_heap = 0;
+		fr_heap_down(fr, 0);
+	}
+	return b;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_heap_up
+ *  Description:  Move the host at i towards the top until its parent is not later.
+ * =====================================================================================
+ */
+static void
+fr_heap_up( frontier_t *fr, int i)
+{
+	fr_back_t *b = fr->fr_heap[i];
+	int        p;
+	for(; i; i = p){
+		p = (i - 1) / 2;
+		if( fr->fr_heap[p]->fb_next <= b->fb_next ) {
+			break;
+		}
+		fr->fr_heap[i] = fr->fr_heap[p];
+		fr->fr_heap[i]->fb_heap = i;
+	}
+	fr->fr_heap[i] = b;
+	b->fb_heap = i;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fr_heap_down
+ *  Description:  Move the host at i away from the top until neither child is earlier.
+ * =====================================================================================
+ */
+static void
+fr_heap_down( frontier_t *fr, int i)
+{
+	fr_back_t *b = fr->fr_heap[i];
+	int        c;
+	for(; (c = 2 * i + 1) < fr->fr_heapn; i = c){
+		if( c + 1 < fr->fr_heapn && fr->fr_heap[c + 1]->fb_next < fr->fr_heap[c]->fb_next ) {
+			c ++;
+		}
+		if( b->fb_next <= fr->fr_heap[c]->fb_next ) {
+			break;
+		}
+		fr->fr_heap[i] = fr->fr_heap[c];
+		fr->fr_heap[i]->fb_heap = i;
+	}
+	fr->fr_heap[i] = b;
+	b->fb_heap = i;
+}
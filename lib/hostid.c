@@ -0,0 +1,312 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  hostid.c
+ *
+ *    Description:  Host interning table.  Hosts are found through a open addressed
+ *                  hash table whose slots pack the upper half of the host's hash with
+ *                  its id,  the name is only compared once those match.  Ids index a
+ *                  directory of fixed size chunks holding a pointer to each name and
+ *                  the names are copied into blocks that are never freed,  so a id or
+ *                  name handed out stays valid for the life of the process.
+ *
+ *                  Readers take no lock.  A new host is added under hi_lock,  its name
+ *                  is published in the directory before its slot so a reader that
+ *                  finds the slot can read the name.  The table is replaced by one
+ *                  twice the size when it is 3/4 full,  the old table is kept since a
+ *                  reader may still be probing it,  at worst that reader misses and
+ *                  looks again under the lock.
+ *
+ *        Version:  1.0
+ *        Created:  29/10/2026 19:22:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/hostid.h>
+#include <azzmos/utils.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define HI_CHUNK       (1u << HI_CHUNK_BITS)
+#define HI_CHUNKS      (1u << (32 - HI_CHUNK_BITS))
+#define HI_SLOT(h, id) (((uint64_t) (h) << 32) | (id))
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct hi_table_s {
+	uint64_t           ht_size;     /* slots,  a power of two */
+	struct hi_table_s *ht_prev;     /* table this one replaced */
+	uint64_t           ht_slots[];  /* hash << 32 | id,  0 for a empty slot */
+} typedef hi_table_t;
+
+struct hi_block_s {
+	struct hi_block_s *hb_next;     /* block filled before this one */
+	size_t             hb_used;     /* bytes of hb_data handed out */
+	size_t             hb_size;     /* bytes in hb_data */
+	char               hb_data[];
+} typedef hi_block_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static uint32_t    hi_find( hi_table_t *ht, uint32_t h, const char *host, size_t len);
+static int         hi_grow( void);
+static const char *hi_copy( const char *host, size_t len);
+static uint32_t    hi_hash( const char *host, size_t len);
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ################################ */
+static pthread_mutex_t hi_lock = PTHREAD_MUTEX_INITIALIZER;   /* serializes adding */
+static hi_table_t     *hi_table;                              /* current hash table */
+static const char    **hi_dir[HI_CHUNKS];                     /* id to name */
+static uint32_t        hi_ids;                                /* ids handed out */
+static hi_block_t     *hi_names;                              /* block being filled */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_intern
+ *  Description:  The id of the len bytes at host,  adding the host if it has not been
+ *                seen.  The host should already be normalized,  names differing only
+ *                in case are different hosts here.  Returns HI_NONE if the host is
+ *                empty or memory ran out.
+ * =====================================================================================
+ */
+extern uint32_t
+hi_intern( const char *host, size_t len)
+{
+	uint32_t      h  = hi_hash(host, len),
+	              id = HI_NONE;
+	uint64_t      i;
+	hi_table_t   *ht;
+	const char  **chunk,
+	             *name;
+	if( ! len ) {
+		return HI_NONE;
+	}
+	if( (ht = __atomic_load_n(&hi_table, __ATOMIC_ACQUIRE))
+			&& (id = hi_find(ht, h, host, len)) ) {
+		return id;
+	}
+	pthread_mutex_lock(&hi_lock);
+	if( ! hi_table && hi_grow() ) {
+		pthread_mutex_unlock(&hi_lock);
+		return HI_NONE;
+	}
+	/* another thread may have added it since */
+	if( (id = hi_find(hi_table, h, host, len)) ) {
+		pthread_mutex_unlock(&hi_lock);
+		return id;
+	}
+	if( ((uint64_t) hi_ids + 1) * 4 >= hi_table->ht_size * 3 && hi_grow() ) {
+		pthread_mutex_unlock(&hi_lock);
+		return HI_NONE;
+	}
+	if( hi_ids == UINT32_MAX || ! (name = hi_copy(host, len)) ) {
+		pthread_mutex_unlock(&hi_lock);
+		return HI_NONE;
+	}
+	id = hi_ids + 1;
+	if( ! (chunk = hi_dir[id >> HI_CHUNK_BITS]) ) {
+		if( ! (chunk = (const char **) calloc(HI_CHUNK, sizeof(char *))) ) {
+			pthread_mutex_unlock(&hi_lock);
+			return HI_NONE;
+		}
+		__atomic_store_n(&hi_dir[id >> HI_CHUNK_BITS], chunk, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&chunk[id & (HI_CHUNK - 1)], name, __ATOMIC_RELEASE);
+	ht = hi_table;
+	for(i = h & (ht->ht_size - 1); ht->ht_slots[i]; i = (i + 1) & (ht->ht_size - 1));
+	__atomic_store_n(&hi_ids, id, __ATOMIC_RELEASE);
+	__atomic_store_n(&ht->ht_slots[i], HI_SLOT(h, id), __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&hi_lock);
+	return id;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_lookup
+ *  Description:  The id of a host that has been interned,  HI_NONE if it has not.
+ * =====================================================================================
+ */
+extern uint32_t
+hi_lookup( const char *host, size_t len)
+{
+	hi_table_t *ht = __atomic_load_n(&hi_table, __ATOMIC_ACQUIRE);
+	uint32_t    id;
+	if( ! ht || ! len ) {
+		return HI_NONE;
+	}
+	if( (id = hi_find(ht, hi_hash(host, len), host, len)) ) {
+		return id;
+	}
+	/* the table may have been replaced while it was probed */
+	pthread_mutex_lock(&hi_lock);
+	id = hi_find(hi_table, hi_hash(host, len), host, len);
+	pthread_mutex_unlock(&hi_lock);
+	return id;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_name
+ *  Description:  The shared,  NUL terminated,  name of a host id.  NULL if id has not
+ *                been handed out.  The string must not be changed or freed.
+ * =====================================================================================
+ */
+extern const char *
+hi_name( uint32_t id)
+{
+	const char **chunk;
+	if( id == HI_NONE || id > __atomic_load_n(&hi_ids, __ATOMIC_ACQUIRE) ) {
+		return NULL;
+	}
+	chunk = __atomic_load_n(&hi_dir[id >> HI_CHUNK_BITS], __ATOMIC_ACQUIRE);
+	return __atomic_load_n(&chunk[id & (HI_CHUNK - 1)], __ATOMIC_ACQUIRE);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_count
+ *  Description:  Hosts interned so far,  also the highest id handed out.
+ * =====================================================================================
+ */
+extern uint32_t
+hi_count( void)
+{
+	return __atomic_load_n(&hi_ids, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_uri
+ *  Description:  The host id of a URI,  interning its normalized host name or for a IP
+ *                literal the address the first time and keeping it in uri_hostid.
+ *                uri_normalize sets it so this is normally a field read.  Returns
+ *                HI_NONE if the URI has no host or memory ran out.
+ * =====================================================================================
+ */
+extern uint32_t
+hi_uri( uriobj_t *uri)
+{
+	char *key = NULL;
+	if( uri->uri_hostid ) {
+		return uri->uri_hostid;
+	}
+	if( uri->uri_flags & URI_IP && uri->uri_ip && *uri->uri_ip ) {
+		key = *uri->uri_ip;
+	}
+	else if( uri->uri_host && *uri->uri_host ) {
+		key = *uri->uri_host;
+	}
+	if( key ) {
+		uri->uri_hostid = hi_intern(key, strlen(key));
+	}
+	return uri->uri_hostid;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_find
+ *  Description:  Probe ht for the host,  its id or HI_NONE.  Safe without hi_lock.
+ * =====================================================================================
+ */
+static uint32_t
+hi_find( hi_table_t *ht, uint32_t h, const char *host, size_t len)
+{
+	uint64_t    mask = ht->ht_size - 1,
+	            i    = h & mask,
+	            s;
+	const char *name;
+	for(; (s = __atomic_load_n(&ht->ht_slots[i], __ATOMIC_ACQUIRE)); i = (i + 1) & mask){
+		if( (uint32_t) (s >> 32) != h ) {
+			continue;
+		}
+		name = hi_name((uint32_t) s);
+		if( name && strncmp(name, host, len) == 0 && name[len] == '\0' ) {
+			return (uint32_t) s;
+		}
+	}
+	return HI_NONE;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_grow
+ *  Description:  Replace the table with one twice the size,  or create the first.
+ *                Called with hi_lock held.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+hi_grow( void)
+{
+	hi_table_t *old  = hi_table,
+	           *ht;
+	uint64_t    size = old ? 2 * old->ht_size : HI_MIN_SLOTS,
+	            i    = 0,
+	            j;
+	ht = (hi_table_t *) calloc(1, sizeof(hi_table_t) + size * sizeof(uint64_t));
+	if( ! ht ) {
+		return ENOMEM;
+	}
+	ht->ht_size = size;
+	ht->ht_prev = old;
+	for(; old && i < old->ht_size; i ++){
+		if( ! old->ht_slots[i] ) {
+			continue;
+		}
+		for(j = (old->ht_slots[i] >> 32) & (size - 1); ht->ht_slots[j]; j = (j + 1) & (size - 1));
+		ht->ht_slots[j] = old->ht_slots[i];
+	}
+	__atomic_store_n(&hi_table, ht, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_copy
+ *  Description:  Copy a name into the current block,  starting a new one when it does
+ *                not fit.  Called with hi_lock held.  NULL if memory ran out.
+ * =====================================================================================
+ */
+static const char *
+hi_copy( const char *host, size_t len)
+{
+	hi_block_t *b = hi_names;
+	char       *name;
+	size_t      size;
+	if( ! b || b->hb_size - b->hb_used < len + 1 ) {
+		size = len + 1 > HI_ARENA ? len + 1 : HI_ARENA;
+		if( ! (b = (hi_block_t *) malloc(sizeof(hi_block_t) + size)) ) {
+			return NULL;
+		}
+		b->hb_next = hi_names;
+		b->hb_used = 0;
+		b->hb_size = size;
+		hi_names   = b;
+	}
+	name = b->hb_data + b->hb_used;
+	memcpy(name, host, len);
+	name[len] = '\0';
+	b->hb_used += len + 1;
+	return name;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  hi_hash
+ *  Description:  The 32 bits of a host's hash kept in its slot,  never 0 so a slot
+ *                holding id and hash is never mistaken for a empty one.
+ * =====================================================================================
+ */
+static uint32_t
+hi_hash( const char *host, size_t len)
+{
+	uint32_t h = (uint32_t) (mem_hash64(host, len) >> 32);
+	return h ? h : 1;
+}
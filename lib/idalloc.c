@@ -0,0 +1,338 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  idalloc.c
+ *
+ *    Description:  uri_id allocator.  The allocator holds the current range and at most
+ *                  one spare behind it under ia_lock,  a thread only takes that lock to
+ *                  move IA_LOCAL ids into its cache.  Ranges are requested through
+ *                  dw_submit and arrive in ia_done on the writer thread.
+ *
+ *        Version:  1.0
+ *        Created:  04/11/2026 18:22:37
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/idalloc.h>
+#include <azzmos/dbcopy.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define IA_RANGE_SQL  "SELECT nextval($1::regclass), seqincrement FROM pg_catalog.pg_sequence " \
+                      "WHERE seqrelid = $1::regclass"
+#define IA_RETRY_MS   10          /* wait before asking again when the writer was full */
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct ia_tcache_s {
+	int64_t tc_next;   /* next id in the thread's cache */
+	int64_t tc_end;    /* one past the last */
+} typedef ia_tcache_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static ia_tcache_t *ia_tcache( idalloc_t *ia);
+static void         ia_want( idalloc_t *ia, bool now);
+static void         ia_done( void *arg, PGresult *res, int err);
+static int          ia_add( idalloc_t *ia, int64_t first, int64_t count);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_init
+ *  Description:  Initilize a allocator reserving ranges from the sequence seq,  NULL
+ *                for DC_SEQ,  through dw.  The first range is requested at once.
+ *                Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ia_init( idalloc_t *ia, dbwriter_t *dw, const char *seq)
+{
+	int err;
+	bzero(ia, sizeof(idalloc_t));
+	ia->ia_dw = dw;
+	if( ! (ia->ia_seq = strdup(seq ? seq : DC_SEQ)) ) {
+		return ENOMEM;
+	}
+	if( (err = pthread_mutex_init(&ia->ia_lock, NULL)) ) {
+		free(ia->ia_seq);
+		return err;
+	}
+	if( (err = pthread_cond_init(&ia->ia_cond, NULL)) ) {
+		pthread_mutex_destroy(&ia->ia_lock);
+		free(ia->ia_seq);
+		return err;
+	}
+	if( (err = pthread_key_create(&ia->ia_key, free)) ) {
+		pthread_cond_destroy(&ia->ia_cond);
+		pthread_mutex_destroy(&ia->ia_lock);
+		free(ia->ia_seq);
+		return err;
+	}
+	pthread_mutex_lock(&ia->ia_lock);
+	ia_want(ia, true);
+	pthread_mutex_unlock(&ia->ia_lock);
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_next
+ *  Description:  Give out the next id.  Usually it comes from the thread's cache,
+ *                otherwise IA_LOCAL more are taken from the current range.  With no
+ *                ids left and wait true the call blocks until the requested range
+ *                arrives,  asking again every IA_RETRY_MS while the writer's queue is
+ *                too full to take the request.  Returns 0,  EAGAIN if none are left
+ *                and wait is false or the error the request for a range failed with.
+ * =====================================================================================
+ */
+extern int
+ia_next( idalloc_t *ia, bool wait, int64_t *id)
+{
+	ia_tcache_t *tc = ia_tcache(ia);
+	int64_t      n;
+	struct timespec ts;
+	bool         asked = false;
+	int          err;
+	if( tc && tc->tc_next < tc->tc_end ) {
+		*id = tc->tc_next ++;
+		return 0;
+	}
+	pthread_mutex_lock(&ia->ia_lock);
+	for(;;) {
+		if( ia->ia_next == ia->ia_end && ia->ia_spare != ia->ia_spare_end ) {
+			ia->ia_next  = ia->ia_spare;
+			ia->ia_end   = ia->ia_spare_end;
+			ia->ia_spare = ia->ia_spare_end = 0;
+		}
+		if( ia->ia_next < ia->ia_end ) {
+			n = ia->ia_end - ia->ia_next;
+			if( n > (tc ? IA_LOCAL : 1) ) {
+				n = tc ? IA_LOCAL : 1;
+			}
+			*id = ia->ia_next;
+			if( tc ) {
+				tc->tc_next = ia->ia_next + 1;
+				tc->tc_end  = ia->ia_next + n;
+			}
+			ia->ia_next += n;
+			ia_want(ia, false);
+			pthread_mutex_unlock(&ia->ia_lock);
+			return 0;
+		}
+		if( ! asked ) {
+			ia->ia_waits ++;
+			asked = true;
+			ia_want(ia, true);
+		}
+		else if( ! ia->ia_pending && ia->ia_err == EAGAIN ) {
+			ia_want(ia, true);
+		}
+		/* the request failed with nothing left */
+		if( ! ia->ia_pending && ia->ia_err != EAGAIN ) {
+			err = ia->ia_err ? ia->ia_err : EIO;
+			break;
+		}
+		if( ! wait ) {
+			err = EAGAIN;
+			break;
+		}
+		if( ia->ia_pending ) {
+			pthread_cond_wait(&ia->ia_cond, &ia->ia_lock);
+			continue;
+		}
+		/* the writer had no room,  a range may still be added by ia_add_range */
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += IA_RETRY_MS * 1000000L;
+		if( ts.tv_nsec >= 1000000000L ) {
+			ts.tv_sec  ++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&ia->ia_cond, &ia->ia_lock, &ts);
+	}
+	pthread_mutex_unlock(&ia->ia_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_assign
+ *  Description:  Set uri_id to the next id.  Returns as ia_next.
+ * =====================================================================================
+ */
+extern int
+ia_assign( idalloc_t *ia, uriobj_t *uri, bool wait)
+{
+	int64_t id;
+	int     err = ia_next(ia, wait, &id);
+	if( ! err ) {
+		uri->uri_id = (long) id;
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_add_range
+ *  Description:  Add count ids from first reserved elsewhere,  for example by a
+ *                earlier nextval.  Returns 0,  EINVAL if count is not positive or
+ *                EBUSY if a spare range is already waiting.
+ * =====================================================================================
+ */
+extern int
+ia_add_range( idalloc_t *ia, int64_t first, int64_t count)
+{
+	int err;
+	pthread_mutex_lock(&ia->ia_lock);
+	err = ia_add(ia, first, count);
+	pthread_cond_broadcast(&ia->ia_cond);
+	pthread_mutex_unlock(&ia->ia_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_free
+ *  Description:  Release the allocator once a outstanding request has completed.  The
+ *                ids left are not returned,  the sequence just has a gap.  Caches of
+ *                other threads still running are leaked as with bp_destroy.
+ * =====================================================================================
+ */
+extern void
+ia_free( idalloc_t *ia)
+{
+	ia_tcache_t *tc = (ia_tcache_t *) pthread_getspecific(ia->ia_key);
+	pthread_mutex_lock(&ia->ia_lock);
+	while( ia->ia_pending ) {
+		pthread_cond_wait(&ia->ia_cond, &ia->ia_lock);
+	}
+	pthread_mutex_unlock(&ia->ia_lock);
+	if( tc ) {
+		pthread_setspecific(ia->ia_key, NULL);
+		free(tc);
+	}
+	pthread_key_delete(ia->ia_key);
+	pthread_cond_destroy(&ia->ia_cond);
+	pthread_mutex_destroy(&ia->ia_lock);
+	free(ia->ia_seq);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_tcache
+ *  Description:  The calling thread's cache,  created on first use.  NULL if it could
+ *                not be,  ids are then taken one at a time under the lock.
+ * =====================================================================================
+ */
+static ia_tcache_t *
+ia_tcache( idalloc_t *ia)
+{
+	ia_tcache_t *tc = (ia_tcache_t *) pthread_getspecific(ia->ia_key);
+	if( tc ) {
+		return tc;
+	}
+	if( ! (tc = (ia_tcache_t *) calloc(1, sizeof(ia_tcache_t))) ) {
+		return NULL;
+	}
+	if( pthread_setspecific(ia->ia_key, tc) ) {
+		free(tc);
+		return NULL;
+	}
+	return tc;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_want
+ *  Description:  Request a range unless one is already requested or,  when now is
+ *                false,  a spare is waiting or half of the current range is left.  If
+ *                the writer's queue is full ia_err is EAGAIN and the next call asks
+ *                again.  Called with ia_lock held.
+ * =====================================================================================
+ */
+static void
+ia_want( idalloc_t *ia, bool now)
+{
+	const char *values[1] = { ia->ia_seq };
+	if( ia->ia_pending ) {
+		return;
+	}
+	if( ! now && (ia->ia_spare != ia->ia_spare_end
+				|| ia->ia_end - ia->ia_next >= ia->ia_size / 2) ) {
+		return;
+	}
+	ia->ia_pending = true;
+	ia->ia_err     = 0;
+	if( (ia->ia_err = dw_submit(ia->ia_dw, IA_RANGE_SQL, 1, values, NULL, NULL, ia_done, ia)) ) {
+		ia->ia_pending = false;
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_done
+ *  Description:  A range request completed on the writer thread.  The sequence's
+ *                nextval is the first id and its increment the size of the range.
+ * =====================================================================================
+ */
+static void
+ia_done( void *arg, PGresult *res, int err)
+{
+	idalloc_t *ia = (idalloc_t *) arg;
+	pthread_mutex_lock(&ia->ia_lock);
+	ia->ia_pending = false;
+	if( err ) {
+		ia->ia_err = err;
+	}
+	else if( PQntuples(res) != 1 ) {
+		ia->ia_err = ENOENT;
+	}
+	else {
+		ia->ia_err = ia_add(ia, strtoll(PQgetvalue(res, 0, 0), NULL, 10),
+				strtoll(PQgetvalue(res, 0, 1), NULL, 10));
+	}
+	pthread_cond_broadcast(&ia->ia_cond);
+	pthread_mutex_unlock(&ia->ia_lock);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ia_add
+ *  Description:  Make a range current,  or the spare if the current one still has ids.
+ *                A spare waiting behind a used up range is made current first.
+ *                Returns 0,  EINVAL or EBUSY.  Called with ia_lock held.
+ * =====================================================================================
+ */
+static int
+ia_add( idalloc_t *ia, int64_t first, int64_t count)
+{
+	if( count <= 0 ) {
+		return EINVAL;
+	}
+	if( ia->ia_next == ia->ia_end && ia->ia_spare != ia->ia_spare_end ) {
+		ia->ia_next  = ia->ia_spare;
+		ia->ia_end   = ia->ia_spare_end;
+		ia->ia_spare = ia->ia_spare_end = 0;
+	}
+	if( ia->ia_next == ia->ia_end ) {
+		ia->ia_next = first;
+		ia->ia_end  = first + count;
+	}
+	else if( ia->ia_spare == ia->ia_spare_end ) {
+		ia->ia_spare     = first;
+		ia->ia_spare_end = first + count;
+	}
+	else {
+		return EBUSY;
+	}
+	ia->ia_size = count;
+	ia->ia_ranges ++;
+	return 0;
+}
@@ -0,0 +1,691 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  linkex.c
+ *
+ *    Description:  Incremental link extractor.  This is not a HTML parser,  it is a
+ *                  tokenizer that only understands enough of tags, comments and raw
+ *                  text elements to find link attributes.  All state is held in the
+ *                  linkex_t so a page can be fed in chunks of any size, memory use is
+ *                  fixed no matter how large the page is.
+ *
+ *                  Most of a page is text,  comments,  raw text and the attributes of
+ *                  tags that can not hold a link,  none of which are looked at a byte
+ *                  at a time.  They are skipped by searching for the next byte that
+ *                  matters,  with memchr or with SSE2 when several bytes matter.  A
+ *                  link value that lies within one chunk is emitted as a span of that
+ *                  chunk,  it is only copied when it is split across chunks or has
+ *                  character references to decode.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 21:02:45
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/linkex.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define LX_TEXT     0   /* character data */
+#define LX_OPEN     1   /* seen '<' */
+#define LX_BANG     2   /* seen '<!' */
+#define LX_BDASH    3   /* seen '<!-' */
+#define LX_COMMENT  4   /* inside '<!-- -->' */
+#define LX_SKIP     5   /* skipping to '>', end tags, declarations and PIs */
+#define LX_TAG      6   /* tag name */
+#define LX_ATTRS    7   /* between attributes */
+#define LX_ANAME    8   /* attribute name */
+#define LX_AEQ      9   /* after attribute name, waiting for '=' */
+#define LX_BVALUE   10  /* after '=', waiting for the value */
+#define LX_VALUE    11  /* quoted value */
+#define LX_UVALUE   12  /* unquoted value */
+#define LX_RAW      13  /* script or style content, waiting for the end tag */
+
+#define LX_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r' || (c) == '\f')
+#define LX_LOWER(c) (((c) >= 'A' && (c) <= 'Z') ? (c) | 0x20 : (c))
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static void        lx_begin_value( linkex_t *lx);
+static int         lx_end_value( linkex_t *lx, const char *v, size_t n);
+static void        lx_append( linkex_t *lx, const char *v, size_t n);
+static void        lx_end_tag( linkex_t *lx);
+static bool        lx_is_link( linkex_t *lx);
+static bool        lx_is_link_tag( linkex_t *lx);
+static bool        lx_is_raw( linkex_t *lx);
+static const char *lx_scan( const char *p, const char *end, char a, char b, char c);
+static const char *lx_scan_unquoted( const char *p, const char *end);
+static size_t      lx_decode( char *v, size_t n);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_init
+ *  Description:  Initilize the extractor.  emit is called with every link attribute
+ *                value as it is closed.
+ * =====================================================================================
+ */
+extern void
+lx_init( linkex_t *lx, lx_emit_f emit, void *arg)
+{
+	bzero(lx, sizeof(linkex_t));
+	lx->lx_emit = emit;
+	lx->lx_arg  = arg;
+	lx_reset(lx);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_reset
+ *  Description:  Put the extractor back into its initial state so it can be used for
+ *                another page.  The link counters are kept.
+ * =====================================================================================
+ */
+extern void
+lx_reset( linkex_t *lx)
+{
+	lx->lx_state   = LX_TEXT;
+	lx->lx_match   = 0;
+	lx->lx_quote   = '\0';
+	lx->lx_want    = false;
+	lx->lx_drop    = false;
+	lx->lx_skip    = false;
+	lx->lx_taglen  = 0;
+	lx->lx_namelen = 0;
+	lx->lx_vallen  = 0;
+	lx->lx_tag[0]  = '\0';
+	lx->lx_name[0] = '\0';
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_feed
+ *  Description:  Feed the next len bytes of the page to the extractor.  A tag or value
+ *                may be split over any number of chunks.  Returns 0 or the non zero
+ *                value returned by the emit callback.  buf must stay unchanged until
+ *                lx_feed returns as values are emitted as spans of it.
+ * =====================================================================================
+ */
+extern int
+lx_feed( linkex_t *lx, const char *buf, size_t len)
+{
+	const char *end = buf + len,
+	           *p   = buf,
+	           *q;
+	char        c;
+	int         err = 0;
+	while( p < end ) {
+		switch( lx->lx_state ) {
+			case LX_TEXT:
+				/* nothing but '<' matters in text, so skip straight to it */
+				q = memchr(p, '<', end - p);
+				if( ! q ) {
+					return 0;
+				}
+				lx->lx_state = LX_OPEN;
+				p = q + 1;
+				continue;
+			case LX_ATTRS:
+				if( ! lx->lx_skip ) {
+					break;
+				}
+				/* a tag without link attributes,  only its end and the '=' before a
+				 * value matter.  A quote anywhere else is part of a name or an
+				 * unquoted value and does not start a quoted one */
+				q = lx_scan(p, end, '>', '=', '=');
+				if( ! q ) {
+					return 0;
+				}
+				p = q + 1;
+				if( *q == '>' ) {
+					lx_end_tag(lx);
+				}
+				else {
+					lx->lx_want   = false;
+					lx->lx_drop   = false;
+					lx->lx_vallen = 0;
+					lx->lx_state  = LX_BVALUE;
+				}
+				continue;
+			case LX_VALUE:
+			case LX_UVALUE:
+				/* the whole value is handled here,  as a span of buf when it can be */
+				if( lx->lx_state == LX_VALUE ) {
+					q = memchr(p, lx->lx_quote, end - p);
+				}
+				else {
+					q = lx_scan_unquoted(p, end);
+				}
+				if( ! q ) {
+					if( lx->lx_want && ! lx->lx_drop ) {
+						lx_append(lx, p, end - p);
+					}
+					return 0;
+				}
+				if( (err = lx_end_value(lx, p, q - p)) ) {
+					return err;
+				}
+				p = q + 1;
+				if( *q == '>' ) {
+					lx_end_tag(lx);
+				}
+				else {
+					lx->lx_state = LX_ATTRS;
+				}
+				continue;
+			case LX_TAG:
+				/* take the rest of the name in one go,  the delimiter is left for below */
+				for(; p < end && ! LX_SPACE(*p) && *p != '>' && *p != '/'; p ++){
+					if( lx->lx_taglen < LX_NAME_MAX ) {
+						lx->lx_tag[lx->lx_taglen ++] = LX_LOWER(*p);
+					}
+					else {
+						lx->lx_taglen = LX_NAME_MAX + 1;
+					}
+				}
+				if( p == end ) {
+					return 0;
+				}
+				break;
+			case LX_ANAME:
+				for(; p < end && ! LX_SPACE(*p) && *p != '>' && *p != '/' && *p != '='; p ++){
+					if( lx->lx_namelen < LX_NAME_MAX ) {
+						lx->lx_name[lx->lx_namelen ++] = LX_LOWER(*p);
+					}
+					else {
+						lx->lx_namelen = LX_NAME_MAX + 1;
+					}
+				}
+				if( p == end ) {
+					return 0;
+				}
+				break;
+			case LX_SKIP:
+				q = memchr(p, '>', end - p);
+				if( ! q ) {
+					return 0;
+				}
+				p = q + 1;
+				lx->lx_state = LX_TEXT;
+				continue;
+			case LX_COMMENT:
+				if( lx->lx_match == 0 ) {
+					q = memchr(p, '-', end - p);
+					if( ! q ) {
+						return 0;
+					}
+					p = q;
+				}
+				break;
+			case LX_RAW:
+				if( lx->lx_match == 0 ) {
+					q = memchr(p, '<', end - p);
+					if( ! q ) {
+						return 0;
+					}
+					p = q;
+				}
+				break;
+		}
+		c = *p ++;
+		switch( lx->lx_state ) {
+			case LX_OPEN:
+				if( c == '!' ) {
+					lx->lx_state = LX_BANG;
+				}
+				else if( c == '/' || c == '?' ) {
+					lx->lx_state = LX_SKIP;
+				}
+				else if( isalpha(c) ) {
+					lx->lx_tag[0] = LX_LOWER(c);
+					lx->lx_taglen = 1;
+					lx->lx_state  = LX_TAG;
+				}
+				else {
+					lx->lx_state = (c == '<') ? LX_OPEN : LX_TEXT;
+				}
+				break;
+			case LX_BANG:
+				lx->lx_state = (c == '-') ? LX_BDASH : (c == '>') ? LX_TEXT : LX_SKIP;
+				break;
+			case LX_BDASH:
+				if( c == '-' ) {
+					lx->lx_state = LX_COMMENT;
+					lx->lx_match = 0;
+				}
+				else {
+					lx->lx_state = (c == '>') ? LX_TEXT : LX_SKIP;
+				}
+				break;
+			case LX_COMMENT:
+				if( c == '-' ) {
+					lx->lx_match ++;
+				}
+				else if( c == '>' && lx->lx_match >= 2 ) {
+					lx->lx_state = LX_TEXT;
+				}
+				else {
+					lx->lx_match = 0;
+				}
+				break;
+			case LX_TAG:
+				if( c == '>' ) {
+					lx_end_tag(lx);
+				}
+				else if( LX_SPACE(c) || c == '/' ) {
+					lx->lx_tag[lx->lx_taglen <= LX_NAME_MAX ? lx->lx_taglen : 0] = '\0';
+					lx->lx_skip  = ! lx_is_link_tag(lx);
+					lx->lx_state = LX_ATTRS;
+				}
+				else if( lx->lx_taglen < LX_NAME_MAX ) {
+					lx->lx_tag[lx->lx_taglen ++] = LX_LOWER(c);
+				}
+				else {
+					/* too long to be a tag we care about */
+					lx->lx_taglen = LX_NAME_MAX + 1;
+				}
+				break;
+			case LX_AEQ:
+				if( LX_SPACE(c) ) {
+					break;
+				}
+				if( c == '=' ) {
+					lx_begin_value(lx);
+					break;
+				}
+				/* attribute without a value, c starts the next one */
+				lx->lx_state = LX_ATTRS;
+				/* FALL THROUGH */
+			case LX_ATTRS:
+				if( c == '>' ) {
+					lx_end_tag(lx);
+				}
+				else if( ! LX_SPACE(c) && c != '/' ) {
+					lx->lx_name[0]  = LX_LOWER(c);
+					lx->lx_namelen  = 1;
+					lx->lx_state    = LX_ANAME;
+				}
+				break;
+			case LX_ANAME:
+				if( c == '=' ) {
+					lx_begin_value(lx);
+				}
+				else if( LX_SPACE(c) ) {
+					lx->lx_state = LX_AEQ;
+				}
+				else if( c == '>' ) {
+					lx_end_tag(lx);
+				}
+				else if( c == '/' ) {
+					lx->lx_state = LX_ATTRS;
+				}
+				else if( lx->lx_namelen < LX_NAME_MAX ) {
+					lx->lx_name[lx->lx_namelen ++] = LX_LOWER(c);
+				}
+				else {
+					lx->lx_namelen = LX_NAME_MAX + 1;
+				}
+				break;
+			case LX_BVALUE:
+				if( LX_SPACE(c) ) {
+					break;
+				}
+				if( c == '>' ) {
+					lx_end_tag(lx);
+					break;
+				}
+				if( c == '"' || c == '\'' ) {
+					lx->lx_quote = c;
+					lx->lx_state = LX_VALUE;
+				}
+				else {
+					/* c is the first byte of a unquoted value */
+					lx->lx_state = LX_UVALUE;
+					p --;
+				}
+				break;
+			case LX_RAW:
+				/* looking for '</' followed by the tag name */
+				if( lx->lx_match == 0 ) {
+					lx->lx_match = (c == '<') ? 1 : 0;
+				}
+				else if( lx->lx_match == 1 ) {
+					lx->lx_match = (c == '/') ? 2 : (c == '<') ? 1 : 0;
+				}
+				else if( LX_LOWER(c) == lx->lx_tag[lx->lx_match - 2] ) {
+					if( ++ lx->lx_match - 2 == lx->lx_taglen ) {
+						lx->lx_state = LX_SKIP;
+					}
+				}
+				else {
+					lx->lx_match = (c == '<') ? 1 : 0;
+				}
+				break;
+		}
+	}
+	return err;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_is_link
+ *  Description:  Is the current attribute one that holds a link.
+ * =====================================================================================
+ */
+static bool
+lx_is_link( linkex_t *lx)
+{
+	switch( lx->lx_namelen ) {
+		case 3:
+			return strcmp(lx->lx_name, "src") == 0;
+		case 4:
+			return strcmp(lx->lx_name, "href") == 0;
+		case 6:
+			return strcmp(lx->lx_name, "action") == 0;
+	}
+	return false;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_is_link_tag
+ *  Description:  Can the current tag hold a link attribute,  the attributes of every
+ *                other tag are skipped without being tokenized.
+ * =====================================================================================
+ */
+static bool
+lx_is_link_tag( linkex_t *lx)
+{
+	const char *t = lx->lx_tag;
+	if( lx->lx_taglen > LX_NAME_MAX ) {
+		return false;
+	}
+	/* every tag is checked,  so switch on the first letter rather than search a list */
+	switch( *t ) {
+		case 'a':
+			return ! t[1] || strcmp(t, "area") == 0 || strcmp(t, "audio") == 0;
+		case 'b':
+			return strcmp(t, "base") == 0;
+		case 'e':
+			return strcmp(t, "embed") == 0;
+		case 'f':
+			return strcmp(t, "form") == 0 || strcmp(t, "frame") == 0;
+		case 'i':
+			return strcmp(t, "img") == 0 || strcmp(t, "iframe") == 0 || strcmp(t, "input") == 0;
+		case 'l':
+			return strcmp(t, "link") == 0;
+		case 's':
+			return strcmp(t, "script") == 0 || strcmp(t, "source") == 0;
+		case 't':
+			return strcmp(t, "track") == 0;
+		case 'v':
+			return strcmp(t, "video") == 0;
+	}
+	return false;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_is_raw
+ *  Description:  Is the current tag a raw text element,  the content of these can
+ *                contain '<' characters that do not start tags.
+ * =====================================================================================
+ */
+static bool
+lx_is_raw( linkex_t *lx)
+{
+	if( lx->lx_taglen > LX_NAME_MAX ) {
+		return false;
+	}
+	lx->lx_tag[lx->lx_taglen] = '\0';
+	return (lx->lx_taglen == 6 && strcmp(lx->lx_tag, "script") == 0)
+	    || (lx->lx_taglen == 5 && strcmp(lx->lx_tag, "style") == 0);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_end_tag
+ *  Description:  The '>' closing a start tag has been seen.
+ * =====================================================================================
+ */
+static void
+lx_end_tag( linkex_t *lx)
+{
+	lx->lx_want = false;
+	lx->lx_skip = false;
+	if( lx_is_raw(lx) ) {
+		lx->lx_state = LX_RAW;
+		lx->lx_match = 0;
+	}
+	else {
+		lx->lx_state = LX_TEXT;
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_begin_value
+ *  Description:  The '=' after a attribute name has been seen,  decide if the value
+ *                is to be kept.
+ * =====================================================================================
+ */
+static void
+lx_begin_value( linkex_t *lx)
+{
+	lx->lx_name[lx->lx_namelen <= LX_NAME_MAX ? lx->lx_namelen : 0] = '\0';
+	lx->lx_want   = lx_is_link(lx);
+	lx->lx_drop   = false;
+	lx->lx_vallen = 0;
+	lx->lx_state  = LX_BVALUE;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_end_value
+ *  Description:  A attribute value has been closed,  v is its last n bytes.  If it is
+ *                a link and earlier bytes were saved from previous chunks v is added
+ *                to them,  otherwise v is the whole value.  The surrounding white
+ *                space is stripped,  character references decoded and it is emitted.
+ * =====================================================================================
+ */
+static int
+lx_end_value( linkex_t *lx, const char *v, size_t n)
+{
+	if( ! lx->lx_want ) {
+		return 0;
+	}
+	lx->lx_want = false;
+	if( lx->lx_vallen || n > LX_VALUE_MAX ) {
+		lx_append(lx, v, n);
+		v = lx->lx_value;
+		n = lx->lx_vallen;
+	}
+	if( lx->lx_drop ) {
+		lx->lx_dropped ++;
+		return 0;
+	}
+	while( n && LX_SPACE(*v) ) {
+		v ++;
+		n --;
+	}
+	while( n && LX_SPACE(v[n - 1]) ) {
+		n --;
+	}
+	if( ! n ) {
+		return 0;
+	}
+	if( memchr(v, '&', n) ) {
+		memmove(lx->lx_value, v, n);
+		v = lx->lx_value;
+		n = lx_decode(lx->lx_value, n);
+	}
+	lx->lx_links ++;
+	return lx->lx_emit(lx->lx_tag, v, n, lx->lx_arg);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_append
+ *  Description:  Save part of a link value that is split across chunks,  a value that
+ *                grows past LX_VALUE_MAX is dropped.
+ * =====================================================================================
+ */
+static void
+lx_append( linkex_t *lx, const char *v, size_t n)
+{
+	if( lx->lx_drop ) {
+		return;
+	}
+	if( lx->lx_vallen + n > LX_VALUE_MAX ) {
+		lx->lx_drop = true;
+		return;
+	}
+	memcpy(lx->lx_value + lx->lx_vallen, v, n);
+	lx->lx_vallen += n;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_scan
+ *  Description:  Find the first of three bytes between p and end,  NULL if none is
+ *                there.  With SSE2 sixteen bytes are compared at a time.
+ * =====================================================================================
+ */
+static const char *
+lx_scan( const char *p, const char *end, char a, char b, char c)
+{
+#ifdef __SSE2__
+	__m128i va = _mm_set1_epi8(a),
+	        vb = _mm_set1_epi8(b),
+	        vc = _mm_set1_epi8(c),
+	        x;
+	int     m;
+	while( end - p >= 16 ) {
+		x = _mm_loadu_si128((const __m128i *) p);
+		m = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, va),
+		                                                _mm_cmpeq_epi8(x, vb)),
+		                                   _mm_cmpeq_epi8(x, vc)));
+		if( m ) {
+			return p + __builtin_ctz(m);
+		}
+		p += 16;
+	}
+#endif
+	for(; p < end; p ++){
+		if( *p == a || *p == b || *p == c ) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_scan_unquoted
+ *  Description:  Find the end of a unquoted value,  white space or '>'.  These are
+ *                short so a plain loop is used.
+ * =====================================================================================
+ */
+static const char *
+lx_scan_unquoted( const char *p, const char *end)
+{
+	for(; p < end; p ++){
+		if( LX_SPACE(*p) || *p == '>' ) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  lx_decode
+ *  Description:  Decode the character references of v in place,  the named ones
+ *                that turn up in URLs and numeric ones,  which are written as UTF-8.
+ *                Anything else,  including a reference without its ';',  is left
+ *                alone as it is as likely to be part of a query string.  Returns the
+ *                new length,  which is never longer.
+ * =====================================================================================
+ */
+static size_t
+lx_decode( char *v, size_t n)
+{
+	static const struct { const char *name; size_t len; char c; } named[] = {
+		{ "amp;", 4, '&' }, { "lt;", 3, '<' }, { "gt;", 3, '>' },
+		{ "quot;", 5, '"' }, { "apos;", 5, '\'' }, { NULL, 0, 0 } };
+	size_t        i = 0,
+	              o = 0,
+	              j,
+	              k;
+	unsigned long cp;
+	char         *e;
+	for(; i < n; i ++){
+		if( v[i] != '&' ) {
+			v[o ++] = v[i];
+			continue;
+		}
+		for(k = 0; named[k].name; k ++){
+			if( n - i - 1 >= named[k].len
+					&& strncmp(v + i + 1, named[k].name, named[k].len) == 0 ) {
+				break;
+			}
+		}
+		if( named[k].name ) {
+			v[o ++] = named[k].c;
+			i += named[k].len;
+			continue;
+		}
+		if( i + 3 < n && v[i + 1] == '#' ) {
+			j  = i + 2;
+			cp = 0;
+			if( v[j] == 'x' || v[j] == 'X' ) {
+				for(j ++; j < n && isxdigit(v[j]) && cp <= 0x10FFFF; j ++){
+					cp = cp * 16 + (isdigit(v[j]) ? v[j] - '0' : tolower(v[j]) - 'a' + 10);
+				}
+			}
+			else {
+				for(; j < n && isdigit(v[j]) && cp <= 0x10FFFF; j ++){
+					cp = cp * 10 + v[j] - '0';
+				}
+			}
+			if( j < n && v[j] == ';' && j > i + 2 && cp && cp <= 0x10FFFF
+					&& ! (cp >= 0xD800 && cp <= 0xDFFF) ) {
+				e = v + o;
+				if( cp < 0x80 ) {
+					*e ++ = cp;
+				}
+				else if( cp < 0x800 ) {
+					*e ++ = 0xC0 | (cp >> 6);
+					*e ++ = 0x80 | (cp & 0x3F);
+				}
+				else if( cp < 0x10000 ) {
+					*e ++ = 0xE0 | (cp >> 12);
+					*e ++ = 0x80 | ((cp >> 6) & 0x3F);
+					*e ++ = 0x80 | (cp & 0x3F);
+				}
+				else {
+					*e ++ = 0xF0 | (cp >> 18);
+					*e ++ = 0x80 | ((cp >> 12) & 0x3F);
+					*e ++ = 0x80 | ((cp >> 6) & 0x3F);
+					*e ++ = 0x80 | (cp & 0x3F);
+				}
+				o = e - v;
+				i = j;
+				continue;
+			}
+		}
+		v[o ++] = v[i];
+	}
+	return o;
+}
@@ -0,0 +1,391 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mpmc.c
+ *
+ *    Description:  Bounded lock free MPMC queue.  Cell i of lap l has sequence number
+ *                  l * size + i while it is free to push and one more once it holds a
+ *                  item,  popping it sets it to the position of the next lap.  A
+ *                  producer checks how many cells from mq_tail are free and claims
+ *                  them all by moving mq_tail with one compare and swap,  then fills
+ *                  them and publishes each by storing its sequence number.  Consumers
+ *                  do the same from mq_head.  Positions are 64 bit and never wrap.
+ *
+ *                  A caller that has to block sets bit 0 of mq_notempty or mq_notfull,
+ *                  tries once more and sleeps on the word.  The other side only bumps
+ *                  the word and makes the system call when it finds the bit set,  and
+ *                  clears it as it does,  so one wake up is made however many items
+ *                  are pushed before the sleepers run and none at all while the queue
+ *                  is neither empty nor full.
+ *
+ *        Version:  1.0
+ *        Created:  27/10/2026 19:31:08
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/mpmc.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static int      mq_try_push( mpmc_t *mq, void **items, int n);
+static int      mq_try_pop( mpmc_t *mq, void **items, int n);
+static bool     mq_empty( mpmc_t *mq);
+static bool     mq_full( mpmc_t *mq);
+static uint32_t mq_sleeping( uint32_t *word);
+static void     mq_wait( mpmc_t *mq, uint32_t *word, uint32_t ev);
+static void     mq_wake( mpmc_t *mq, uint32_t *word);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_init
+ *  Description:  Initilize a queue of at least size items,  rounded up to a power of
+ *                two.  The ring is aligned to a cache line.  Returns 0,  EINVAL if
+ *                size is less than two or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+mq_init( mpmc_t *mq, size_t size)
+{
+	size_t cells = 2,
+	       i     = 0;
+	bzero(mq, sizeof(mpmc_t));
+	if( size < 2 ) {
+		return EINVAL;
+	}
+	while( cells < size ) {
+		cells *= 2;
+	}
+	if( posix_memalign((void **) &mq->mq_cells, MQ_CACHELINE, cells * sizeof(mq_cell_t)) ) {
+		return ENOMEM;
+	}
+	for(; i < cells; i ++){
+		mq->mq_cells[i].mc_seq  = i;
+		mq->mq_cells[i].mc_data = NULL;
+	}
+	mq->mq_mask = cells - 1;
+#ifndef __linux__
+	pthread_mutex_init(&mq->mq_lock, NULL);
+	pthread_cond_init(&mq->mq_cond, NULL);
+#endif
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_push_n
+ *  Description:  Push up to n items in order,  returns the number pushed.  Without
+ *                wait that is as many as there is room for,  with it the call blocks
+ *                until all n are pushed or the queue is closed.
+ * =====================================================================================
+ */
+extern int
+mq_push_n( mpmc_t *mq, void **items, int n, bool wait)
+{
+	uint32_t ev;
+	int      done = 0,
+	         k;
+	while( done < n ) {
+		if( (k = mq_try_push(mq, items + done, n - done)) ) {
+			done += k;
+			mq_wake(mq, &mq->mq_notempty);
+			continue;
+		}
+		if( ! wait || __atomic_load_n(&mq->mq_closed, __ATOMIC_ACQUIRE) ) {
+			break;
+		}
+		ev = mq_sleeping(&mq->mq_notfull);
+		/* a consumer that popped before the bit was set did not see it */
+		if( mq_full(mq) && ! __atomic_load_n(&mq->mq_closed, __ATOMIC_SEQ_CST) ) {
+			mq_wait(mq, &mq->mq_notfull, ev);
+		}
+	}
+	return done;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_pop_n
+ *  Description:  Pop up to n items in order,  returns the number popped.  With wait
+ *                the call blocks while the queue is empty and returns 0 only once it
+ *                is empty and closed.
+ * =====================================================================================
+ */
+extern int
+mq_pop_n( mpmc_t *mq, void **items, int n, bool wait)
+{
+	uint32_t ev;
+	int      k;
+	for(;;) {
+		if( (k = mq_try_pop(mq, items, n)) ) {
+			mq_wake(mq, &mq->mq_notfull);
+			return k;
+		}
+		if( ! wait || __atomic_load_n(&mq->mq_closed, __ATOMIC_ACQUIRE) ) {
+			return 0;
+		}
+		ev = mq_sleeping(&mq->mq_notempty);
+		/* a producer that pushed before the bit was set did not see it */
+		if( mq_empty(mq) && ! __atomic_load_n(&mq->mq_closed, __ATOMIC_SEQ_CST) ) {
+			mq_wait(mq, &mq->mq_notempty, ev);
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_push
+ *  Description:  Push one item.  Returns 0,  EAGAIN if the queue is full and wait is
+ *                false or ECANCELED if it was closed while waiting.
+ * =====================================================================================
+ */
+extern int
+mq_push( mpmc_t *mq, void *item, bool wait)
+{
+	if( mq_push_n(mq, &item, 1, wait) ) {
+		return 0;
+	}
+	return wait ? ECANCELED : EAGAIN;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_pop
+ *  Description:  Pop one item.  Returns 0,  EAGAIN if the queue is empty and wait is
+ *                false or ECANCELED if it is empty and closed.
+ * =====================================================================================
+ */
+extern int
+mq_pop( mpmc_t *mq, void **item, bool wait)
+{
+	if( mq_pop_n(mq, item, 1, wait) ) {
+		return 0;
+	}
+	return wait ? ECANCELED : EAGAIN;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_close
+ *  Description:  Wake every waiter.  Blocked pushes give up,  blocked pops drain what
+ *                is left and then give up.
+ * =====================================================================================
+ */
+extern void
+mq_close( mpmc_t *mq)
+{
+	__atomic_store_n(&mq->mq_closed, 1, __ATOMIC_SEQ_CST);
+	mq_wake(mq, &mq->mq_notempty);
+	mq_wake(mq, &mq->mq_notfull);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_destroy
+ *  Description:  Release the ring,  items still in it are not freed.
+ * =====================================================================================
+ */
+extern void
+mq_destroy( mpmc_t *mq)
+{
+	free(mq->mq_cells);
+	mq->mq_cells = NULL;
+#ifndef __linux__
+	pthread_cond_destroy(&mq->mq_cond);
+	pthread_mutex_destroy(&mq->mq_lock);
+#endif
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_try_push
+ *  Description:  Claim and fill as many of the n cells from mq_tail as are free,
+ *                returns how many.  0 means the queue is full.
+ * =====================================================================================
+ */
+static int
+mq_try_push( mpmc_t *mq, void **items, int n)
+{
+	mq_cell_t *c;
+	uint64_t   pos = __atomic_load_n(&mq->mq_tail, __ATOMIC_RELAXED),
+	           seq;
+	int        k;
+	for(;;) {
+		for(k = 0; k < n; k ++){
+			c = &mq->mq_cells[(pos + k) & mq->mq_mask];
+			if( __atomic_load_n(&c->mc_seq, __ATOMIC_ACQUIRE) != pos + k ) {
+				break;
+			}
+		}
+		if( k ) {
+			if( __atomic_compare_exchange_n(&mq->mq_tail, &pos, pos + k, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED) ) {
+				break;
+			}
+			continue;
+		}
+		seq = __atomic_load_n(&mq->mq_cells[pos & mq->mq_mask].mc_seq, __ATOMIC_ACQUIRE);
+		if( (int64_t) (seq - pos) < 0 ) {
+			return 0;
+		}
+		pos = __atomic_load_n(&mq->mq_tail, __ATOMIC_RELAXED);
+	}
+	for(n = 0; n < k; n ++){
+		c = &mq->mq_cells[(pos + n) & mq->mq_mask];
+		c->mc_data = items[n];
+		__atomic_store_n(&c->mc_seq, pos + n + 1, __ATOMIC_RELEASE);
+	}
+	return k;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_try_pop
+ *  Description:  Claim and empty as many of the n cells from mq_head as are full,
+ *                returns how many.  0 means the queue is empty.
+ * =====================================================================================
+ */
+static int
+mq_try_pop( mpmc_t *mq, void **items, int n)
+{
+	mq_cell_t *c;
+	uint64_t   pos = __atomic_load_n(&mq->mq_head, __ATOMIC_RELAXED),
+	           seq;
+	int        k;
+	for(;;) {
+		for(k = 0; k < n; k ++){
+			c = &mq->mq_cells[(pos + k) & mq->mq_mask];
+			if( __atomic_load_n(&c->mc_seq, __ATOMIC_ACQUIRE) != pos + k + 1 ) {
+				break;
+			}
+		}
+		if( k ) {
+			if( __atomic_compare_exchange_n(&mq->mq_head, &pos, pos + k, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED) ) {
+				break;
+			}
+			continue;
+		}
+		seq = __atomic_load_n(&mq->mq_cells[pos & mq->mq_mask].mc_seq, __ATOMIC_ACQUIRE);
+		if( (int64_t) (seq - (pos + 1)) < 0 ) {
+			return 0;
+		}
+		pos = __atomic_load_n(&mq->mq_head, __ATOMIC_RELAXED);
+	}
+	for(n = 0; n < k; n ++){
+		c = &mq->mq_cells[(pos + n) & mq->mq_mask];
+		items[n] = c->mc_data;
+		__atomic_store_n(&c->mc_seq, pos + n + mq->mq_mask + 1, __ATOMIC_RELEASE);
+	}
+	return k;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_empty
+ *  Description:  Is the cell at mq_head still to be pushed,  without claiming it.
+ * =====================================================================================
+ */
+static bool
+mq_empty( mpmc_t *mq)
+{
+	uint64_t pos = __atomic_load_n(&mq->mq_head, __ATOMIC_SEQ_CST),
+	         seq = __atomic_load_n(&mq->mq_cells[pos & mq->mq_mask].mc_seq, __ATOMIC_SEQ_CST);
+	return (int64_t) (seq - (pos + 1)) < 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_full
+ *  Description:  Is the cell at mq_tail still to be popped,  without claiming it.
+ * =====================================================================================
+ */
+static bool
+mq_full( mpmc_t *mq)
+{
+	uint64_t pos = __atomic_load_n(&mq->mq_tail, __ATOMIC_SEQ_CST),
+	         seq = __atomic_load_n(&mq->mq_cells[pos & mq->mq_mask].mc_seq, __ATOMIC_SEQ_CST);
+	return (int64_t) (seq - pos) < 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_sleeping
+ *  Description:  Set bit 0 of word to say a caller is about to sleep on it,  returns
+ *                the value to sleep on.
+ * =====================================================================================
+ */
+static uint32_t
+mq_sleeping( uint32_t *word)
+{
+	uint32_t ev = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+	while( ! (ev & 1) && ! __atomic_compare_exchange_n(word, &ev, ev | 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) );
+	return ev | 1;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_wait
+ *  Description:  Sleep while word is still ev.  Spurious wake ups are fine,  callers
+ *                try again.
+ * =====================================================================================
+ */
+static void
+mq_wait( mpmc_t *mq, uint32_t *word, uint32_t ev)
+{
+#ifdef __linux__
+	(void) mq;
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, ev, NULL, NULL, 0);
+#else
+	pthread_mutex_lock(&mq->mq_lock);
+	while( __atomic_load_n(word, __ATOMIC_SEQ_CST) == ev ) {
+		pthread_cond_wait(&mq->mq_cond, &mq->mq_lock);
+	}
+	pthread_mutex_unlock(&mq->mq_lock);
+#endif
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mq_wake
+ *  Description:  Wake the callers sleeping on word if bit 0 says there are any.  The
+ *                fence orders the push or pop just made before reading the word,
+ *                pairing with the sleeper setting the bit before it looks again.
+ *                Only the caller that clears the bit makes the system call.
+ * =====================================================================================
+ */
+static void
+mq_wake( mpmc_t *mq, uint32_t *word)
+{
+	uint32_t w;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	w = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+	if( ! (w & 1) || ! __atomic_compare_exchange_n(word, &w, (w + 2) & ~1u, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ) {
+		return;
+	}
+#ifdef __linux__
+	(void) mq;
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+	pthread_mutex_lock(&mq->mq_lock);
+	pthread_cond_broadcast(&mq->mq_cond);
+	pthread_mutex_unlock(&mq->mq_lock);
+#endif
+}
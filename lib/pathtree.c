@@ -0,0 +1,779 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pathtree.c
+ *
+ *    Description:  Per host adaptive radix trees of crawled paths.  Each node holds the
+ *                  bytes all paths below it share,  so a run of single child nodes is
+ *                  never built,  and a inner node is only as large as its number of
+ *                  children needs: up to PT_SORTED_MAX they are a sorted array of
+ *                  bytes and one of pointers,  sized to fit and grown by half,  past
+ *                  that a pointer per byte.  Leaves store only the part of the path no
+ *                  other path shares and when that fits in a pointer,  as the tail of
+ *                  most paths under a directory does,  it is packed into the parent's
+ *                  child pointer.  Every inner node counts the paths below it so
+ *                  counting a prefix is a walk down to the prefix rather than over the
+ *                  paths.
+ *
+ *        Version:  1.0
+ *        Created:  30/10/2026 19:05:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/pathtree.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define PT_URI_BUF   2048    /* URIs shorter than this are built on the stack */
+#define PT_WALK_BUF  256     /* starting size of the path built by pt_iter */
+#define PT_INLINE    (sizeof(uintptr_t) - 1)   /* longest leaf packed into a pointer */
+
+/*****************************************************************************************
+ * The child pointers and then the keys of a inner node follow its header,  the prefix
+ * comes after them.
+ *****************************************************************************************/
+#define PT_CHILDREN(n)  ((pt_node_t **) ((pt_inner_t *) (n) + 1))
+#define PT_KEYS(n)      ((uint8_t *) (PT_CHILDREN(n) + (n)->pn_cap))
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct pt_inner_s {
+	pt_node_t        pi_node;
+	uint64_t         pi_count;        /* paths below the node */
+} typedef pt_inner_t;
+
+struct pt_walk_s {
+	char            *pw_buf;          /* path to the current node */
+	size_t           pw_len;          /* bytes of pw_buf in use */
+	size_t           pw_size;         /* bytes allocated */
+	pt_fn_t          pw_fn;
+	void            *pw_arg;
+} typedef pt_walk_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static pt_root_t  *pt_root( pathtree_t *pt, uint32_t host, bool create);
+static int         pt_put( pathtree_t *pt, pt_node_t **ref, const uint8_t *key, size_t len,
+                           size_t depth);
+static pt_node_t  *pt_seek( pt_node_t *n, const uint8_t *q, size_t qlen, size_t *at);
+static int         pt_walk( pt_walk_t *w, pt_node_t *n);
+static bool        pt_append( pt_walk_t *w, const void *p, size_t len);
+static pt_node_t  *pt_new( pathtree_t *pt, int type, int cap, const uint8_t *prefix,
+                           uint32_t plen);
+static pt_node_t  *pt_leaf( pathtree_t *pt, const uint8_t *suffix, uint32_t len);
+static void        pt_trim( pathtree_t *pt, pt_node_t **ref, uint32_t skip);
+static void        pt_free( pathtree_t *pt, pt_node_t *n);
+static int         pt_add( pathtree_t *pt, pt_node_t **ref, uint8_t c, pt_node_t *child);
+static int         pt_resize( pathtree_t *pt, pt_node_t **ref, int cap);
+static int         pt_grow( pathtree_t *pt, pt_node_t **ref);
+static pt_node_t **pt_child( pt_node_t *n, uint8_t c);
+static uint32_t    pt_prefix( pt_node_t *n, uint8_t *tmp, const uint8_t **prefix);
+static size_t      pt_offset( int type, int cap);
+static int         pt_type( pt_node_t *n);
+static uint64_t    pt_paths( pt_node_t *n);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_init
+ *  Description:  Initilize a empty store.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+pt_init( pathtree_t *pt)
+{
+	int err = 0,
+	    i   = 0;
+	bzero(pt, sizeof(pathtree_t));
+	if( (err = pthread_mutex_init(&pt->pt_lock, NULL)) ) {
+		return err;
+	}
+	for(; i < PT_BUCKETS; i ++){
+		INIT_LIST_HEAD(&pt->pt_table[i]);
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_insert
+ *  Description:  Add a normalized path to the tree of a interned host.  Returns 0,
+ *                EEXIST if the path is already there,  EINVAL for HI_NONE or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+pt_insert( pathtree_t *pt, uint32_t host, const char *path)
+{
+	pt_root_t *r;
+	int        err;
+	if( host == HI_NONE ) {
+		return EINVAL;
+	}
+	pthread_mutex_lock(&pt->pt_lock);
+	if( ! (r = pt_root(pt, host, true)) ) {
+		err = ENOMEM;
+	}
+	/* the NUL ends the key so a path that prefixes another gets its own leaf */
+	else if( ! (err = pt_put(pt, &r->pr_root, (const uint8_t *) path, strlen(path) + 1, 0)) ) {
+		r->pr_paths ++;
+		pt->pt_paths ++;
+	}
+	pthread_mutex_unlock(&pt->pt_lock);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_insert_uri
+ *  Description:  Add a normalized URI's path and query to its host's tree.  Returns
+ *                as pt_insert.
+ * =====================================================================================
+ */
+extern int
+pt_insert_uri( pathtree_t *pt, uriobj_t *uri)
+{
+	const char *path  = (*uri->uri_path && **uri->uri_path) ? *uri->uri_path : "/",
+	           *query = *uri->uri_query;
+	char        buf[PT_URI_BUF],
+	           *s     = buf;
+	size_t      len   = strlen(path) + 1 + (query ? strlen(query) + 1 : 0);
+	int         err;
+	if( len > PT_URI_BUF && ! (s = (char *) malloc(len)) ) {
+		return ENOMEM;
+	}
+	sprintf(s, "%s%s%s", path, query ? "?" : "", query ? query : "");
+	err = pt_insert(pt, hi_uri(uri), s);
+	if( s != buf ) {
+		free(s);
+	}
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_lookup
+ *  Description:  Is the path in the host's tree.
+ * =====================================================================================
+ */
+extern bool
+pt_lookup( pathtree_t *pt, uint32_t host, const char *path)
+{
+	const uint8_t *key   = (const uint8_t *) path,
+	              *pre;
+	uint8_t        tmp[PT_INLINE];
+	size_t         len   = strlen(path) + 1,
+	               depth = 0;
+	uint32_t       plen;
+	pt_root_t     *r;
+	pt_node_t     *n,
+	             **child;
+	bool           found = false;
+	pthread_mutex_lock(&pt->pt_lock);
+	for(n = (r = pt_root(pt, host, false)) ? r->pr_root : NULL; n; n = *child){
+		plen = pt_prefix(n, tmp, &pre);
+		if( plen > len - depth || memcmp(pre, key + depth, plen) ) {
+			break;
+		}
+		/* a leaf's prefix ends with the NUL so matching it matches the whole path */
+		if( pt_type(n) == PT_LEAF ) {
+			found = true;
+			break;
+		}
+		depth += plen;
+		if( ! (child = pt_child(n, key[depth ++])) ) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pt->pt_lock);
+	return found;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_count
+ *  Description:  The number of the host's paths that start with prefix,  all of them
+ *                for "".
+ * =====================================================================================
+ */
+extern uint64_t
+pt_count( pathtree_t *pt, uint32_t host, const char *prefix)
+{
+	pt_root_t *r;
+	pt_node_t *n     = NULL;
+	size_t     at;
+	uint64_t   count = 0;
+	pthread_mutex_lock(&pt->pt_lock);
+	if( (r = pt_root(pt, host, false)) && r->pr_root ) {
+		n = pt_seek(r->pr_root, (const uint8_t *) prefix, strlen(prefix), &at);
+	}
+	if( n ) {
+		count = pt_paths(n);
+	}
+	pthread_mutex_unlock(&pt->pt_lock);
+	return count;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_iter
+ *  Description:  Call fn for each of the host's paths that start with prefix,  in byte
+ *                order.  The store is locked during the walk so fn must not call
+ *                back into it.  Returns 0,  the first non zero value fn returned or
+ *                ENOMEM.
+ * =====================================================================================
+ */
+extern int
+pt_iter( pathtree_t *pt, uint32_t host, const char *prefix, pt_fn_t fn, void *arg)
+{
+	pt_walk_t  w;
+	pt_root_t *r;
+	pt_node_t *n  = NULL;
+	size_t     at = 0;
+	int        rv = 0;
+	bzero(&w, sizeof(pt_walk_t));
+	w.pw_fn  = fn;
+	w.pw_arg = arg;
+	pthread_mutex_lock(&pt->pt_lock);
+	if( (r = pt_root(pt, host, false)) && r->pr_root ) {
+		n = pt_seek(r->pr_root, (const uint8_t *) prefix, strlen(prefix), &at);
+	}
+	/* the walk starts from the bytes that led to the node */
+	if( n ) {
+		rv = pt_append(&w, prefix, at) ? pt_walk(&w, n) : ENOMEM;
+	}
+	pthread_mutex_unlock(&pt->pt_lock);
+	free(w.pw_buf);
+	return rv;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_destroy
+ *  Description:  Release every host's tree and the store.
+ * =====================================================================================
+ */
+extern void
+pt_destroy( pathtree_t *pt)
+{
+	pt_root_t *r,
+	          *rn;
+	int        i = 0;
+	for(; i < PT_BUCKETS; i ++){
+		list_for_each_entry_safe(r, rn, &pt->pt_table[i], pr_hash){
+			if( r->pr_root ) {
+				pt_free(pt, r->pr_root);
+			}
+			free(r);
+		}
+	}
+	pthread_mutex_destroy(&pt->pt_lock);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_root
+ *  Description:  Find the host's tree,  adding a empty one if create is true.  Called
+ *                with pt_lock held.
+ * =====================================================================================
+ */
+static pt_root_t *
+pt_root( pathtree_t *pt, uint32_t host, bool create)
+{
+	struct list_head *bucket = &pt->pt_table[host % PT_BUCKETS];
+	pt_root_t        *r;
+	list_for_each_entry(r, bucket, pr_hash){
+		if( r->pr_host == host ) {
+			return r;
+		}
+	}
+	if( ! create || ! (r = (pt_root_t *) calloc(1, sizeof(pt_root_t))) ) {
+		return NULL;
+	}
+	r->pr_host = host;
+	list_add(&r->pr_hash, bucket);
+	pt->pt_hosts ++;
+	return r;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_put
+ *  Description:  Insert the key,  whose last byte is its NUL,  below *ref which depth
+ *                bytes of the key led to.  Inner node prefixes never hold a NUL so
+ *                the key always has a byte left to choose a child by.  Returns 0,
+ *                EEXIST or ENOMEM,  the counts on the way down only change on 0.
+ * =====================================================================================
+ */
+static int
+pt_put( pathtree_t *pt, pt_node_t **ref, const uint8_t *key, size_t len, size_t depth)
+{
+	pt_node_t     *n    = *ref,
+	              *rest = NULL,
+	              *leaf = NULL,
+	              *split,
+	             **child;
+	const uint8_t *pre;
+	uint8_t        tmp[PT_INLINE],
+	               c;
+	uint32_t       plen,
+	               p    = 0;
+	int            err;
+	if( ! n ) {
+		return (*ref = pt_leaf(pt, key + depth, len - depth)) ? 0 : ENOMEM;
+	}
+	plen = pt_prefix(n, tmp, &pre);
+	for(; p < plen && pre[p] == key[depth + p]; p ++);
+	if( p == plen && pt_type(n) == PT_LEAF ) {
+		return EEXIST;
+	}
+	if( p < plen ) {
+		/* the key leaves the prefix at p,  a new node takes the shared part */
+		c = pre[p];
+		if( pt_type(n) == PT_LEAF && ! (rest = pt_leaf(pt, pre + p + 1, plen - p - 1)) ) {
+			return ENOMEM;
+		}
+		if( (split = pt_new(pt, PT_NODE, 2, pre, p)) ) {
+			leaf = pt_leaf(pt, key + depth + p + 1, len - depth - p - 1);
+		}
+		if( ! leaf ) {
+			if( split ) {
+				pt_free(pt, split);
+			}
+			if( rest ) {
+				pt_free(pt, rest);
+			}
+			return ENOMEM;
+		}
+		((pt_inner_t *) split)->pi_count = pt_paths(n) + 1;
+		pt_add(pt, &split, c, rest ? rest : n);
+		pt_add(pt, &split, key[depth + p], leaf);
+		if( rest ) {
+			pt_free(pt, n);
+		}
+		else {
+			pt_trim(pt, pt_child(split, c), p + 1);
+		}
+		*ref = split;
+		return 0;
+	}
+	depth += plen;
+	if( (child = pt_child(n, key[depth])) ) {
+		if( ! (err = pt_put(pt, child, key, len, depth + 1)) ) {
+			((pt_inner_t *) n)->pi_count ++;
+		}
+		return err;
+	}
+	if( ! (leaf = pt_leaf(pt, key + depth + 1, len - depth - 1)) ) {
+		return ENOMEM;
+	}
+	if( (err = pt_add(pt, ref, key[depth], leaf)) ) {
+		pt_free(pt, leaf);
+		return err;
+	}
+	((pt_inner_t *) *ref)->pi_count ++;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_seek
+ *  Description:  The highest node every key below which starts with q,  at is set to
+ *                the bytes of q that led to it.  NULL if no key starts with q.
+ * =====================================================================================
+ */
+static pt_node_t *
+pt_seek( pt_node_t *n, const uint8_t *q, size_t qlen, size_t *at)
+{
+	pt_node_t    **child;
+	const uint8_t *pre;
+	uint8_t        tmp[PT_INLINE];
+	uint32_t       plen;
+	size_t         depth = 0;
+	for(;;) {
+		plen = pt_prefix(n, tmp, &pre);
+		if( memcmp(pre, q + depth, (plen < qlen - depth) ? plen : qlen - depth) ) {
+			return NULL;
+		}
+		if( depth + plen >= qlen ) {
+			*at = depth;
+			return n;
+		}
+		if( pt_type(n) == PT_LEAF ) {
+			return NULL;
+		}
+		depth += plen;
+		if( ! (child = pt_child(n, q[depth ++])) ) {
+			return NULL;
+		}
+		n = *child;
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_walk
+ *  Description:  Call w->pw_fn for each leaf below n in byte order.  pw_buf holds the
+ *                path up to n and is restored before returning.
+ * =====================================================================================
+ */
+static int
+pt_walk( pt_walk_t *w, pt_node_t *n)
+{
+	pt_node_t    **child;
+	const uint8_t *pre;
+	uint8_t        tmp[PT_INLINE],
+	              *keys;
+	size_t         len = w->pw_len;
+	uint32_t       plen;
+	int            rv  = 0,
+	               i   = 0;
+	plen = pt_prefix(n, tmp, &pre);
+	if( ! pt_append(w, pre, plen) ) {
+		return ENOMEM;
+	}
+	/* a leaf's prefix ends with the NUL so pw_buf is a string */
+	if( pt_type(n) == PT_LEAF ) {
+		rv = w->pw_fn(w->pw_arg, w->pw_buf, w->pw_len - 1);
+	}
+	else if( n->pn_type == PT_NODE256 ) {
+		child = PT_CHILDREN(n);
+		for(; ! rv && i < 256; i ++){
+			if( child[i] ) {
+				w->pw_buf[w->pw_len ++] = (char) i;
+				rv = pt_walk(w, child[i]);
+				w->pw_len --;
+			}
+		}
+	}
+	else {
+		child = PT_CHILDREN(n);
+		keys  = PT_KEYS(n);
+		for(; ! rv && i < n->pn_n; i ++){
+			w->pw_buf[w->pw_len ++] = (char) keys[i];
+			rv = pt_walk(w, child[i]);
+			w->pw_len --;
+		}
+	}
+	w->pw_len = len;
+	return rv;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_append
+ *  Description:  Append len bytes to the walk's path,  keeping room for a edge byte
+ *                after them.  false on ENOMEM.
+ * =====================================================================================
+ */
+static bool
+pt_append( pt_walk_t *w, const void *p, size_t len)
+{
+	size_t size = w->pw_size ? w->pw_size : PT_WALK_BUF;
+	char  *buf;
+	for(; size < w->pw_len + len + 1; size *= 2);
+	if( size != w->pw_size ) {
+		if( ! (buf = (char *) realloc(w->pw_buf, size)) ) {
+			return false;
+		}
+		w->pw_buf  = buf;
+		w->pw_size = size;
+	}
+	memcpy(w->pw_buf + w->pw_len, p, len);
+	w->pw_len += len;
+	return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_new
+ *  Description:  A empty node of the type given,  a PT_NODE with room for cap
+ *                children,  with a copy of the prefix.
+ * =====================================================================================
+ */
+static pt_node_t *
+pt_new( pathtree_t *pt, int type, int cap, const uint8_t *prefix, uint32_t plen)
+{
+	size_t     size = pt_offset(type, cap) + plen;
+	pt_node_t *n    = (pt_node_t *) calloc(1, size);
+	if( n ) {
+		n->pn_type = type;
+		n->pn_cap  = cap;
+		n->pn_plen = plen;
+		memcpy((uint8_t *) n + size - plen, prefix, plen);
+		pt->pt_bytes += size;
+	}
+	return n;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_leaf
+ *  Description:  A leaf holding the last len bytes of a key.  Up to PT_INLINE bytes
+ *                are packed into the pointer itself,  its low byte holding the tag
+ *                bit and the length,  which malloc'd nodes never have set.
+ * =====================================================================================
+ */
+static pt_node_t *
+pt_leaf( pathtree_t *pt, const uint8_t *suffix, uint32_t len)
+{
+	uintptr_t v = 1 | (len << 1);
+	uint32_t  i = 0;
+	if( len > PT_INLINE ) {
+		return pt_new(pt, PT_LEAF, 0, suffix, len);
+	}
+	for(; i < len; i ++){
+		v |= (uintptr_t) suffix[i] << (8 * (i + 1));
+	}
+	return (pt_node_t *) v;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_trim
+ *  Description:  Drop the first skip bytes of a inner node's prefix,  shrinking it.
+ * =====================================================================================
+ */
+static void
+pt_trim( pathtree_t *pt, pt_node_t **ref, uint32_t skip)
+{
+	pt_node_t *n   = *ref;
+	uint8_t   *pre = (uint8_t *) n + pt_offset(n->pn_type, n->pn_cap);
+	n->pn_plen    -= skip;
+	memmove(pre, pre + skip, n->pn_plen);
+	pt->pt_bytes  -= skip;
+	/* a failed shrink leaves the node as it was,  which is still correct */
+	if( (n = (pt_node_t *) realloc(n, pt_offset(n->pn_type, n->pn_cap) + n->pn_plen)) ) {
+		*ref = n;
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_free
+ *  Description:  Release a node and everything below it.
+ * =====================================================================================
+ */
+static void
+pt_free( pathtree_t *pt, pt_node_t *n)
+{
+	pt_node_t **child;
+	int         i = 0;
+	if( (uintptr_t) n & 1 ) {
+		return;
+	}
+	if( n->pn_type != PT_LEAF ) {
+		child = PT_CHILDREN(n);
+		for(; i < (n->pn_type == PT_NODE256 ? 256 : n->pn_n); i ++){
+			if( child[i] ) {
+				pt_free(pt, child[i]);
+			}
+		}
+	}
+	pt->pt_bytes -= pt_offset(n->pn_type, n->pn_cap) + n->pn_plen;
+	free(n);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_add
+ *  Description:  Give the inner node *ref a child for byte c,  which it must not have
+ *                yet,  making the node larger if it is full.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+pt_add( pathtree_t *pt, pt_node_t **ref, uint8_t c, pt_node_t *child)
+{
+	pt_node_t  *n = *ref,
+	          **children;
+	uint8_t    *keys;
+	int         i;
+	if( n->pn_type == PT_NODE256 ) {
+		PT_CHILDREN(n)[c] = child;
+		n->pn_n ++;
+		return 0;
+	}
+	if( n->pn_n == n->pn_cap ) {
+		if( n->pn_cap == PT_SORTED_MAX ) {
+			return pt_grow(pt, ref) ? ENOMEM : pt_add(pt, ref, c, child);
+		}
+		i = n->pn_cap + n->pn_cap / 2 + 1;
+		if( pt_resize(pt, ref, (i > PT_SORTED_MAX) ? PT_SORTED_MAX : i) ) {
+			return ENOMEM;
+		}
+		n = *ref;
+	}
+	children = PT_CHILDREN(n);
+	keys     = PT_KEYS(n);
+	for(i = n->pn_n; i > 0 && keys[i - 1] > c; i --){
+		keys[i]     = keys[i - 1];
+		children[i] = children[i - 1];
+	}
+	keys[i]     = c;
+	children[i] = child;
+	n->pn_n ++;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_resize
+ *  Description:  Make room for cap children in the PT_NODE *ref,  moving its keys and
+ *                prefix up past the larger child array.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+pt_resize( pathtree_t *pt, pt_node_t **ref, int cap)
+{
+	pt_node_t *n    = *ref;
+	size_t     from = pt_offset(PT_NODE, n->pn_cap),
+	           to   = pt_offset(PT_NODE, cap);
+	uint8_t   *keys;
+	if( ! (n = (pt_node_t *) realloc(n, to + n->pn_plen)) ) {
+		return ENOMEM;
+	}
+	/* the prefix first,  the keys move up into where it was */
+	memmove((uint8_t *) n + to, (uint8_t *) n + from, n->pn_plen);
+	keys       = PT_KEYS(n);
+	n->pn_cap  = cap;
+	memmove(PT_KEYS(n), keys, n->pn_n);
+	pt->pt_bytes += to - from;
+	*ref = n;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_grow
+ *  Description:  Replace the full PT_NODE *ref with a PT_NODE256.  Returns 0 or
+ *                ENOMEM.
+ * =====================================================================================
+ */
+static int
+pt_grow( pathtree_t *pt, pt_node_t **ref)
+{
+	pt_node_t  *n = *ref,
+	           *g,
+	          **children;
+	uint8_t    *keys;
+	int         i = 0;
+	keys = PT_KEYS(n);
+	if( ! (g = pt_new(pt, PT_NODE256, 0, keys + n->pn_cap, n->pn_plen)) ) {
+		return ENOMEM;
+	}
+	((pt_inner_t *) g)->pi_count = ((pt_inner_t *) n)->pi_count;
+	children = PT_CHILDREN(n);
+	for(; i < n->pn_n; i ++){
+		PT_CHILDREN(g)[keys[i]] = children[i];
+	}
+	g->pn_n = n->pn_n;
+	pt->pt_bytes -= pt_offset(n->pn_type, n->pn_cap) + n->pn_plen;
+	free(n);
+	*ref = g;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_child
+ *  Description:  The slot holding the inner node's child for byte c,  NULL if it has
+ *                none.  A PT_NODE's keys are binary searched.
+ * =====================================================================================
+ */
+static pt_node_t **
+pt_child( pt_node_t *n, uint8_t c)
+{
+	pt_node_t **child = PT_CHILDREN(n);
+	uint8_t    *keys;
+	int         lo    = 0,
+	            hi    = n->pn_n,
+	            mid;
+	if( n->pn_type == PT_NODE256 ) {
+		return child[c] ? &child[c] : NULL;
+	}
+	keys = PT_KEYS(n);
+	while( lo < hi ) {
+		mid = (lo + hi) / 2;
+		if( keys[mid] < c ) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return (lo < n->pn_n && keys[lo] == c) ? &child[lo] : NULL;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_prefix
+ *  Description:  Point prefix at a node's prefix bytes and return how many there are.
+ *                A packed leaf's bytes are unpacked into tmp,  which must hold
+ *                PT_INLINE bytes.
+ * =====================================================================================
+ */
+static uint32_t
+pt_prefix( pt_node_t *n, uint8_t *tmp, const uint8_t **prefix)
+{
+	uintptr_t v = (uintptr_t) n;
+	uint32_t  len,
+	          i = 0;
+	if( ! (v & 1) ) {
+		*prefix = (uint8_t *) n + pt_offset(n->pn_type, n->pn_cap);
+		return n->pn_plen;
+	}
+	len = (v >> 1) & 0x7f;
+	for(; i < len; i ++){
+		tmp[i] = (uint8_t) (v >> (8 * (i + 1)));
+	}
+	*prefix = tmp;
+	return len;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_offset
+ *  Description:  Where the prefix starts in a node of the type and capacity given.
+ * =====================================================================================
+ */
+static size_t
+pt_offset( int type, int cap)
+{
+	if( type == PT_LEAF ) {
+		return sizeof(pt_node_t);
+	}
+	if( type == PT_NODE256 ) {
+		cap = 256;
+	}
+	return sizeof(pt_inner_t) + cap * sizeof(pt_node_t *) + (type == PT_NODE ? cap : 0);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_type
+ *  Description:  The PT_ kind of a node,  packed or not.
+ * =====================================================================================
+ */
+static int
+pt_type( pt_node_t *n)
+{
+	return ((uintptr_t) n & 1) ? PT_LEAF : n->pn_type;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pt_paths
+ *  Description:  The number of paths at or below a node.
+ * =====================================================================================
+ */
+static uint64_t
+pt_paths( pt_node_t *n)
+{
+	return pt_type(n) == PT_LEAF ? 1 : ((pt_inner_t *) n)->pi_count;
+}
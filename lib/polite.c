@@ -0,0 +1,931 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  polite.c
+ *
+ *    Description:  Per host politeness scheduler.  A host with URIs queued is always
+ *                  in exactly one place: the timer wheel while it waits for its next
+ *                  allowed time,  the ready list once that time has passed, or nowhere
+ *                  while it is at its concurrency cap.  Taking a URI is a pop from the
+ *                  ready list,  so the cost does not grow with the number of hosts.
+ *
+ *                  Once a host has been resolved it also belongs to a IP group keyed
+ *                  on its first address masked to pl_ip4bits or pl_ip6bits.  A host
+ *                  may only start a request when both it and its group allow it,  so
+ *                  its effective next time is the later of the two.  A host held back
+ *                  by its group's cap waits on the group and is rescheduled when a
+ *                  request to the group finishes.
+ *
+ *                  With pl_set_adaptive a host's cap is its AIMD window rather than
+ *                  ph_max,  which becomes the ceiling of the window.  The window is fed
+ *                  by the status and latency given to pl_finish.
+ *
+ *                  Connect failures,  timeouts and resolve errors also drive a circuit
+ *                  breaker.  While it is open the host's next time is the end of the
+ *                  cooldown so it sits in the wheel with its URIs queued,  when that
+ *                  time comes the breaker is half open and the host's cap is one.  The
+ *                  outcome of that probe closes the breaker or opens it again for
+ *                  twice as long.
+ *
+ *        Version:  1.0
+ *        Created:  21/10/2026 19:48:20
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/polite.h>
+#include <azzmos/utils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static pl_host_t *pl_host( polite_t *pl, uint32_t id, bool create);
+static pl_ipgrp_t *pl_ipgrp( polite_t *pl, struct addrinfo *ai);
+static pl_ipgrp_t *pl_ipgrp_key( polite_t *pl, const char *key);
+static bool       pl_ip_key( polite_t *pl, struct addrinfo *ai, char *key);
+static void       pl_schedule( polite_t *pl, pl_host_t *h, uint64_t now);
+static void       pl_release( polite_t *pl, uint64_t now);
+static int        pl_cap( polite_t *pl, pl_host_t *h);
+static void       pl_feedback( pl_host_t *h, long status, long latency, uint64_t now);
+static bool       pl_breaker( pl_host_t *h, long status, uint64_t now);
+static void       pl_unlink( polite_t *pl, pl_host_t *h);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_init
+ *  Description:  Initilize the scheduler.  delay is the default number of milliseconds
+ *                between requests to a host and max the default number in flight,
+ *                zero or less picks PL_DELAY_MS and PL_MAX_ACTIVE.
+ * =====================================================================================
+ */
+extern int
+pl_init( polite_t *pl, long delay, int max)
+{
+	int err = 0,
+	    i   = 0;
+	bzero(pl, sizeof(polite_t));
+	pl->pl_delay = (delay > 0) ? delay : PL_DELAY_MS;
+	pl->pl_max   = (max > 0) ? max : PL_MAX_ACTIVE;
+	pl->pl_ip4bits  = 32;
+	pl->pl_ip6bits  = 128;
+	pl->pl_ip_delay = PL_IP_DELAY_MS;
+	pl->pl_ip_max   = PL_IP_MAX;
+	if( (err = pthread_mutex_init(&pl->pl_lock, NULL)) ) {
+		return err;
+	}
+	if( (err = pthread_cond_init(&pl->pl_cond, NULL)) ) {
+		pthread_mutex_destroy(&pl->pl_lock);
+		return err;
+	}
+	tw_init(&pl->pl_wheel, pl_now() / PL_TICK_MS);
+	INIT_LIST_HEAD(&pl->pl_ready);
+	for(; i < PL_HOST_BUCKETS; i ++){
+		INIT_LIST_HEAD(&pl->pl_table[i]);
+	}
+	for(i = 0; i < PL_IP_BUCKETS; i ++){
+		INIT_LIST_HEAD(&pl->pl_iptable[i]);
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_push
+ *  Description:  Queue a normalized URI on its host.  data is handed back in pu_data
+ *                when the URI is taken.  If the URI has been through uri_resolve and
+ *                its host has no IP group yet the host joins the group of its first
+ *                address.  Returns 0, EINVAL if the URI has no host or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+pl_push( polite_t *pl, uriobj_t *uri, void *data)
+{
+	pl_host_t *h;
+	pl_url_t  *u;
+	uint32_t   id = hi_uri(uri);
+	if( ! id ) {
+		return EINVAL;
+	}
+	u = (pl_url_t *) malloc(sizeof(pl_url_t));
+	if( ! u ) {
+		return ENOMEM;
+	}
+	u->pu_uri  = uri;
+	u->pu_data = data;
+	u->pu_ip   = NULL;
+	pthread_mutex_lock(&pl->pl_lock);
+	if( ! (h = pl_host(pl, id, true)) ) {
+		pthread_mutex_unlock(&pl->pl_lock);
+		free(u);
+		return ENOMEM;
+	}
+	if( ! h->ph_ip && uri->uri_addr && *uri->uri_addr ) {
+		h->ph_ip = pl_ipgrp(pl, *uri->uri_addr);
+	}
+	u->pu_host = h;
+	list_add_tail(&u->pu_list, &h->ph_urls);
+	h->ph_queued ++;
+	pl->pl_queued ++;
+	if( h->ph_state == PL_IDLE ) {
+		pl_schedule(pl, h, pl_now());
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_pop
+ *  Description:  Take the next URI whose host may be fetched now.  If no host is ready
+ *                and wait is true the call blocks until one is,  otherwise EAGAIN is
+ *                returned.  ECANCELED is returned once the scheduler is closed.  The
+ *                host and its IP group count the URI as in flight until pl_done is
+ *                called with it.
+ * =====================================================================================
+ */
+extern int
+pl_pop( polite_t *pl, bool wait, pl_url_t **url)
+{
+	struct timespec ts;
+	pl_host_t      *h = NULL;
+	pl_url_t       *u;
+	pl_ipgrp_t     *g;
+	uint64_t        now;
+	pthread_mutex_lock(&pl->pl_lock);
+	for(;;) {
+		now = pl_now();
+		pl_release(pl, now);
+		while( ! list_empty(&pl->pl_ready) ) {
+			h = list_entry(pl->pl_ready.next, pl_host_t, ph_ready);
+			list_del_init(&h->ph_ready);
+			g = h->ph_ip;
+			if( ! g || (g->pg_active < pl->pl_ip_max && g->pg_next <= now) ) {
+				break;
+			}
+			/* another host of the group started first,  park this one again */
+			h->ph_state = PL_IDLE;
+			pl_schedule(pl, h, now);
+			h = NULL;
+		}
+		if( h ) {
+			break;
+		}
+		if( pl->pl_closed || ! wait ) {
+			pthread_mutex_unlock(&pl->pl_lock);
+			return pl->pl_closed ? ECANCELED : EAGAIN;
+		}
+		/* the wheel has no wake up of its own,  poll it once a tick */
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += PL_TICK_MS * 1000000L;
+		if( ts.tv_nsec >= 1000000000L ) {
+			ts.tv_sec  ++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&pl->pl_cond, &pl->pl_lock, &ts);
+	}
+	u = list_entry(h->ph_urls.next, pl_url_t, pu_list);
+	list_del_init(&u->pu_list);
+	h->ph_queued --;
+	pl->pl_queued --;
+	h->ph_active ++;
+	h->ph_next  = now + h->ph_delay;
+	h->ph_state = PL_IDLE;
+	if( (g = h->ph_ip) ) {
+		g->pg_active ++;
+		g->pg_next = now + pl->pl_ip_delay;
+	}
+	u->pu_ip = g;
+	pl_schedule(pl, h, now);
+	pthread_mutex_unlock(&pl->pl_lock);
+	*url = u;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_done
+ *  Description:  The fetch of a URI taken with pl_pop has finished,  release its slot
+ *                on the host and its IP group and free url.  The URI itself is not
+ *                freed.
+ * =====================================================================================
+ */
+extern void
+pl_done( polite_t *pl, pl_url_t *url)
+{
+	pl_finish(pl, url, PL_S_NONE, -1);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_finish
+ *  Description:  As pl_done,  also feeding the outcome to the host's adaptive window.
+ *                status is the HTTP status or a PL_S_ value and latency the time to
+ *                the response in milliseconds,  below zero if not known.  A host
+ *                whose circuit breaker opens is taken off the ready list or out of
+ *                the wheel and held for the cooldown.  The IP group released is the
+ *                one pl_pop charged,  the host may have joined one since.  Every host
+ *                waiting on it is rescheduled,  those that still can not start go
+ *                back to waiting.
+ * =====================================================================================
+ */
+extern void
+pl_finish( polite_t *pl, pl_url_t *url, long status, long latency)
+{
+	pl_host_t  *h = url->pu_host,
+	           *w,
+	           *n;
+	pl_ipgrp_t *g = url->pu_ip;
+	uint64_t    now;
+	pthread_mutex_lock(&pl->pl_lock);
+	now = pl_now();
+	h->ph_active --;
+	pl_feedback(h, status, latency, now);
+	if( pl_breaker(h, status, now) || h->ph_state == PL_BUSY ) {
+		pl_unlink(pl, h);
+		pl_schedule(pl, h, now);
+	}
+	if( g ) {
+		g->pg_active --;
+		list_for_each_entry_safe(w, n, &g->pg_hosts, ph_ready){
+			list_del_init(&w->ph_ready);
+			w->ph_state = PL_IDLE;
+			pl_schedule(pl, w, now);
+		}
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+	free(url);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_set_host
+ *  Description:  Set the delay and concurrency cap of a host,  for example from its
+ *                robots.txt Crawl-delay.  A delay below zero or a max of zero or less
+ *                leaves that value unchanged.  The new delay applies from the next
+ *                request started.
+ * =====================================================================================
+ */
+extern int
+pl_set_host( polite_t *pl, const char *host, long delay, int max)
+{
+	pl_host_t *h;
+	uint32_t   id = hi_intern(host, strlen(host));
+	if( ! id ) {
+		return ENOMEM;
+	}
+	pthread_mutex_lock(&pl->pl_lock);
+	if( ! (h = pl_host(pl, id, true)) ) {
+		pthread_mutex_unlock(&pl->pl_lock);
+		return ENOMEM;
+	}
+	if( delay >= 0 ) {
+		h->ph_delay = delay;
+	}
+	if( max > 0 ) {
+		h->ph_max = max;
+		if( h->ph_window > max ) {
+			h->ph_window = max;
+		}
+		if( h->ph_state == PL_BUSY ) {
+			h->ph_state = PL_IDLE;
+			pl_schedule(pl, h, pl_now());
+		}
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_set_ipgroup
+ *  Description:  Set how hosts are grouped by address and the limits of each group.
+ *                ip4bits and ip6bits are the prefix lengths grouped on,  32 and 128
+ *                group per address while 24 and 64 group per network.  A value out of
+ *                range,  a delay below zero or a max of zero or less leaves that
+ *                setting unchanged.  Only hosts resolved after the call are grouped
+ *                with the new prefix lengths.
+ * =====================================================================================
+ */
+extern void
+pl_set_ipgroup( polite_t *pl, int ip4bits, int ip6bits, long delay, int max)
+{
+	pthread_mutex_lock(&pl->pl_lock);
+	if( ip4bits >= 0 && ip4bits <= 32 ) {
+		pl->pl_ip4bits = ip4bits;
+	}
+	if( ip6bits >= 0 && ip6bits <= 128 ) {
+		pl->pl_ip6bits = ip6bits;
+	}
+	if( delay >= 0 ) {
+		pl->pl_ip_delay = delay;
+	}
+	if( max > 0 ) {
+		pl->pl_ip_max = max;
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_set_adaptive
+ *  Description:  Cap each host by its AIMD window instead of a fixed number.  Windows
+ *                start at one request and grow to at most ph_max,  max replaces the
+ *                default ph_max of new hosts if it is above zero.
+ * =====================================================================================
+ */
+extern void
+pl_set_adaptive( polite_t *pl, int max)
+{
+	pthread_mutex_lock(&pl->pl_lock);
+	pl->pl_adaptive = true;
+	if( max > 0 ) {
+		pl->pl_max = max;
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_close
+ *  Description:  Wake every waiting pl_pop and make them return ECANCELED.
+ * =====================================================================================
+ */
+extern void
+pl_close( polite_t *pl)
+{
+	pthread_mutex_lock(&pl->pl_lock);
+	pl->pl_closed = true;
+	pthread_cond_broadcast(&pl->pl_cond);
+	pthread_mutex_unlock(&pl->pl_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_save
+ *  Description:  Write the state of every host to path,  its delay and cap,  adaptive
+ *                window and latencies,  breaker and IP group,  so a restart neither
+ *                forgets a slow host nor hammers one that was failing.  Queued URIs
+ *                are not saved.  It replaces path atomically with file_replace.
+ *                Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+pl_save( polite_t *pl, const char *path)
+{
+	pl_shead_t   ps;
+	pl_srec_t   *recs;
+	pl_host_t   *h;
+	char        *names;
+	struct iovec iov[3];
+	size_t       nlen = 0,
+	             n    = 0;
+	uint64_t     now;
+	int          err  = 0,
+	             i    = 0;
+	pthread_mutex_lock(&pl->pl_lock);
+	recs  = (pl_srec_t *) calloc(pl->pl_hosts + 1, sizeof(pl_srec_t));
+	for(; i < PL_HOST_BUCKETS; i ++){
+		list_for_each_entry(h, &pl->pl_table[i], ph_hash){
+			nlen += strlen(h->ph_key) + 1;
+		}
+	}
+	names = (char *) malloc(nlen + 1);
+	if( ! recs || ! names ) {
+		pthread_mutex_unlock(&pl->pl_lock);
+		free(recs);
+		free(names);
+		return ENOMEM;
+	}
+	now  = pl_now();
+	nlen = 0;
+	for(i = 0; i < PL_HOST_BUCKETS; i ++){
+		list_for_each_entry(h, &pl->pl_table[i], ph_hash){
+			recs[n].pr_name     = nlen;
+			recs[n].pr_len      = strlen(h->ph_key);
+			recs[n].pr_max      = h->ph_max;
+			recs[n].pr_delay    = h->ph_delay;
+			recs[n].pr_wait     = (h->ph_next > now) ? h->ph_next - now : 0;
+			recs[n].pr_window   = h->ph_window;
+			recs[n].pr_srtt     = h->ph_srtt;
+			recs[n].pr_minrtt   = h->ph_minrtt;
+			recs[n].pr_errate   = h->ph_errate;
+			recs[n].pr_breaker  = h->ph_breaker;
+			recs[n].pr_fails    = h->ph_fails;
+			recs[n].pr_cooldown = h->ph_cooldown;
+			recs[n].pr_open     = (h->ph_open > now) ? h->ph_open - now : 0;
+			if( h->ph_ip ) {
+				strcpy(recs[n].pr_ip, h->ph_ip->pg_key);
+			}
+			memcpy(names + nlen, h->ph_key, recs[n].pr_len + 1);
+			nlen += recs[n ++].pr_len + 1;
+		}
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+	bzero(&ps, sizeof(pl_shead_t));
+	memcpy(ps.ps_magic, PL_MAGIC, sizeof(ps.ps_magic));
+	ps.ps_count = n;
+	ps.ps_names = sizeof(pl_shead_t) + n * sizeof(pl_srec_t);
+	ps.ps_size  = ps.ps_names + nlen;
+	iov[0].iov_base = &ps;
+	iov[0].iov_len  = sizeof(pl_shead_t);
+	iov[1].iov_base = recs;
+	iov[1].iov_len  = n * sizeof(pl_srec_t);
+	iov[2].iov_base = names;
+	iov[2].iov_len  = nlen;
+	err = file_replace(path, iov, 3);
+	free(recs);
+	free(names);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_load
+ *  Description:  Restore the hosts saved by pl_save into a scheduler,  before any URI
+ *                is pushed.  The file is mapped and read in place.  A breaker that was
+ *                half open is restored open with its cooldown over,  as its probe was
+ *                lost.  Returns 0,  EINVAL if the file is not a complete save or a
+ *                errno value.
+ * =====================================================================================
+ */
+extern int
+pl_load( polite_t *pl, const char *path)
+{
+	struct stat       st;
+	const pl_shead_t *ps;
+	const pl_srec_t  *r;
+	const char       *names;
+	pl_host_t        *h;
+	void             *map;
+	uint64_t          now,
+	                  i   = 0;
+	uint32_t          id;
+	int               fd,
+	                  err = 0;
+	if( (fd = open(path, O_RDONLY)) == -1 ) {
+		return errno;
+	}
+	if( fstat(fd, &st) == -1 ) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	if( (size_t) st.st_size < sizeof(pl_shead_t) ) {
+		close(fd);
+		return EINVAL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	err = (map == MAP_FAILED) ? errno : 0;
+	close(fd);
+	if( err ) {
+		return err;
+	}
+	ps    = (const pl_shead_t *) map;
+	r     = (const pl_srec_t *) (ps + 1);
+	names = (const char *) map + ps->ps_names;
+	if( memcmp(ps->ps_magic, PL_MAGIC, sizeof(ps->ps_magic)) != 0
+			|| ps->ps_size != (uint64_t) st.st_size
+			|| ps->ps_count > (ps->ps_size - sizeof(pl_shead_t)) / sizeof(pl_srec_t)
+			|| ps->ps_names != sizeof(pl_shead_t) + ps->ps_count * sizeof(pl_srec_t) ) {
+		munmap(map, st.st_size);
+		return EINVAL;
+	}
+	pthread_mutex_lock(&pl->pl_lock);
+	now = pl_now();
+	for(; ! err && i < ps->ps_count; i ++, r ++){
+		if( r->pr_name >= ps->ps_size || r->pr_name + r->pr_len >= ps->ps_size - ps->ps_names
+				|| names[r->pr_name + r->pr_len] != '\0'
+				|| memchr(r->pr_ip, '\0', sizeof(r->pr_ip)) == NULL ) {
+			err = EINVAL;
+			break;
+		}
+		if( ! (id = hi_intern(names + r->pr_name, r->pr_len))
+				|| ! (h = pl_host(pl, id, true)) ) {
+			err = ENOMEM;
+			break;
+		}
+		h->ph_max      = (r->pr_max > 0) ? r->pr_max : pl->pl_max;
+		h->ph_delay    = (r->pr_delay >= 0) ? r->pr_delay : pl->pl_delay;
+		h->ph_next     = now + r->pr_wait;
+		h->ph_window   = (r->pr_window >= 1 && r->pr_window <= h->ph_max) ? r->pr_window : 1;
+		h->ph_srtt     = r->pr_srtt;
+		h->ph_minrtt   = r->pr_minrtt;
+		h->ph_errate   = r->pr_errate;
+		h->ph_breaker  = (r->pr_breaker == PL_CB_CLOSED) ? PL_CB_CLOSED : PL_CB_OPEN;
+		h->ph_fails    = r->pr_fails;
+		h->ph_cooldown = r->pr_cooldown;
+		h->ph_open     = (r->pr_breaker == PL_CB_OPEN) ? now + r->pr_open : now;
+		if( *r->pr_ip ) {
+			h->ph_ip = pl_ipgrp_key(pl, r->pr_ip);
+		}
+	}
+	pthread_mutex_unlock(&pl->pl_lock);
+	munmap(map, st.st_size);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_destroy
+ *  Description:  Release the scheduler,  its hosts,  IP groups and any URIs queued.  URIs
+ *                taken with pl_pop and not yet returned must not be passed to pl_done
+ *                afterwards.
+ * =====================================================================================
+ */
+extern void
+pl_destroy( polite_t *pl)
+{
+	pl_host_t *h,
+	          *hn;
+	pl_url_t  *u,
+	          *un;
+	pl_ipgrp_t *g,
+	           *gn;
+	int i = 0;
+	for(; i < PL_HOST_BUCKETS; i ++){
+		list_for_each_entry_safe(h, hn, &pl->pl_table[i], ph_hash){
+			list_for_each_entry_safe(u, un, &h->ph_urls, pu_list){
+				free(u);
+			}
+			free(h);
+		}
+	}
+	for(i = 0; i < PL_IP_BUCKETS; i ++){
+		list_for_each_entry_safe(g, gn, &pl->pl_iptable[i], pg_hash){
+			free(g);
+		}
+	}
+	pthread_cond_destroy(&pl->pl_cond);
+	pthread_mutex_destroy(&pl->pl_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_now
+ *  Description:  Monotonic clock in milliseconds.
+ * =====================================================================================
+ */
+extern uint64_t
+pl_now( void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_ip_key
+ *  Description:  Write the group key of a address into key,  the address masked to the
+ *                configured prefix length followed by that length.  false if the
+ *                address family is not IPv4 or IPv6.
+ * =====================================================================================
+ */
+static bool
+pl_ip_key( polite_t *pl, struct addrinfo *ai, char *key)
+{
+	unsigned char addr[16];
+	char          str[INET6_ADDRSTRLEN];
+	int           len,
+	              bits,
+	              i;
+	if( ai->ai_family == AF_INET ) {
+		len  = 4;
+		bits = pl->pl_ip4bits;
+		memcpy(addr, &((struct sockaddr_in *) ai->ai_addr)->sin_addr, len);
+	}
+	else if( ai->ai_family == AF_INET6 ) {
+		len  = 16;
+		bits = pl->pl_ip6bits;
+		memcpy(addr, &((struct sockaddr_in6 *) ai->ai_addr)->sin6_addr, len);
+	}
+	else {
+		return false;
+	}
+	for(i = 0; i < len; i ++){
+		if( bits >= 8 ) {
+			bits -= 8;
+		}
+		else {
+			addr[i] &= (unsigned char) (0xff << (8 - bits));
+			bits = 0;
+		}
+	}
+	if( ! inet_ntop(ai->ai_family, addr, str, sizeof(str)) ) {
+		return false;
+	}
+	snprintf(key, PL_IP_KEY_MAX, "%s/%d",
+			str, ai->ai_family == AF_INET ? pl->pl_ip4bits : pl->pl_ip6bits);
+	return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_ipgrp
+ *  Description:  Find or create the IP group of a address.  NULL if the address can
+ *                not be grouped or on ENOMEM,  the host is then limited only by its
+ *                own delay and cap.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static pl_ipgrp_t *
+pl_ipgrp( polite_t *pl, struct addrinfo *ai)
+{
+	char key[PL_IP_KEY_MAX];
+	if( ! ai->ai_addr || ! pl_ip_key(pl, ai, key) ) {
+		return NULL;
+	}
+	return pl_ipgrp_key(pl, key);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_ipgrp_key
+ *  Description:  Find or create the IP group with the key.  NULL on ENOMEM.  Called
+ *                with pl_lock held.
+ * =====================================================================================
+ */
+static pl_ipgrp_t *
+pl_ipgrp_key( polite_t *pl, const char *key)
+{
+	struct list_head *bucket = &pl->pl_iptable[str_hash(key) % PL_IP_BUCKETS];
+	pl_ipgrp_t       *g;
+	list_for_each_entry(g, bucket, pg_hash){
+		if( strcmp(g->pg_key, key) == 0 ) {
+			return g;
+		}
+	}
+	g = (pl_ipgrp_t *) malloc(sizeof(pl_ipgrp_t));
+	if( ! g ) {
+		return NULL;
+	}
+	bzero(g, sizeof(pl_ipgrp_t));
+	strcpy(g->pg_key, key);
+	INIT_LIST_HEAD(&g->pg_hosts);
+	list_add(&g->pg_hash, bucket);
+	return g;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_host
+ *  Description:  Find the host by its interned id,  creating it with the default delay
+ *                and cap if create is true.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static pl_host_t *
+pl_host( polite_t *pl, uint32_t id, bool create)
+{
+	struct list_head *bucket = &pl->pl_table[id % PL_HOST_BUCKETS];
+	pl_host_t        *h;
+	list_for_each_entry(h, bucket, ph_hash){
+		if( h->ph_id == id ) {
+			return h;
+		}
+	}
+	if( ! create ) {
+		return NULL;
+	}
+	h = (pl_host_t *) malloc(sizeof(pl_host_t));
+	if( ! h ) {
+		return NULL;
+	}
+	bzero(h, sizeof(pl_host_t));
+	h->ph_id     = id;
+	h->ph_key    = hi_name(id);
+	h->ph_state  = PL_IDLE;
+	h->ph_delay  = pl->pl_delay;
+	h->ph_max    = pl->pl_max;
+	h->ph_window = 1;
+	INIT_LIST_HEAD(&h->ph_urls);
+	INIT_LIST_HEAD(&h->ph_ready);
+	tw_timer_init(&h->ph_timer);
+	list_add(&h->ph_hash, bucket);
+	pl->pl_hosts ++;
+	return h;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_schedule
+ *  Description:  Place a host that is in neither the wheel,  the ready list nor a IP
+ *                group wait list.  With nothing queued it goes idle, at its cap it goes
+ *                busy until pl_done and at its group's cap it waits on the group.  If
+ *                the latest of its own and its group's next allowed time and the end
+ *                of a open breaker's cooldown has passed it goes on the ready list and
+ *                otherwise into the wheel.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static void
+pl_schedule( polite_t *pl, pl_host_t *h, uint64_t now)
+{
+	pl_ipgrp_t *g    = h->ph_ip;
+	uint64_t    next = h->ph_next;
+	if( g && g->pg_next > next ) {
+		next = g->pg_next;
+	}
+	if( h->ph_breaker == PL_CB_OPEN ) {
+		if( h->ph_open <= now ) {
+			h->ph_breaker = PL_CB_HALF;
+		}
+		else if( h->ph_open > next ) {
+			next = h->ph_open;
+		}
+	}
+	if( list_empty(&h->ph_urls) ) {
+		h->ph_state = PL_IDLE;
+	}
+	else if( h->ph_active >= pl_cap(pl, h) ) {
+		h->ph_state = PL_BUSY;
+	}
+	else if( g && g->pg_active >= pl->pl_ip_max ) {
+		h->ph_state = PL_IPWAIT;
+		list_add_tail(&h->ph_ready, &g->pg_hosts);
+	}
+	else if( next <= now ) {
+		h->ph_state = PL_READY;
+		list_add_tail(&h->ph_ready, &pl->pl_ready);
+		pthread_cond_signal(&pl->pl_cond);
+	}
+	else {
+		h->ph_state = PL_WAIT;
+		tw_add(&pl->pl_wheel, &h->ph_timer, (next + PL_TICK_MS - 1) / PL_TICK_MS);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_release
+ *  Description:  Advance the wheel to now and move the hosts whose time has come onto
+ *                the ready list.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static void
+pl_release( polite_t *pl, uint64_t now)
+{
+	struct list_head expired;
+	tw_timer_t      *t,
+	                *n;
+	pl_host_t       *h;
+	INIT_LIST_HEAD(&expired);
+	tw_advance(&pl->pl_wheel, now / PL_TICK_MS, &expired);
+	list_for_each_entry_safe(t, n, &expired, tt_list){
+		list_del_init(&t->tt_list);
+		h = list_entry(t, pl_host_t, ph_timer);
+		h->ph_state = PL_IDLE;
+		pl_schedule(pl, h, now);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_cap
+ *  Description:  The number of requests a host may have in flight,  one while its
+ *                breaker is half open.
+ * =====================================================================================
+ */
+static int
+pl_cap( polite_t *pl, pl_host_t *h)
+{
+	if( h->ph_breaker == PL_CB_HALF ) {
+		return 1;
+	}
+	if( pl->pl_adaptive && h->ph_window < h->ph_max ) {
+		return (int) h->ph_window;
+	}
+	return h->ph_max;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_feedback
+ *  Description:  Update a host's latency,  error rate and window from the outcome of
+ *                one request.  A 429,  503 or timeout,  a error rate above
+ *                PL_AIMD_ERRATE or a smoothed latency PL_AIMD_RISE times the lowest
+ *                cuts the window,  at most once per smoothed round trip.  Any other
+ *                good response grows it so that a full window of them adds
+ *                PL_AIMD_INC.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static void
+pl_feedback( pl_host_t *h, long status, long latency, uint64_t now)
+{
+	bool error,
+	     cut = false;
+	if( status == PL_S_NONE ) {
+		return;
+	}
+	error = status < 0 || status == 429 || status >= 500;
+	h->ph_errate += ((error ? 1.0 : 0.0) - h->ph_errate) / PL_AIMD_GAIN;
+	if( status == PL_S_TIMEOUT || status == 429 || status == 503 ) {
+		cut = true;
+	}
+	else if( error ) {
+		cut = h->ph_errate > PL_AIMD_ERRATE;
+	}
+	else if( latency >= 0 ) {
+		if( h->ph_srtt <= 0 ) {
+			h->ph_srtt   = latency;
+			h->ph_minrtt = latency;
+		}
+		else {
+			h->ph_srtt += (latency - h->ph_srtt) / PL_AIMD_GAIN;
+			if( latency < h->ph_minrtt ) {
+				h->ph_minrtt = latency;
+			}
+			else {
+				/* let the floor follow a server whose normal latency has moved */
+				h->ph_minrtt += (h->ph_srtt - h->ph_minrtt) / PL_AIMD_DRIFT;
+			}
+		}
+		/* a tick of slack so hosts answering in a few milliseconds are not cut on noise */
+		cut = h->ph_srtt > h->ph_minrtt * PL_AIMD_RISE + PL_TICK_MS;
+	}
+	if( cut ) {
+		if( now >= h->ph_cut ) {
+			h->ph_window *= PL_AIMD_DEC;
+			if( h->ph_window < 1 ) {
+				h->ph_window = 1;
+			}
+			h->ph_cut = now + (uint64_t) (h->ph_srtt > 0 ? h->ph_srtt : h->ph_delay);
+		}
+	}
+	else if( ! error ) {
+		h->ph_window += PL_AIMD_INC / h->ph_window;
+		if( h->ph_window > h->ph_max ) {
+			h->ph_window = h->ph_max;
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_breaker
+ *  Description:  Update a host's circuit breaker from the outcome of one request.  Only
+ *                timeouts,  connection failures and resolve errors count as failures,
+ *                any HTTP status shows the host is up.  Returns true if the breaker
+ *                has just opened.  Called with pl_lock held.
+ * =====================================================================================
+ */
+static bool
+pl_breaker( pl_host_t *h, long status, uint64_t now)
+{
+	if( status == PL_S_NONE ) {
+		return false;
+	}
+	if( status != PL_S_TIMEOUT && status != PL_S_FAILED && status != PL_S_RESOLVE ) {
+		h->ph_fails    = 0;
+		h->ph_breaker  = PL_CB_CLOSED;
+		h->ph_cooldown = 0;
+		return false;
+	}
+	h->ph_fails ++;
+	if( h->ph_breaker == PL_CB_OPEN
+			|| (h->ph_breaker == PL_CB_CLOSED && h->ph_fails < PL_CB_FAILS) ) {
+		/* already open,  or requests started before it opened are still failing */
+		return false;
+	}
+	if( h->ph_breaker == PL_CB_HALF && h->ph_cooldown ) {
+		h->ph_cooldown *= 2;
+		if( h->ph_cooldown > PL_CB_COOLDOWN_MAX ) {
+			h->ph_cooldown = PL_CB_COOLDOWN_MAX;
+		}
+	}
+	else {
+		h->ph_cooldown = PL_CB_COOLDOWN_MS;
+	}
+	h->ph_breaker = PL_CB_OPEN;
+	h->ph_open    = now + h->ph_cooldown;
+	return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  pl_unlink
+ *  Description:  Take a host out of the wheel,  the ready list or a IP group wait
+ *                list,  whichever it is in,  and leave it idle for pl_schedule.
+ *                Called with pl_lock held.
+ * =====================================================================================
+ */
+static void
+pl_unlink( polite_t *pl, pl_host_t *h)
+{
+	if( h->ph_state == PL_WAIT ) {
+		tw_del(&pl->pl_wheel, &h->ph_timer);
+	}
+	else if( h->ph_state == PL_READY || h->ph_state == PL_IPWAIT ) {
+		list_del_init(&h->ph_ready);
+	}
+	h->ph_state = PL_IDLE;
+}
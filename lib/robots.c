@@ -0,0 +1,727 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  robots.c
+ *
+ *    Description:  robots.txt parsing,  matching and caching.  The groups of a
+ *                  robots.txt that name our product token are used,  or failing that
+ *                  the * group,  and their Allow and Disallow patterns are compiled
+ *                  into a trie.  A * in a pattern is a node that matches any run of
+ *                  bytes and a trailing $ anchors the pattern to the end of the path.
+ *                  Matching walks the path once,  keeping the set of nodes that are
+ *                  still live,  which without wildcards is a single node.  The longest
+ *                  matching pattern decides and a Allow wins a tie.
+ *
+ *        Version:  1.0
+ *        Created:  22/10/2026 20:14:37
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/robots.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define RB_DELAY      3       /* a Crawl-delay line while parsing */
+#define RB_G_STAR     0x01    /* the line belongs to a * group */
+#define RB_G_AGENT    0x02    /* the line belongs to a group naming our agent */
+#define RB_NODES      64      /* nodes allocated for a new trie */
+#define RB_PATTERN    1024    /* longest pattern compiled */
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct rb_line_s {
+	int         rl_kind;    /* RB_ALLOW,  RB_DISALLOW or RB_DELAY */
+	int         rl_group;   /* RB_G_ flags of the group the line is in */
+	const char *rl_val;     /* value,  not terminated */
+	size_t      rl_len;     /* length of rl_val */
+} typedef rb_line_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static int         rb_node( rb_rules_t *rr, int parent, unsigned char ch);
+static int         rb_child( rb_rules_t *rr, int parent, unsigned char ch);
+static void        rb_activate( rb_rules_t *rr, int *set, int *n, int node);
+static void        rb_note( rb_rules_t *rr, int *set, int n, bool end, int *best, int *kind);
+static bool        rb_agent( const char *agent, const char *val, size_t len);
+static rb_entry_t *rb_entry( robots_t *rc, uint32_t id, bool create);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_rules_init
+ *  Description:  Initilize a empty rule set,  one that allows everything.
+ * =====================================================================================
+ */
+extern int
+rb_rules_init( rb_rules_t *rr)
+{
+	bzero(rr, sizeof(rb_rules_t));
+	rr->rr_nodes = (rb_node_t *) malloc(RB_NODES * sizeof(rb_node_t));
+	if( ! rr->rr_nodes ) {
+		return ENOMEM;
+	}
+	bzero(rr->rr_nodes, sizeof(rb_node_t));
+	rr->rr_count = 1;
+	rr->rr_size  = RB_NODES;
+	rr->rr_delay = -1;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_rules_parse
+ *  Description:  Compile the rules of a robots.txt body that apply to agent.  Lines
+ *                are split into groups by their User-agent lines,  if any group names
+ *                agent the rules of every such group are used,  otherwise those of the
+ *                * groups.  Only the first RB_BODY_MAX bytes are read.  The largest
+ *                Crawl-delay of the chosen groups is kept in rr_delay.  Returns 0 or
+ *                ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rb_rules_parse( rb_rules_t *rr, const char *agent, const char *text, size_t len)
+{
+	rb_line_t  *lines = NULL,
+	           *l;
+	const char *p     = text,
+	           *end,
+	           *eol,
+	           *key,
+	           *val,
+	           *c;
+	size_t      klen,
+	            vlen;
+	int         count = 0,
+	            size  = 0,
+	            group = 0,
+	            want,
+	            err   = 0,
+	            i;
+	bool        in_agent = false,
+	            named    = false;
+	double      delay;
+	long        ms;
+	char        num[32];
+	if( len > RB_BODY_MAX ) {
+		len = RB_BODY_MAX;
+	}
+	end = text + len;
+	if( len >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0 ) {
+		p += 3;
+	}
+	for(; p < end; p = eol + 1){
+		if( ! (eol = memchr(p, '\n', end - p)) ) {
+			eol = end;
+		}
+		/* strip the comment and the white space around key and value */
+		if( ! (c = memchr(p, '#', eol - p)) ) {
+			c = eol;
+		}
+		if( ! (val = memchr(p, ':', c - p)) ) {
+			continue;
+		}
+		for(key = p; key < val && isspace(*key); key ++);
+		for(klen = val - key; klen && isspace(key[klen - 1]); klen --);
+		for(val ++; val < c && isspace(*val); val ++);
+		for(vlen = c - val; vlen && isspace(val[vlen - 1]); vlen --);
+		if( klen == 10 && strncasecmp(key, "user-agent", klen) == 0 ) {
+			if( ! in_agent ) {
+				group    = 0;
+				in_agent = true;
+			}
+			if( vlen == 1 && *val == '*' ) {
+				group |= RB_G_STAR;
+			}
+			else if( rb_agent(agent, val, vlen) ) {
+				group |= RB_G_AGENT;
+				named  = true;
+			}
+			continue;
+		}
+		if( klen == 5 && strncasecmp(key, "allow", klen) == 0 ) {
+			want = RB_ALLOW;
+		}
+		else if( klen == 8 && strncasecmp(key, "disallow", klen) == 0 ) {
+			want = RB_DISALLOW;
+		}
+		else if( klen == 11 && strncasecmp(key, "crawl-delay", klen) == 0 ) {
+			want = RB_DELAY;
+		}
+		else {
+			/* Sitemap and unknown lines do not end a run of User-agent lines */
+			continue;
+		}
+		in_agent = false;
+		if( ! group || ! vlen ) {
+			continue;
+		}
+		if( count == size ) {
+			size = size ? size * 2 : 32;
+			if( ! (l = (rb_line_t *) realloc(lines, size * sizeof(rb_line_t))) ) {
+				free(lines);
+				return ENOMEM;
+			}
+			lines = l;
+		}
+		lines[count].rl_kind  = want;
+		lines[count].rl_group = group;
+		lines[count].rl_val   = val;
+		lines[count].rl_len   = vlen;
+		count ++;
+	}
+	want = named ? RB_G_AGENT : RB_G_STAR;
+	for(i = 0; i < count && ! err; i ++){
+		l = &lines[i];
+		if( ! (l->rl_group & want) ) {
+			continue;
+		}
+		if( l->rl_kind == RB_DELAY ) {
+			/* the body need not be terminated,  copy the value out before strtod */
+			snprintf(num, sizeof(num), "%.*s", (int) l->rl_len, l->rl_val);
+			delay = strtod(num, NULL);
+			if( delay >= 0 ) {
+				ms = (delay * 1000 > RB_DELAY_MAX) ? RB_DELAY_MAX : (long) (delay * 1000);
+				if( ms > rr->rr_delay ) {
+					rr->rr_delay = ms;
+				}
+			}
+		}
+		else {
+			err = rb_rules_add(rr, l->rl_kind, l->rl_val, l->rl_len);
+		}
+	}
+	free(lines);
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_rules_add
+ *  Description:  Compile one Allow or Disallow pattern.  Percent escapes are upper
+ *                cased to match paths from uri_norm_path,  runs of * are collapsed,
+ *                a trailing * is dropped as patterns already match by prefix and a
+ *                trailing $ anchors the pattern.  Patterns longer than RB_PATTERN are
+ *                cut short.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rb_rules_add( rb_rules_t *rr, int kind, const char *pattern, size_t len)
+{
+	char       buf[RB_PATTERN];
+	size_t     n = 0,
+	           i = 0;
+	int        node = 0;
+	bool       anchor = false;
+	rb_node_t *nd;
+	if( len && *pattern != '/' && *pattern != '*' ) {
+		buf[n ++] = '/';
+	}
+	for(; i < len && n < RB_PATTERN; i ++){
+		if( pattern[i] == '*' && n && buf[n - 1] == '*' ) {
+			continue;
+		}
+		if( pattern[i] == '%' && i + 2 < len && isxdigit(pattern[i + 1])
+				&& isxdigit(pattern[i + 2]) && n + 3 <= RB_PATTERN ) {
+			buf[n ++] = '%';
+			buf[n ++] = toupper(pattern[++ i]);
+			buf[n ++] = toupper(pattern[++ i]);
+			continue;
+		}
+		buf[n ++] = pattern[i];
+	}
+	if( n && buf[n - 1] == '$' ) {
+		anchor = true;
+		n --;
+	}
+	if( n && buf[n - 1] == '*' ) {
+		anchor = false;
+		n --;
+	}
+	for(i = 0; i < n; i ++){
+		if( ! (node = rb_node(rr, node, buf[i])) ) {
+			return ENOMEM;
+		}
+	}
+	nd = &rr->rr_nodes[node];
+	if( anchor ) {
+		if( nd->rn_erule != RB_ALLOW ) {
+			nd->rn_erule = kind;
+		}
+		nd->rn_elen = len;
+	}
+	else {
+		if( nd->rn_rule != RB_ALLOW ) {
+			nd->rn_rule = kind;
+		}
+		nd->rn_len = len;
+	}
+	rr->rr_rules ++;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_rules_match
+ *  Description:  Is path,  followed by ? and query when query is not empty,  allowed.
+ *                path should be normalized by uri_norm_path,  a empty path is taken
+ *                as /.  The trie is walked once over the bytes of the path,  each step
+ *                noting the rules of the live nodes.
+ * =====================================================================================
+ */
+extern bool
+rb_rules_match( rb_rules_t *rr, const char *path, const char *query)
+{
+	int         set[2][RB_ACTIVE_MAX],
+	           *a = set[0],
+	           *b = set[1],
+	           *t,
+	            na = 0,
+	            nb,
+	            best = -1,
+	            kind = RB_ALLOW,
+	            part,
+	            c,
+	            i;
+	const char *s[3],
+	           *p;
+	if( ! rr->rr_rules ) {
+		return true;
+	}
+	s[0] = (path && *path) ? path : "/";
+	s[1] = (query && *query) ? "?" : "";
+	s[2] = (query && *query) ? query : "";
+	rb_activate(rr, a, &na, 0);
+	for(part = 0; part < 3; part ++){
+		for(p = s[part]; *p; p ++){
+			rb_note(rr, a, na, false, &best, &kind);
+			nb = 0;
+			for(i = 0; i < na; i ++){
+				if( a[i] && rr->rr_nodes[a[i]].rn_ch == '*' ) {
+					rb_activate(rr, b, &nb, a[i]);
+				}
+				if( (c = rb_child(rr, a[i], *p)) ) {
+					rb_activate(rr, b, &nb, c);
+				}
+			}
+			t  = a;
+			a  = b;
+			b  = t;
+			na = nb;
+			if( ! na ) {
+				return kind == RB_ALLOW;
+			}
+		}
+	}
+	rb_note(rr, a, na, true, &best, &kind);
+	return kind == RB_ALLOW;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_rules_free
+ *  Description:  Release the trie of a rule set.
+ * =====================================================================================
+ */
+extern void
+rb_rules_free( rb_rules_t *rr)
+{
+	free(rr->rr_nodes);
+	rr->rr_nodes = NULL;
+	rr->rr_count = rr->rr_size = rr->rr_rules = 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_init
+ *  Description:  Initilize a robots.txt cache for the product token agent.  ttl is the
+ *                number of seconds a robots.txt is kept,  zero or less picks RB_TTL.
+ *                If pl is not NULL each host's Crawl-delay is set on it.
+ * =====================================================================================
+ */
+extern int
+rb_init( robots_t *rc, const char *agent, long ttl, polite_t *pl)
+{
+	int err = 0,
+	    i   = 0;
+	bzero(rc, sizeof(robots_t));
+	if( ! (rc->rc_agent = strdup(agent)) ) {
+		return ENOMEM;
+	}
+	rc->rc_ttl = (ttl > 0) ? ttl : RB_TTL;
+	rc->rc_pl  = pl;
+	if( (err = pthread_mutex_init(&rc->rc_lock, NULL)) ) {
+		free(rc->rc_agent);
+		return err;
+	}
+	if( (err = pthread_cond_init(&rc->rc_cond, NULL)) ) {
+		pthread_mutex_destroy(&rc->rc_lock);
+		free(rc->rc_agent);
+		return err;
+	}
+	for(; i < RB_BUCKETS; i ++){
+		INIT_LIST_HEAD(&rc->rc_table[i]);
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_check
+ *  Description:  Check a normalized URI against the robots.txt of its host and set
+ *                allowed.  If the host's robots.txt is missing or has expired the
+ *                first caller gets EINPROGRESS and must fetch rb_url of the URI and
+ *                pass the result,  failed or not,  to rb_store.  While that fetch is
+ *                in flight other callers use the expired rules if there are any,
+ *                otherwise they block until it is stored if wait is true or get
+ *                EAGAIN.  A fetch not stored within RB_FETCH_MS is taken to be lost
+ *                and the next caller,  or a blocked one,  gets EINPROGRESS in its
+ *                place.  Returns 0,  EINPROGRESS,  EAGAIN,  EINVAL if the URI has
+ *                no host or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rb_check( robots_t *rc, uriobj_t *uri, bool wait, bool *allowed)
+{
+	struct timespec ts;
+	rb_entry_t     *e;
+	uint64_t        now,
+	                left;
+	uint32_t        id = hi_uri(uri);
+	if( ! id ) {
+		return EINVAL;
+	}
+	pthread_mutex_lock(&rc->rc_lock);
+	for(;;) {
+		if( ! (e = rb_entry(rc, id, true)) ) {
+			pthread_mutex_unlock(&rc->rc_lock);
+			return ENOMEM;
+		}
+		now = pl_now();
+		if( e->re_fetching && now - e->re_started >= RB_FETCH_MS ) {
+			/* the caller told to fetch it died or is stuck,  a late rb_store is harmless */
+			e->re_fetching = false;
+		}
+		if( e->re_ready && (e->re_fetching || e->re_expires > time(NULL)) ) {
+			*allowed = rb_rules_match(&e->re_rules, *uri->uri_path, *uri->uri_query);
+			pthread_mutex_unlock(&rc->rc_lock);
+			return 0;
+		}
+		if( ! e->re_fetching ) {
+			e->re_fetching = true;
+			e->re_started  = now;
+			pthread_mutex_unlock(&rc->rc_lock);
+			return EINPROGRESS;
+		}
+		if( ! wait ) {
+			pthread_mutex_unlock(&rc->rc_lock);
+			return EAGAIN;
+		}
+		/* wake by the fetch's deadline to take it over if it is not stored */
+		left = e->re_started + RB_FETCH_MS - now;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec  += left / 1000;
+		ts.tv_nsec += (left % 1000) * 1000000L;
+		if( ts.tv_nsec >= 1000000000L ) {
+			ts.tv_sec  ++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&rc->rc_cond, &rc->rc_lock, &ts);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_store
+ *  Description:  Store the result of fetching a host's robots.txt.  status is the
+ *                HTTP status,  or 0 if the fetch failed.  After RFC 9309 a 2xx body
+ *                is parsed,  a 3xx or 4xx other than 429 means there are no rules and
+ *                anything else means the whole host is disallowed,  for RB_ERROR_TTL
+ *                rather than the cache's TTL.  Callers blocked in rb_check are woken.
+ *                Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rb_store( robots_t *rc, const char *host, long status, const char *body, size_t len)
+{
+	rb_rules_t  rr;
+	rb_entry_t *e;
+	uint32_t    id    = hi_intern(host, strlen(host));
+	long        ttl   = rc->rc_ttl,
+	            delay;
+	int         err;
+	if( ! (err = rb_rules_init(&rr)) ) {
+		if( status >= 200 && status < 300 ) {
+			err = body ? rb_rules_parse(&rr, rc->rc_agent, body, len) : 0;
+		}
+		else if( status < 300 || status >= 500 || status == 429 ) {
+			err = rb_rules_add(&rr, RB_DISALLOW, "/", 1);
+			ttl = RB_ERROR_TTL;
+		}
+	}
+	pthread_mutex_lock(&rc->rc_lock);
+	if( ! id || ! (e = rb_entry(rc, id, ! err)) ) {
+		err = err ? err : ENOMEM;
+	}
+	else if( err ) {
+		/* leave the old rules,  or none,  and let the next check fetch again */
+		e->re_fetching = false;
+	}
+	else {
+		if( e->re_ready ) {
+			rb_rules_free(&e->re_rules);
+		}
+		e->re_rules    = rr;
+		e->re_ready    = true;
+		e->re_fetching = false;
+		e->re_expires  = time(NULL) + ttl;
+	}
+	pthread_cond_broadcast(&rc->rc_cond);
+	pthread_mutex_unlock(&rc->rc_lock);
+	if( err ) {
+		rb_rules_free(&rr);
+		return err;
+	}
+	if( rc->rc_pl && rr.rr_delay >= 0 ) {
+		delay = (rr.rr_delay > rc->rc_pl->pl_delay) ? rr.rr_delay : rc->rc_pl->pl_delay;
+		err   = pl_set_host(rc->rc_pl, host, delay, 0);
+	}
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_url
+ *  Description:  The robots.txt URL for the host of a URI,  to be freed by the
+ *                caller.  NULL if the URI has no scheme or authority or on ENOMEM.
+ * =====================================================================================
+ */
+extern char *
+rb_url( uriobj_t *uri)
+{
+	char   *scheme = *uri->uri_scheme,
+	       *auth   = *uri->uri_auth,
+	       *url;
+	size_t  len;
+	if( ! scheme || ! auth ) {
+		return NULL;
+	}
+	len = strlen(scheme) + strlen(auth) + sizeof("://" "/robots.txt");
+	if( (url = (char *) malloc(len)) ) {
+		snprintf(url, len, "%s://%s/robots.txt", scheme, auth);
+	}
+	return url;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_expire
+ *  Description:  Drop the hosts whose robots.txt has expired and is not being
+ *                fetched.  Returns the number dropped.
+ * =====================================================================================
+ */
+extern int
+rb_expire( robots_t *rc)
+{
+	rb_entry_t *e,
+	           *n;
+	time_t      now = time(NULL);
+	int         i   = 0,
+	            count = 0;
+	pthread_mutex_lock(&rc->rc_lock);
+	for(; i < RB_BUCKETS; i ++){
+		list_for_each_entry_safe(e, n, &rc->rc_table[i], re_hash){
+			if( e->re_fetching || e->re_expires > now ) {
+				continue;
+			}
+			list_del(&e->re_hash);
+			if( e->re_ready ) {
+				rb_rules_free(&e->re_rules);
+			}
+			free(e);
+			rc->rc_entries --;
+			count ++;
+		}
+	}
+	pthread_mutex_unlock(&rc->rc_lock);
+	return count;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_destroy
+ *  Description:  Release the cache and every host in it.
+ * =====================================================================================
+ */
+extern void
+rb_destroy( robots_t *rc)
+{
+	rb_entry_t *e,
+	           *n;
+	int         i = 0;
+	for(; i < RB_BUCKETS; i ++){
+		list_for_each_entry_safe(e, n, &rc->rc_table[i], re_hash){
+			if( e->re_ready ) {
+				rb_rules_free(&e->re_rules);
+			}
+			free(e);
+		}
+	}
+	free(rc->rc_agent);
+	pthread_cond_destroy(&rc->rc_cond);
+	pthread_mutex_destroy(&rc->rc_lock);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_node
+ *  Description:  The child of parent on ch,  created if there is none.  0 on ENOMEM,
+ *                the root is never a child.
+ * =====================================================================================
+ */
+static int
+rb_node( rb_rules_t *rr, int parent, unsigned char ch)
+{
+	rb_node_t *nodes;
+	int        node = rb_child(rr, parent, ch);
+	if( node ) {
+		return node;
+	}
+	if( rr->rr_count == rr->rr_size ) {
+		nodes = (rb_node_t *) realloc(rr->rr_nodes, rr->rr_size * 2 * sizeof(rb_node_t));
+		if( ! nodes ) {
+			return 0;
+		}
+		rr->rr_nodes = nodes;
+		rr->rr_size *= 2;
+	}
+	node = rr->rr_count ++;
+	bzero(&rr->rr_nodes[node], sizeof(rb_node_t));
+	rr->rr_nodes[node].rn_ch   = ch;
+	rr->rr_nodes[node].rn_next = rr->rr_nodes[parent].rn_child;
+	rr->rr_nodes[parent].rn_child = node;
+	return node;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_child
+ *  Description:  The child of parent on ch,  0 if there is none.
+ * =====================================================================================
+ */
+static int
+rb_child( rb_rules_t *rr, int parent, unsigned char ch)
+{
+	int node = rr->rr_nodes[parent].rn_child;
+	while( node && rr->rr_nodes[node].rn_ch != ch ) {
+		node = rr->rr_nodes[node].rn_next;
+	}
+	return node;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_activate
+ *  Description:  Add node to the live set along with its wildcard child,  which
+ *                matches the empty run.  Nodes past RB_ACTIVE_MAX are dropped.
+ * =====================================================================================
+ */
+static void
+rb_activate( rb_rules_t *rr, int *set, int *n, int node)
+{
+	int i = 0;
+	for(; i < *n; i ++){
+		if( set[i] == node ) {
+			return;
+		}
+	}
+	if( *n == RB_ACTIVE_MAX ) {
+		return;
+	}
+	set[(*n) ++] = node;
+	if( (node = rb_child(rr, node, '*')) ) {
+		rb_activate(rr, set, n, node);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_note
+ *  Description:  Fold the rules of the live nodes into the best match so far,  the
+ *                anchored ones only at the end of the path.
+ * =====================================================================================
+ */
+static void
+rb_note( rb_rules_t *rr, int *set, int n, bool end, int *best, int *kind)
+{
+	rb_node_t *nd;
+	int        i = 0;
+	for(; i < n; i ++){
+		nd = &rr->rr_nodes[set[i]];
+		if( nd->rn_rule && (nd->rn_len > *best
+					|| (nd->rn_len == *best && nd->rn_rule == RB_ALLOW)) ) {
+			*best = nd->rn_len;
+			*kind = nd->rn_rule;
+		}
+		if( end && nd->rn_erule && (nd->rn_elen > *best
+					|| (nd->rn_elen == *best && nd->rn_erule == RB_ALLOW)) ) {
+			*best = nd->rn_elen;
+			*kind = nd->rn_erule;
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_agent
+ *  Description:  Does a User-agent value name agent.  Only the product token is
+ *                compared,  without regard to case and ignoring any version.
+ * =====================================================================================
+ */
+static bool
+rb_agent( const char *agent, const char *val, size_t len)
+{
+	size_t n = 0;
+	while( n < len && val[n] != '/' && ! isspace(val[n]) ) {
+		n ++;
+	}
+	return n && strlen(agent) == n && strncasecmp(agent, val, n) == 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rb_entry
+ *  Description:  Find the cache entry of a host by its interned id,  creating a empty
+ *                one if create is true.  Called with rc_lock held.
+ * =====================================================================================
+ */
+static rb_entry_t *
+rb_entry( robots_t *rc, uint32_t id, bool create)
+{
+	struct list_head *bucket = &rc->rc_table[id % RB_BUCKETS];
+	rb_entry_t       *e;
+	list_for_each_entry(e, bucket, re_hash){
+		if( e->re_id == id ) {
+			return e;
+		}
+	}
+	if( ! create ) {
+		return NULL;
+	}
+	e = (rb_entry_t *) malloc(sizeof(rb_entry_t));
+	if( ! e ) {
+		return NULL;
+	}
+	bzero(e, sizeof(rb_entry_t));
+	e->re_id  = id;
+	e->re_key = hi_name(id);
+	list_add(&e->re_hash, bucket);
+	rc->rc_entries ++;
+	return e;
+}
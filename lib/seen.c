@@ -0,0 +1,290 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  seen.c
+ *
+ *    Description:  The URL seen set,  a blocked Bloom filter over 64 bit URI
+ *                  fingerprints.  The fingerprint picks a block and k bits in it by
+ *                  double hashing,  the bits in each word are set with one atomic OR
+ *                  which also tells whether they were all set before,  so a insert is
+ *                  also the test and concurrent inserts need no lock.  Two threads
+ *                  inserting the same new key at once may both be told it is new.
+ *                  A saved filter is loaded with a private mapping of the file,  pages
+ *                  are read in as they are touched and writes never reach the file.
+ *
+ *        Version:  1.0
+ *        Created:  24/10/2026 19:36:12
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/seen.h>
+#include <azzmos/utils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define SN_FP_BASE   0.6185    /* false positive rate of one bit per key,  0.5 ^ ln2 */
+#define SN_URI_BUF   2048      /* URIs shorter than this are fingerprinted on the stack */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static uint64_t *sn_block( seen_t *sn, uint64_t fp, uint64_t mask[SN_BLOCK_WORDS]);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_init
+ *  Description:  Initilize a empty filter sized for n keys at the false positive rate
+ *                given,  SN_FP_RATE if rate is 0.  The bits per key are the fewest
+ *                for which a standard Bloom filter meets the rate plus one,  blocking
+ *                costs a little accuracy.  The memory is a anonymous mapping so the
+ *                pages are only committed once a key lands in them.  Returns 0,
+ *                EINVAL or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+sn_init( seen_t *sn, uint64_t n, double rate)
+{
+	double   p    = 1.0;
+	uint64_t bits = 1;
+	bzero(sn, sizeof(seen_t));
+	if( rate == 0.0 ) {
+		rate = SN_FP_RATE;
+	}
+	if( rate <= 0.0 || rate >= 1.0 ) {
+		return EINVAL;
+	}
+	for(; p > rate; bits ++){
+		p *= SN_FP_BASE;
+	}
+	sn->sn_k = (int) ((bits - 1) * 693 + 500) / 1000;
+	if( sn->sn_k < 1 ) {
+		sn->sn_k = 1;
+	}
+	if( sn->sn_k > SN_K_MAX ) {
+		sn->sn_k = SN_K_MAX;
+	}
+	bits *= n ? n : 1;
+	sn->sn_blocks = (bits + SN_BLOCK_BITS - 1) / SN_BLOCK_BITS;
+	sn->sn_maplen = sn->sn_blocks * SN_BLOCK_WORDS * sizeof(uint64_t);
+	sn->sn_map    = mmap(NULL, sn->sn_maplen, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( sn->sn_map == MAP_FAILED ) {
+		sn->sn_map = NULL;
+		return ENOMEM;
+	}
+	sn->sn_bits = (uint64_t *) sn->sn_map;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_insert
+ *  Description:  Add a fingerprint,  returns true if it was already in the filter,
+ *                or is a false positive,  and the URI need not be queued.  Safe to
+ *                call from any number of threads at once.
+ * =====================================================================================
+ */
+extern bool
+sn_insert( seen_t *sn, uint64_t fp)
+{
+	uint64_t  mask[SN_BLOCK_WORDS],
+	         *b   = sn_block(sn, fp, mask),
+	          old;
+	bool      seen = true;
+	int       i    = 0;
+	for(; i < SN_BLOCK_WORDS; i ++){
+		if( ! mask[i] ) {
+			continue;
+		}
+		/* a plain load first,  a link seen before dirties no cache line */
+		old = __atomic_load_n(&b[i], __ATOMIC_RELAXED);
+		if( (old & mask[i]) != mask[i] ) {
+			old = __atomic_fetch_or(&b[i], mask[i], __ATOMIC_RELAXED);
+			if( (old & mask[i]) != mask[i] ) {
+				seen = false;
+			}
+		}
+	}
+	if( ! seen ) {
+		__atomic_fetch_add(&sn->sn_count, 1, __ATOMIC_RELAXED);
+	}
+	return seen;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_test
+ *  Description:  Is the fingerprint in the filter,  without adding it.
+ * =====================================================================================
+ */
+extern bool
+sn_test( seen_t *sn, uint64_t fp)
+{
+	uint64_t  mask[SN_BLOCK_WORDS],
+	         *b = sn_block(sn, fp, mask);
+	int       i = 0;
+	for(; i < SN_BLOCK_WORDS; i ++){
+		if( (__atomic_load_n(&b[i], __ATOMIC_RELAXED) & mask[i]) != mask[i] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_fingerprint
+ *  Description:  Fingerprint of a normalized URI,  mem_hash64 of its uri_url_str
+ *                "scheme://authority/path?query",  the same value rf_resolve gives a
+ *                link in rr_fp.  Returns 0 if memory for a long URI could not be
+ *                allocated.
+ * =====================================================================================
+ */
+extern uint64_t
+sn_fingerprint( uriobj_t *uri)
+{
+	char     buf[SN_URI_BUF],
+	        *s   = buf;
+	size_t   len = uri_url_str(uri, NULL);
+	uint64_t fp;
+	if( len >= SN_URI_BUF && ! (s = (char *) malloc(len + 1)) ) {
+		return 0;
+	}
+	len = uri_url_str(uri, s);
+	fp  = mem_hash64(s, len);
+	if( s != buf ) {
+		free(s);
+	}
+	return fp;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_save
+ *  Description:  Write the filter to path.  It is written to path.tmp and renamed so
+ *                a crash while saving leaves the last saved filter in place.  Inserts
+ *                may carry on while it is saved,  those that race with it may or may
+ *                not be in the file.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+sn_save( seen_t *sn, const char *path)
+{
+	sn_header_t  sh;
+	struct iovec iov[2];
+	bzero(&sh, sizeof(sn_header_t));
+	memcpy(sh.sh_magic, SN_MAGIC, sizeof(sh.sh_magic));
+	sh.sh_blocks = sn->sn_blocks;
+	sh.sh_k      = sn->sn_k;
+	sh.sh_count  = __atomic_load_n(&sn->sn_count, __ATOMIC_RELAXED);
+	sh.sh_size   = sizeof(sn_header_t) + sn->sn_blocks * SN_BLOCK_WORDS * sizeof(uint64_t);
+	iov[0].iov_base = &sh;
+	iov[0].iov_len  = sizeof(sn_header_t);
+	iov[1].iov_base = sn->sn_bits;
+	iov[1].iov_len  = sh.sh_size - sizeof(sn_header_t);
+	return file_replace(path, iov, 2);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_load
+ *  Description:  Initilize the filter from a file written by sn_save.  The file is
+ *                mapped privately rather than read,  so a large filter is usable
+ *                straight away.  Returns 0,  EINVAL if the file is not a complete
+ *                saved filter or a errno value from opening or mapping it.
+ * =====================================================================================
+ */
+extern int
+sn_load( seen_t *sn, const char *path)
+{
+	struct stat  st;
+	sn_header_t *sh;
+	int          fd,
+	             err = 0;
+	bzero(sn, sizeof(seen_t));
+	if( (fd = open(path, O_RDONLY)) == -1 ) {
+		return errno;
+	}
+	if( fstat(fd, &st) == -1 ) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	if( (size_t) st.st_size < sizeof(sn_header_t) ) {
+		close(fd);
+		return EINVAL;
+	}
+	sn->sn_maplen = st.st_size;
+	sn->sn_map    = mmap(NULL, sn->sn_maplen, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	err = (sn->sn_map == MAP_FAILED) ? errno : 0;
+	close(fd);
+	if( err ) {
+		sn->sn_map = NULL;
+		return err;
+	}
+	sh = (sn_header_t *) sn->sn_map;
+	if( memcmp(sh->sh_magic, SN_MAGIC, sizeof(sh->sh_magic)) != 0
+			|| sh->sh_size != (uint64_t) st.st_size || ! sh->sh_blocks
+			|| sh->sh_size != sizeof(sn_header_t) + sh->sh_blocks * SN_BLOCK_WORDS * sizeof(uint64_t)
+			|| sh->sh_k < 1 || sh->sh_k > SN_K_MAX ) {
+		sn_free(sn);
+		return EINVAL;
+	}
+	sn->sn_blocks = sh->sh_blocks;
+	sn->sn_k      = (int) sh->sh_k;
+	sn->sn_count  = sh->sh_count;
+	sn->sn_bits   = (uint64_t *) ((char *) sn->sn_map + sizeof(sn_header_t));
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_free
+ *  Description:  Release the filter.
+ * =====================================================================================
+ */
+extern void
+sn_free( seen_t *sn)
+{
+	if( sn->sn_map ) {
+		munmap(sn->sn_map, sn->sn_maplen);
+	}
+	bzero(sn, sizeof(seen_t));
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sn_block
+ *  Description:  The block a fingerprint falls in and the bits of it that are set for
+ *                the fingerprint,  as a mask for each word.  The block is picked by
+ *                the fingerprint and the bits by double hashing a remix of it so the
+ *                two are independent.
+ * =====================================================================================
+ */
+static uint64_t *
+sn_block( seen_t *sn, uint64_t fp, uint64_t mask[SN_BLOCK_WORDS])
+{
+	uint64_t h  = (fp ^ (fp >> 31)) * 0x9e3779b97f4a7c15ULL;
+	uint32_t h1 = (uint32_t) h,
+	         h2 = (uint32_t) (h >> 32) | 1,
+	         bit;
+	int      i  = 0;
+	bzero(mask, SN_BLOCK_WORDS * sizeof(uint64_t));
+	for(; i < sn->sn_k; i ++){
+		bit = (h1 + i * h2) % SN_BLOCK_BITS;
+		mask[bit / 64] |= 1ULL << (bit % 64);
+	}
+	return sn->sn_bits + (fp % sn->sn_blocks) * SN_BLOCK_WORDS;
+}
@@ -0,0 +1,576 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  segq.c
+ *
+ *    Description:  Disk backed queues.  A record is a varint length and its bytes.
+ *                  Records are appended to a queue's tail,  a growing buffer of at
+ *                  most SQ_PAGE_SIZE,  and read from its head.  A full tail is written
+ *                  to the end of the current segment as a page.  When memory is over
+ *                  budget the tails of the queues pushed to least recently are written
+ *                  out,  however short.  Once a head is read the queue's oldest page is
+ *                  mapped in,  or if it has none its tail becomes the head.  A segment
+ *                  counts its pages that have not been read,  when that reaches zero it
+ *                  is truncated and reused.
+ *
+ *        Version:  1.0
+ *        Created:  25/10/2026 19:14:52
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/segq.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define SQ_VARINT_MAX  3    /* bytes in the varint of SQ_RECORD_MAX */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static char     *sq_reserve( segq_t *sq, sq_queue_t *q, size_t len);
+static int       sq_budget( segq_t *sq);
+static int       sq_spill( segq_t *sq, sq_queue_t *q, bool keep);
+static sq_seg_t *sq_segment( segq_t *sq, size_t len);
+static void      sq_release( segq_t *sq, sq_seg_t *seg);
+static int       sq_map( segq_t *sq, sq_queue_t *q);
+static void      sq_head_free( segq_t *sq, sq_queue_t *q);
+static size_t    sq_varint_put( char *p, size_t v);
+static size_t    sq_varint_get( const char *p, const char *end, size_t *v);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_init
+ *  Description:  Initilize the queues with segments in dir,  which must exist.  A zero
+ *                seg_size or budget is SQ_SEG_SIZE or SQ_BUDGET.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+sq_init( segq_t *sq, const char *dir, off_t seg_size, size_t budget)
+{
+	bzero(sq, sizeof(segq_t));
+	if( ! (sq->sq_dir = strdup(dir)) ) {
+		return ENOMEM;
+	}
+	sq->sq_seg_size = seg_size ? seg_size : SQ_SEG_SIZE;
+	sq->sq_budget   = budget ? budget : SQ_BUDGET;
+	INIT_LIST_HEAD(&sq->sq_free);
+	INIT_LIST_HEAD(&sq->sq_tails);
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_queue_init
+ *  Description:  Initilize a empty queue for the host key.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+sq_queue_init( sq_queue_t *q, const char *key)
+{
+	bzero(q, sizeof(sq_queue_t));
+	if( ! (q->sq_key = strdup(key)) ) {
+		return ENOMEM;
+	}
+	INIT_LIST_HEAD(&q->sq_pages);
+	INIT_LIST_HEAD(&q->sq_lru);
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_push
+ *  Description:  Append a record of len bytes to the queue.  Returns 0,  EINVAL if it
+ *                is longer than SQ_RECORD_MAX,  ENOMEM or a errno value from writing a
+ *                segment.
+ * =====================================================================================
+ */
+extern int
+sq_push( segq_t *sq, sq_queue_t *q, const void *data, size_t len)
+{
+	char *p;
+	if( len > SQ_RECORD_MAX ) {
+		return EINVAL;
+	}
+	if( ! (p = sq_reserve(sq, q, len)) ) {
+		return errno;
+	}
+	memcpy(p, data, len);
+	return sq_budget(sq);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_pop
+ *  Description:  Take the oldest record from the queue.  data points into the queue's
+ *                head and stays valid until the next sq_pop on the queue.  Returns 0,
+ *                ENOENT if the queue is empty,  EIO if a page is corrupt or a errno
+ *                value from mapping a page.
+ * =====================================================================================
+ */
+extern int
+sq_pop( segq_t *sq, sq_queue_t *q, const char **data, size_t *len)
+{
+	size_t n;
+	int    err;
+	if( q->sq_hpos >= q->sq_hlen ) {
+		sq_head_free(sq, q);
+		if( ! list_empty(&q->sq_pages) ) {
+			if( (err = sq_map(sq, q)) ) {
+				return err;
+			}
+		}
+		else if( q->sq_tlen ) {
+			/* nothing was spilled,  the tail is read where it is */
+			q->sq_head  = q->sq_tail;
+			q->sq_hlen  = q->sq_tlen;
+			q->sq_hsize = q->sq_tsize;
+			q->sq_tail  = NULL;
+			q->sq_tlen  = q->sq_tsize = 0;
+			list_del_init(&q->sq_lru);
+		}
+		else {
+			return ENOENT;
+		}
+	}
+	n = sq_varint_get(q->sq_head + q->sq_hpos, q->sq_head + q->sq_hlen, len);
+	if( ! n || *len > q->sq_hlen - q->sq_hpos - n ) {
+		return EIO;
+	}
+	*data = q->sq_head + q->sq_hpos + n;
+	q->sq_hpos += n + *len;
+	q->sq_count --;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_push_uri
+ *  Description:  Append a normalized http or https URI.  The record is a SQ_ flags
+ *                byte,  the authority if it is not the queue's key and the path and
+ *                query.  Returns as sq_push,  EINVAL if the scheme is not http or
+ *                https.
+ * =====================================================================================
+ */
+extern int
+sq_push_uri( segq_t *sq, sq_queue_t *q, uriobj_t *uri)
+{
+	const char *scheme = *uri->uri_scheme,
+	           *auth   = *uri->uri_auth ? *uri->uri_auth : "",
+	           *path   = (*uri->uri_path && **uri->uri_path) ? *uri->uri_path : "/",
+	           *query  = *uri->uri_query;
+	size_t      alen   = 0,
+	            plen   = strlen(path),
+	            qlen   = query ? strlen(query) + 1 : 0,
+	            len;
+	char        flags  = 0,
+	           *p;
+	if( ! scheme || (strcasecmp(scheme, "http") && strcasecmp(scheme, "https")) ) {
+		return EINVAL;
+	}
+	if( strcasecmp(scheme, "https") == 0 ) {
+		flags |= SQ_HTTPS;
+	}
+	if( strcasecmp(auth, q->sq_key) ) {
+		flags |= SQ_AUTH;
+		alen   = strlen(auth);
+	}
+	len = 1 + plen + qlen;
+	if( alen ) {
+		len += alen + ((alen < 0x80) ? 1 : (alen < 0x4000) ? 2 : 3);
+	}
+	if( len > SQ_RECORD_MAX ) {
+		return EINVAL;
+	}
+	if( ! (p = sq_reserve(sq, q, len)) ) {
+		return errno;
+	}
+	*p ++ = flags;
+	if( alen ) {
+		p += sq_varint_put(p, alen);
+		memcpy(p, auth, alen);
+		p += alen;
+	}
+	memcpy(p, path, plen);
+	if( query ) {
+		p[plen] = '?';
+		memcpy(p + plen + 1, query, qlen - 1);
+	}
+	return sq_budget(sq);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_pop_uri
+ *  Description:  Take the oldest URI pushed with sq_push_uri as a string ready for
+ *                uri_parse,  url must be freed by the caller.  Returns as sq_pop.
+ * =====================================================================================
+ */
+extern int
+sq_pop_uri( segq_t *sq, sq_queue_t *q, char **url)
+{
+	const char *rec,
+	           *auth;
+	size_t      len,
+	            alen,
+	            n = 0;
+	int         err;
+	if( (err = sq_pop(sq, q, &rec, &len)) ) {
+		return err;
+	}
+	if( ! len ) {
+		return EIO;
+	}
+	auth = q->sq_key;
+	alen = strlen(auth);
+	if( rec[0] & SQ_AUTH ) {
+		if( ! (n = sq_varint_get(rec + 1, rec + len, &alen)) || alen > len - 1 - n ) {
+			return EIO;
+		}
+		auth = rec + 1 + n;
+	}
+	n   += 1 + ((rec[0] & SQ_AUTH) ? alen : 0);
+	*url = (char *) malloc(sizeof("https://") + alen + len - n);
+	if( ! *url ) {
+		return ENOMEM;
+	}
+	sprintf(*url, "%s://%.*s%.*s", (rec[0] & SQ_HTTPS) ? "https" : "http",
+			(int) alen, auth, (int) (len - n), rec + n);
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_queue_free
+ *  Description:  Drop the queue and any records left in it.
+ * =====================================================================================
+ */
+extern void
+sq_queue_free( segq_t *sq, sq_queue_t *q)
+{
+	sq_page_t *page,
+	          *n;
+	sq_head_free(sq, q);
+	list_for_each_entry_safe(page, n, &q->sq_pages, sp_list){
+		list_del(&page->sp_list);
+		sq_release(sq, page->sp_seg);
+		free(page);
+	}
+	if( q->sq_tail ) {
+		sq->sq_mem -= q->sq_tsize;
+		free(q->sq_tail);
+	}
+	list_del_init(&q->sq_lru);
+	free(q->sq_key);
+	bzero(q, sizeof(sq_queue_t));
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_destroy
+ *  Description:  Close and remove the segment files,  every queue must have been freed.
+ * =====================================================================================
+ */
+extern void
+sq_destroy( segq_t *sq)
+{
+	char path[PATH_MAX];
+	int  i = 0;
+	for(; i < sq->sq_nsegs; i ++){
+		close(sq->sq_segs[i]->ss_fd);
+		snprintf(path, sizeof(path), "%s/seg.%d", sq->sq_dir, i);
+		unlink(path);
+		free(sq->sq_segs[i]);
+	}
+	free(sq->sq_segs);
+	free(sq->sq_dir);
+	bzero(sq, sizeof(segq_t));
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_reserve
+ *  Description:  Make room for a record of len bytes at the end of the tail and write
+ *                its length,  returns where the record goes.  A tail that cannot take
+ *                it is spilled first and its buffer kept,  the queue is pushed to
+ *                often.  Returns NULL with errno set on failure.
+ * =====================================================================================
+ */
+static char *
+sq_reserve( segq_t *sq, sq_queue_t *q, size_t len)
+{
+	char  *p;
+	size_t need = len + SQ_VARINT_MAX,
+	       size = q->sq_tsize ? q->sq_tsize : SQ_TAIL_MIN;
+	int    err;
+	if( q->sq_tlen + need > SQ_PAGE_SIZE && (err = sq_spill(sq, q, true)) ) {
+		errno = err;
+		return NULL;
+	}
+	if( q->sq_tlen + need > q->sq_tsize ) {
+		while( size < q->sq_tlen + need ) {
+			size *= 2;
+		}
+		if( size > SQ_PAGE_SIZE ) {
+			size = SQ_PAGE_SIZE;
+		}
+		if( ! (p = (char *) realloc(q->sq_tail, size)) ) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		sq->sq_mem   += size - q->sq_tsize;
+		q->sq_tail    = p;
+		q->sq_tsize   = size;
+	}
+	list_move_tail(&q->sq_lru, &sq->sq_tails);
+	p = q->sq_tail + q->sq_tlen;
+	p += sq_varint_put(p, len);
+	q->sq_tlen = (p - q->sq_tail) + len;
+	q->sq_count ++;
+	return p;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_budget
+ *  Description:  Spill the tails pushed to least recently until memory is within the
+ *                budget,  or there are no tails left.  Heads are not spilled,  a
+ *                queue's head is at most one page.
+ * =====================================================================================
+ */
+static int
+sq_budget( segq_t *sq)
+{
+	int err;
+	while( sq->sq_mem > sq->sq_budget && ! list_empty(&sq->sq_tails) ) {
+		if( (err = sq_spill(sq, list_entry(sq->sq_tails.next, sq_queue_t, sq_lru), false)) ) {
+			return err;
+		}
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_spill
+ *  Description:  Append the queue's tail to the current segment as a page.  Unless
+ *                keep is true the tail's buffer is freed.  Returns 0,  ENOMEM or a
+ *                errno value from writing the segment.
+ * =====================================================================================
+ */
+static int
+sq_spill( segq_t *sq, sq_queue_t *q, bool keep)
+{
+	sq_page_t *page;
+	sq_seg_t  *seg;
+	ssize_t    n;
+	size_t     done = 0;
+	if( ! q->sq_tlen ) {
+		return 0;
+	}
+	if( ! (page = (sq_page_t *) malloc(sizeof(sq_page_t))) ) {
+		return ENOMEM;
+	}
+	if( ! (seg = sq_segment(sq, q->sq_tlen)) ) {
+		free(page);
+		return errno;
+	}
+	while( done < q->sq_tlen ) {
+		n = pwrite(seg->ss_fd, q->sq_tail + done, q->sq_tlen - done, seg->ss_size + done);
+		if( n == -1 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			free(page);
+			return errno;
+		}
+		done += n;
+	}
+	page->sp_seg  = seg;
+	page->sp_off  = seg->ss_size;
+	page->sp_len  = q->sq_tlen;
+	list_add_tail(&page->sp_list, &q->sq_pages);
+	seg->ss_size += q->sq_tlen;
+	seg->ss_live ++;
+	sq->sq_spills ++;
+	q->sq_tlen = 0;
+	list_del_init(&q->sq_lru);
+	if( ! keep ) {
+		sq->sq_mem -= q->sq_tsize;
+		free(q->sq_tail);
+		q->sq_tail  = NULL;
+		q->sq_tsize = 0;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_segment
+ *  Description:  The segment to append len bytes to,  moving to a empty segment if
+ *                the current one is full.  A empty segment is reused if there is one,
+ *                otherwise a new file is created.  Returns NULL with errno set on
+ *                failure.
+ * =====================================================================================
+ */
+static sq_seg_t *
+sq_segment( segq_t *sq, size_t len)
+{
+	sq_seg_t  *seg = sq->sq_cur,
+	         **segs;
+	char       path[PATH_MAX];
+	if( seg && (! seg->ss_size || seg->ss_size + (off_t) len <= sq->sq_seg_size) ) {
+		return seg;
+	}
+	if( ! list_empty(&sq->sq_free) ) {
+		seg = list_entry(sq->sq_free.next, sq_seg_t, ss_free);
+		list_del_init(&seg->ss_free);
+		return sq->sq_cur = seg;
+	}
+	segs = (sq_seg_t **) realloc(sq->sq_segs, (sq->sq_nsegs + 1) * sizeof(sq_seg_t *));
+	if( ! segs ) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	sq->sq_segs = segs;
+	if( ! (seg = (sq_seg_t *) malloc(sizeof(sq_seg_t))) ) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	bzero(seg, sizeof(sq_seg_t));
+	seg->ss_id = sq->sq_nsegs;
+	snprintf(path, sizeof(path), "%s/seg.%d", sq->sq_dir, seg->ss_id);
+	if( (seg->ss_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1 ) {
+		free(seg);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&seg->ss_free);
+	sq->sq_segs[sq->sq_nsegs ++] = seg;
+	return sq->sq_cur = seg;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_release
+ *  Description:  A page of the segment has been read.  Once every page has been the
+ *                segment is truncated,  and unless it is still being appended to put
+ *                on the free list.
+ * =====================================================================================
+ */
+static void
+sq_release( segq_t *sq, sq_seg_t *seg)
+{
+	if( -- seg->ss_live ) {
+		return;
+	}
+	if( ftruncate(seg->ss_fd, 0) == -1 ) {
+		ERROR("truncating segment");
+	}
+	seg->ss_size = 0;
+	if( seg != sq->sq_cur ) {
+		list_add_tail(&seg->ss_free, &sq->sq_free);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_map
+ *  Description:  Map the queue's oldest page in as its head.  The whole page is asked
+ *                for at once so it is read in one go.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+static int
+sq_map( segq_t *sq, sq_queue_t *q)
+{
+	sq_page_t *page  = list_entry(q->sq_pages.next, sq_page_t, sp_list);
+	off_t      delta = page->sp_off % sysconf(_SC_PAGESIZE);
+	void      *map   = mmap(NULL, page->sp_len + delta, PROT_READ, MAP_PRIVATE,
+	                        page->sp_seg->ss_fd, page->sp_off - delta);
+	if( map == MAP_FAILED ) {
+		return errno;
+	}
+	madvise(map, page->sp_len + delta, MADV_WILLNEED);
+	list_del(&page->sp_list);
+	q->sq_hmap    = map;
+	q->sq_hsize   = page->sp_len + delta;
+	q->sq_hpage   = page;
+	q->sq_head    = (char *) map + delta;
+	q->sq_hlen    = page->sp_len;
+	q->sq_hpos    = 0;
+	sq->sq_mem   += q->sq_hsize;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_head_free
+ *  Description:  Release the queue's head,  unmapping it and releasing its page if
+ *                it was mapped.
+ * =====================================================================================
+ */
+static void
+sq_head_free( segq_t *sq, sq_queue_t *q)
+{
+	if( q->sq_hmap ) {
+		munmap(q->sq_hmap, q->sq_hsize);
+		sq_release(sq, q->sq_hpage->sp_seg);
+		free(q->sq_hpage);
+	}
+	else {
+		free(q->sq_head);
+	}
+	sq->sq_mem -= q->sq_hsize;
+	q->sq_head  = NULL;
+	q->sq_hmap  = NULL;
+	q->sq_hpage = NULL;
+	q->sq_hlen  = q->sq_hpos = q->sq_hsize = 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_varint_put
+ *  Description:  Write v seven bits a byte,  low bits first,  returns the bytes used.
+ * =====================================================================================
+ */
+static size_t
+sq_varint_put( char *p, size_t v)
+{
+	size_t n = 0;
+	for(; v >= 0x80; v >>= 7){
+		p[n ++] = (char) (v | 0x80);
+	}
+	p[n ++] = (char) v;
+	return n;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  sq_varint_get
+ *  Description:  Read a varint of at most SQ_VARINT_MAX bytes before end,  returns the
+ *                bytes used or 0 if it is not complete.
+ * =====================================================================================
+ */
+static size_t
+sq_varint_get( const char *p, const char *end, size_t *v)
+{
+	size_t n = 0;
+	*v = 0;
+	for(; p + n < end && n < SQ_VARINT_MAX; n ++){
+		*v |= (size_t) (p[n] & 0x7F) << (7 * n);
+		if( ! (p[n] & 0x80) ) {
+			return n + 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  twheel.c
+ *
+ *    Description:  Hierarchical timer wheel,  after the one in the Linux kernel.  The
+ *                  first level holds timers expiring within TW_SIZE ticks one slot per
+ *                  tick,  each further level covers TW_SIZE times the range of the
+ *                  one below.  When the first level wraps the next slot of the level
+ *                  above is cascaded down,  so a timer is touched at most once per
+ *                  level on its way to expiring.
+ *
+ *        Version:  1.0
+ *        Created:  21/10/2026 19:05:51
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/twheel.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define TW_INDEX(tw, n) (((tw)->tw_now >> ((n) * TW_BITS)) & TW_MASK)
+#define TW_RANGE        ((uint64_t) 1 << (TW_LEVELS * TW_BITS))
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static void tw_insert( twheel_t *tw, tw_timer_t *timer);
+static int  tw_cascade( twheel_t *tw, int level, int index);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_init
+ *  Description:  Initilize a empty wheel whose current tick is now.
+ * =====================================================================================
+ */
+extern void
+tw_init( twheel_t *tw, uint64_t now)
+{
+	int l = 0,
+	    s;
+	tw->tw_now   = now;
+	tw->tw_count = 0;
+	for(; l < TW_LEVELS; l ++){
+		for(s = 0; s < TW_SIZE; s ++){
+			INIT_LIST_HEAD(&tw->tw_slots[l][s]);
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_timer_init
+ *  Description:  Initilize a timer that is not pending.
+ * =====================================================================================
+ */
+extern void
+tw_timer_init( tw_timer_t *timer)
+{
+	timer->tt_expires = 0;
+	INIT_LIST_HEAD(&timer->tt_list);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_add
+ *  Description:  Start the timer so that it expires on tick expires.  A timer already
+ *                pending is moved.  Ticks in the past expire on the next advance,
+ *                ticks beyond the range of the wheel are held in its last slot and
+ *                placed again when that slot cascades.
+ * =====================================================================================
+ */
+extern void
+tw_add( twheel_t *tw, tw_timer_t *timer, uint64_t expires)
+{
+	if( tw_pending(timer) ) {
+		tw_del(tw, timer);
+	}
+	timer->tt_expires = expires;
+	tw_insert(tw, timer);
+	tw->tw_count ++;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_del
+ *  Description:  Stop a pending timer.
+ * =====================================================================================
+ */
+extern void
+tw_del( twheel_t *tw, tw_timer_t *timer)
+{
+	if( tw_pending(timer) ) {
+		list_del_init(&timer->tt_list);
+		tw->tw_count --;
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_pending
+ *  Description:  Is the timer in the wheel.
+ * =====================================================================================
+ */
+extern bool
+tw_pending( tw_timer_t *timer)
+{
+	return ! list_empty(&timer->tt_list);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_advance
+ *  Description:  Process every tick up to and including now,  moving the timers that
+ *                expire onto the tail of expired.  The tt_list of each expired timer
+ *                links it into expired,  it is pending again only once re-added.
+ *                Returns the number of timers expired.
+ * =====================================================================================
+ */
+extern int
+tw_advance( twheel_t *tw, uint64_t now, struct list_head *expired)
+{
+	struct list_head *pos;
+	int               index,
+	                  level,
+	                  m,
+	                  n = 0;
+	while( tw->tw_now <= now ) {
+		if( ! tw->tw_count ) {
+			/* nothing to expire,  jump straight to the end */
+			tw->tw_now = now + 1;
+			break;
+		}
+		index = TW_INDEX(tw, 0);
+		for(level = 1; ! index && level < TW_LEVELS; level ++){
+			index = tw_cascade(tw, level, TW_INDEX(tw, level));
+		}
+		index = TW_INDEX(tw, 0);
+		m = 0;
+		list_for_each(pos, &tw->tw_slots[0][index]){
+			m ++;
+		}
+		tw->tw_count -= m;
+		n += m;
+		list_splice_init(&tw->tw_slots[0][index], expired->prev);
+		tw->tw_now ++;
+	}
+	return n;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_insert
+ *  Description:  Place the timer in the slot for its expiry relative to tw_now.
+ * =====================================================================================
+ */
+static void
+tw_insert( twheel_t *tw, tw_timer_t *timer)
+{
+	uint64_t expires = timer->tt_expires,
+	         delta;
+	int      level = 0;
+	if( expires < tw->tw_now ) {
+		expires = tw->tw_now;
+	}
+	delta = expires - tw->tw_now;
+	if( delta >= TW_RANGE ) {
+		expires = tw->tw_now + TW_RANGE - 1;
+		delta   = TW_RANGE - 1;
+	}
+	while( level < TW_LEVELS - 1 && delta >= ((uint64_t) 1 << ((level + 1) * TW_BITS)) ) {
+		level ++;
+	}
+	list_add_tail(&timer->tt_list,
+			&tw->tw_slots[level][(expires >> (level * TW_BITS)) & TW_MASK]);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  tw_cascade
+ *  Description:  Re-insert the timers of one slot of a upper level,  they now fall in
+ *                the levels below.  Returns index so the caller knows whether the
+ *                level above has wrapped too.
+ * =====================================================================================
+ */
+static int
+tw_cascade( twheel_t *tw, int level, int index)
+{
+	tw_timer_t      *timer,
+	                *n;
+	struct list_head slot;
+	INIT_LIST_HEAD(&slot);
+	list_splice_init(&tw->tw_slots[level][index], &slot);
+	list_for_each_entry_safe(timer, n, &slot, tt_list){
+		list_del_init(&timer->tt_list);
+		tw_insert(tw, timer);
+	}
+	return index;
+}
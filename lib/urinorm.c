@@ -18,6 +18,7 @@
 
 /* #####   HEADER FILE INCLUDES   ################################################### */
 #include <azzmos/urinorm.h>
+#include <azzmos/hostid.h>
 
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
 #define RE_ID 0
@@ -243,6 +244,7 @@ uri_parse( uriobj_t *uri, regexpr_t *re, const char *fqp)
 		*(uri->uri_query)  = usplice(fqp, re->re_ovector[RE_Q_S], re->re_ovector[RE_Q_E] -1);
 		*(uri->uri_frag)   = usplice(fqp, re->re_ovector[RE_F_S], re->re_ovector[RE_F_E] -1);
 		uri->uri_id = uri->uri_flags = 0;
+		uri->uri_mdate = 0;
 		*(uri->uri_host) = *(uri->uri_port)
 			         = *(uri->uri_ip)
 			         = NULL;
@@ -813,7 +815,8 @@ uri_auth_sync( uriobj_t *uri)
 /* 
  * ===  FUNCTION  ======================================================================
  *         Name:  uri_normalize
- *  Description:  Normalize all section of the URI.
+ *  Description:  Normalize all section of the URI and intern its host,  see hi_uri.
+ *                A URI without a host is left with uri_hostid HI_NONE.
  * =====================================================================================
  */
 extern int        
@@ -840,6 +843,15 @@ uri_normalize( uriobj_t *uri)
 	if( ! err ){
 		err = uri_norm_path(uri);
 	}
+	/* per host state is keyed on the interned id rather than the name,  a URI with
+	   no host such as mailto: or file:/// keeps HI_NONE */
+	if( ! err ){
+		uri->uri_hostid = 0;
+		if( ! hi_uri(uri) && (*(uri->uri_host)
+		                      || (uri->uri_flags & URI_IP && *(uri->uri_ip))) ) {
+			err = ENOMEM;
+		}
+	}
 	return err;
 }
 
@@ -173,6 +173,72 @@ init_uriobj_str( uriobj_t *uri)
 	uri->uri_port   = (char **) malloc(sizeof(char *));
 	uri->uri_ip     = (char **) malloc(sizeof(char *));
 	uri->uri_addr   = (struct addrinfo **) malloc(sizeof(struct addrinfo *));
+	uri->uri_etag   = (char **) malloc(sizeof(char *));
+	*(uri->uri_scheme) = *(uri->uri_auth)
+	                   = *(uri->uri_path)
+	                   = *(uri->uri_query)
+	                   = *(uri->uri_frag)
+	                   = *(uri->uri_host)
+	                   = *(uri->uri_port)
+	                   = *(uri->uri_ip)
+	                   = *(uri->uri_etag)
+	                   = NULL;
+	*(uri->uri_addr) = NULL;
+	uri->uri_hostid  = 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  free_uriobj
+ *  Description:  Release a uri object allocated with malloc,  its strings,  resolved
+ *                addresses and the object itself.
+ * =====================================================================================
+ */
+extern void
+free_uriobj( uriobj_t *uri)
+{
+	char **s[] = { uri->uri_scheme, uri->uri_auth, uri->uri_path, uri->uri_query,
+	               uri->uri_frag, uri->uri_host, uri->uri_port, uri->uri_ip,
+	               uri->uri_etag };
+	int    i = 0;
+	for(; i < (int) (sizeof(s) / sizeof(s[0])); i ++){
+		if( s[i] ) {
+			free(*s[i]);
+			free(s[i]);
+		}
+	}
+	if( uri->uri_addr ) {
+		if( *uri->uri_addr ) {
+			freeaddrinfo(*uri->uri_addr);
+		}
+		free(uri->uri_addr);
+	}
+	free(uri);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  uri_url_str
+ *  Description:  Write a normalized URI as "scheme://authority/path?query" to buf,
+ *                '\0' terminated,  and return its length.  With buf NULL only the
+ *                length is returned.  An empty path is written as "/".  This is the
+ *                string URIs are fingerprinted and stored as,  so every place that
+ *                needs it must build it here.
+ * =====================================================================================
+ */
+extern size_t
+uri_url_str( uriobj_t *uri, char *buf)
+{
+	const char *scheme = (uri->uri_scheme && *uri->uri_scheme) ? *uri->uri_scheme : "",
+	           *auth   = (uri->uri_auth && *uri->uri_auth) ? *uri->uri_auth : "",
+	           *path   = (uri->uri_path && *uri->uri_path && **uri->uri_path)
+	                   ? *uri->uri_path : "/",
+	           *query  = uri->uri_query ? *uri->uri_query : NULL;
+	if( buf ) {
+		return sprintf(buf, "%s://%s%s%s%s", scheme, auth, path, query ? "?" : "",
+				query ? query : "");
+	}
+	return strlen(scheme) + 3 + strlen(auth) + strlen(path) + (query ? strlen(query) + 1 : 0);
 }
 
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
@@ -0,0 +1,1299 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  urlrun.c
+ *
+ *    Description:  Runs of sorted,  front coded and compressed URLs and the store that
+ *                  keeps them.  Each URL in a block is written as the number of bytes
+ *                  it shares with the one before,  the number it does not and those
+ *                  bytes,  the first of a block sharing none so a block can be read on
+ *                  its own.  A lookup walks the entries of one block keeping how much
+ *                  of the URL sought the last entry matched,  which with the entries
+ *                  sorted decides most of them from the shared count alone.  Each
+ *                  run ends with a bloom filter of its URLs,  so most lookups of a URL
+ *                  that is not in it inflate nothing.
+ *
+ *                  The store's memtable is a hash table of the URLs inserted since the
+ *                  last flush.  A flush sorts it and writes it as the newest run,  the
+ *                  first pass of a external merge sort,  then while the run after the
+ *                  newest is no more than UR_RATIO times its size the two are merged,
+ *                  so every URL is rewritten a logarithmic number of times and a store
+ *                  of N URLs has about log N / log UR_RATIO runs.  The merge is written
+ *                  without the store's lock,  which is only taken again to swap the
+ *                  merged run for the two it replaces.  Runs are written to a temporary
+ *                  file and renamed,  a crash leaves at worst a run that is also in a
+ *                  newer one,  which is harmless in a set.
+ *
+ *        Version:  1.0
+ *        Created:  31/10/2026 18:47:03
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/urlrun.h>
+#include <azzmos/utils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define UR_VARINT_MAX  10        /* bytes in the varint of a 64 bit value */
+#define UR_ENTRY_HEAD  20        /* fixed bytes of a index entry */
+#define UR_SLOTS_MIN   1024      /* starting size of the memtable hash */
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct ur_key_s {
+	const char      *uk_url;
+	size_t           uk_len;
+} typedef ur_key_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static int         ur_flush_block( ur_writer_t *uw);
+static void        ur_write_free( ur_writer_t *uw);
+static bool        ur_reserve( char **buf, size_t *size, size_t need);
+static int         ur_inflate( ur_run_t *run, uint64_t block, char *raw);
+static int         ur_scan( const char *raw, size_t rlen, const char *url, size_t len);
+static int         ur_cmp( const char *a, size_t alen, const char *b, size_t blen);
+static void        ur_bloom_add( uint64_t *bloom, uint64_t bits, uint64_t h);
+static bool        ur_bloom_test( const uint64_t *bloom, uint64_t bits, uint64_t h);
+static int         ur_key_cmp( const void *a, const void *b);
+static void        ur_heap_down( ur_iter_t *its, int *heap, int n, int i);
+static int         ur_compact( ur_store_t *us);
+static int         ur_flush_mem( ur_store_t *us);
+static char       *ur_run_path( ur_store_t *us, uint64_t seq);
+static size_t     *ur_mem_find( ur_store_t *us, const char *url, size_t len);
+static int         ur_mem_add( ur_store_t *us, const char *url, size_t len);
+static const char *ur_mem_url( ur_store_t *us, size_t slot, size_t *len);
+static size_t      ur_varint_put( char *p, uint64_t v);
+static size_t      ur_varint_get( const char *p, const char *end, uint64_t *v);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_write_open
+ *  Description:  Start writing a run to path.  It is written to path.tmp until
+ *                ur_write_close.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_write_open( ur_writer_t *uw, const char *path)
+{
+	int err;
+	bzero(uw, sizeof(ur_writer_t));
+	uw->uw_fd = -1;
+	if( ! (uw->uw_path = strdup(path)) || ! (uw->uw_tmp = (char *) malloc(strlen(path) + 5)) ) {
+		ur_write_free(uw);
+		return ENOMEM;
+	}
+	sprintf(uw->uw_tmp, "%s.tmp", path);
+	if( (uw->uw_fd = open(uw->uw_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1 ) {
+		err = errno;
+		ur_write_free(uw);
+		return err;
+	}
+	if( (err = write_all(uw->uw_fd, UR_MAGIC, 8)) ) {
+		ur_write_abort(uw);
+		return err;
+	}
+	uw->uw_offset = 8;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_write_add
+ *  Description:  Append a URL,  which must sort after the last one.  A URL equal to
+ *                the last is dropped.  Returns 0,  EINVAL if the URL is out of order
+ *                or a errno value,  after which the writer should be aborted.
+ * =====================================================================================
+ */
+extern int
+ur_write_add( ur_writer_t *uw, const char *url, size_t len)
+{
+	size_t shared = 0;
+	int    c,
+	       err;
+	if( uw->uw_count ) {
+		if( (c = ur_cmp(url, len, uw->uw_last, uw->uw_lastlen)) == 0 ) {
+			return 0;
+		}
+		if( c < 0 ) {
+			return EINVAL;
+		}
+	}
+	if( uw->uw_rlen >= UR_BLOCK && (err = ur_flush_block(uw)) ) {
+		return err;
+	}
+	/* the first entry of a block shares nothing so the block stands alone */
+	if( uw->uw_rlen ) {
+		for(; shared < len && shared < uw->uw_lastlen && url[shared] == uw->uw_last[shared];
+				shared ++);
+	}
+	if( ! ur_reserve(&uw->uw_raw, &uw->uw_rsize, uw->uw_rlen + 2 * UR_VARINT_MAX + len)
+			|| ! ur_reserve(&uw->uw_last, &uw->uw_lastsize, len + 1)
+			|| ! ur_reserve((char **) &uw->uw_hash, &uw->uw_hsize,
+				(uw->uw_count + 1) * sizeof(uint64_t)) ) {
+		return ENOMEM;
+	}
+	uw->uw_hash[uw->uw_count] = mem_hash64(url, len);
+	uw->uw_rlen += ur_varint_put(uw->uw_raw + uw->uw_rlen, shared);
+	uw->uw_rlen += ur_varint_put(uw->uw_raw + uw->uw_rlen, len - shared);
+	memcpy(uw->uw_raw + uw->uw_rlen, url + shared, len - shared);
+	uw->uw_rlen += len - shared;
+	memcpy(uw->uw_last, url, len);
+	uw->uw_lastlen = len;
+	uw->uw_count ++;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_write_close
+ *  Description:  Write the last block,  the index,  the bloom filter and the footer and
+ *                move the run into place.  The writer is released either way.  Returns
+ *                0 or a errno value,  in which case nothing is left at the path.
+ * =====================================================================================
+ */
+extern int
+ur_write_close( ur_writer_t *uw)
+{
+	ur_footer_t uf;
+	uint64_t   *bloom = NULL,
+	            pad   = 0,
+	            i     = 0;
+	int         err   = ur_flush_block(uw);
+	bzero(&uf, sizeof(ur_footer_t));
+	uf.uf_index  = uw->uw_offset;
+	uf.uf_blocks = uw->uw_blocks;
+	uf.uf_count  = uw->uw_count;
+	uf.uf_rmax   = uw->uw_rmax;
+	uf.uf_bloom  = (uf.uf_index + uw->uw_ilen + 7) & ~7ULL;
+	uf.uf_bwords = (uw->uw_count * UR_BLOOM_BITS + 63) / 64 + 1;
+	memcpy(uf.uf_magic, UR_MAGIC, sizeof(uf.uf_magic));
+	if( ! err && ! (bloom = (uint64_t *) calloc(uf.uf_bwords, sizeof(uint64_t))) ) {
+		err = ENOMEM;
+	}
+	for(; ! err && i < uw->uw_count; i ++){
+		ur_bloom_add(bloom, uf.uf_bwords * 64, uw->uw_hash[i]);
+	}
+	if( ! err ) {
+		err = write_all(uw->uw_fd, uw->uw_index, uw->uw_ilen);
+	}
+	if( ! err ) {
+		err = write_all(uw->uw_fd, &pad, uf.uf_bloom - uf.uf_index - uw->uw_ilen);
+	}
+	if( ! err ) {
+		err = write_all(uw->uw_fd, bloom, uf.uf_bwords * sizeof(uint64_t));
+	}
+	free(bloom);
+	if( ! err ) {
+		err = write_all(uw->uw_fd, &uf, sizeof(ur_footer_t));
+	}
+	if( ! err && fsync(uw->uw_fd) == -1 ) {
+		err = errno;
+	}
+	if( close(uw->uw_fd) == -1 && ! err ) {
+		err = errno;
+	}
+	uw->uw_fd = -1;
+	if( ! err && rename(uw->uw_tmp, uw->uw_path) == -1 ) {
+		err = errno;
+	}
+	if( err ) {
+		unlink(uw->uw_tmp);
+	}
+	ur_write_free(uw);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_write_abort
+ *  Description:  Give up on a run,  removing what was written and releasing the writer.
+ * =====================================================================================
+ */
+extern void
+ur_write_abort( ur_writer_t *uw)
+{
+	if( uw->uw_fd != -1 ) {
+		close(uw->uw_fd);
+		uw->uw_fd = -1;
+		unlink(uw->uw_tmp);
+	}
+	ur_write_free(uw);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_open
+ *  Description:  Map a run and read its index into memory.  Returns 0,  EINVAL if the
+ *                file is not a whole run or a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_open( ur_run_t *run, const char *path)
+{
+	struct stat  st;
+	ur_footer_t  uf;
+	const char  *p,
+	            *end;
+	char        *keys;
+	uint64_t     i   = 0;
+	uint32_t     clen,
+	             rlen,
+	             klen;
+	int          fd,
+	             err = 0;
+	bzero(run, sizeof(ur_run_t));
+	run->ur_cached = -1;
+	if( (fd = open(path, O_RDONLY)) == -1 ) {
+		return errno;
+	}
+	if( fstat(fd, &st) == -1 ) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	if( (size_t) st.st_size < 8 + sizeof(ur_footer_t) ) {
+		close(fd);
+		return EINVAL;
+	}
+	run->ur_maplen = st.st_size;
+	run->ur_map    = mmap(NULL, run->ur_maplen, PROT_READ, MAP_SHARED, fd, 0);
+	err = (run->ur_map == MAP_FAILED) ? errno : 0;
+	close(fd);
+	if( err ) {
+		run->ur_map = NULL;
+		return err;
+	}
+	end = (char *) run->ur_map + run->ur_maplen - sizeof(ur_footer_t);
+	memcpy(&uf, end, sizeof(ur_footer_t));
+	if( memcmp(run->ur_map, UR_MAGIC, 8) || memcmp(uf.uf_magic, UR_MAGIC, 8)
+			|| uf.uf_index < 8 || uf.uf_index > (uint64_t) (end - (char *) run->ur_map)
+			|| uf.uf_blocks > (uint64_t) (end - (char *) run->ur_map) / UR_ENTRY_HEAD
+			|| uf.uf_bloom % 8 || uf.uf_bloom < uf.uf_index || ! uf.uf_bwords
+			|| uf.uf_bloom > (uint64_t) (end - (char *) run->ur_map)
+			|| uf.uf_bwords > ((uint64_t) (end - (char *) run->ur_map) - uf.uf_bloom) / 8 ) {
+		ur_close(run);
+		return EINVAL;
+	}
+	run->ur_count  = uf.uf_count;
+	run->ur_blocks = uf.uf_blocks;
+	run->ur_rmax   = uf.uf_rmax;
+	run->ur_bloom  = (const uint64_t *) ((char *) run->ur_map + uf.uf_bloom);
+	run->ur_bbits  = uf.uf_bwords * 64;
+	p = (char *) run->ur_map + uf.uf_index;
+	run->ur_index = (ur_index_t *) calloc(uf.uf_blocks + 1, sizeof(ur_index_t));
+	run->ur_keys  = keys = (char *) malloc(end - p + 1);
+	run->ur_buf   = (char *) malloc(uf.uf_rmax + 1);
+	if( ! run->ur_index || ! keys || ! run->ur_buf ) {
+		ur_close(run);
+		return ENOMEM;
+	}
+	for(; ! err && i < uf.uf_blocks; i ++){
+		if( end - p < UR_ENTRY_HEAD ) {
+			err = EINVAL;
+			break;
+		}
+		memcpy(&run->ur_index[i].ui_offset, p, 8);
+		memcpy(&clen, p + 8, 4);
+		memcpy(&rlen, p + 12, 4);
+		memcpy(&klen, p + 16, 4);
+		p += UR_ENTRY_HEAD;
+		if( (uint64_t) (end - p) < klen || rlen > uf.uf_rmax
+				|| run->ur_index[i].ui_offset < 8
+				|| run->ur_index[i].ui_offset + clen > uf.uf_index ) {
+			err = EINVAL;
+			break;
+		}
+		memcpy(keys, p, klen);
+		run->ur_index[i].ui_clen = clen;
+		run->ur_index[i].ui_rlen = rlen;
+		run->ur_index[i].ui_key  = keys;
+		run->ur_index[i].ui_klen = klen;
+		keys += klen;
+		p    += klen;
+	}
+	if( ! err && (err = pthread_mutex_init(&run->ur_lock, NULL)) == 0 ) {
+		if( ! (run->ur_path = strdup(path)) ) {
+			pthread_mutex_destroy(&run->ur_lock);
+			err = ENOMEM;
+		}
+	}
+	if( err ) {
+		ur_close(run);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_contains
+ *  Description:  Is the URL in the run.  The bloom filter turns away most URLs that
+ *                are not,  otherwise the index picks the one block it could be in,
+ *                the last inflated block is kept so lookups of nearby URLs,  such as
+ *                those of a page being checked in sorted order,  skip the inflate.
+ *                Returns 0 if it is,  ENOENT if it is not or EIO if the block does
+ *                not inflate.
+ * =====================================================================================
+ */
+extern int
+ur_contains( ur_run_t *run, const char *url, size_t len)
+{
+	uint64_t lo = 0,
+	         hi = run->ur_blocks,
+	         mid;
+	int      err = 0;
+	if( ! ur_bloom_test(run->ur_bloom, run->ur_bbits, mem_hash64(url, len)) ) {
+		return ENOENT;
+	}
+	while( lo < hi ) {
+		mid = (lo + hi) / 2;
+		if( ur_cmp(run->ur_index[mid].ui_key, run->ur_index[mid].ui_klen, url, len) <= 0 ) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	if( ! lo ) {
+		return ENOENT;
+	}
+	pthread_mutex_lock(&run->ur_lock);
+	if( run->ur_cached != (int64_t) lo - 1 ) {
+		run->ur_cached = -1;
+		if( ! (err = ur_inflate(run, lo - 1, run->ur_buf)) ) {
+			run->ur_cached = lo - 1;
+		}
+	}
+	if( ! err ) {
+		err = ur_scan(run->ur_buf, run->ur_index[lo - 1].ui_rlen, url, len);
+	}
+	pthread_mutex_unlock(&run->ur_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_close
+ *  Description:  Unmap a run and release its index.
+ * =====================================================================================
+ */
+extern void
+ur_close( ur_run_t *run)
+{
+	if( run->ur_path ) {
+		pthread_mutex_destroy(&run->ur_lock);
+	}
+	if( run->ur_map ) {
+		munmap(run->ur_map, run->ur_maplen);
+	}
+	free(run->ur_index);
+	free(run->ur_keys);
+	free(run->ur_buf);
+	free(run->ur_path);
+	bzero(run, sizeof(ur_run_t));
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_iter_init
+ *  Description:  Start a walk over a run's URLs in order.  A iterator inflates into
+ *                its own buffer so it does not disturb lookups.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+ur_iter_init( ur_iter_t *it, ur_run_t *run)
+{
+	bzero(it, sizeof(ur_iter_t));
+	it->it_run = run;
+	if( ! (it->it_raw = (char *) malloc(run->ur_rmax + 1)) ) {
+		return ENOMEM;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_iter_next
+ *  Description:  The next URL of the run,  valid until the next call.  Returns 0,
+ *                ENOENT at the end,  EIO if a block is damaged or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+ur_iter_next( ur_iter_t *it, const char **url, size_t *len)
+{
+	const char *p,
+	           *end;
+	uint64_t    shared,
+	            rest;
+	size_t      n;
+	int         err;
+	while( it->it_pos >= it->it_rlen ) {
+		if( it->it_block == it->it_run->ur_blocks ) {
+			return ENOENT;
+		}
+		if( (err = ur_inflate(it->it_run, it->it_block, it->it_raw)) ) {
+			return err;
+		}
+		it->it_rlen = it->it_run->ur_index[it->it_block ++].ui_rlen;
+		it->it_pos  = 0;
+		it->it_klen = 0;
+	}
+	p   = it->it_raw + it->it_pos;
+	end = it->it_raw + it->it_rlen;
+	if( ! (n = ur_varint_get(p, end, &shared)) ) {
+		return EIO;
+	}
+	p += n;
+	if( ! (n = ur_varint_get(p, end, &rest)) || rest > (uint64_t) (end - p - n)
+			|| shared > it->it_klen ) {
+		return EIO;
+	}
+	p += n;
+	if( ! ur_reserve(&it->it_key, &it->it_ksize, shared + rest + 1) ) {
+		return ENOMEM;
+	}
+	memcpy(it->it_key + shared, p, rest);
+	it->it_klen = shared + rest;
+	it->it_key[it->it_klen] = '\0';
+	it->it_pos  = p + rest - it->it_raw;
+	*url = it->it_key;
+	*len = it->it_klen;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_iter_free
+ *  Description:  Release a iterator,  the run is left open.
+ * =====================================================================================
+ */
+extern void
+ur_iter_free( ur_iter_t *it)
+{
+	free(it->it_raw);
+	free(it->it_key);
+	bzero(it, sizeof(ur_iter_t));
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_merge
+ *  Description:  Merge n runs into a new run at path,  each URL once.  The runs are
+ *                read in order through a heap of their iterators so any number may be
+ *                merged in one pass.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_merge( ur_run_t **runs, int n, const char *path)
+{
+	ur_writer_t  uw;
+	const char  *url;
+	size_t       len;
+	ur_iter_t   *its  = (ur_iter_t *) calloc(n, sizeof(ur_iter_t));
+	int         *heap = (int *) malloc(n * sizeof(int));
+	int          err  = 0,
+	             live = 0,
+	             i    = 0;
+	bzero(&uw, sizeof(ur_writer_t));
+	if( ! its || ! heap ) {
+		free(its);
+		free(heap);
+		return ENOMEM;
+	}
+	for(; ! err && i < n; i ++){
+		if( (err = ur_iter_init(&its[i], runs[i])) ) {
+			break;
+		}
+		/* the heap orders on it_key,  the iterator's current URL */
+		if( ! (err = ur_iter_next(&its[i], &url, &len)) ) {
+			heap[live ++] = i;
+		}
+		else if( err == ENOENT ) {
+			err = 0;
+		}
+	}
+	for(i = live / 2 - 1; i >= 0; i --){
+		ur_heap_down(its, heap, live, i);
+	}
+	if( ! err ) {
+		err = ur_write_open(&uw, path);
+	}
+	while( ! err && live ) {
+		i = heap[0];
+		if( (err = ur_write_add(&uw, its[i].it_key, its[i].it_klen)) ) {
+			break;
+		}
+		if( (err = ur_iter_next(&its[i], &url, &len)) ) {
+			if( err != ENOENT ) {
+				break;
+			}
+			err     = 0;
+			heap[0] = heap[-- live];
+		}
+		ur_heap_down(its, heap, live, 0);
+	}
+	if( ! err ) {
+		err = ur_write_close(&uw);
+	}
+	else if( uw.uw_path ) {
+		ur_write_abort(&uw);
+	}
+	for(i = 0; i < n; i ++){
+		ur_iter_free(&its[i]);
+	}
+	free(its);
+	free(heap);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_store_open
+ *  Description:  Open the store in dir,  which must exist,  with the runs already in
+ *                it.  Partly written runs are removed.  A zero budget is UR_BUDGET.
+ *                Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_store_open( ur_store_t *us, const char *dir, size_t budget)
+{
+	DIR           *d;
+	struct dirent *de;
+	uint64_t       seqs[UR_RUNS_MAX],
+	               seq,
+	               t;
+	char          *path;
+	int            n   = 0,
+	               err = 0,
+	               i,
+	               j;
+	bzero(us, sizeof(ur_store_t));
+	us->us_budget = budget ? budget : UR_BUDGET;
+	us->us_nslots = UR_SLOTS_MIN;
+	if( ! (us->us_dir = strdup(dir))
+			|| ! (us->us_slots = (size_t *) calloc(us->us_nslots, sizeof(size_t))) ) {
+		free(us->us_dir);
+		return ENOMEM;
+	}
+	if( ! (d = opendir(dir)) ) {
+		err = errno;
+		free(us->us_slots);
+		free(us->us_dir);
+		return err;
+	}
+	while( ! err && (de = readdir(d)) ) {
+		if( strncmp(de->d_name, "run.", 4) || ! isdigit(de->d_name[4]) ) {
+			continue;
+		}
+		seq = strtoull(de->d_name + 4, &path, 10);
+		if( *path ) {
+			/* a run.N.tmp left by a crash while writing */
+			if( (path = ur_run_path(us, seq)) ) {
+				strcat(path, ".tmp");
+				unlink(path);
+				free(path);
+			}
+			continue;
+		}
+		if( n == UR_RUNS_MAX ) {
+			err = EMFILE;
+			break;
+		}
+		seqs[n ++] = seq;
+		if( seq >= us->us_seq ) {
+			us->us_seq = seq + 1;
+		}
+	}
+	closedir(d);
+	/* newest,  the highest N,  first */
+	for(i = 1; i < n; i ++){
+		for(t = seqs[i], j = i; j > 0 && seqs[j - 1] < t; j --){
+			seqs[j] = seqs[j - 1];
+		}
+		seqs[j] = t;
+	}
+	for(i = 0; ! err && i < n; i ++){
+		if( ! (path = ur_run_path(us, seqs[i]))
+				|| ! (us->us_runs[i] = (ur_run_t *) malloc(sizeof(ur_run_t))) ) {
+			free(path);
+			err = ENOMEM;
+			break;
+		}
+		if( (err = ur_open(us->us_runs[i], path)) ) {
+			free(us->us_runs[i]);
+		}
+		else {
+			us->us_nruns ++;
+		}
+		free(path);
+	}
+	if( ! err && ! (err = pthread_mutex_init(&us->us_lock, NULL))
+			&& (err = pthread_cond_init(&us->us_merged, NULL)) ) {
+		pthread_mutex_destroy(&us->us_lock);
+	}
+	if( err ) {
+		for(i = 0; i < us->us_nruns; i ++){
+			ur_close(us->us_runs[i]);
+			free(us->us_runs[i]);
+		}
+		free(us->us_slots);
+		free(us->us_dir);
+	}
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_store_insert
+ *  Description:  Add a URL unless the store already has it.  The memtable is flushed
+ *                once it holds the budget.  Returns 0 if the URL was added,  EEXIST
+ *                if it was there or a errno value.  A failed flush keeps the URLs in
+ *                the memtable,  the next insert or ur_store_flush tries again.
+ * =====================================================================================
+ */
+extern int
+ur_store_insert( ur_store_t *us, const char *url, size_t len)
+{
+	int err = EEXIST,
+	    rc  = ENOENT,
+	    i   = 0;
+	pthread_mutex_lock(&us->us_lock);
+	if( ! ur_mem_find(us, url, len) ) {
+		for(; i < us->us_nruns; i ++){
+			if( (rc = ur_contains(us->us_runs[i], url, len)) != ENOENT ) {
+				break;
+			}
+		}
+		if( i == us->us_nruns ) {
+			err = ur_mem_add(us, url, len);
+		}
+		else if( rc ) {
+			err = rc;
+		}
+	}
+	if( ! err && us->us_memlen >= us->us_budget ) {
+		err = ur_flush_mem(us);
+	}
+	pthread_mutex_unlock(&us->us_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_store_contains
+ *  Description:  Is the URL in the store.  Returns 0 if it is,  ENOENT if it is not or
+ *                a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_store_contains( ur_store_t *us, const char *url, size_t len)
+{
+	int err = 0,
+	    i   = 0;
+	pthread_mutex_lock(&us->us_lock);
+	if( ! ur_mem_find(us, url, len) ) {
+		for(err = ENOENT; err == ENOENT && i < us->us_nruns; i ++){
+			err = ur_contains(us->us_runs[i], url, len);
+		}
+	}
+	pthread_mutex_unlock(&us->us_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_store_flush
+ *  Description:  Write the memtable out as a run and merge runs as needed.  Returns 0
+ *                or a errno value.
+ * =====================================================================================
+ */
+extern int
+ur_store_flush( ur_store_t *us)
+{
+	int err;
+	pthread_mutex_lock(&us->us_lock);
+	err = ur_flush_mem(us);
+	pthread_mutex_unlock(&us->us_lock);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_store_close
+ *  Description:  Wait for a running compaction,  flush the memtable and release the
+ *                store.  Returns the result of the flush,  the store is released
+ *                either way.
+ * =====================================================================================
+ */
+extern int
+ur_store_close( ur_store_t *us)
+{
+	int err,
+	    i = 0;
+	pthread_mutex_lock(&us->us_lock);
+	while( us->us_compacting ) {
+		pthread_cond_wait(&us->us_merged, &us->us_lock);
+	}
+	err = ur_flush_mem(us);
+	pthread_mutex_unlock(&us->us_lock);
+	for(; i < us->us_nruns; i ++){
+		ur_close(us->us_runs[i]);
+		free(us->us_runs[i]);
+	}
+	free(us->us_mem);
+	free(us->us_slots);
+	free(us->us_dir);
+	pthread_cond_destroy(&us->us_merged);
+	pthread_mutex_destroy(&us->us_lock);
+	bzero(us, sizeof(ur_store_t));
+	return err;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_flush_block
+ *  Description:  Compress and write the block being built and add its index entry,
+ *                the first URL being the whole of the block's first entry.
+ * =====================================================================================
+ */
+static int
+ur_flush_block( ur_writer_t *uw)
+{
+	uLongf   zlen = compressBound(uw->uw_rlen);
+	uint64_t shared,
+	         klen;
+	uint32_t v;
+	size_t   n,
+	         m;
+	char    *e;
+	int      err;
+	if( ! uw->uw_rlen ) {
+		return 0;
+	}
+	if( ! ur_reserve(&uw->uw_zbuf, &uw->uw_zsize, zlen) ) {
+		return ENOMEM;
+	}
+	if( compress2((Bytef *) uw->uw_zbuf, &zlen, (Bytef *) uw->uw_raw, uw->uw_rlen,
+				Z_DEFAULT_COMPRESSION) != Z_OK ) {
+		return ENOMEM;
+	}
+	if( (err = write_all(uw->uw_fd, uw->uw_zbuf, zlen)) ) {
+		return err;
+	}
+	n = ur_varint_get(uw->uw_raw, uw->uw_raw + uw->uw_rlen, &shared);
+	m = ur_varint_get(uw->uw_raw + n, uw->uw_raw + uw->uw_rlen, &klen);
+	if( ! ur_reserve(&uw->uw_index, &uw->uw_isize, uw->uw_ilen + UR_ENTRY_HEAD + klen) ) {
+		return ENOMEM;
+	}
+	e = uw->uw_index + uw->uw_ilen;
+	memcpy(e, &uw->uw_offset, 8);
+	v = (uint32_t) zlen;
+	memcpy(e + 8, &v, 4);
+	v = (uint32_t) uw->uw_rlen;
+	memcpy(e + 12, &v, 4);
+	v = (uint32_t) klen;
+	memcpy(e + 16, &v, 4);
+	memcpy(e + UR_ENTRY_HEAD, uw->uw_raw + n + m, klen);
+	uw->uw_ilen   += UR_ENTRY_HEAD + klen;
+	uw->uw_offset += zlen;
+	if( uw->uw_rlen > uw->uw_rmax ) {
+		uw->uw_rmax = uw->uw_rlen;
+	}
+	uw->uw_blocks ++;
+	uw->uw_rlen = 0;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_write_free
+ *  Description:  Release a writer's buffers.
+ * =====================================================================================
+ */
+static void
+ur_write_free( ur_writer_t *uw)
+{
+	free(uw->uw_path);
+	free(uw->uw_tmp);
+	free(uw->uw_raw);
+	free(uw->uw_zbuf);
+	free(uw->uw_last);
+	free(uw->uw_index);
+	free(uw->uw_hash);
+	bzero(uw, sizeof(ur_writer_t));
+	uw->uw_fd = -1;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_reserve
+ *  Description:  Grow a buffer to at least need bytes.  false on ENOMEM.
+ * =====================================================================================
+ */
+static bool
+ur_reserve( char **buf, size_t *size, size_t need)
+{
+	size_t n = *size ? *size : 256;
+	char  *b;
+	if( need <= *size ) {
+		return true;
+	}
+	for(; n < need; n *= 2);
+	if( ! (b = (char *) realloc(*buf, n)) ) {
+		return false;
+	}
+	*buf  = b;
+	*size = n;
+	return true;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_inflate
+ *  Description:  Inflate a block into raw,  which must hold ur_rmax bytes.  Returns 0
+ *                or EIO.
+ * =====================================================================================
+ */
+static int
+ur_inflate( ur_run_t *run, uint64_t block, char *raw)
+{
+	ur_index_t *ui   = &run->ur_index[block];
+	uLongf      rlen = ui->ui_rlen;
+	if( uncompress((Bytef *) raw, &rlen, (Bytef *) run->ur_map + ui->ui_offset, ui->ui_clen)
+			!= Z_OK || rlen != ui->ui_rlen ) {
+		return EIO;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_scan
+ *  Description:  Look for the URL in a inflated block without rebuilding its entries.
+ *                matched is how much of the URL the last entry,  which sorts before
+ *                it,  shares.  A entry sharing less than that with the last differs
+ *                from it where the URL matched so it sorts after the URL,  one sharing
+ *                more keeps the last entry's lower byte there so sorts before it and
+ *                only one sharing exactly that much needs its bytes compared.
+ *                Returns 0,  ENOENT or EIO.
+ * =====================================================================================
+ */
+static int
+ur_scan( const char *raw, size_t rlen, const char *url, size_t len)
+{
+	const char *p       = raw,
+	           *end     = raw + rlen;
+	uint64_t    shared,
+	            rest;
+	size_t      matched = 0,
+	            n,
+	            c;
+	while( p < end ) {
+		if( ! (n = ur_varint_get(p, end, &shared)) ) {
+			return EIO;
+		}
+		p += n;
+		if( ! (n = ur_varint_get(p, end, &rest)) || rest > (uint64_t) (end - p - n) ) {
+			return EIO;
+		}
+		p += n;
+		if( shared < matched ) {
+			return ENOENT;
+		}
+		if( shared == matched ) {
+			for(c = 0; c < rest && matched + c < len && p[c] == url[matched + c]; c ++);
+			if( c == rest && matched + c == len ) {
+				return 0;
+			}
+			/* the URL is a prefix of the entry or has the lower byte */
+			if( matched + c == len
+					|| (c < rest && (unsigned char) p[c] > (unsigned char) url[matched + c]) ) {
+				return ENOENT;
+			}
+			matched += c;
+		}
+		p += rest;
+	}
+	return ENOENT;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_cmp
+ *  Description:  Compare two URLs byte by byte,  a prefix sorting first.
+ * =====================================================================================
+ */
+static int
+ur_cmp( const char *a, size_t alen, const char *b, size_t blen)
+{
+	int c = memcmp(a, b, (alen < blen) ? alen : blen);
+	if( c ) {
+		return c;
+	}
+	return (alen < blen) ? -1 : (alen > blen);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_bloom_add
+ *  Description:  Set the UR_BLOOM_K bits of hash h in a filter of bits bits.  The bits
+ *                are picked by double hashing from the two halves of h.
+ * =====================================================================================
+ */
+static void
+ur_bloom_add( uint64_t *bloom, uint64_t bits, uint64_t h)
+{
+	uint64_t step = (h >> 32) | 1,
+	         b;
+	int      i    = 0;
+	for(; i < UR_BLOOM_K; i ++, h += step){
+		b = h % bits;
+		bloom[b / 64] |= 1ULL << (b % 64);
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_bloom_test
+ *  Description:  false if any of the bits ur_bloom_add sets for h is clear,  the URL
+ *                is then certainly not in the run.
+ * =====================================================================================
+ */
+static bool
+ur_bloom_test( const uint64_t *bloom, uint64_t bits, uint64_t h)
+{
+	uint64_t step = (h >> 32) | 1,
+	         b;
+	int      i    = 0;
+	for(; i < UR_BLOOM_K; i ++, h += step){
+		b = h % bits;
+		if( ! (bloom[b / 64] & (1ULL << (b % 64))) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_key_cmp
+ *  Description:  qsort comparison of two ur_key_t.
+ * =====================================================================================
+ */
+static int
+ur_key_cmp( const void *a, const void *b)
+{
+	const ur_key_t *x = (const ur_key_t *) a,
+	               *y = (const ur_key_t *) b;
+	return ur_cmp(x->uk_url, x->uk_len, y->uk_url, y->uk_len);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_heap_down
+ *  Description:  Sift heap[i] down the heap of n iterators ordered by current URL.
+ * =====================================================================================
+ */
+static void
+ur_heap_down( ur_iter_t *its, int *heap, int n, int i)
+{
+	int c,
+	    t;
+	for(; (c = 2 * i + 1) < n; i = c){
+		if( c + 1 < n && ur_cmp(its[heap[c + 1]].it_key, its[heap[c + 1]].it_klen,
+					its[heap[c]].it_key, its[heap[c]].it_klen) < 0 ) {
+			c ++;
+		}
+		if( ur_cmp(its[heap[i]].it_key, its[heap[i]].it_klen,
+					its[heap[c]].it_key, its[heap[c]].it_klen) <= 0 ) {
+			break;
+		}
+		t       = heap[i];
+		heap[i] = heap[c];
+		heap[c] = t;
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_compact
+ *  Description:  Merge the newest pair of neighbouring runs in which the older is no
+ *                more than UR_RATIO times the newer until there is none.  Called with
+ *                us_lock held,  which is dropped while a merge is written so inserts
+ *                and lookups carry on against the two runs,  the merged run replaces
+ *                them under the lock.  Flushes while it is dropped only add runs in
+ *                front,  so the pair stays together.  One compaction runs at a time,
+ *                a flush that finds one running leaves the merging to it.
+ * =====================================================================================
+ */
+static int
+ur_compact( ur_store_t *us)
+{
+	ur_run_t *pair[2],
+	         *run;
+	char     *path;
+	uint64_t  seq;
+	int       err = 0,
+	          i;
+	if( us->us_compacting ) {
+		return 0;
+	}
+	us->us_compacting = true;
+	while( ! err ) {
+		for(i = 0; i + 1 < us->us_nruns
+				&& us->us_runs[i + 1]->ur_count > UR_RATIO * us->us_runs[i]->ur_count; i ++);
+		if( i + 1 >= us->us_nruns ) {
+			break;
+		}
+		pair[0] = us->us_runs[i];
+		pair[1] = us->us_runs[i + 1];
+		seq     = us->us_seq ++;
+		pthread_mutex_unlock(&us->us_lock);
+		run  = (ur_run_t *) malloc(sizeof(ur_run_t));
+		path = ur_run_path(us, seq);
+		if( ! run || ! path ) {
+			err = ENOMEM;
+		}
+		else if( ! (err = ur_merge(pair, 2, path)) && (err = ur_open(run, path)) ) {
+			unlink(path);
+		}
+		free(path);
+		pthread_mutex_lock(&us->us_lock);
+		if( err ) {
+			free(run);
+			break;
+		}
+		for(i = 0; us->us_runs[i] != pair[0]; i ++);
+		us->us_runs[i] = run;
+		memmove(&us->us_runs[i + 1], &us->us_runs[i + 2],
+				(us->us_nruns - i - 2) * sizeof(ur_run_t *));
+		us->us_nruns --;
+		for(i = 0; i < 2; i ++){
+			unlink(pair[i]->ur_path);
+			ur_close(pair[i]);
+			free(pair[i]);
+		}
+	}
+	us->us_compacting = false;
+	pthread_cond_broadcast(&us->us_merged);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_flush_mem
+ *  Description:  Sort the memtable into a new run,  empty it and compact.  Called with
+ *                us_lock held,  which ur_compact may drop while it merges.
+ * =====================================================================================
+ */
+static int
+ur_flush_mem( ur_store_t *us)
+{
+	ur_writer_t uw;
+	ur_key_t   *keys;
+	ur_run_t   *run;
+	char       *path;
+	size_t      i = 0,
+	            n = 0;
+	int         err;
+	if( ! us->us_nmem ) {
+		return 0;
+	}
+	if( us->us_nruns == UR_RUNS_MAX ) {
+		return EMFILE;
+	}
+	if( ! (keys = (ur_key_t *) malloc(us->us_nmem * sizeof(ur_key_t))) ) {
+		return ENOMEM;
+	}
+	for(; i < us->us_nslots; i ++){
+		if( us->us_slots[i] ) {
+			keys[n].uk_url = ur_mem_url(us, us->us_slots[i], &keys[n].uk_len);
+			n ++;
+		}
+	}
+	qsort(keys, n, sizeof(ur_key_t), ur_key_cmp);
+	path = ur_run_path(us, us->us_seq);
+	run  = (ur_run_t *) malloc(sizeof(ur_run_t));
+	if( ! path || ! run ) {
+		err = ENOMEM;
+	}
+	else if( ! (err = ur_write_open(&uw, path)) ) {
+		for(i = 0; ! err && i < n; i ++){
+			err = ur_write_add(&uw, keys[i].uk_url, keys[i].uk_len);
+		}
+		if( err ) {
+			ur_write_abort(&uw);
+		}
+		else if( ! (err = ur_write_close(&uw)) && (err = ur_open(run, path)) ) {
+			unlink(path);
+		}
+	}
+	free(keys);
+	free(path);
+	if( err ) {
+		free(run);
+		return err;
+	}
+	us->us_seq ++;
+	memmove(&us->us_runs[1], &us->us_runs[0], us->us_nruns * sizeof(ur_run_t *));
+	us->us_runs[0] = run;
+	us->us_nruns ++;
+	bzero(us->us_slots, us->us_nslots * sizeof(size_t));
+	us->us_memlen = 0;
+	us->us_nmem   = 0;
+	return ur_compact(us);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_run_path
+ *  Description:  The path of run N in the store,  with room for a .tmp suffix.  To be
+ *                freed by the caller,  NULL on ENOMEM.
+ * =====================================================================================
+ */
+static char *
+ur_run_path( ur_store_t *us, uint64_t seq)
+{
+	size_t len  = strlen(us->us_dir) + 32;
+	char  *path = (char *) malloc(len);
+	if( path ) {
+		snprintf(path, len, "%s/run.%llu", us->us_dir, (unsigned long long) seq);
+	}
+	return path;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_mem_find
+ *  Description:  The memtable slot holding the URL,  or if it is not there the empty
+ *                slot it would go in.  NULL when it is not there.
+ * =====================================================================================
+ */
+static size_t *
+ur_mem_find( ur_store_t *us, const char *url, size_t len)
+{
+	size_t      mask = us->us_nslots - 1,
+	            i    = mem_hash64(url, len) & mask,
+	            n;
+	const char *s;
+	for(; us->us_slots[i]; i = (i + 1) & mask){
+		s = ur_mem_url(us, us->us_slots[i], &n);
+		if( n == len && memcmp(s, url, len) == 0 ) {
+			return &us->us_slots[i];
+		}
+	}
+	return NULL;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_mem_add
+ *  Description:  Add a URL that is not in the memtable,  doubling the hash table once
+ *                it is half full.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+ur_mem_add( ur_store_t *us, const char *url, size_t len)
+{
+	size_t *slots,
+	        mask,
+	        i,
+	        j,
+	        n;
+	if( 2 * (us->us_nmem + 1) > us->us_nslots ) {
+		if( ! (slots = (size_t *) calloc(2 * us->us_nslots, sizeof(size_t))) ) {
+			return ENOMEM;
+		}
+		mask = 2 * us->us_nslots - 1;
+		for(i = 0; i < us->us_nslots; i ++){
+			if( us->us_slots[i] ) {
+				const char *s = ur_mem_url(us, us->us_slots[i], &n);
+				for(j = mem_hash64(s, n) & mask; slots[j]; j = (j + 1) & mask);
+				slots[j] = us->us_slots[i];
+			}
+		}
+		free(us->us_slots);
+		us->us_slots   = slots;
+		us->us_nslots *= 2;
+	}
+	if( ! ur_reserve(&us->us_mem, &us->us_memsize, us->us_memlen + UR_VARINT_MAX + len) ) {
+		return ENOMEM;
+	}
+	mask = us->us_nslots - 1;
+	for(i = mem_hash64(url, len) & mask; us->us_slots[i]; i = (i + 1) & mask);
+	us->us_slots[i] = us->us_memlen + 1;
+	us->us_memlen  += ur_varint_put(us->us_mem + us->us_memlen, len);
+	memcpy(us->us_mem + us->us_memlen, url, len);
+	us->us_memlen  += len;
+	us->us_nmem ++;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_mem_url
+ *  Description:  The URL a memtable slot refers to.
+ * =====================================================================================
+ */
+static const char *
+ur_mem_url( ur_store_t *us, size_t slot, size_t *len)
+{
+	const char *p = us->us_mem + slot - 1;
+	uint64_t    v;
+	p   += ur_varint_get(p, us->us_mem + us->us_memlen, &v);
+	*len = (size_t) v;
+	return p;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_varint_put
+ *  Description:  Write v 7 bits a byte,  low bits first,  returns the bytes written.
+ * =====================================================================================
+ */
+static size_t
+ur_varint_put( char *p, uint64_t v)
+{
+	size_t n = 0;
+	for(; v >= 0x80; v >>= 7){
+		p[n ++] = (char) (v | 0x80);
+	}
+	p[n ++] = (char) v;
+	return n;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ur_varint_get
+ *  Description:  Read a varint that must end before end,  returns the bytes read or 0
+ *                if it does not.
+ * =====================================================================================
+ */
+static size_t
+ur_varint_get( const char *p, const char *end, uint64_t *v)
+{
+	size_t n     = 0;
+	int    shift = 0;
+	*v = 0;
+	for(; p + n < end && shift < 64; shift += 7){
+		*v |= (uint64_t) (p[n] & 0x7f) << shift;
+		if( ! (p[n ++] & 0x80) ) {
+			return n;
+		}
+	}
+	return 0;
+}
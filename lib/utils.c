@@ -18,6 +18,8 @@
 
 
 #include <azzmos/utils.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* 
  * ===  FUNCTION  ======================================================================
@@ -100,3 +102,156 @@ reset_file ( FILE *fh )
 	freopen(NULL,"w+",fh);
 }
 
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  str_hash
+ *  Description:  FNV-1a hash of a '\0' terminated string,  used to index the hash 
+ *                tables keyed on hosts and origins.
+ * =====================================================================================
+ */
+extern unsigned int
+str_hash( const char *s)
+{
+	unsigned int h = 2166136261u;
+	for(; *s; s ++){
+		h ^= (unsigned char) *s;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  mem_hash64
+ *  Description:  64 bit fingerprint of len bytes,  FNV-1a with a final avalanche so
+ *                the low bits can be used directly as a hash table index.
+ * =====================================================================================
+ */
+extern uint64_t
+mem_hash64( const void *p, size_t len)
+{
+	const unsigned char *s = (const unsigned char *) p;
+	uint64_t             h = 14695981039346656037ULL;
+	for(; len; len --, s ++){
+		h ^= *s;
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  write_all
+ *  Description:  Write all of len bytes to fd,  retrying short and interrupted writes.
+ *                Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+write_all( int fd, const void *p, size_t len)
+{
+	const char *s = (const char *) p;
+	ssize_t     n;
+	while( len ) {
+		if( (n = write(fd, s, len)) == -1 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			return errno;
+		}
+		s   += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  file_replace
+ *  Description:  Atomically replace path with the n buffers in iov.  They are written
+ *                to path.tmp,  synced and renamed over path,  then the directory is
+ *                synced so the rename survives a crash.  On failure path.tmp is
+ *                removed and the old path is left as it was.  Returns 0 or a errno
+ *                value.
+ * =====================================================================================
+ */
+extern int
+file_replace( const char *path, const struct iovec *iov, int n)
+{
+	char       *tmp = (char *) malloc(strlen(path) + 5),
+	           *slash;
+	int         fd,
+	            i,
+	            err = 0;
+	if( ! tmp ) {
+		return ENOMEM;
+	}
+	sprintf(tmp, "%s.tmp", path);
+	if( (fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1 ) {
+		err = errno;
+		free(tmp);
+		return err;
+	}
+	for(i = 0; i < n && ! err; i ++){
+		err = write_all(fd, iov[i].iov_base, iov[i].iov_len);
+	}
+	if( ! err && fsync(fd) == -1 ) {
+		err = errno;
+	}
+	if( close(fd) == -1 && ! err ) {
+		err = errno;
+	}
+	if( ! err && rename(tmp, path) == -1 ) {
+		err = errno;
+	}
+	if( err ) {
+		unlink(tmp);
+		free(tmp);
+		return err;
+	}
+	/* reuse tmp for the directory name */
+	if( ! (slash = strrchr(path, '/')) ) {
+		strcpy(tmp, ".");
+	}
+	else if( slash == path ) {
+		strcpy(tmp, "/");
+	}
+	else {
+		memcpy(tmp, path, slash - path);
+		tmp[slash - path] = '\0';
+	}
+	if( (fd = open(tmp, O_RDONLY)) == -1 ) {
+		err = errno;
+	}
+	else {
+		if( fsync(fd) == -1 ) {
+			err = errno;
+		}
+		close(fd);
+	}
+	free(tmp);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  put_netorder
+ *  Description:  Write the low bytes of v to p in network order,  returns the byte
+ *                after.  Used to build the binary parameters and COPY rows sent to
+ *                PostgreSQL.
+ * =====================================================================================
+ */
+extern char *
+put_netorder( char *p, uint64_t v, int bytes)
+{
+	int i = bytes;
+	while( i -- ) {
+		p[i] = (char) (v & 0xff);
+		v  >>= 8;
+	}
+	return p + bytes;
+}
@@ -0,0 +1,503 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  wsched.c
+ *
+ *    Description:  Work stealing scheduler.  The deques are the Chase-Lev deque with
+ *                  the memory orders of Le,  Pop,  Cohen and Zappa Nardelli.  The owner
+ *                  pushes and takes at the bottom without a atomic read modify write
+ *                  unless it races a thief for the last task,  thieves take from the
+ *                  top with one compare and swap.  A full deque doubles its array,  the
+ *                  old one is kept until the scheduler is destroyed since a thief may
+ *                  still be reading it.
+ *
+ *                  A worker runs its own tasks,  then those spawned from outside,  then
+ *                  tries to steal from every other worker starting at a random one.
+ *                  If all that fails it parks.  It counts itself in ws_sleepers under
+ *                  ws_lock and looks for work once more before waiting,  and a spawn
+ *                  only takes the lock to signal when that count is not zero.
+ *
+ *        Version:  1.0
+ *        Created:  28/10/2026 19:12:40
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <azzmos/wsched.h>
+#include <unistd.h>
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static void      *ws_main( void *arg);
+static void       ws_stop( wsched_t *ws, int started);
+static void       ws_free( wsched_t *ws);
+static ws_task_t *ws_find( wsched_t *ws, ws_worker_t *w);
+static bool       ws_has_work( wsched_t *ws);
+static void       ws_run( wsched_t *ws, ws_task_t *task);
+static void       ws_notify( wsched_t *ws);
+static int        wd_init( ws_deque_t *d);
+static int        wd_push( ws_deque_t *d, ws_task_t *task);
+static ws_task_t *wd_take( ws_deque_t *d);
+static int        wd_steal( ws_deque_t *d, ws_task_t **task);
+static void       wd_free( ws_deque_t *d);
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ################################ */
+static __thread ws_worker_t *ws_self = NULL;  /* worker running on this thread */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_init
+ *  Description:  Initilize the scheduler and start its worker threads,  one per online
+ *                processor if workers is zero or less.  Returns 0 or a errno value.
+ * =====================================================================================
+ */
+extern int
+ws_init( wsched_t *ws, int workers)
+{
+	int err     = 0,
+	    started = 0,
+	    i       = 0;
+	bzero(ws, sizeof(wsched_t));
+	if( workers <= 0 && (workers = (int) sysconf(_SC_NPROCESSORS_ONLN)) <= 0 ) {
+		workers = 1;
+	}
+	ws->ws_workers = (ws_worker_t *) calloc(workers, sizeof(ws_worker_t));
+	if( ! ws->ws_workers ) {
+		return ENOMEM;
+	}
+	if( (err = mq_init(&ws->ws_inject, WS_INJECT)) ) {
+		free(ws->ws_workers);
+		return err;
+	}
+	pthread_mutex_init(&ws->ws_lock, NULL);
+	pthread_cond_init(&ws->ws_cond, NULL);
+	pthread_cond_init(&ws->ws_idle, NULL);
+	for(; i < workers; i ++){
+		ws->ws_workers[i].ww_sched = ws;
+		ws->ws_workers[i].ww_id    = i;
+		ws->ws_workers[i].ww_seed  = 2654435761u * (i + 1);
+		if( (err = wd_init(&ws->ws_workers[i].ww_deque)) ) {
+			break;
+		}
+	}
+	ws->ws_nworkers = workers;
+	/* the deques must all exist before any thread tries to steal from them */
+	for(; ! err && started < workers; started ++){
+		err = pthread_create(&ws->ws_workers[started].ww_thread, NULL, ws_main,
+				&ws->ws_workers[started]);
+		if( err ) {
+			break;
+		}
+	}
+	if( err ) {
+		ws_stop(ws, started);
+		ws_free(ws);
+	}
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_task_init
+ *  Description:  Initilize a task to call fn.
+ * =====================================================================================
+ */
+extern void
+ws_task_init( ws_task_t *task, ws_fn_t fn)
+{
+	task->wt_fn = fn;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_spawn
+ *  Description:  Run task on one of the workers.  From a worker of this scheduler the
+ *                task goes on its own deque,  where it will be run next unless it is
+ *                stolen,  otherwise on the shared queue,  waiting while that is full.
+ *                Returns 0,  ENOMEM if a deque could not grow or ECANCELED if the
+ *                scheduler is being destroyed.
+ * =====================================================================================
+ */
+extern int
+ws_spawn( wsched_t *ws, ws_task_t *task)
+{
+	int err;
+	if( __atomic_load_n(&ws->ws_stop, __ATOMIC_SEQ_CST) ) {
+		return ECANCELED;
+	}
+	__atomic_fetch_add(&ws->ws_pending, 1, __ATOMIC_SEQ_CST);
+	if( ws_self && ws_self->ww_sched == ws ) {
+		err = wd_push(&ws_self->ww_deque, task);
+	}
+	else {
+		err = mq_push(&ws->ws_inject, task, true);
+	}
+	if( err ) {
+		__atomic_fetch_sub(&ws->ws_pending, 1, __ATOMIC_SEQ_CST);
+		return err;
+	}
+	ws_notify(ws);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_wait
+ *  Description:  Block until every task spawned so far,  and every task they spawn,
+ *                has run.  Must not be called from a worker.
+ * =====================================================================================
+ */
+extern void
+ws_wait( wsched_t *ws)
+{
+	pthread_mutex_lock(&ws->ws_lock);
+	while( __atomic_load_n(&ws->ws_pending, __ATOMIC_SEQ_CST) ) {
+		pthread_cond_wait(&ws->ws_idle, &ws->ws_lock);
+	}
+	pthread_mutex_unlock(&ws->ws_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_worker
+ *  Description:  The index of the worker the caller is running on,  -1 if it is not
+ *                one of this scheduler's workers.  Lets a task use per worker state.
+ * =====================================================================================
+ */
+extern int
+ws_worker( wsched_t *ws)
+{
+	return (ws_self && ws_self->ww_sched == ws) ? ws_self->ww_id : -1;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_destroy
+ *  Description:  Stop and join the workers and release the scheduler.  Tasks that
+ *                have not started are dropped,  call ws_wait first to run them.
+ * =====================================================================================
+ */
+extern void
+ws_destroy( wsched_t *ws)
+{
+	ws_stop(ws, ws->ws_nworkers);
+	ws_free(ws);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_main
+ *  Description:  Worker thread,  run tasks until the scheduler stops.
+ * =====================================================================================
+ */
+static void *
+ws_main( void *arg)
+{
+	ws_worker_t *w  = (ws_worker_t *) arg;
+	wsched_t    *ws = w->ww_sched;
+	ws_task_t   *t;
+	ws_self = w;
+	while( ! __atomic_load_n(&ws->ws_stop, __ATOMIC_SEQ_CST) ) {
+		if( (t = ws_find(ws, w)) ) {
+			ws_run(ws, t);
+			continue;
+		}
+		pthread_mutex_lock(&ws->ws_lock);
+		__atomic_fetch_add(&ws->ws_sleepers, 1, __ATOMIC_SEQ_CST);
+		if( ! __atomic_load_n(&ws->ws_stop, __ATOMIC_SEQ_CST) && ! ws_has_work(ws) ) {
+			pthread_cond_wait(&ws->ws_cond, &ws->ws_lock);
+		}
+		__atomic_fetch_sub(&ws->ws_sleepers, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&ws->ws_lock);
+	}
+	return NULL;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_stop
+ *  Description:  Tell the workers to exit and join the first started of them.  The
+ *                shared queue is closed before the join so a ws_spawn blocked on it,
+ *                or made from here on,  returns ECANCELED instead of waiting on
+ *                workers that are gone.
+ * =====================================================================================
+ */
+static void
+ws_stop( wsched_t *ws, int started)
+{
+	int i = 0;
+	pthread_mutex_lock(&ws->ws_lock);
+	__atomic_store_n(&ws->ws_stop, 1, __ATOMIC_SEQ_CST);
+	mq_close(&ws->ws_inject);
+	pthread_cond_broadcast(&ws->ws_cond);
+	pthread_mutex_unlock(&ws->ws_lock);
+	for(; i < started; i ++){
+		pthread_join(ws->ws_workers[i].ww_thread, NULL);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_free
+ *  Description:  Release the deques,  the shared queue and the locks.
+ * =====================================================================================
+ */
+static void
+ws_free( wsched_t *ws)
+{
+	int i = 0;
+	for(; i < ws->ws_nworkers; i ++){
+		wd_free(&ws->ws_workers[i].ww_deque);
+	}
+	free(ws->ws_workers);
+	mq_destroy(&ws->ws_inject);
+	pthread_cond_destroy(&ws->ws_idle);
+	pthread_cond_destroy(&ws->ws_cond);
+	pthread_mutex_destroy(&ws->ws_lock);
+	bzero(ws, sizeof(wsched_t));
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_find
+ *  Description:  The next task for a worker,  its own newest,  then the oldest spawned
+ *                from outside,  then one stolen.  NULL if there is none.
+ * =====================================================================================
+ */
+static ws_task_t *
+ws_find( wsched_t *ws, ws_worker_t *w)
+{
+	ws_task_t *t;
+	int        round = 0,
+	           start,
+	           i,
+	           v,
+	           err;
+	if( (t = wd_take(&w->ww_deque)) ) {
+		return t;
+	}
+	if( mq_pop(&ws->ws_inject, (void **) &t, false) == 0 ) {
+		return t;
+	}
+	for(; round < WS_STEALS; round ++){
+		w->ww_seed ^= w->ww_seed << 13;
+		w->ww_seed ^= w->ww_seed >> 17;
+		w->ww_seed ^= w->ww_seed << 5;
+		start = w->ww_seed % ws->ws_nworkers;
+		for(i = 0; i < ws->ws_nworkers; i ++){
+			if( (v = (start + i) % ws->ws_nworkers) == w->ww_id ) {
+				continue;
+			}
+			/* EAGAIN is a lost race with another thief,  the deque may have more */
+			while( (err = wd_steal(&ws->ws_workers[v].ww_deque, &t)) == EAGAIN );
+			if( ! err ) {
+				return t;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_has_work
+ *  Description:  Does any deque or the shared queue look to have a task.  A slot that
+ *                has been claimed but not yet filled counts,  the worker then looks
+ *                again rather than parking.
+ * =====================================================================================
+ */
+static bool
+ws_has_work( wsched_t *ws)
+{
+	ws_deque_t *d;
+	int         i = 0;
+	if( __atomic_load_n(&ws->ws_inject.mq_tail, __ATOMIC_SEQ_CST)
+			!= __atomic_load_n(&ws->ws_inject.mq_head, __ATOMIC_SEQ_CST) ) {
+		return true;
+	}
+	for(; i < ws->ws_nworkers; i ++){
+		d = &ws->ws_workers[i].ww_deque;
+		if( __atomic_load_n(&d->wd_bottom, __ATOMIC_SEQ_CST)
+				> __atomic_load_n(&d->wd_top, __ATOMIC_SEQ_CST) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_run
+ *  Description:  Run a task and wake ws_wait if it was the last.  The task may free
+ *                itself so it is not touched afterwards.
+ * =====================================================================================
+ */
+static void
+ws_run( wsched_t *ws, ws_task_t *task)
+{
+	task->wt_fn(task);
+	if( __atomic_sub_fetch(&ws->ws_pending, 1, __ATOMIC_SEQ_CST) == 0 ) {
+		pthread_mutex_lock(&ws->ws_lock);
+		pthread_cond_broadcast(&ws->ws_idle);
+		pthread_mutex_unlock(&ws->ws_lock);
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  ws_notify
+ *  Description:  Wake a parked worker after a spawn,  if any are parked.  The fence
+ *                orders the push before reading ws_sleepers,  pairing with a parking
+ *                worker counting itself before it looks for work again.
+ * =====================================================================================
+ */
+static void
+ws_notify( wsched_t *ws)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if( ! __atomic_load_n(&ws->ws_sleepers, __ATOMIC_SEQ_CST) ) {
+		return;
+	}
+	pthread_mutex_lock(&ws->ws_lock);
+	pthread_cond_signal(&ws->ws_cond);
+	pthread_mutex_unlock(&ws->ws_lock);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  wd_init
+ *  Description:  Initilize a empty deque with room for WS_DEQUE_MIN tasks.
+ * =====================================================================================
+ */
+static int
+wd_init( ws_deque_t *d)
+{
+	bzero(d, sizeof(ws_deque_t));
+	d->wd_array = (ws_array_t *) calloc(1, sizeof(ws_array_t)
+			+ WS_DEQUE_MIN * sizeof(ws_task_t *));
+	if( ! d->wd_array ) {
+		return ENOMEM;
+	}
+	d->wd_array->wa_size = WS_DEQUE_MIN;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  wd_push
+ *  Description:  Owner only,  push a task at the bottom,  doubling the array if it is
+ *                full.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+wd_push( ws_deque_t *d, ws_task_t *task)
+{
+	int64_t     b = __atomic_load_n(&d->wd_bottom, __ATOMIC_RELAXED),
+	            t = __atomic_load_n(&d->wd_top, __ATOMIC_ACQUIRE),
+	            i;
+	ws_array_t *a = __atomic_load_n(&d->wd_array, __ATOMIC_RELAXED),
+	           *n;
+	if( b - t > a->wa_size - 1 ) {
+		n = (ws_array_t *) malloc(sizeof(ws_array_t) + 2 * a->wa_size * sizeof(ws_task_t *));
+		if( ! n ) {
+			return ENOMEM;
+		}
+		n->wa_size = 2 * a->wa_size;
+		n->wa_prev = a;
+		for(i = t; i < b; i ++){
+			n->wa_tasks[i & (n->wa_size - 1)] = a->wa_tasks[i & (a->wa_size - 1)];
+		}
+		__atomic_store_n(&d->wd_array, n, __ATOMIC_RELEASE);
+		a = n;
+	}
+	__atomic_store_n(&a->wa_tasks[b & (a->wa_size - 1)], task, __ATOMIC_RELAXED);
+	__atomic_store_n(&d->wd_bottom, b + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  wd_take
+ *  Description:  Owner only,  take the newest task.  Only the last task is raced for
+ *                with the thieves.  NULL if the deque is empty.
+ * =====================================================================================
+ */
+static ws_task_t *
+wd_take( ws_deque_t *d)
+{
+	int64_t     b = __atomic_load_n(&d->wd_bottom, __ATOMIC_RELAXED) - 1,
+	            t;
+	ws_array_t *a = __atomic_load_n(&d->wd_array, __ATOMIC_RELAXED);
+	ws_task_t  *task = NULL;
+	__atomic_store_n(&d->wd_bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	t = __atomic_load_n(&d->wd_top, __ATOMIC_RELAXED);
+	if( t <= b ) {
+		task = __atomic_load_n(&a->wa_tasks[b & (a->wa_size - 1)], __ATOMIC_RELAXED);
+		if( t == b ) {
+			if( ! __atomic_compare_exchange_n(&d->wd_top, &t, t + 1, false,
+						__ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ) {
+				task = NULL;
+			}
+			__atomic_store_n(&d->wd_bottom, b + 1, __ATOMIC_RELAXED);
+		}
+	}
+	else {
+		__atomic_store_n(&d->wd_bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return task;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  wd_steal
+ *  Description:  Any thread,  take the oldest task.  Returns 0,  ENOENT if the deque
+ *                is empty or EAGAIN if another thread took the task first.
+ * =====================================================================================
+ */
+static int
+wd_steal( ws_deque_t *d, ws_task_t **task)
+{
+	int64_t     t = __atomic_load_n(&d->wd_top, __ATOMIC_ACQUIRE),
+	            b;
+	ws_array_t *a;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&d->wd_bottom, __ATOMIC_ACQUIRE);
+	if( t >= b ) {
+		return ENOENT;
+	}
+	a     = __atomic_load_n(&d->wd_array, __ATOMIC_ACQUIRE);
+	*task = __atomic_load_n(&a->wa_tasks[t & (a->wa_size - 1)], __ATOMIC_RELAXED);
+	if( ! __atomic_compare_exchange_n(&d->wd_top, &t, t + 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ) {
+		return EAGAIN;
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  wd_free
+ *  Description:  Release the deque's array and every array it replaced.
+ * =====================================================================================
+ */
+static void
+wd_free( ws_deque_t *d)
+{
+	ws_array_t *a = d->wd_array,
+	           *p;
+	for(; a; a = p){
+		p = a->wa_prev;
+		free(a);
+	}
+	d->wd_array = NULL;
+}
@@ -0,0 +1,787 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  download.c
+ *
+ *    Description:  Downloader functions.  Each origin (scheme and authority) gets one
+ *                  connection and transfers to it are multiplexed as HTTP/2 streams,
+ *                  when an origin already has dl_max_streams in flight further
+ *                  transfers are held on the origin until a stream is released.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 20:11:02
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <download.h>
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+
+/*****************************************************************************************
+ * CURL_HTTP_VERSION_2TLS only asks for HTTP/2 over https,  plain http stays on 1.1 which
+ * avoids the upgrade round trip against servers that do not speak h2c.
+ *****************************************************************************************/
+#ifdef CURL_HTTP_VERSION_2TLS
+#define DL_HTTP_VERSION CURL_HTTP_VERSION_2TLS
+#else
+#define DL_HTTP_VERSION CURL_HTTP_VERSION_2_0
+#endif
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static dl_origin_t  *dl_origin( dl_t *dl, uriobj_t *uri);
+static int           dl_start( dl_t *dl, dl_xfer_t *xfer);
+static void          dl_finish( dl_t *dl, CURL *easy, CURLcode result);
+static size_t        dl_write( char *ptr, size_t size, size_t nmemb, void *data);
+static int           dl_emit( const char *tag, const char *value, size_t len, void *arg);
+static void          dl_xfer_free( dl_xfer_t *xfer);
+static void          dl_resume( dl_t *dl);
+static size_t        dl_header( char *ptr, size_t size, size_t nmemb, void *data);
+static int           dl_conditional( dl_xfer_t *xfer);
+static bool          dl_hvalue( char *ptr, size_t len, const char *name, char **v, size_t *n);
+static bool          dl_policy( dl_t *dl, dl_xfer_t *xfer);
+static void          dl_abort( dl_xfer_t *xfer, int reason);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_init
+ *  Description:  Initilize the downloader and its multi handle.  max_streams is the
+ *                number of concurrent streams allowed per origin,  if it is zero or
+ *                less DL_MAX_STREAMS is used.  done is called as each transfer
+ *                completes.  Returns 0 on success or a errno value.
+ * =====================================================================================
+ */
+extern int
+dl_init( dl_t *dl, long max_streams, dl_done_f done, void *arg)
+{
+	int i = 0;
+	bzero(dl, sizeof(dl_t));
+	dl->dl_multi = curl_multi_init();
+	if( ! dl->dl_multi ) {
+		return ENOMEM;
+	}
+	if( max_streams <= 0 ) {
+		max_streams = DL_MAX_STREAMS;
+	}
+	dl->dl_max_streams = max_streams;
+	dl->dl_done = done;
+	dl->dl_arg  = arg;
+	INIT_LIST_HEAD(&dl->dl_active);
+	INIT_LIST_HEAD(&dl->dl_types);
+	for(; i < DL_ORIGIN_BUCKETS; i ++){
+		INIT_LIST_HEAD(&dl->dl_otable[i]);
+	}
+	curl_multi_setopt(dl->dl_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(dl->dl_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) DL_MAX_HOST_CONNS);
+#if LIBCURL_VERSION_NUM >= 0x074300
+	curl_multi_setopt(dl->dl_multi, CURLMOPT_MAX_CONCURRENT_STREAMS, max_streams);
+#endif
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_links
+ *  Description:  Ask for links to be extracted from HTML pages as they download.  Each
+ *                href,  src and action is resolved against the page's base,  links
+ *                repeated on a page are dropped and the rest are passed through
+ *                ref_resolve and handed to link,  so outlinks are found without the
+ *                page ever being buffered.
+ * =====================================================================================
+ */
+extern void
+dl_links( dl_t *dl, regexpr_t *re, bool strict, dl_link_f link, void *arg)
+{
+	dl->dl_re       = re;
+	dl->dl_strict   = strict;
+	dl->dl_link     = link;
+	dl->dl_link_arg = arg;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_body
+ *  Description:  Keep response bodies as chunk chains taken from pool.  When the pool
+ *                is exhausted transfers are paused until chunks are returned,  this is
+ *                the back pressure that keeps the downloader inside the pool's cap.
+ * =====================================================================================
+ */
+extern void
+dl_body( dl_t *dl, bufpool_t *pool)
+{
+	dl->dl_pool = pool;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_allow
+ *  Description:  Add a content type to the allow list with a body size limit of max
+ *                bytes,  zero for no limit.  type may be a media type, a major type
+ *                ending in '/' or "*".  While the list is empty every type is
+ *                allowed,  once it has entries a 2xx response whose type is not on it
+ *                is aborted as soon as its headers arrive,  as is one whose
+ *                Content-Length is over the limit or whose body grows past it.
+ *                Returns 0,  EINVAL for a missing or empty type or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+dl_allow( dl_t *dl, const char *type, size_t max)
+{
+	dl_type_t *dt;
+	if( ! type || ! *type ) {
+		return EINVAL;
+	}
+	dt = (dl_type_t *) malloc(sizeof(dl_type_t));
+	if( ! dt ) {
+		return ENOMEM;
+	}
+	dt->dt_type = strdup(type);
+	if( ! dt->dt_type ) {
+		free(dt);
+		return ENOMEM;
+	}
+	dt->dt_max = max;
+	list_add_tail(&dt->dt_list, &dl->dl_types);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_add
+ *  Description:  Queue a normalized URI for download.  If the URI's origin has a free
+ *                stream the transfer is handed to curl straight away, otherwise it
+ *                waits on the origin until dl_perform releases a stream.  data is
+ *                passed back through dx_data when the transfer completes.
+ * =====================================================================================
+ */
+extern int
+dl_add( dl_t *dl, uriobj_t *uri, void *data)
+{
+	dl_xfer_t *xfer = (dl_xfer_t *) malloc(sizeof(dl_xfer_t));
+	int        err;
+	if( ! xfer ) {
+		return errno;
+	}
+	bzero(xfer, sizeof(dl_xfer_t));
+	INIT_LIST_HEAD(&xfer->dx_list);
+	bp_chain_init(&xfer->dx_body);
+	xfer->dx_abort  = -1;
+	xfer->dx_length = -1;
+	xfer->dx_dl   = dl;
+	xfer->dx_uri  = uri;
+	xfer->dx_data = data;
+	xfer->dx_url  = uri_comp_recomp(uri);
+	xfer->dx_origin = dl_origin(dl, uri);
+	if( ! xfer->dx_url || ! xfer->dx_origin ) {
+		dl_xfer_free(xfer);
+		return ENOMEM;
+	}
+	if( xfer->dx_origin->do_streams >= dl->dl_max_streams ) {
+		list_add_tail(&xfer->dx_list, &xfer->dx_origin->do_pending);
+		xfer->dx_origin->do_queued ++;
+		return 0;
+	}
+	if( (err = dl_start(dl, xfer)) ) {
+		dl_xfer_free(xfer);
+	}
+	return err;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_perform
+ *  Description:  Drive the transfers, waiting at most timeout_ms for socket activity.
+ *                Completed transfers are passed to the done callback and any transfer
+ *                waiting on their origin is started.  Transfers paused on the pool are
+ *                resumed once it has chunks to spare.  Returns the number of transfers
+ *                still running or a negative errno value on error.
+ * =====================================================================================
+ */
+extern int
+dl_perform( dl_t *dl, int timeout_ms)
+{
+	CURLMcode mc;
+	CURLMsg  *msg;
+	int       running = 0,
+	          left    = 0;
+	if( dl->dl_paused && bp_avail(dl->dl_pool, dl->dl_pool->bp_size) ) {
+		dl_resume(dl);
+	}
+	mc = curl_multi_perform(dl->dl_multi, &running);
+	if( mc == CURLM_OK && running ) {
+		mc = curl_multi_wait(dl->dl_multi, NULL, 0, timeout_ms, NULL);
+		if( mc == CURLM_OK ) {
+			mc = curl_multi_perform(dl->dl_multi, &running);
+		}
+	}
+	if( mc != CURLM_OK ) {
+		ERROR_B("driving transfers", curl_multi_strerror(mc));
+		return -EIO;
+	}
+	while( (msg = curl_multi_info_read(dl->dl_multi, &left)) ) {
+		if( msg->msg == CURLMSG_DONE ) {
+			dl_finish(dl, msg->easy_handle, msg->data.result);
+		}
+	}
+	return dl->dl_running;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_stats
+ *  Description:  Print the per-origin stream counts to fh.  One line is printed per
+ *                origin: the origin, streams in flight, peak streams, transfers
+ *                waiting for a stream, completed transfers and how many of those were
+ *                carried over HTTP/2.
+ * =====================================================================================
+ */
+extern void
+dl_stats( dl_t *dl, FILE *fh)
+{
+	dl_origin_t *o;
+	int i = 0;
+	fprintf(fh, "origins=%d running=%d max_streams=%li notmod=%li\n",
+			dl->dl_origins, dl->dl_running, dl->dl_max_streams, dl->dl_notmod);
+	fprintf(fh, "aborts type=%li length=%li size=%li\n", dl->dl_aborts[DL_ABORT_TYPE],
+			dl->dl_aborts[DL_ABORT_LENGTH], dl->dl_aborts[DL_ABORT_SIZE]);
+	for(; i < DL_ORIGIN_BUCKETS; i ++){
+		list_for_each_entry(o, &dl->dl_otable[i], do_list){
+			fprintf(fh, "%s streams=%d peak=%d queued=%d total=%li h2=%li\n",
+					o->do_key, o->do_streams, o->do_peak, o->do_queued,
+					o->do_total, o->do_h2);
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_cleanup
+ *  Description:  Abort any running or waiting transfers and release the downloader.
+ *                The done callback is not called for aborted transfers.
+ * =====================================================================================
+ */
+extern void
+dl_cleanup( dl_t *dl)
+{
+	dl_xfer_t    *xfer,
+	             *n;
+	dl_origin_t  *o,
+	             *on;
+	dl_type_t    *dt,
+	             *dn;
+	int i = 0;
+	list_for_each_entry_safe(xfer, n, &dl->dl_active, dx_list){
+		curl_multi_remove_handle(dl->dl_multi, xfer->dx_easy);
+		curl_easy_cleanup(xfer->dx_easy);
+		dl_xfer_free(xfer);
+	}
+	for(; i < DL_ORIGIN_BUCKETS; i ++){
+		list_for_each_entry_safe(o, on, &dl->dl_otable[i], do_list){
+			list_for_each_entry_safe(xfer, n, &o->do_pending, dx_list){
+				dl_xfer_free(xfer);
+			}
+			list_del(&o->do_list);
+			free(o->do_key);
+			free(o);
+		}
+	}
+	list_for_each_entry_safe(dt, dn, &dl->dl_types, dt_list){
+		list_del(&dt->dt_list);
+		free(dt->dt_type);
+		free(dt);
+	}
+	curl_multi_cleanup(dl->dl_multi);
+	dl->dl_multi = NULL;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_origin
+ *  Description:  Find the origin for the URI,  creating it if this is the first
+ *                transfer against it.  Returns NULL on memory allocation failure.
+ * =====================================================================================
+ */
+static dl_origin_t *
+dl_origin( dl_t *dl, uriobj_t *uri)
+{
+	dl_origin_t      *o;
+	struct list_head *bucket;
+	char             *key;
+	if( asprintf(&key, "%s://%s", UI(uri->uri_scheme), UI(uri->uri_auth)) < 0 ) {
+		return NULL;
+	}
+	bucket = &dl->dl_otable[str_hash(key) % DL_ORIGIN_BUCKETS];
+	list_for_each_entry(o, bucket, do_list){
+		if( strcmp(o->do_key, key) == 0 ) {
+			free(key);
+			return o;
+		}
+	}
+	o = (dl_origin_t *) malloc(sizeof(dl_origin_t));
+	if( ! o ) {
+		free(key);
+		return NULL;
+	}
+	bzero(o, sizeof(dl_origin_t));
+	o->do_key = key;
+	INIT_LIST_HEAD(&o->do_pending);
+	list_add(&o->do_list, bucket);
+	dl->dl_origins ++;
+	return o;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_start
+ *  Description:  Create the easy handle for the transfer and add it to the multi
+ *                handle.  PIPEWAIT makes curl wait for the origin's connection to come
+ *                up and multiplex onto it rather than opening a second connection.
+ *                Returns 0 or a errno value,  on failure the transfer still belongs to
+ *                the caller.
+ * =====================================================================================
+ */
+static int
+dl_start( dl_t *dl, dl_xfer_t *xfer)
+{
+	CURLMcode mc;
+	CURL     *easy = curl_easy_init();
+	if( ! easy ) {
+		return ENOMEM;
+	}
+	if( dl->dl_link ) {
+		xfer->dx_lx = (linkex_t *) malloc(sizeof(linkex_t));
+		if( ! xfer->dx_lx ) {
+			curl_easy_cleanup(easy);
+			return ENOMEM;
+		}
+		lx_init(xfer->dx_lx, dl_emit, xfer);
+	}
+	xfer->dx_easy = easy;
+	if( dl_conditional(xfer) ) {
+		curl_easy_cleanup(easy);
+		xfer->dx_easy = NULL;
+		return ENOMEM;
+	}
+	curl_easy_setopt(easy, CURLOPT_URL, xfer->dx_url);
+	curl_easy_setopt(easy, CURLOPT_PRIVATE, xfer);
+	curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long) DL_HTTP_VERSION);
+	curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+	curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, dl_write);
+	curl_easy_setopt(easy, CURLOPT_WRITEDATA, xfer);
+	curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, dl_header);
+	curl_easy_setopt(easy, CURLOPT_HEADERDATA, xfer);
+	curl_easy_setopt(easy, CURLOPT_FILETIME, 1L);
+	mc = curl_multi_add_handle(dl->dl_multi, easy);
+	if( mc != CURLM_OK ) {
+		ERROR_B("adding transfer", curl_multi_strerror(mc));
+		curl_easy_cleanup(easy);
+		xfer->dx_easy = NULL;
+		return EIO;
+	}
+	xfer->dx_origin->do_streams ++;
+	if( xfer->dx_origin->do_streams > xfer->dx_origin->do_peak ) {
+		xfer->dx_origin->do_peak = xfer->dx_origin->do_streams;
+	}
+	list_add_tail(&xfer->dx_list, &dl->dl_active);
+	dl->dl_running ++;
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_finish
+ *  Description:  Account for a completed transfer, hand it to the done callback,
+ *                release the stream and start the next transfer waiting on the
+ *                origin.  A waiting transfer that cannot be started is handed to the
+ *                done callback with dx_result set to CURLE_FAILED_INIT so the caller
+ *                knows it was dropped.
+ * =====================================================================================
+ */
+static void
+dl_finish( dl_t *dl, CURL *easy, CURLcode result)
+{
+	dl_xfer_t   *xfer,
+	            *next;
+	dl_origin_t *o;
+	long         version = 0,
+	             mdate   = -1;
+	curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **) &xfer);
+	curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &xfer->dx_code);
+	if( result == CURLE_OK && xfer->dx_code == 304 ) {
+		xfer->dx_notmod = true;
+		dl->dl_notmod ++;
+	}
+	else if( result == CURLE_OK && xfer->dx_code >= 200 && xfer->dx_code < 300 ) {
+		/* keep the validators for the next conditional fetch */
+		curl_easy_getinfo(easy, CURLINFO_FILETIME, &mdate);
+		xfer->dx_uri->uri_mdate = (mdate > 0) ? (time_t) mdate : time(NULL);
+		free(*xfer->dx_uri->uri_etag);
+		*(xfer->dx_uri->uri_etag) = xfer->dx_etag;
+		xfer->dx_etag = NULL;
+	}
+#if LIBCURL_VERSION_NUM >= 0x073200
+	curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &version);
+#endif
+	xfer->dx_result = result;
+	o = xfer->dx_origin;
+	o->do_streams --;
+	o->do_total ++;
+	if( version == CURL_HTTP_VERSION_2_0 ) {
+		o->do_h2 ++;
+	}
+	dl->dl_running --;
+	if( xfer->dx_paused ) {
+		dl->dl_paused --;
+	}
+	list_del_init(&xfer->dx_list);
+	curl_multi_remove_handle(dl->dl_multi, easy);
+	if( dl->dl_done ) {
+		dl->dl_done(xfer, dl->dl_arg);
+	}
+	curl_easy_cleanup(easy);
+	dl_xfer_free(xfer);
+	while( ! list_empty(&o->do_pending) && o->do_streams < dl->dl_max_streams ) {
+		next = list_entry(o->do_pending.next, dl_xfer_t, dx_list);
+		list_del_init(&next->dx_list);
+		o->do_queued --;
+		if( dl_start(dl, next) ) {
+			next->dx_result = CURLE_FAILED_INIT;
+			if( dl->dl_done ) {
+				dl->dl_done(next, dl->dl_arg);
+			}
+			dl_xfer_free(next);
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_write
+ *  Description:  curl write callback.  When the downloader has a pool the data is
+ *                appended to the transfer's body chain,  if the pool is exhausted the
+ *                transfer is paused and curl will offer the same data again once it
+ *                is resumed.  The data is then pushed through the transfer's link
+ *                extractor.  The content type is checked on the first call and the
+ *                extractor dropped if the body is not HTML.
+ * =====================================================================================
+ */
+static size_t
+dl_write( char *ptr, size_t size, size_t nmemb, void *data)
+{
+	dl_xfer_t *xfer = (dl_xfer_t *) data;
+	dl_t      *dl   = xfer->dx_dl;
+	char      *type = NULL;
+	size_t     len  = size * nmemb;
+	int        err  = 0;
+	if( xfer->dx_notmod ) {
+		return len;
+	}
+	if( xfer->dx_limit && xfer->dx_received + len > xfer->dx_limit ) {
+		dl_abort(xfer, DL_ABORT_SIZE);
+		return 0;
+	}
+	if( dl->dl_pool ) {
+		err = bp_chain_write(dl->dl_pool, &xfer->dx_body, ptr, len, false);
+		if( err == EAGAIN ) {
+			xfer->dx_paused = true;
+			dl->dl_paused ++;
+			return CURL_WRITEFUNC_PAUSE;
+		}
+		if( err ) {
+			ERROR_E("storing body", err);
+			return 0;
+		}
+	}
+	xfer->dx_received += len;
+	if( ! xfer->dx_lx ) {
+		return len;
+	}
+	if( ! xfer->dx_typed ) {
+		xfer->dx_typed = true;
+		curl_easy_getinfo(xfer->dx_easy, CURLINFO_CONTENT_TYPE, &type);
+		if( type && strncasecmp(type, "text/html", 9) != 0
+		         && strncasecmp(type, "application/xhtml", 17) != 0 ) {
+			free(xfer->dx_lx);
+			xfer->dx_lx = NULL;
+			return len;
+		}
+	}
+	if( lx_feed(xfer->dx_lx, ptr, len) ) {
+		return 0;
+	}
+	return len;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_emit
+ *  Description:  Link extractor callback,  resolve the link against the page's base
+ *                and pass it on.  The base is prepared once per page in dx_rf and the
+ *                span is resolved in place,  so a link repeated on the page is dropped
+ *                before a uriobj is built for it.  The first <base href> becomes the
+ *                base for the links after it rather than being passed on itself.  A
+ *                memory allocation failure aborts the transfer.
+ * =====================================================================================
+ */
+static int
+dl_emit( const char *tag, const char *value, size_t len, void *arg)
+{
+	dl_xfer_t *xfer = (dl_xfer_t *) arg;
+	dl_t      *dl   = xfer->dx_dl;
+	rf_span_t  span = { value, len };
+	rf_ref_t   out;
+	uriobj_t  *ref;
+	int        n,
+	           err;
+	if( ! xfer->dx_rf ) {
+		if( ! (xfer->dx_rf = (rf_batch_t *) malloc(sizeof(rf_batch_t))) ) {
+			return ENOMEM;
+		}
+		if( (err = rf_init(xfer->dx_rf, xfer->dx_uri, dl->dl_strict)) ) {
+			ERROR("preparing the page's base");
+			free(xfer->dx_rf);
+			xfer->dx_rf = NULL;
+			return err;
+		}
+	}
+	if( strcmp(tag, "base") == 0 ) {
+		if( xfer->dx_rebased ) {
+			return 0;
+		}
+		xfer->dx_rebased = true;
+		err = rf_rebase(xfer->dx_rf, value, len);
+		return (err == ENOMEM) ? err : 0;
+	}
+	if( (err = rf_resolve(xfer->dx_rf, &span, 1, &out, &n)) ) {
+		ERROR("resolving href");
+		return err;
+	}
+	if( ! n ) {
+		return 0;
+	}
+	ref = ref_resolve(xfer->dx_uri, (char *) out.rr_uri, dl->dl_re, dl->dl_strict);
+	if( ! ref ) {
+		ERROR("resolving href");
+		return ENOMEM;
+	}
+	dl->dl_link(xfer, ref, dl->dl_link_arg);
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_xfer_free
+ *  Description:  Release a transfer,  the easy handle must already be cleaned up.
+ * =====================================================================================
+ */
+static void
+dl_xfer_free( dl_xfer_t *xfer)
+{
+	if( xfer->dx_dl->dl_pool ) {
+		bp_chain_release(xfer->dx_dl->dl_pool, &xfer->dx_body);
+	}
+	curl_slist_free_all(xfer->dx_headers);
+	free(xfer->dx_etag);
+	free(xfer->dx_lx);
+	if( xfer->dx_rf ) {
+		rf_free(xfer->dx_rf);
+		free(xfer->dx_rf);
+	}
+	free(xfer->dx_url);
+	free(xfer);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_resume
+ *  Description:  Unpause the transfers that were stopped because the pool ran out.
+ *                A transfer may pause again straight away if another takes the chunks
+ *                first.
+ * =====================================================================================
+ */
+static void
+dl_resume( dl_t *dl)
+{
+	dl_xfer_t *xfer,
+	          *n;
+	list_for_each_entry_safe(xfer, n, &dl->dl_active, dx_list){
+		if( xfer->dx_paused ) {
+			xfer->dx_paused = false;
+			dl->dl_paused --;
+			curl_easy_pause(xfer->dx_easy, CURLPAUSE_CONT);
+		}
+	}
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_conditional
+ *  Description:  Make the request conditional if the URI has been fetched before,
+ *                If-Modified-Since is sent from uri_mdate and If-None-Match from the
+ *                stored ETag.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+static int
+dl_conditional( dl_xfer_t *xfer)
+{
+	uriobj_t          *uri = xfer->dx_uri;
+	struct curl_slist *headers;
+	char              *line;
+	if( uri->uri_mdate > 0 ) {
+		curl_easy_setopt(xfer->dx_easy, CURLOPT_TIMECONDITION, (long) CURL_TIMECOND_IFMODSINCE);
+		curl_easy_setopt(xfer->dx_easy, CURLOPT_TIMEVALUE, (long) uri->uri_mdate);
+	}
+	if( uri->uri_etag && *uri->uri_etag ) {
+		if( asprintf(&line, "If-None-Match: %s", *uri->uri_etag) < 0 ) {
+			return ENOMEM;
+		}
+		headers = curl_slist_append(xfer->dx_headers, line);
+		free(line);
+		if( ! headers ) {
+			return ENOMEM;
+		}
+		xfer->dx_headers = headers;
+		curl_easy_setopt(xfer->dx_easy, CURLOPT_HTTPHEADER, headers);
+	}
+	return 0;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_header
+ *  Description:  curl header callback.  The status line is checked for 304 so the
+ *                body, if any, is skipped before it arrives and the ETag is kept so it
+ *                can be stored with the URI.  Content-Type and Content-Length are kept
+ *                and the content policy applied at the blank line ending the headers,
+ *                returning 0 there aborts the transfer before any of the body is
+ *                read.  Each response in a redirect chain starts again from its own
+ *                status line.
+ * =====================================================================================
+ */
+static size_t
+dl_header( char *ptr, size_t size, size_t nmemb, void *data)
+{
+	dl_xfer_t *xfer = (dl_xfer_t *) data;
+	size_t     len  = size * nmemb,
+	           n    = 0,
+	           i    = 0;
+	char      *v;
+	if( len > 5 && strncmp(ptr, "HTTP/", 5) == 0 ) {
+		v = memchr(ptr, ' ', len);
+		xfer->dx_status   = v ? atoi(v + 1) : 0;
+		xfer->dx_notmod   = xfer->dx_status == 304;
+		xfer->dx_length   = -1;
+		xfer->dx_limit    = 0;
+		xfer->dx_ctype[0] = '\0';
+		free(xfer->dx_etag);
+		xfer->dx_etag = NULL;
+	}
+	else if( dl_hvalue(ptr, len, "ETag:", &v, &n) ) {
+		free(xfer->dx_etag);
+		xfer->dx_etag = n ? strndup(v, n) : NULL;
+	}
+	else if( dl_hvalue(ptr, len, "Content-Type:", &v, &n) ) {
+		for(; i < n && i < DL_CTYPE_MAX - 1 && v[i] != ';' && ! isspace(v[i]); i ++){
+			xfer->dx_ctype[i] = tolower(v[i]);
+		}
+		xfer->dx_ctype[i] = '\0';
+	}
+	else if( dl_hvalue(ptr, len, "Content-Length:", &v, &n) ) {
+		xfer->dx_length = (curl_off_t) strtoll(v, NULL, 10);
+	}
+	else if( len <= 2 && (*ptr == '\r' || *ptr == '\n') ) {
+		if( xfer->dx_status >= 200 && xfer->dx_status < 300 && dl_policy(xfer->dx_dl, xfer) ) {
+			return 0;
+		}
+	}
+	return len;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_hvalue
+ *  Description:  If the header line is the named header set v and n to its value with
+ *                the surrounding white space removed.  The value is not terminated.
+ * =====================================================================================
+ */
+static bool
+dl_hvalue( char *ptr, size_t len, const char *name, char **v, size_t *n)
+{
+	size_t nlen = strlen(name);
+	if( len < nlen || strncasecmp(ptr, name, nlen) != 0 ) {
+		return false;
+	}
+	*v = ptr + nlen;
+	*n = len - nlen;
+	while( *n && (**v == ' ' || **v == '\t') ) {
+		(*v) ++;
+		(*n) --;
+	}
+	while( *n && isspace((*v)[*n - 1]) ) {
+		(*n) --;
+	}
+	return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_policy
+ *  Description:  Apply the content policy once the headers of a 2xx response are in.
+ *                The first allow list entry matching the media type sets the body
+ *                limit for the rest of the transfer.  Returns true if the transfer is
+ *                to be aborted.
+ * =====================================================================================
+ */
+static bool
+dl_policy( dl_t *dl, dl_xfer_t *xfer)
+{
+	dl_type_t *dt;
+	size_t     len;
+	if( list_empty(&dl->dl_types) ) {
+		return false;
+	}
+	list_for_each_entry(dt, &dl->dl_types, dt_list){
+		len = strlen(dt->dt_type);
+		if( strcmp(dt->dt_type, "*") == 0 || strcasecmp(dt->dt_type, xfer->dx_ctype) == 0 ) {
+			break;
+		}
+		if( dt->dt_type[len - 1] == '/' && strncasecmp(dt->dt_type, xfer->dx_ctype, len) == 0 ) {
+			break;
+		}
+	}
+	if( &dt->dt_list == &dl->dl_types ) {
+		dl_abort(xfer, DL_ABORT_TYPE);
+		return true;
+	}
+	xfer->dx_limit = dt->dt_max;
+	if( xfer->dx_limit && xfer->dx_length > 0 && (size_t) xfer->dx_length > xfer->dx_limit ) {
+		dl_abort(xfer, DL_ABORT_LENGTH);
+		return true;
+	}
+	return false;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  dl_abort
+ *  Description:  Record why the content policy is aborting the transfer.
+ * =====================================================================================
+ */
+static void
+dl_abort( dl_xfer_t *xfer, int reason)
+{
+	xfer->dx_abort = reason;
+	xfer->dx_dl->dl_aborts[reason] ++;
+}
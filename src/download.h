@@ -0,0 +1,163 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  download.h
+ *
+ *    Description:  The downloader.  Transfers are driven through a single curl multi
+ *                  handle,  HTTP/2 is negotiated where the server supports it and
+ *                  requests to the same origin are multiplexed as streams over one
+ *                  connection.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 20:11:02
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS__DOWNLOAD_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef _AZZMOS_UTILS_H_
+#include <azzmos/utils.h>
+#endif
+#ifndef __AZZMOS_LINKEX_H__
+#include <azzmos/linkex.h>
+#endif
+#ifndef __AZZMOS_BUFPOOL_H__
+#include <azzmos/bufpool.h>
+#endif
+
+/*****************************************************************************************
+ * uriresolve imports urinorm which imports the uriobj functions.
+ *****************************************************************************************/
+#ifndef __AZZMOS__URIRESOLVE_H__
+#include <uriresolve.h>
+#endif
+
+/* #####   EXPORTED MACROS   ######################################################## */
+#define DL_MAX_STREAMS     100  /* default concurrent streams per origin */
+#define DL_MAX_HOST_CONNS  1    /* connections per origin, streams share it */
+#define DL_ORIGIN_BUCKETS  256  /* hash buckets for the origin table */
+#define DL_CTYPE_MAX       64   /* longest media type kept from Content-Type */
+
+/*****************************************************************************************
+ * Reasons a transfer is aborted by the content policy,  these index dl_aborts.
+ *****************************************************************************************/
+#define DL_ABORT_TYPE      0    /* Content-Type is not in the allow list */
+#define DL_ABORT_LENGTH    1    /* Content-Length is over the type's limit */
+#define DL_ABORT_SIZE      2    /* bytes received went over the type's limit */
+#define DL_ABORT_REASONS   3
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+
+/*****************************************************************************************
+ * A entry in the content type allow list.  dt_type is a media type such as "text/html",
+ * a major type ending in '/' such as "text/" for any of its subtypes, or "*" for any
+ * type at all.  dt_max is the largest body that
+ * will be downloaded for the type,  zero for no limit.
+ *****************************************************************************************/
+struct dl_type_s {
+	char            *dt_type;     /* media type pattern */
+	size_t           dt_max;      /* body size limit in bytes, 0 for none */
+	struct list_head dt_list;     /* allow list */
+} typedef dl_type_t;
+
+struct dl_origin_s {
+	char            *do_key;      /* scheme://authority of the origin */
+	int              do_streams;  /* streams currently in flight */
+	int              do_peak;     /* highest number of concurrent streams seen */
+	int              do_queued;   /* transfers waiting for a free stream */
+	long             do_total;    /* transfers completed against this origin */
+	long             do_h2;       /* of do_total, how many were carried over HTTP/2 */
+	struct list_head do_pending;  /* transfers waiting for a free stream */
+	struct list_head do_list;     /* origin hash bucket */
+} typedef dl_origin_t;
+
+struct dl_s;
+
+struct dl_xfer_s {
+	struct dl_s     *dx_dl;       /* downloader the transfer belongs to */
+	CURL            *dx_easy;     /* curl easy handle for this transfer */
+	uriobj_t        *dx_uri;      /* normalized URI being fetched */
+	char            *dx_url;      /* recomposed URI string handed to curl */
+	dl_origin_t     *dx_origin;   /* origin the transfer is accounted against */
+	long             dx_code;     /* HTTP response code */
+	int              dx_status;   /* status of the response whose headers are arriving */
+	int              dx_abort;    /* DL_ABORT_ reason or -1 if not aborted by policy */
+	char             dx_ctype[DL_CTYPE_MAX]; /* media type of the response */
+	curl_off_t       dx_length;   /* Content-Length or -1 if not sent */
+	size_t           dx_limit;    /* body size limit for the response, 0 for none */
+	size_t           dx_received; /* body bytes received */
+	CURLcode         dx_result;   /* curl result of the transfer */
+	void            *dx_data;     /* caller data */
+	linkex_t        *dx_lx;       /* link extractor, NULL if links are not wanted */
+	rf_batch_t      *dx_rf;       /* the page's base and links, NULL until a link is seen */
+	bool             dx_rebased;  /* a <base href> has been seen */
+	bool             dx_typed;    /* the content type has been checked */
+	bool             dx_paused;   /* paused waiting for the pool to free a chunk */
+	bool             dx_notmod;   /* 304, the stored copy is still current */
+	char            *dx_etag;     /* ETag of the response */
+	struct curl_slist *dx_headers;/* request headers */
+	bp_chain_t       dx_body;     /* response body when the downloader has a pool */
+	struct list_head dx_list;     /* origin pending list or downloader active list */
+} typedef dl_xfer_t;
+
+/*****************************************************************************************
+ * Called for every transfer once it is complete,  the transfer is cleaned up by the
+ * downloader once the callback returns so nothing in it should be held on to.  The
+ * exception is dx_body,  the callback may take the chain by copying it and calling
+ * bp_chain_init on dx_body,  it then becomes responsible for releasing it.
+ *
+ * When dx_notmod is set the server answered a conditional request with 304,  there is
+ * no body and the page should not be parsed or stored again.  When dx_abort is not -1
+ * the content policy stopped the transfer and dx_result is CURLE_WRITE_ERROR.  A
+ * transfer that waited for a stream and then could not be started is passed with
+ * dx_result CURLE_FAILED_INIT and dx_code zero.
+ *****************************************************************************************/
+typedef void (*dl_done_f)( dl_xfer_t *xfer, void *arg);
+
+/*****************************************************************************************
+ * Called for every link found in a page while it is still downloading,  the href,  src
+ * and action attributes.  Each distinct link on a page is passed once,  resolved against
+ * the page's <base href> if it has one.  ref is the object returned by ref_resolve and
+ * belongs to the callback,  its uri_flags should be checked for URI_INVALID.
+ *****************************************************************************************/
+typedef void (*dl_link_f)( dl_xfer_t *xfer, uriobj_t *ref, void *arg);
+
+struct dl_s {
+	CURLM           *dl_multi;                      /* curl multi handle */
+	long             dl_max_streams;                /* streams allowed per origin */
+	int              dl_running;                    /* transfers added to dl_multi */
+	int              dl_origins;                    /* number of origins in the table */
+	dl_done_f        dl_done;                       /* completion callback */
+	void            *dl_arg;                        /* argument to dl_done */
+	dl_link_f        dl_link;                       /* link callback, NULL for none */
+	void            *dl_link_arg;                   /* argument to dl_link */
+	regexpr_t       *dl_re;                         /* regex used by ref_resolve */
+	bool             dl_strict;                     /* strict argument to ref_resolve */
+	bufpool_t       *dl_pool;                       /* body chunks, NULL to discard bodies */
+	int              dl_paused;                     /* transfers paused on dl_pool */
+	long             dl_notmod;                     /* transfers answered with 304 */
+	long             dl_aborts[DL_ABORT_REASONS];   /* policy aborts by reason */
+	struct list_head dl_types;                      /* content type allow list */
+	struct list_head dl_active;                     /* transfers added to dl_multi */
+	struct list_head dl_otable[DL_ORIGIN_BUCKETS];  /* origin hash table */
+} typedef dl_t;
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern int  dl_init( dl_t *dl, long max_streams, dl_done_f done, void *arg);
+extern void dl_links( dl_t *dl, regexpr_t *re, bool strict, dl_link_f link, void *arg);
+extern void dl_body( dl_t *dl, bufpool_t *pool);
+extern int  dl_allow( dl_t *dl, const char *type, size_t max);
+extern int  dl_add( dl_t *dl, uriobj_t *uri, void *data);
+extern int  dl_perform( dl_t *dl, int timeout_ms);
+extern void dl_stats( dl_t *dl, FILE *fh);
+extern void dl_cleanup( dl_t *dl);
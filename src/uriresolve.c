@@ -21,6 +21,35 @@
 /* #####   HEADER FILE INCLUDES   ################################################### */
 #include <uriresolve.h>
 
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
+#define RF_LOWER(c) (((c) >= 'A' && (c) <= 'Z') ? (c) | 0x20 : (c))
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+struct rf_parts_s {
+	const char *rp_scheme;      /* NULL if the reference has no scheme */
+	size_t      rp_slen;
+	const char *rp_auth;
+	size_t      rp_alen;
+	bool        rp_has_auth;
+	const char *rp_path;
+	size_t      rp_plen;
+	const char *rp_query;
+	size_t      rp_qlen;
+	bool        rp_has_query;
+} typedef rf_parts_t;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
+static void   rf_split( const char *s, size_t n, rf_parts_t *r);
+static int    rf_base( rf_batch_t *rf, rf_parts_t *r);
+static size_t rf_need( rf_batch_t *rf, rf_parts_t *r);
+static size_t rf_build( rf_batch_t *rf, rf_parts_t *r, char *b);
+static size_t rf_copy( char *d, const char *s, size_t n, bool auth);
+static size_t rf_remove_dots( char *p, size_t n);
+static bool   rf_http( const char *s, size_t n);
+static char  *rf_alloc( rf_batch_t *rf, size_t size);
+static void   rf_trim( rf_batch_t *rf, char *p, size_t len);
+static int    rf_seen( rf_batch_t *rf, uint64_t fp);
+
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
 /* 
  * ===  FUNCTION  ======================================================================
@@ -123,4 +152,542 @@ uri_resolve( uriobj_t *uri)
 		*uri->uri_addr = addr;
 	}
 	return gai_error;
-}
\ No newline at end of file
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_init
+ *  Description:  Prepare to resolve the links of a page against base.  The base is
+ *                put together once here,  with the offsets each kind of reference
+ *                needs from it,  so that resolving a link is a copy of a prefix of
+ *                the base and the link.  Returns 0,  EINVAL if the base has no scheme
+ *                or authority or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rf_init( rf_batch_t *rf, uriobj_t *base, bool strict)
+{
+	rf_parts_t r;
+	bzero(rf, sizeof(rf_batch_t));
+	bzero(&r, sizeof(rf_parts_t));
+	rf->rf_strict = strict;
+	if( ! *base->uri_scheme || ! *base->uri_auth ) {
+		return EINVAL;
+	}
+	r.rp_scheme    = *base->uri_scheme;
+	r.rp_slen      = strlen(r.rp_scheme);
+	r.rp_auth      = *base->uri_auth;
+	r.rp_alen      = strlen(r.rp_auth);
+	r.rp_has_auth  = true;
+	r.rp_path      = *base->uri_path ? *base->uri_path : "";
+	r.rp_plen      = strlen(r.rp_path);
+	r.rp_query     = *base->uri_query;
+	r.rp_qlen      = r.rp_query ? strlen(r.rp_query) : 0;
+	r.rp_has_query = r.rp_query != NULL;
+	return rf_base(rf, &r);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_rebase
+ *  Description:  Make the page's <base href> the base for the links after it.  href
+ *                is resolved against the current base first.  Returns 0,  EINVAL if
+ *                it does not resolve to a http or https URI or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rf_rebase( rf_batch_t *rf, const char *href, size_t len)
+{
+	rf_parts_t r;
+	char      *b;
+	size_t     n;
+	int        err;
+	rf_split(href, len, &r);
+	if( r.rp_scheme && ! rf_http(r.rp_scheme, r.rp_slen) ) {
+		return EINVAL;
+	}
+	if( ! (b = (char *) malloc(rf_need(rf, &r))) ) {
+		return ENOMEM;
+	}
+	if( ! (n = rf_build(rf, &r, b)) ) {
+		free(b);
+		return EINVAL;
+	}
+	rf_split(b, n, &r);
+	err = rf_base(rf, &r);
+	free(b);
+	return err;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_resolve
+ *  Description:  Resolve n hrefs against the base after RFC3986 section 5.2.2.  Each
+ *                result has its fragment dropped,  its scheme and host lower cased,
+ *                its dot segments removed and bytes that may not appear in a URI
+ *                percent encoded.  Results that are not http or https and results
+ *                already seen on this page are dropped,  the rest are written to out
+ *                in order and their number to nout.  out must have room for n and its
+ *                strings stay valid until rf_reset or rf_free.  Returns 0 or ENOMEM.
+ * =====================================================================================
+ */
+extern int
+rf_resolve( rf_batch_t *rf, const rf_span_t *hrefs, int n, rf_ref_t *out, int *nout)
+{
+	rf_parts_t  r;
+	const char *s;
+	char       *b;
+	size_t      len;
+	uint64_t    fp;
+	int         err,
+	            i = 0;
+	*nout = 0;
+	for(; i < n; i ++){
+		s   = hrefs[i].rs_ptr;
+		len = hrefs[i].rs_len;
+		while( len && isspace((unsigned char) *s) ) {
+			s ++;
+			len --;
+		}
+		while( len && isspace((unsigned char) s[len - 1]) ) {
+			len --;
+		}
+		rf_split(s, len, &r);
+		if( r.rp_scheme && ! rf_http(r.rp_scheme, r.rp_slen) ) {
+			rf->rf_skipped ++;
+			continue;
+		}
+		if( ! (b = rf_alloc(rf, rf_need(rf, &r))) ) {
+			return ENOMEM;
+		}
+		if( ! (len = rf_build(rf, &r, b)) ) {
+			rf_trim(rf, b, 0);
+			rf->rf_skipped ++;
+			continue;
+		}
+		fp = mem_hash64(b, len);
+		if( (err = rf_seen(rf, fp)) ) {
+			rf_trim(rf, b, 0);
+			if( err != EEXIST ) {
+				return err;
+			}
+			rf->rf_dups ++;
+			continue;
+		}
+		rf_trim(rf, b, len + 1);
+		out[*nout].rr_uri = b;
+		out[*nout].rr_len = len;
+		out[*nout].rr_fp  = fp;
+		(*nout) ++;
+	}
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_reset
+ *  Description:  Forget the URIs resolved so far,  releasing the arena,  so the batch
+ *                can be used for another page with the same base.
+ * =====================================================================================
+ */
+extern void
+rf_reset( rf_batch_t *rf)
+{
+	rf_block_t *k,
+	           *n;
+	for(k = rf->rf_blocks; k; k = n){
+		n = k->rk_next;
+		free(k);
+	}
+	rf->rf_blocks = NULL;
+	if( rf->rf_seen ) {
+		bzero(rf->rf_seen, rf->rf_seen_size * sizeof(uint64_t));
+	}
+	rf->rf_seen_count = 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_free
+ *  Description:  Release the batch and every URI it resolved.
+ * =====================================================================================
+ */
+extern void
+rf_free( rf_batch_t *rf)
+{
+	rf_reset(rf);
+	free(rf->rf_seen);
+	free(rf->rf_self);
+	rf->rf_seen = NULL;
+	rf->rf_self = NULL;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_split
+ *  Description:  Split a reference into the components of RFC3986 appendix B without
+ *                copying it,  the fragment is ignored.
+ * =====================================================================================
+ */
+static void
+rf_split( const char *s, size_t n, rf_parts_t *r)
+{
+	const char *p = s,
+	           *e = s + n,
+	           *q;
+	bzero(r, sizeof(rf_parts_t));
+	for(q = p; q < e && (isalnum((unsigned char) *q) || *q == '+' || *q == '-' || *q == '.'); q ++);
+	if( q < e && q > p && *q == ':' && isalpha((unsigned char) *p) ) {
+		r->rp_scheme = p;
+		r->rp_slen   = q - p;
+		p = q + 1;
+	}
+	if( e - p >= 2 && p[0] == '/' && p[1] == '/' ) {
+		for(p += 2, q = p; q < e && *q != '/' && *q != '?' && *q != '#'; q ++);
+		r->rp_auth     = p;
+		r->rp_alen     = q - p;
+		r->rp_has_auth = true;
+		p = q;
+	}
+	for(q = p; q < e && *q != '?' && *q != '#'; q ++);
+	r->rp_path = p;
+	r->rp_plen = q - p;
+	p = q;
+	if( p < e && *p == '?' ) {
+		for(q = ++ p; q < e && *q != '#'; q ++);
+		r->rp_query     = p;
+		r->rp_qlen      = q - p;
+		r->rp_has_query = true;
+	}
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_base
+ *  Description:  Set the base from the components of a absolute URI and work out the
+ *                prefixes of it that references are joined to.  A empty path is
+ *                taken as "/".
+ * =====================================================================================
+ */
+static int
+rf_base( rf_batch_t *rf, rf_parts_t *r)
+{
+	char  *b;
+	size_t o = 0,
+	       i;
+	if( ! r->rp_scheme || ! r->rp_has_auth ) {
+		return EINVAL;
+	}
+	b = (char *) malloc(r->rp_slen + 3 + 3 * (r->rp_alen + r->rp_plen + r->rp_qlen) + 3);
+	if( ! b ) {
+		return ENOMEM;
+	}
+	for(i = 0; i < r->rp_slen; i ++){
+		b[o ++] = RF_LOWER(r->rp_scheme[i]);
+	}
+	rf->rf_slen = o;
+	b[o ++] = ':';
+	b[o ++] = '/';
+	b[o ++] = '/';
+	o += rf_copy(b + o, r->rp_auth, r->rp_alen, true);
+	rf->rf_plen = o;
+	o += rf_copy(b + o, r->rp_path, r->rp_plen, false);
+	if( o == rf->rf_plen ) {
+		b[o ++] = '/';
+	}
+	o = rf->rf_plen + rf_remove_dots(b + rf->rf_plen, o - rf->rf_plen);
+	rf->rf_qoff = o;
+	for(rf->rf_dlen = o; b[rf->rf_dlen - 1] != '/'; rf->rf_dlen --);
+	if( r->rp_has_query ) {
+		b[o ++] = '?';
+		o += rf_copy(b + o, r->rp_query, r->rp_qlen, false);
+	}
+	b[o] = '\0';
+	free(rf->rf_self);
+	rf->rf_self = b;
+	rf->rf_len  = o;
+	return 0;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_need
+ *  Description:  Bytes that resolving a reference can take at most,  every byte of it
+ *                may be percent encoded and be joined to the whole base.
+ * =====================================================================================
+ */
+static size_t
+rf_need( rf_batch_t *rf, rf_parts_t *r)
+{
+	return rf->rf_len + 3 * (r->rp_slen + r->rp_alen + r->rp_plen + r->rp_qlen) + 8;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_build
+ *  Description:  Write the target of a reference to b,  which has room for rf_need.
+ *                Relative references copy the prefix of the base they need,  only
+ *                one merged with the base path has the base's directory copied.
+ *                Returns the length written or 0 if the target has no authority.
+ * =====================================================================================
+ */
+static size_t
+rf_build( rf_batch_t *rf, rf_parts_t *r, char *b)
+{
+	const char *scheme = r->rp_scheme;
+	size_t      o = 0,
+	            start,
+	            i;
+	/* outside strict mode "http:foo" is "foo" when the base is http */
+	if( scheme && ! rf->rf_strict && ! r->rp_has_auth && r->rp_slen == rf->rf_slen
+			&& strncasecmp(scheme, rf->rf_self, rf->rf_slen) == 0 ) {
+		scheme = NULL;
+	}
+	if( scheme || r->rp_has_auth ) {
+		if( ! r->rp_has_auth ) {
+			return 0;
+		}
+		if( scheme ) {
+			for(i = 0; i < r->rp_slen; i ++){
+				b[o ++] = RF_LOWER(scheme[i]);
+			}
+		}
+		else {
+			memcpy(b, rf->rf_self, rf->rf_slen);
+			o = rf->rf_slen;
+		}
+		b[o ++] = ':';
+		b[o ++] = '/';
+		b[o ++] = '/';
+		o += rf_copy(b + o, r->rp_auth, r->rp_alen, true);
+		start = o;
+		o += rf_copy(b + o, r->rp_path, r->rp_plen, false);
+		if( o == start ) {
+			b[o ++] = '/';
+		}
+		o = start + rf_remove_dots(b + start, o - start);
+	}
+	else if( ! r->rp_plen ) {
+		if( ! r->rp_has_query ) {
+			memcpy(b, rf->rf_self, rf->rf_len + 1);
+			return rf->rf_len;
+		}
+		memcpy(b, rf->rf_self, rf->rf_qoff);
+		o = rf->rf_qoff;
+	}
+	else {
+		/* only the base's directory is needed to merge,  the authority for the rest */
+		o = (r->rp_path[0] == '/') ? rf->rf_plen : rf->rf_dlen;
+		memcpy(b, rf->rf_self, o);
+		o += rf_copy(b + o, r->rp_path, r->rp_plen, false);
+		o  = rf->rf_plen + rf_remove_dots(b + rf->rf_plen, o - rf->rf_plen);
+	}
+	if( r->rp_has_query ) {
+		b[o ++] = '?';
+		o += rf_copy(b + o, r->rp_query, r->rp_qlen, false);
+	}
+	b[o] = '\0';
+	return o;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_copy
+ *  Description:  Copy n bytes percent encoding those that may not appear in a URI and
+ *                upper casing the hex digits of existing escapes.  For a authority
+ *                the host,  everything after any userinfo,  is lower cased.  Returns
+ *                the number of bytes written,  at most 3 * n.
+ * =====================================================================================
+ */
+static size_t
+rf_copy( char *d, const char *s, size_t n, bool auth)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const char       *host  = s;
+	unsigned char     c;
+	size_t            o = 0,
+	                  i = 0;
+	if( auth ) {
+		for(; i < n; i ++){
+			if( s[i] == '@' ) {
+				host = s + i + 1;
+			}
+		}
+		i = 0;
+	}
+	for(; i < n; i ++){
+		c = s[i];
+		if( c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '\\' ) {
+			d[o ++] = '%';
+			d[o ++] = hex[c >> 4];
+			d[o ++] = hex[c & 0x0F];
+		}
+		else if( c == '%' && i + 2 < n && isxdigit((unsigned char) s[i + 1])
+				&& isxdigit((unsigned char) s[i + 2]) ) {
+			d[o ++] = '%';
+			d[o ++] = toupper((unsigned char) s[++ i]);
+			d[o ++] = toupper((unsigned char) s[++ i]);
+		}
+		else {
+			d[o ++] = (auth && s + i >= host) ? RF_LOWER(c) : c;
+		}
+	}
+	return o;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_remove_dots
+ *  Description:  RFC3986 section 5.2.4 in place on a path of n bytes,  returns the new
+ *                length.  The output never grows so it is written over the input.
+ * =====================================================================================
+ */
+static size_t
+rf_remove_dots( char *p, size_t n)
+{
+	size_t i = 0,
+	       o = 0;
+	while( i < n ) {
+		if( n - i >= 3 && strncmp(p + i, "../", 3) == 0 ) {
+			i += 3;
+		}
+		else if( n - i >= 2 && strncmp(p + i, "./", 2) == 0 ) {
+			i += 2;
+		}
+		else if( n - i >= 3 && strncmp(p + i, "/./", 3) == 0 ) {
+			i += 2;
+		}
+		else if( n - i == 2 && strncmp(p + i, "/.", 2) == 0 ) {
+			p[o ++] = '/';
+			i = n;
+		}
+		else if( (n - i >= 4 && strncmp(p + i, "/../", 4) == 0)
+				|| (n - i == 3 && strncmp(p + i, "/..", 3) == 0) ) {
+			/* drop the last segment of the output along with its '/' */
+			while( o && p[o - 1] != '/' ) {
+				o --;
+			}
+			if( o ) {
+				o --;
+			}
+			if( n - i == 3 ) {
+				p[o ++] = '/';
+				i = n;
+			}
+			else {
+				i += 3;
+			}
+		}
+		else if( (n - i == 1 && p[i] == '.') || (n - i == 2 && strncmp(p + i, "..", 2) == 0) ) {
+			i = n;
+		}
+		else {
+			do {
+				p[o ++] = p[i ++];
+			} while( i < n && p[i] != '/' );
+		}
+	}
+	return o;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_http
+ *  Description:  Is the scheme http or https.
+ * =====================================================================================
+ */
+static bool
+rf_http( const char *s, size_t n)
+{
+	return (n == 4 && strncasecmp(s, "http", 4) == 0)
+	    || (n == 5 && strncasecmp(s, "https", 5) == 0);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_alloc
+ *  Description:  Take size bytes from the arena,  starting a new block if the current
+ *                one is full.  Blocks are never moved so earlier results stay valid.
+ * =====================================================================================
+ */
+static char *
+rf_alloc( rf_batch_t *rf, size_t size)
+{
+	rf_block_t *k = rf->rf_blocks;
+	size_t      bs;
+	char       *p;
+	if( ! k || k->rk_size - k->rk_used < size ) {
+		bs = (size > RF_BLOCK_SIZE) ? size : RF_BLOCK_SIZE;
+		if( ! (k = (rf_block_t *) malloc(sizeof(rf_block_t) + bs)) ) {
+			return NULL;
+		}
+		k->rk_size    = bs;
+		k->rk_used    = 0;
+		k->rk_next    = rf->rf_blocks;
+		rf->rf_blocks = k;
+	}
+	p = k->rk_data + k->rk_used;
+	k->rk_used += size;
+	return p;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_trim
+ *  Description:  Shrink the last allocation p to len bytes,  giving the rest back.
+ * =====================================================================================
+ */
+static void
+rf_trim( rf_batch_t *rf, char *p, size_t len)
+{
+	rf->rf_blocks->rk_used = (p - rf->rf_blocks->rk_data) + len;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  rf_seen
+ *  Description:  Add a fingerprint to the page's set.  The set is open addressed with
+ *                linear probing and doubles before it is half full.  Returns 0 if the
+ *                fingerprint is new,  EEXIST if it was already there or ENOMEM.
+ * =====================================================================================
+ */
+static int
+rf_seen( rf_batch_t *rf, uint64_t fp)
+{
+	uint64_t *old  = rf->rf_seen,
+	         *slot;
+	size_t    size = rf->rf_seen_size,
+	          mask,
+	          i;
+	if( ! fp ) {
+		fp = 1;
+	}
+	if( (rf->rf_seen_count + 1) * 2 > size ) {
+		size = size ? size * 2 : RF_SEEN_MIN;
+		if( ! (rf->rf_seen = (uint64_t *) calloc(size, sizeof(uint64_t))) ) {
+			rf->rf_seen = old;
+			return ENOMEM;
+		}
+		rf->rf_seen_size = size;
+		mask = size - 1;
+		for(i = 0; old && i < size / 2; i ++){
+			if( old[i] ) {
+				for(slot = &rf->rf_seen[old[i] & mask]; *slot;
+						slot = &rf->rf_seen[(slot - rf->rf_seen + 1) & mask]);
+				*slot = old[i];
+			}
+		}
+		free(old);
+	}
+	mask = rf->rf_seen_size - 1;
+	for(i = fp & mask; rf->rf_seen[i]; i = (i + 1) & mask){
+		if( rf->rf_seen[i] == fp ) {
+			return EEXIST;
+		}
+	}
+	rf->rf_seen[i] = fp;
+	rf->rf_seen_count ++;
+	return 0;
+}
@@ -3,7 +3,8 @@
  *
  *       Filename:  uriresolve.h
  *
- *    Description:  
+ *    Description:  URI resolution,  single references with ref_resolve and every
+ *                  link of a page against its one base with the rf_ batch functions.
  *
  *        Version:  1.0
  *        Created:  16/09/2010 22:18:11
@@ -33,6 +34,50 @@
 #include <azzmos/urinorm.h>
 #endif
 
+/* #####   EXPORTED MACROS   ######################################################## */
+#define RF_BLOCK_SIZE  65536   /* size of a arena block holding resolved URIs */
+#define RF_SEEN_MIN    256     /* initial size of the fingerprint set of a page */
+
+/* #####   EXPORTED DATA TYPES   #################################################### */
+struct rf_span_s {
+	const char *rs_ptr;         /* href,  need not be '\0' terminated */
+	size_t      rs_len;
+} typedef rf_span_t;
+
+struct rf_ref_s {
+	const char *rr_uri;         /* resolved URI,  '\0' terminated,  in the arena */
+	size_t      rr_len;
+	uint64_t    rr_fp;          /* mem_hash64 fingerprint of rr_uri */
+} typedef rf_ref_t;
+
+struct rf_block_s {
+	struct rf_block_s *rk_next; /* previously filled block */
+	size_t             rk_used; /* bytes of rk_data in use */
+	size_t             rk_size; /* bytes of rk_data */
+	char               rk_data[];
+} typedef rf_block_t;
+
+struct rf_batch_s {
+	char       *rf_self;        /* the base as scheme://authority/path?query */
+	size_t      rf_len;         /* length of rf_self */
+	size_t      rf_slen;        /* length of the scheme */
+	size_t      rf_plen;        /* length up to the end of the authority */
+	size_t      rf_dlen;        /* length up to the last '/' of the path,  the merge prefix */
+	size_t      rf_qoff;        /* length up to the end of the path */
+	bool        rf_strict;      /* as the strict argument to uri_trans_ref */
+	rf_block_t *rf_blocks;      /* arena,  newest block first */
+	uint64_t   *rf_seen;        /* open addressed set of fingerprints,  0 is empty */
+	size_t      rf_seen_size;
+	size_t      rf_seen_count;
+	long        rf_dups;        /* hrefs dropped as duplicates of earlier ones */
+	long        rf_skipped;     /* hrefs dropped as not http or https */
+} typedef rf_batch_t;
+
 /* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
 extern uriobj_t *ref_resolve( uriobj_t *base, char *href, regexpr_t *re, bool strict);
-extern int uri_resolve( uriobj_t *uri);
\ No newline at end of file
+extern int uri_resolve( uriobj_t *uri);
+extern int  rf_init( rf_batch_t *rf, uriobj_t *base, bool strict);
+extern int  rf_rebase( rf_batch_t *rf, const char *href, size_t len);
+extern int  rf_resolve( rf_batch_t *rf, const rf_span_t *hrefs, int n, rf_ref_t *out, int *nout);
+extern void rf_reset( rf_batch_t *rf);
+extern void rf_free( rf_batch_t *rf);
\ No newline at end of file
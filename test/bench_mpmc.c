@@ -0,0 +1,194 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench_mpmc.c
+ *
+ *    Description:  Contention benchmark for mpmc.c.  The same producers and consumers
+ *                  hand items through the lock free queue,  one at a time and in
+ *                  batches,  and through a list_head queue under a mutex with a
+ *                  condition variable,  the way the tree queued work before.
+ *
+ *                  usage: bench_mpmc [threads per side] [items per producer] [batch]
+ *
+ *        Version:  1.0
+ *        Created:  27/10/2026 21:48:12
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <azzmos/mpmc.h>
+
+#define BENCH_RING  1024
+
+struct lq_node_s {
+	void            *ln_data;
+	struct list_head ln_list;
+} typedef lq_node_t;
+
+struct lq_s {
+	pthread_mutex_t  lq_lock;
+	pthread_cond_t   lq_cond;
+	struct list_head lq_list;
+	bool             lq_closed;
+} typedef lq_t;
+
+static mpmc_t mq;
+static lq_t   lq;
+static long   items;
+static int    batch;
+
+static void *
+mq_producer( void *arg)
+{
+	void *b[64];
+	long  i = 0;
+	int   j;
+	(void) arg;
+	for(; i < items; i += batch){
+		for(j = 0; j < batch; j ++){
+			b[j] = (void *) (i + j + 1);
+		}
+		mq_push_n(&mq, b, batch, true);
+	}
+	return NULL;
+}
+
+static void *
+mq_consumer( void *arg)
+{
+	void *b[64];
+	long  sum = 0;
+	int   n,
+	      j;
+	while( (n = mq_pop_n(&mq, b, batch, true)) ) {
+		for(j = 0; j < n; j ++){
+			sum += (long) b[j];
+		}
+	}
+	*(long *) arg = sum;
+	return NULL;
+}
+
+static void *
+lq_producer( void *arg)
+{
+	lq_node_t *n;
+	long       i = 0;
+	(void) arg;
+	for(; i < items; i ++){
+		n = (lq_node_t *) malloc(sizeof(lq_node_t));
+		n->ln_data = (void *) (i + 1);
+		pthread_mutex_lock(&lq.lq_lock);
+		list_add_tail(&n->ln_list, &lq.lq_list);
+		pthread_cond_signal(&lq.lq_cond);
+		pthread_mutex_unlock(&lq.lq_lock);
+	}
+	return NULL;
+}
+
+static void *
+lq_consumer( void *arg)
+{
+	lq_node_t *n;
+	long       sum = 0;
+	for(;;) {
+		pthread_mutex_lock(&lq.lq_lock);
+		while( list_empty(&lq.lq_list) && ! lq.lq_closed ) {
+			pthread_cond_wait(&lq.lq_cond, &lq.lq_lock);
+		}
+		if( list_empty(&lq.lq_list) ) {
+			pthread_mutex_unlock(&lq.lq_lock);
+			break;
+		}
+		n = list_entry(lq.lq_list.next, lq_node_t, ln_list);
+		list_del(&n->ln_list);
+		pthread_mutex_unlock(&lq.lq_lock);
+		sum += (long) n->ln_data;
+		free(n);
+	}
+	*(long *) arg = sum;
+	return NULL;
+}
+
+static double
+run( const char *name, int threads, void *(*prod)(void *), void *(*cons)(void *),
+		void (*close)(void))
+{
+	pthread_t      *p    = (pthread_t *) malloc(2 * threads * sizeof(pthread_t));
+	long           *sums = (long *) calloc(threads, sizeof(long)),
+	                sum  = 0;
+	struct timespec t0,
+	                t1;
+	double          secs;
+	int             i = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(; i < threads; i ++){
+		pthread_create(&p[i], NULL, cons, &sums[i]);
+		pthread_create(&p[threads + i], NULL, prod, NULL);
+	}
+	for(i = 0; i < threads; i ++){
+		pthread_join(p[threads + i], NULL);
+	}
+	close();
+	for(i = 0; i < threads; i ++){
+		pthread_join(p[i], NULL);
+		sum += sums[i];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	fprintf(stdout, "%-20s %3d x %3d  %8.2f Mitems/s%s\n", name, threads, threads,
+			threads * items / secs / 1e6,
+			(sum == threads * (items * (items + 1) / 2)) ? "" : "  CHECKSUM MISMATCH");
+	free(p);
+	free(sums);
+	return secs;
+}
+
+static void
+mq_stop( void)
+{
+	mq_close(&mq);
+}
+
+static void
+lq_stop( void)
+{
+	pthread_mutex_lock(&lq.lq_lock);
+	lq.lq_closed = true;
+	pthread_cond_broadcast(&lq.lq_cond);
+	pthread_mutex_unlock(&lq.lq_lock);
+}
+
+int
+main( int argc, char **argv)
+{
+	int threads = (argc > 1) ? atoi(argv[1]) : 4,
+	    want    = (argc > 3) ? atoi(argv[3]) : 16;
+	items = (argc > 2) ? atol(argv[2]) : 1000000;
+	if( threads < 1 || want < 1 || want > 64 ) {
+		fprintf(stderr, "usage: %s [threads] [items] [batch 1-64]\n", argv[0]);
+		exit(1);
+	}
+	/* producers push whole batches */
+	items -= items % want;
+	batch = 1;
+	mq_init(&mq, BENCH_RING);
+	run("mpmc", threads, mq_producer, mq_consumer, mq_stop);
+	mq_destroy(&mq);
+	batch = want;
+	mq_init(&mq, BENCH_RING);
+	run("mpmc batched", threads, mq_producer, mq_consumer, mq_stop);
+	mq_destroy(&mq);
+	pthread_mutex_init(&lq.lq_lock, NULL);
+	pthread_cond_init(&lq.lq_cond, NULL);
+	INIT_LIST_HEAD(&lq.lq_list);
+	run("mutex list_head", threads, lq_producer, lq_consumer, lq_stop);
+	pthread_cond_destroy(&lq.lq_cond);
+	pthread_mutex_destroy(&lq.lq_lock);
+	exit(0);
+}
@@ -0,0 +1,182 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_bufpool.c
+ *
+ *    Description:  tests the buffer chunk pool in bufpool.c
+ *
+ *        Version:  1.0
+ *        Created:  20/10/2026 20:15:40
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/bufpool.h>
+#include <unistd.h>
+
+struct holder_s {
+	bufpool_t       *pool;
+	int              chunks;   /* taken and put back by the holder */
+	bool             idle;     /* the holder has put its chunks back */
+	bool             release;  /* the holder may exit */
+	pthread_mutex_t  lock;
+	pthread_cond_t   cond;
+} typedef holder_t;
+
+/* 
+ * take chunks and put them back so they sit on this thread's own free list,  then
+ * stay alive without touching the pool until released
+ */
+static void *
+hold( void *arg)
+{
+	holder_t   *h = (holder_t *) arg;
+	bp_chunk_t *chunks[16];
+	int         i;
+	for(i = 0; i < h->chunks; i ++){
+		chunks[i] = bp_get(h->pool, false);
+	}
+	for(i = 0; i < h->chunks; i ++){
+		bp_put(h->pool, chunks[i]);
+	}
+	pthread_mutex_lock(&h->lock);
+	h->idle = true;
+	pthread_cond_broadcast(&h->cond);
+	while( ! h->release ) {
+		pthread_cond_wait(&h->cond, &h->lock);
+	}
+	pthread_mutex_unlock(&h->lock);
+	return NULL;
+}
+
+static void *
+take( void *arg)
+{
+	return bp_get((bufpool_t *) arg, true);
+}
+
+void
+test_bp_chain_write_1( CuTest *tc)
+{
+	bufpool_t   bp;
+	bp_chain_t  chain;
+	bp_chunk_t *chunk;
+	char        buf[250],
+	            out[250];
+	int         i = 0,
+	            n = 0;
+	for(; i < 250; i ++){
+		buf[i] = (char) i;
+	}
+	bp_init(&bp, 64, 64 * 8);
+	bp_chain_init(&chain);
+	CuAssertIntEquals(tc, 0, bp_chain_write(&bp, &chain, buf, 100, false));
+	CuAssertIntEquals(tc, 0, bp_chain_write(&bp, &chain, buf + 100, 150, false));
+	CuAssertIntEquals(tc, 250, chain.ch_len);
+	CuAssertIntEquals(tc, 4, chain.ch_count);
+	bp_chain_for_each(chunk, &chain){
+		memcpy(out + n, chunk->bc_data, chunk->bc_len);
+		n += chunk->bc_len;
+	}
+	CuAssertIntEquals(tc, 0, memcmp(buf, out, 250));
+	bp_chain_release(&bp, &chain);
+	bp_destroy(&bp);
+}
+
+void
+test_bp_chain_write_2( CuTest *tc)
+{
+	bufpool_t  bp;
+	bp_chain_t a,
+	           b;
+	char       buf[256];
+	bp_init(&bp, 64, 64 * 4);
+	bp_chain_init(&a);
+	bp_chain_init(&b);
+	CuAssertIntEquals(tc, 0, bp_chain_write(&bp, &a, buf, 192, false));
+	CuAssertIntEquals(tc, EAGAIN, bp_chain_write(&bp, &b, buf, 128, false));
+	CuAssertIntEquals(tc, 0, b.ch_len);
+	CuAssertTrue(tc, bp_avail(&bp, 64));
+	CuAssertTrue(tc, ! bp_avail(&bp, 65));
+	bp_chain_release(&bp, &a);
+	CuAssertIntEquals(tc, 0, bp_chain_write(&bp, &b, buf, 256, false));
+	CuAssertIntEquals(tc, 4, bp.bp_alloc);
+	bp_chain_release(&bp, &b);
+	bp_destroy(&bp);
+}
+
+void
+test_bp_get_1( CuTest *tc)
+{
+	bufpool_t   bp;
+	holder_t    h;
+	pthread_t   th,
+	            waiter;
+	bp_chunk_t *chunks[4];
+	void       *got;
+	int         i;
+	bp_init(&bp, 64, 64 * 4);
+	bzero(&h, sizeof(holder_t));
+	h.pool   = &bp;
+	h.chunks = 4;
+	pthread_mutex_init(&h.lock, NULL);
+	pthread_cond_init(&h.cond, NULL);
+	pthread_create(&th, NULL, hold, &h);
+	pthread_mutex_lock(&h.lock);
+	while( ! h.idle ) {
+		pthread_cond_wait(&h.cond, &h.lock);
+	}
+	pthread_mutex_unlock(&h.lock);
+	/* every chunk is idle on the other thread's list,  they are still available */
+	CuAssertIntEquals(tc, 4, (int) bp.bp_alloc);
+	CuAssertTrue(tc, bp_avail(&bp, 64 * 4));
+	for(i = 0; i < 4; i ++){
+		chunks[i] = bp_get(&bp, false);
+		CuAssertPtrNotNull(tc, chunks[i]);
+	}
+	CuAssertPtrEquals(tc, NULL, bp_get(&bp, false));
+	/* a waiter is woken by a put even though the chunk goes to this thread's list */
+	pthread_create(&waiter, NULL, take, &bp);
+	usleep(50000);
+	bp_put(&bp, chunks[0]);
+	pthread_join(waiter, &got);
+	CuAssertPtrNotNull(tc, got);
+	bp_put(&bp, (bp_chunk_t *) got);
+	for(i = 1; i < 4; i ++){
+		bp_put(&bp, chunks[i]);
+	}
+	pthread_mutex_lock(&h.lock);
+	h.release = true;
+	pthread_cond_broadcast(&h.cond);
+	pthread_mutex_unlock(&h.lock);
+	pthread_join(th, NULL);
+	bp_destroy(&bp);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_bp_chain_write_1);
+	SUITE_ADD_TEST( suite, test_bp_chain_write_2);
+	SUITE_ADD_TEST( suite, test_bp_get_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,211 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_ckpt.c
+ *
+ *    Description:  tests the checkpoints of ckpt.c and the save and load of the host
+ *                  state and frontier they hold
+ *
+ *        Version:  1.0
+ *        Created:  01/11/2026 21:40:16
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/ckpt.h>
+#include <testuri.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* enough of a parser for the http://host/path URLs the tests save */
+static uriobj_t *
+parse( void *arg, const char *url)
+{
+	const char *host = url + 7,
+	           *path = strchr(host, '/');
+	char        name[64];
+	++ *(int *) arg;
+	if( strncmp(url, "http://", 7) || ! path ) {
+		return NULL;
+	}
+	sprintf(name, "%.*s", (int) (path - host), host);
+	return test_uri(name, path);
+}
+
+static void
+remove_dir( const char *dir)
+{
+	char path[256];
+	int  i = 0;
+	for(; i < 8; i ++){
+		sprintf(path, "%s/MANIFEST.%d", dir, i);
+		unlink(path);
+		sprintf(path, "%s/ck.%d.%s", dir, i, CK_SEEN);
+		unlink(path);
+		sprintf(path, "%s/ck.%d.%s", dir, i, CK_HOSTS);
+		unlink(path);
+		sprintf(path, "%s/ck.%d.%s", dir, i, CK_FRONTIER);
+		unlink(path);
+	}
+	rmdir(dir);
+}
+
+void
+test_ck_restore_1( CuTest *tc)
+{
+	ckpt_t     ck;
+	seen_t     sn;
+	polite_t   pl;
+	frontier_t fr;
+	fr_url_t  *u;
+	pl_host_t *h;
+	uriobj_t  *uris[3];
+	char       dir[] = "/tmp/test_ckpt.XXXXXX";
+	int        parsed = 0,
+	           i      = 0;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	CuAssertIntEquals(tc, 0, ck_init(&ck, dir, 0));
+	CuAssertIntEquals(tc, 0, (int) ck.ck_gen);
+	CuAssertIntEquals(tc, ENOENT, ck_restore(&ck, &sn, NULL, NULL, NULL, NULL));
+	CuAssertTrue(tc, ! ck_due(&ck));
+	/* the state to save */
+	CuAssertIntEquals(tc, 0, sn_init(&sn, 10000, 0.01));
+	for(; i < 1000; i ++){
+		sn_insert(&sn, mem_hash64(&i, sizeof(i)));
+	}
+	pl_init(&pl, 1000, 1);
+	CuAssertIntEquals(tc, 0, pl_set_host(&pl, "slow.example.com", 5000, 2));
+	CuAssertIntEquals(tc, 0, fr_init(&fr, 1, 4));
+	uris[0] = test_uri("a.example.com", "/1");
+	uris[1] = test_uri("a.example.com", "/2");
+	uris[2] = test_uri("b.example.com", "/");
+	CuAssertIntEquals(tc, 0, fr_push(&fr, uris[0], 0, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, uris[1], 2, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, uris[2], 1, NULL));
+	CuAssertIntEquals(tc, 0, fr_set_host(&fr, "b.example.com", 3000));
+	/* a URI being fetched is saved too */
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertIntEquals(tc, 0, ck_save(&ck, &sn, &pl, &fr));
+	CuAssertIntEquals(tc, 1, (int) ck.ck_gen);
+	CuAssertIntEquals(tc, 3, (int) ck.ck_cur.cm_files);
+	fr_done(&fr, u);
+	fr_destroy(&fr);
+	pl_destroy(&pl);
+	sn_free(&sn);
+	for(i = 0; i < 3; i ++){
+		free_uriobj(uris[i]);
+	}
+	ck_free(&ck);
+	/* a restart finds and restores it */
+	CuAssertIntEquals(tc, 0, ck_init(&ck, dir, 0));
+	CuAssertIntEquals(tc, 1, (int) ck.ck_gen);
+	pl_init(&pl, 1000, 1);
+	CuAssertIntEquals(tc, 0, fr_init(&fr, 1, 4));
+	CuAssertIntEquals(tc, 0, ck_restore(&ck, &sn, &pl, &fr, parse, &parsed));
+	CuAssertIntEquals(tc, 3, parsed);
+	for(i = 0; i < 1000; i ++){
+		CuAssertTrue(tc, sn_test(&sn, mem_hash64(&i, sizeof(i))));
+	}
+	h = list_entry(pl.pl_table[hi_lookup("slow.example.com", 16) % PL_HOST_BUCKETS].next,
+			pl_host_t, ph_hash);
+	CuAssertIntEquals(tc, 5000, (int) h->ph_delay);
+	CuAssertIntEquals(tc, 2, h->ph_max);
+	CuAssertIntEquals(tc, 3, (int) fr.fr_queued);
+	for(i = 0; i < 3; i ++){
+		CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+		if( strcmp(*u->fu_uri->uri_host, "b.example.com") == 0 ) {
+			CuAssertIntEquals(tc, 3000, (int) u->fu_back->fb_delay);
+		}
+		free_uriobj(u->fu_uri);
+		fr_done(&fr, u);
+	}
+	fr_destroy(&fr);
+	pl_destroy(&pl);
+	sn_free(&sn);
+	ck_free(&ck);
+	remove_dir(dir);
+}
+
+void
+test_ck_init_1( CuTest *tc)
+{
+	ckpt_t     ck;
+	polite_t   pl;
+	frontier_t fr;
+	char       dir[] = "/tmp/test_ckpt.XXXXXX",
+	           path[256];
+	int        fd,
+	           i = 0;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	pl_init(&pl, 1000, 1);
+	CuAssertIntEquals(tc, 0, ck_init(&ck, dir, 0));
+	/* only the last CK_KEEP generations are kept */
+	for(; i < 4; i ++){
+		CuAssertIntEquals(tc, 0, pl_set_host(&pl, "example.com", 1000 * (i + 1), 1));
+		CuAssertIntEquals(tc, 0, ck_save(&ck, NULL, &pl, NULL));
+	}
+	CuAssertIntEquals(tc, 4, (int) ck.ck_gen);
+	sprintf(path, "%s/MANIFEST.2", dir);
+	CuAssertIntEquals(tc, -1, access(path, F_OK));
+	sprintf(path, "%s/ck.2.%s", dir, CK_HOSTS);
+	CuAssertIntEquals(tc, -1, access(path, F_OK));
+	sprintf(path, "%s/MANIFEST.3", dir);
+	CuAssertIntEquals(tc, 0, access(path, F_OK));
+	ck_free(&ck);
+	pl_destroy(&pl);
+	/* a damaged newest generation and a uncommitted one fall back to generation 3 */
+	sprintf(path, "%s/ck.4.%s", dir, CK_HOSTS);
+	fd = open(path, O_WRONLY);
+	CuAssertTrue(tc, pwrite(fd, "X", 1, 20) == 1);
+	close(fd);
+	sprintf(path, "%s/ck.5.%s.tmp", dir, CK_HOSTS);
+	close(open(path, O_WRONLY | O_CREAT, 0644));
+	CuAssertIntEquals(tc, 0, ck_init(&ck, dir, 0));
+	CuAssertIntEquals(tc, 3, (int) ck.ck_gen);
+	CuAssertIntEquals(tc, -1, access(path, F_OK));
+	sprintf(path, "%s/MANIFEST.4", dir);
+	CuAssertIntEquals(tc, -1, access(path, F_OK));
+	pl_init(&pl, 1000, 1);
+	CuAssertIntEquals(tc, 0, ck_restore(&ck, NULL, &pl, NULL, NULL, NULL));
+	/* generation 3 has no frontier */
+	CuAssertIntEquals(tc, 0, fr_init(&fr, 1, 1));
+	CuAssertIntEquals(tc, ENOENT, ck_restore(&ck, NULL, NULL, &fr, NULL, NULL));
+	fr_destroy(&fr);
+	CuAssertIntEquals(tc, 1, pl.pl_hosts);
+	CuAssertIntEquals(tc, 3000, (int) list_entry(pl.pl_table[hi_lookup("example.com", 11)
+				% PL_HOST_BUCKETS].next, pl_host_t, ph_hash)->ph_delay);
+	pl_destroy(&pl);
+	/* the next generation after a fall back reuses the number */
+	CuAssertIntEquals(tc, 0, ck_save(&ck, NULL, NULL, NULL));
+	CuAssertIntEquals(tc, 4, (int) ck.ck_gen);
+	ck_free(&ck);
+	remove_dir(dir);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_ck_restore_1);
+	SUITE_ADD_TEST( suite, test_ck_init_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,183 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_dbcopy.c
+ *
+ *    Description:  tests the batched COPY writer in dbcopy.c.  Without a database the
+ *                  encoding,  batching and retries are tested against a server that
+ *                  does not exist,  with AZZMOS_TEST_PG set to a conninfo a batch is
+ *                  also written to that database's uri table.
+ *
+ *        Version:  1.0
+ *        Created:  02/11/2026 21:08:47
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/dbcopy.h>
+
+#define NO_SERVER  "host=/nonexistent port=1 connect_timeout=1"
+
+struct rejects_s {
+	int  batches;
+	long rows;
+} typedef rejects_t;
+
+static void
+reject( void *arg, const char *buf, size_t len, long rows)
+{
+	rejects_t *r = (rejects_t *) arg;
+	r->batches ++;
+	r->rows += rows;
+}
+
+void
+test_dc_add_1( CuTest *tc)
+{
+	dbcopy_t    dc;
+	uriobj_t    uri;
+	const char *p;
+	const char  row[] = "\0\6" "\377\377\377\377" "\0\0\0\10" "\1\2\3\4\5\6\7\10"
+	                    "\0\0\0\13" "example.com" "\0\0\0\24" "http://example.com/a"
+	                    "\377\377\377\377" "\377\377\377\377";
+	CuAssertIntEquals(tc, 0, dc_init(&dc, NO_SERVER, 0, 0, 0));
+	CuAssertIntEquals(tc, DC_ROWS, (int) dc.dc_rows);
+	/* a row with no id has a NULL uri_id,  one not fetched NULL validators */
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 0, 0x0102030405060708ULL, "example.com",
+				"http://example.com/a", 20, NULL, 0));
+	CuAssertIntEquals(tc, 1, (int) dc.dc_cur->cb_rows);
+	CuAssertIntEquals(tc, (int) sizeof(row) - 1, (int) dc.dc_cur->cb_len);
+	CuAssertTrue(tc, memcmp(row, dc.dc_cur->cb_buf, sizeof(row) - 1) == 0);
+	/* a URI's row is its id,  fingerprint,  host,  string and validators */
+	init_uriobj_str(&uri);
+	*(uri.uri_scheme) = "http";
+	*(uri.uri_auth)   = "example.com:8080";
+	*(uri.uri_host)   = "example.com";
+	*(uri.uri_path)   = "/b";
+	*(uri.uri_query)  = "q=1";
+	*(uri.uri_etag)   = "\"v1\"";
+	uri.uri_id        = 42;
+	/* 2000-01-02 is one day,  86400000000 microseconds,  after the timestamptz epoch */
+	uri.uri_mdate     = 946771200;
+	CuAssertIntEquals(tc, 0, dc_add_uri(&dc, &uri));
+	CuAssertIntEquals(tc, 2, (int) dc.dc_cur->cb_rows);
+	p = dc.dc_cur->cb_buf + sizeof(row) - 1;
+	CuAssertTrue(tc, memcmp(p, "\0\6\0\0\0\10\0\0\0\0\0\0\0\52", 14) == 0);
+	p += 14 + 12 + 4 + 11;
+	CuAssertTrue(tc, memcmp(p, "\0\0\0\35http://example.com:8080/b?q=1", 33) == 0);
+	p += 33;
+	CuAssertTrue(tc, memcmp(p, "\0\0\0\4\"v1\"" "\0\0\0\10\0\0\0\24\35\327\140\0", 20) == 0);
+	CuAssertIntEquals(tc, (int) (p + 20 - dc.dc_cur->cb_buf), (int) dc.dc_cur->cb_len);
+	/* nothing was due so nothing was sent */
+	CuAssertIntEquals(tc, 0, dc_poll(&dc));
+	CuAssertIntEquals(tc, 2, (int) dc.dc_cur->cb_rows);
+	CuAssertIntEquals(tc, EIO, dc_close(&dc));
+	CuAssertIntEquals(tc, 2, (int) dc.dc_dropped);
+}
+
+void
+test_dc_retry_1( CuTest *tc)
+{
+	dbcopy_t  dc;
+	rejects_t r;
+	int       i = 0;
+	bzero(&r, sizeof(rejects_t));
+	CuAssertIntEquals(tc, 0, dc_init(&dc, NO_SERVER, 2, 0, 0));
+	dc_set_reject(&dc, reject, &r);
+	dc.dc_backoff = 0;
+	/* the second row fills the batch,  its send fails and it waits to be retried */
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 1, 1, "a.com", "http://a.com/", 13, NULL, 0));
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 2, 2, "a.com", "http://a.com/x", 14, NULL, 0));
+	CuAssertIntEquals(tc, 0, (int) dc.dc_cur->cb_rows);
+	CuAssertIntEquals(tc, 1, dc.dc_nfailed);
+	CuAssertIntEquals(tc, 1, (int) dc.dc_retried);
+	/* with no backoff one poll retries it until it is rejected */
+	CuAssertIntEquals(tc, EIO, dc_poll(&dc));
+	CuAssertIntEquals(tc, 0, dc.dc_nfailed);
+	CuAssertIntEquals(tc, DC_RETRIES, (int) dc.dc_retried);
+	CuAssertIntEquals(tc, 1, r.batches);
+	CuAssertIntEquals(tc, 2, (int) r.rows);
+	/* failed batches hold back new rows once there are too many */
+	dc.dc_backoff = 60000;
+	for(; i < 2 * DC_FAILED_MAX; i ++){
+		CuAssertIntEquals(tc, 0, dc_add(&dc, i + 3, i + 3, "a.com", "http://a.com/y", 14, NULL, 0));
+	}
+	CuAssertIntEquals(tc, DC_FAILED_MAX, dc.dc_nfailed);
+	CuAssertIntEquals(tc, ENOBUFS, dc_add(&dc, 99, 99, "a.com", "http://a.com/z", 14, NULL, 0));
+	/* still in their backoff */
+	CuAssertIntEquals(tc, 0, dc_poll(&dc));
+	CuAssertIntEquals(tc, DC_FAILED_MAX, dc.dc_nfailed);
+	CuAssertIntEquals(tc, EIO, dc_close(&dc));
+	CuAssertIntEquals(tc, 1 + DC_FAILED_MAX, r.batches);
+	CuAssertIntEquals(tc, 2 + 2 * DC_FAILED_MAX, (int) r.rows);
+	CuAssertIntEquals(tc, 0, (int) dc.dc_sent);
+}
+
+void
+test_dc_copy_1( CuTest *tc)
+{
+	dbcopy_t    dc;
+	PGconn     *conn;
+	PGresult   *res;
+	const char *conninfo = getenv("AZZMOS_TEST_PG");
+	if( ! conninfo ) {
+		return;
+	}
+	conn = PQconnectdb(conninfo);
+	CuAssertIntEquals(tc, CONNECTION_OK, PQstatus(conn));
+	PQclear(PQexec(conn, "CREATE SEQUENCE IF NOT EXISTS uri_uri_id_seq"));
+	PQclear(PQexec(conn, "CREATE TABLE IF NOT EXISTS uri (uri_id int8 PRIMARY KEY, "
+				"uri_fp int8 NOT NULL UNIQUE, uri_host text NOT NULL, uri_url text NOT NULL, "
+				"uri_etag text, uri_mdate timestamptz)"));
+	PQclear(PQexec(conn, "ALTER TABLE uri ADD COLUMN IF NOT EXISTS uri_etag text, "
+				"ADD COLUMN IF NOT EXISTS uri_mdate timestamptz"));
+	PQclear(PQexec(conn, "DELETE FROM uri WHERE uri_host = 'dbcopy.test'"));
+	CuAssertIntEquals(tc, 0, dc_init(&dc, conninfo, 2, 0, 0));
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 0, 0x7ffffffffff0ULL, "dbcopy.test", "http://dbcopy.test/1", 20, NULL, 0));
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 0, 0x7ffffffffff1ULL, "dbcopy.test", "http://dbcopy.test/2", 20, NULL, 0));
+	/* a URI already stored takes the validators of a fetch,  a link to it in the same
+	 * batch leaves them alone,  rather than either failing the batch */
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 0, 0x7ffffffffff1ULL, "dbcopy.test", "http://dbcopy.test/2", 20,
+				"\"v2\"", 946771200));
+	CuAssertIntEquals(tc, 0, dc_add(&dc, 0, 0x7ffffffffff1ULL, "dbcopy.test", "http://dbcopy.test/2", 20, NULL, 0));
+	CuAssertIntEquals(tc, 0, dc_close(&dc));
+	CuAssertIntEquals(tc, 4, (int) dc.dc_sent);
+	res = PQexec(conn, "SELECT count(*) FROM uri WHERE uri_host = 'dbcopy.test'");
+	CuAssertStrEquals(tc, "2", PQgetvalue(res, 0, 0));
+	PQclear(res);
+	res = PQexec(conn, "SELECT uri_etag, extract(epoch FROM uri_mdate)::int8 FROM uri "
+			"WHERE uri_url = 'http://dbcopy.test/2'");
+	CuAssertStrEquals(tc, "\"v2\"", PQgetvalue(res, 0, 0));
+	CuAssertStrEquals(tc, "946771200", PQgetvalue(res, 0, 1));
+	PQclear(res);
+	PQclear(PQexec(conn, "DELETE FROM uri WHERE uri_host = 'dbcopy.test'"));
+	PQfinish(conn);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_dc_add_1);
+	SUITE_ADD_TEST( suite, test_dc_retry_1);
+	SUITE_ADD_TEST( suite, test_dc_copy_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,221 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_dbexist.c
+ *
+ *    Description:  tests the batched existence check in dbexist.c.  Without a database
+ *                  the LRU and batching are tested with queries that fail,  with
+ *                  AZZMOS_TEST_PG set to a conninfo fingerprints are also looked up
+ *                  in that database's uri table.
+ *
+ *        Version:  1.0
+ *        Created:  05/11/2026 21:12:50
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/dbexist.h>
+#include <unistd.h>
+
+#define NO_SERVER  "host=/nonexistent port=1 connect_timeout=1"
+
+struct answers_s {
+	int      count;
+	int      errors;
+	int      exist;
+	int      err;
+	uint64_t fps;      /* sum of the fingerprints answered */
+} typedef answers_t;
+
+static void
+answer( void *arg, uint64_t fp, bool exists, int err)
+{
+	answers_t *a = (answers_t *) arg;
+	a->fps += fp;
+	if( err ) {
+		a->errors ++;
+		a->err = err;
+	}
+	else if( exists ) {
+		a->exist ++;
+	}
+	__atomic_add_fetch(&a->count, 1, __ATOMIC_SEQ_CST);
+}
+
+/* 
+ * wait up to five seconds for n answers
+ */
+static int
+wait_for( answers_t *a, int n)
+{
+	int i;
+	for(i = 0; i < 5000 && __atomic_load_n(&a->count, __ATOMIC_SEQ_CST) < n; i ++){
+		usleep(1000);
+	}
+	return __atomic_load_n(&a->count, __ATOMIC_SEQ_CST);
+}
+
+void
+test_dx_check_1( CuTest *tc)
+{
+	dbwriter_t dw;
+	dbexist_t  dx;
+	answers_t  a;
+	bool       exists = false;
+	bzero(&a, sizeof(answers_t));
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 0, 0));
+	/* fail statements at once rather than hold them for a server that is not there */
+	dw.dw_hold_ms = 0;
+	CuAssertIntEquals(tc, 0, dx_init(&dx, &dw, 4, 3, 60000));
+	/* noted answers come from the LRU */
+	dx_note(&dx, 1, true);
+	dx_note(&dx, 2, false);
+	CuAssertIntEquals(tc, 0, dx_check(&dx, 1, &exists, answer, &a));
+	CuAssertTrue(tc, exists);
+	CuAssertIntEquals(tc, 0, dx_check(&dx, 2, &exists, answer, &a));
+	CuAssertTrue(tc, ! exists);
+	CuAssertIntEquals(tc, 2, (int) dx.dx_hits);
+	/* a fingerprint already waiting is not asked for twice */
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 10, &exists, answer, &a));
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 11, &exists, answer, &a));
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 10, &exists, answer, &a));
+	CuAssertIntEquals(tc, 2, dx.dx_cur->xb_count);
+	/* not yet due */
+	dx_poll(&dx);
+	CuAssertIntEquals(tc, 2, dx.dx_cur->xb_count);
+	/* the third fills the batch,  its query fails and nothing is cached */
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 12, &exists, answer, &a));
+	CuAssertTrue(tc, dx.dx_cur == NULL);
+	CuAssertIntEquals(tc, 4, wait_for(&a, 4));
+	CuAssertIntEquals(tc, 4, a.errors);
+	CuAssertIntEquals(tc, ENOTCONN, a.err);
+	CuAssertIntEquals(tc, 10 + 11 + 10 + 12, (int) a.fps);
+	CuAssertIntEquals(tc, 1, (int) dx.dx_queries);
+	CuAssertIntEquals(tc, 2, (int) dx.dx_cached);
+	/* the oldest answers are dropped over the cap */
+	dx_note(&dx, 3, true);
+	dx_note(&dx, 4, true);
+	dx_note(&dx, 5, true);
+	CuAssertIntEquals(tc, 4, (int) dx.dx_cached);
+	CuAssertIntEquals(tc, 0, dx_check(&dx, 5, &exists, answer, &a));
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 1, &exists, answer, &a));
+	/* dx_free sends what is left and waits for it */
+	dx_free(&dx);
+	CuAssertIntEquals(tc, 5, a.count);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+}
+
+static void
+ignore( void *arg, PGresult *res, int err)
+{
+}
+
+void
+test_dx_send_1( CuTest *tc)
+{
+	dbwriter_t dw;
+	dbexist_t  dx;
+	answers_t  a;
+	bool       exists = false;
+	int        n = 0,
+	           i;
+	bzero(&a, sizeof(answers_t));
+	/* the writer holds what it takes until it gives up on the server,  fill it and
+	   give its thread time to move what it can from the queue to its backlog */
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 0, 2));
+	for(i = 0; i < 20; i ++){
+		while( dw_submit(&dw, "SELECT 1", 0, NULL, NULL, NULL, ignore, NULL) == 0 ) {
+			n ++;
+		}
+		usleep(5000);
+	}
+	CuAssertIntEquals(tc, 4, n);
+	CuAssertIntEquals(tc, 0, dx_init(&dx, &dw, 0, 1, 0));
+	/* a full batch the writer has no room for is held,  not failed */
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 7, &exists, answer, &a));
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 7, &exists, answer, &a));
+	CuAssertTrue(tc, ! list_empty(&dx.dx_held));
+	CuAssertTrue(tc, dx.dx_cur == NULL);
+	dx_poll(&dx);
+	CuAssertTrue(tc, ! list_empty(&dx.dx_held));
+	CuAssertIntEquals(tc, 0, a.count);
+	CuAssertIntEquals(tc, 0, (int) dx.dx_queries);
+	/* the writer closes,  the held batch is sent again and refused for good */
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	dx_free(&dx);
+	CuAssertIntEquals(tc, 2, a.count);
+	CuAssertIntEquals(tc, ECANCELED, a.err);
+}
+
+void
+test_dx_check_2( CuTest *tc)
+{
+	dbwriter_t  dw;
+	dbexist_t   dx;
+	answers_t   a;
+	PGconn     *conn;
+	bool        exists = false;
+	const char *conninfo = getenv("AZZMOS_TEST_PG");
+	int         i;
+	if( ! conninfo ) {
+		return;
+	}
+	conn = PQconnectdb(conninfo);
+	CuAssertIntEquals(tc, CONNECTION_OK, PQstatus(conn));
+	PQclear(PQexec(conn, "CREATE TABLE IF NOT EXISTS uri (uri_id int8 PRIMARY KEY, "
+				"uri_fp int8 NOT NULL UNIQUE, uri_host text NOT NULL, uri_url text NOT NULL, "
+				"uri_etag text, uri_mdate timestamptz)"));
+	PQclear(PQexec(conn, "DELETE FROM uri WHERE uri_host = 'dbexist.test'"));
+	PQclear(PQexec(conn, "INSERT INTO uri VALUES (-1, 1000001, 'dbexist.test', 'http://dbexist.test/1'), "
+				"(-2, 1000002, 'dbexist.test', 'http://dbexist.test/2'), "
+				"(-3, -1000003, 'dbexist.test', 'http://dbexist.test/3')"));
+	bzero(&a, sizeof(answers_t));
+	CuAssertIntEquals(tc, 0, dw_init(&dw, conninfo, 1, 0, 0));
+	CuAssertIntEquals(tc, 0, dx_init(&dx, &dw, 0, 0, 0));
+	/* one query answers them all,  negative fingerprints included */
+	for(i = 1; i <= 5; i ++){
+		CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, 1000000 + i, &exists, answer, &a));
+	}
+	CuAssertIntEquals(tc, EINPROGRESS, dx_check(&dx, (uint64_t) -1000003LL, &exists, answer, &a));
+	dx_flush(&dx);
+	CuAssertIntEquals(tc, 6, wait_for(&a, 6));
+	CuAssertIntEquals(tc, 0, a.errors);
+	CuAssertIntEquals(tc, 3, a.exist);
+	CuAssertIntEquals(tc, 1, (int) dx.dx_queries);
+	CuAssertIntEquals(tc, 0, dx_check(&dx, 1000002, &exists, answer, &a));
+	CuAssertTrue(tc, exists);
+	CuAssertIntEquals(tc, 0, dx_check(&dx, 1000004, &exists, answer, &a));
+	CuAssertTrue(tc, ! exists);
+	dx_free(&dx);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	PQclear(PQexec(conn, "DELETE FROM uri WHERE uri_host = 'dbexist.test'"));
+	PQfinish(conn);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_dx_check_1);
+	SUITE_ADD_TEST( suite, test_dx_send_1);
+	SUITE_ADD_TEST( suite, test_dx_check_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,191 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_dbwriter.c
+ *
+ *    Description:  tests the asynchronous writer in dbwriter.c.  Without a database
+ *                  statements are failed through their callbacks,  with AZZMOS_TEST_PG
+ *                  set to a conninfo they are also run on that database.
+ *
+ *        Version:  1.0
+ *        Created:  03/11/2026 21:40:06
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/dbwriter.h>
+#include <azzmos/polite.h>
+#include <unistd.h>
+
+#define NO_SERVER  "host=/nonexistent port=1 connect_timeout=1"
+#define STATEMENTS 1000
+
+struct results_s {
+	pthread_t thread;      /* the submitting thread */
+	int       done;
+	int       errors[STATEMENTS];
+	long      values[STATEMENTS];
+	bool      other;       /* every callback ran on another thread */
+} typedef results_t;
+
+struct slot_s {
+	results_t *res;
+	int        i;
+} typedef slot_t;
+
+static void
+done( void *arg, PGresult *res, int err)
+{
+	slot_t    *s = (slot_t *) arg;
+	results_t *r = s->res;
+	r->errors[s->i] = err;
+	if( ! err && PQntuples(res) == 1 ) {
+		r->values[s->i] = atol(PQgetvalue(res, 0, 0));
+	}
+	if( pthread_equal(pthread_self(), r->thread) ) {
+		r->other = false;
+	}
+	__atomic_add_fetch(&r->done, 1, __ATOMIC_SEQ_CST);
+}
+
+void
+test_dw_submit_1( CuTest *tc)
+{
+	dbwriter_t  dw;
+	results_t   r;
+	slot_t      s[8];
+	const char *v[1] = { "1" };
+	int         i;
+	bzero(&r, sizeof(results_t));
+	r.thread = pthread_self();
+	r.other  = true;
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 2, 0, 4));
+	/* with nothing to connect to the statements are held until the close */
+	for(i = 0; i < 8; i ++){
+		s[i].res = &r;
+		s[i].i   = i;
+		while( dw_submit(&dw, "SELECT $1::int8", 1, v, NULL, NULL, done, &s[i]) == EAGAIN ) {
+			usleep(1000);
+		}
+	}
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	CuAssertIntEquals(tc, 8, r.done);
+	CuAssertTrue(tc, r.other);
+	for(i = 0; i < 8; i ++){
+		CuAssertIntEquals(tc, ENOTCONN, r.errors[i]);
+	}
+	CuAssertIntEquals(tc, 8, (int) dw.dw_failed);
+	CuAssertIntEquals(tc, 0, (int) dw.dw_sent);
+}
+
+void
+test_dw_submit_2( CuTest *tc)
+{
+	dbwriter_t dw;
+	results_t  r;
+	slot_t     s;
+	bzero(&r, sizeof(results_t));
+	s.res = &r;
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 1, 2));
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	/* a closed writer takes nothing */
+	CuAssertIntEquals(tc, ECANCELED, dw_submit(&dw, "SELECT 1", 0, NULL, NULL, NULL, done, &s));
+	CuAssertIntEquals(tc, 0, r.done);
+}
+
+void
+test_dw_hold_1( CuTest *tc)
+{
+	dbwriter_t dw;
+	results_t  r;
+	slot_t     s;
+	uint64_t   start;
+	bzero(&r, sizeof(results_t));
+	s.res = &r;
+	s.i   = 0;
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 1, 2));
+	dw.dw_hold_ms = 200;
+	start = pl_now();
+	CuAssertIntEquals(tc, 0, dw_submit(&dw, "SELECT 1", 0, NULL, NULL, NULL, done, &s));
+	/* held across the failed attempt,  then given up on */
+	while( ! __atomic_load_n(&r.done, __ATOMIC_SEQ_CST) && pl_now() - start < 5000 ) {
+		usleep(10000);
+	}
+	CuAssertIntEquals(tc, 1, r.done);
+	CuAssertIntEquals(tc, ENOTCONN, r.errors[0]);
+	CuAssertTrue(tc, pl_now() - start >= 200);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+}
+
+void
+test_dw_pipeline_1( CuTest *tc)
+{
+	dbwriter_t  dw;
+	results_t  *r;
+	slot_t     *s;
+	char        buf[32];
+	const char *v[1] = { buf };
+	const char *conninfo = getenv("AZZMOS_TEST_PG");
+	int         i;
+	if( ! conninfo ) {
+		return;
+	}
+	r = (results_t *) calloc(1, sizeof(results_t));
+	s = (slot_t *) calloc(STATEMENTS, sizeof(slot_t));
+	r->thread = pthread_self();
+	CuAssertIntEquals(tc, 0, dw_init(&dw, conninfo, 2, 0, 0));
+	for(i = 0; i < STATEMENTS; i ++){
+		s[i].res = r;
+		s[i].i   = i;
+		/* the parameter is copied,  buf is reused at once */
+		sprintf(buf, "%d", i);
+		while( dw_submit(&dw, (i == 500) ? "SELECT 1 / ($1::int8 - 500)" : "SELECT $1::int8 + 1",
+					1, v, NULL, NULL, done, &s[i]) == EAGAIN ) {
+			usleep(1000);
+		}
+	}
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	CuAssertIntEquals(tc, STATEMENTS, r->done);
+	/* the failing statement takes no other with it */
+	for(i = 0; i < STATEMENTS; i ++){
+		if( i == 500 ) {
+			CuAssertIntEquals(tc, EIO, r->errors[i]);
+		}
+		else {
+			CuAssertIntEquals(tc, 0, r->errors[i]);
+			CuAssertIntEquals(tc, i + 1, (int) r->values[i]);
+		}
+	}
+	CuAssertIntEquals(tc, 1, (int) dw.dw_failed);
+	free(s);
+	free(r);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_dw_submit_1);
+	SUITE_ADD_TEST( suite, test_dw_submit_2);
+	SUITE_ADD_TEST( suite, test_dw_hold_1);
+	SUITE_ADD_TEST( suite, test_dw_pipeline_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
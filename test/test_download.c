@@ -0,0 +1,251 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_download.c
+ *
+ *    Description:  tests the downloader in download.c without a server.  The source is
+ *                  included so the curl callbacks can be driven directly,  transfers
+ *                  are added but dl_perform is never called.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 21:40:12
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <download.c>
+#include <testuri.h>
+
+/*
+ * Feed one header line to the transfer as curl would,  true if it was accepted.
+ */
+static bool
+header( dl_xfer_t *xfer, const char *line)
+{
+	char   buf[256];
+	size_t len = strlen(line);
+	memcpy(buf, line, len);
+	return dl_header(buf, 1, len, xfer) == len;
+}
+
+static dl_xfer_t *
+first_xfer( dl_t *dl)
+{
+	return list_entry(dl->dl_active.next, dl_xfer_t, dx_list);
+}
+
+void
+test_dl_add_1( CuTest *tc)
+{
+	dl_t         dl;
+	dl_origin_t *o;
+	uriobj_t    *a = test_uri("a.example.com", "/1"),
+	            *b = test_uri("a.example.com", "/2"),
+	            *c = test_uri("a.example.com", "/3"),
+	            *d = test_uri("b.example.com", "/1");
+	char         buf[1024];
+	FILE        *fh;
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 2, NULL, NULL));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, a, NULL));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, b, NULL));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, c, NULL));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, d, NULL));
+	/* the third transfer to a origin waits for one of its two streams */
+	o = dl_origin(&dl, a);
+	CuAssertIntEquals(tc, 2, o->do_streams);
+	CuAssertIntEquals(tc, 2, o->do_peak);
+	CuAssertIntEquals(tc, 1, o->do_queued);
+	CuAssertPtrEquals(tc, c, list_entry(o->do_pending.next, dl_xfer_t, dx_list)->dx_uri);
+	/* the other origin is not held up by it */
+	o = dl_origin(&dl, d);
+	CuAssertIntEquals(tc, 1, o->do_streams);
+	CuAssertIntEquals(tc, 0, o->do_queued);
+	CuAssertIntEquals(tc, 2, dl.dl_origins);
+	CuAssertIntEquals(tc, 3, dl.dl_running);
+	fh = tmpfile();
+	dl_stats(&dl, fh);
+	rewind(fh);
+	buf[fread(buf, 1, sizeof(buf) - 1, fh)] = '\0';
+	fclose(fh);
+	CuAssertTrue(tc, strstr(buf, "http://a.example.com streams=2 peak=2 queued=1") != NULL);
+	CuAssertTrue(tc, strstr(buf, "http://b.example.com streams=1 peak=1 queued=0") != NULL);
+	dl_cleanup(&dl);
+	free_uriobj(a);
+	free_uriobj(b);
+	free_uriobj(c);
+	free_uriobj(d);
+}
+
+void
+test_dl_conditional_1( CuTest *tc)
+{
+	dl_t       dl;
+	dl_xfer_t *xfer;
+	uriobj_t  *a = test_uri("a.example.com", "/"),
+	          *b = test_uri("b.example.com", "/");
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 0, NULL, NULL));
+	/* a URI never fetched is asked for unconditionally */
+	CuAssertIntEquals(tc, 0, dl_add(&dl, a, NULL));
+	CuAssertPtrEquals(tc, NULL, first_xfer(&dl)->dx_headers);
+	dl_cleanup(&dl);
+	/* one with a stored ETag sends it back as If-None-Match */
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 0, NULL, NULL));
+	*(b->uri_etag) = strdup("\"v1\"");
+	b->uri_mdate   = 946771200;
+	CuAssertIntEquals(tc, 0, dl_add(&dl, b, NULL));
+	xfer = first_xfer(&dl);
+	CuAssertPtrNotNull(tc, xfer->dx_headers);
+	CuAssertStrEquals(tc, "If-None-Match: \"v1\"", xfer->dx_headers->data);
+	CuAssertPtrEquals(tc, NULL, xfer->dx_headers->next);
+	dl_cleanup(&dl);
+	free_uriobj(a);
+	free_uriobj(b);
+}
+
+void
+test_dl_header_1( CuTest *tc)
+{
+	dl_t       dl;
+	dl_xfer_t *xfer;
+	uriobj_t  *a = test_uri("a.example.com", "/");
+	char       body[] = "<html></html>";
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 0, NULL, NULL));
+	/* even a type the policy refuses is not aborted on a 304 */
+	CuAssertIntEquals(tc, 0, dl_allow(&dl, "image/", 0));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, a, NULL));
+	xfer = first_xfer(&dl);
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 304 Not Modified\r\n"));
+	CuAssertTrue(tc, header(xfer, "ETag:  \"v2\" \r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: text/html\r\n"));
+	CuAssertTrue(tc, header(xfer, "\r\n"));
+	CuAssertTrue(tc, xfer->dx_notmod);
+	CuAssertIntEquals(tc, -1, xfer->dx_abort);
+	CuAssertStrEquals(tc, "\"v2\"", xfer->dx_etag);
+	/* a body sent anyway is skipped */
+	CuAssertIntEquals(tc, (int) strlen(body), (int) dl_write(body, 1, strlen(body), xfer));
+	CuAssertIntEquals(tc, 0, (int) xfer->dx_received);
+	/* each response of a redirect chain starts from its own status line */
+	CuAssertTrue(tc, header(xfer, "HTTP/2 200\r\n"));
+	CuAssertTrue(tc, ! xfer->dx_notmod);
+	CuAssertPtrEquals(tc, NULL, xfer->dx_etag);
+	CuAssertIntEquals(tc, 200, xfer->dx_status);
+	dl_cleanup(&dl);
+	free_uriobj(a);
+}
+
+void
+test_dl_policy_1( CuTest *tc)
+{
+	dl_t       dl;
+	dl_xfer_t *xfer;
+	uriobj_t  *a = test_uri("a.example.com", "/");
+	char       body[600];
+	memset(body, 'x', sizeof(body));
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 0, NULL, NULL));
+	CuAssertIntEquals(tc, 0, dl_allow(&dl, "text/html", 1000));
+	CuAssertIntEquals(tc, 0, dl_allow(&dl, "image/", 0));
+	CuAssertIntEquals(tc, 0, dl_add(&dl, a, NULL));
+	xfer = first_xfer(&dl);
+	/* a type not on the list is aborted at the end of the headers */
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: application/octet-stream\r\n"));
+	CuAssertTrue(tc, ! header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, DL_ABORT_TYPE, xfer->dx_abort);
+	/* as is a Content-Length over the type's limit,  parameters are ignored */
+	xfer->dx_abort = -1;
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: TEXT/HTML; charset=utf-8\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Length: 5000\r\n"));
+	CuAssertTrue(tc, ! header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, DL_ABORT_LENGTH, xfer->dx_abort);
+	/* without a length the body is stopped once it grows past the limit */
+	xfer->dx_abort = -1;
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: text/html\r\n"));
+	CuAssertTrue(tc, header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, 1000, (int) xfer->dx_limit);
+	CuAssertIntEquals(tc, 600, (int) dl_write(body, 1, 600, xfer));
+	CuAssertIntEquals(tc, 0, (int) dl_write(body, 1, 600, xfer));
+	CuAssertIntEquals(tc, DL_ABORT_SIZE, xfer->dx_abort);
+	/* a major type allows its subtypes with no limit */
+	xfer->dx_abort    = -1;
+	xfer->dx_received = 0;
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: image/png\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Length: 50000000\r\n"));
+	CuAssertTrue(tc, header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, 600, (int) dl_write(body, 1, 600, xfer));
+	CuAssertIntEquals(tc, -1, xfer->dx_abort);
+	/* and responses other than 2xx are not judged */
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 404 Not Found\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: application/json\r\n"));
+	CuAssertTrue(tc, header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, -1, xfer->dx_abort);
+	CuAssertIntEquals(tc, 1, (int) dl.dl_aborts[DL_ABORT_TYPE]);
+	CuAssertIntEquals(tc, 1, (int) dl.dl_aborts[DL_ABORT_LENGTH]);
+	CuAssertIntEquals(tc, 1, (int) dl.dl_aborts[DL_ABORT_SIZE]);
+	dl_cleanup(&dl);
+	free_uriobj(a);
+}
+
+void
+test_dl_policy_2( CuTest *tc)
+{
+	dl_t       dl;
+	dl_xfer_t *xfer;
+	uriobj_t  *a = test_uri("a.example.com", "/");
+	CuAssertIntEquals(tc, 0, dl_init(&dl, 0, NULL, NULL));
+	/* an empty type is refused and leaves the list empty */
+	CuAssertIntEquals(tc, EINVAL, dl_allow(&dl, "", 0));
+	CuAssertIntEquals(tc, EINVAL, dl_allow(&dl, NULL, 0));
+	/* with no allow list every type and size is fetched */
+	CuAssertIntEquals(tc, 0, dl_add(&dl, a, NULL));
+	xfer = first_xfer(&dl);
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: application/x-iso9660-image\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Length: 2000000000\r\n"));
+	CuAssertTrue(tc, header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, -1, xfer->dx_abort);
+	CuAssertIntEquals(tc, 0, (int) xfer->dx_limit);
+	/* "*" allows any type but still sets a limit */
+	CuAssertIntEquals(tc, 0, dl_allow(&dl, "*", 1000000));
+	CuAssertTrue(tc, header(xfer, "HTTP/1.1 200 OK\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Type: application/x-iso9660-image\r\n"));
+	CuAssertTrue(tc, header(xfer, "Content-Length: 2000000000\r\n"));
+	CuAssertTrue(tc, ! header(xfer, "\r\n"));
+	CuAssertIntEquals(tc, DL_ABORT_LENGTH, xfer->dx_abort);
+	dl_cleanup(&dl);
+	free_uriobj(a);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_dl_add_1);
+	SUITE_ADD_TEST( suite, test_dl_conditional_1);
+	SUITE_ADD_TEST( suite, test_dl_header_1);
+	SUITE_ADD_TEST( suite, test_dl_policy_1);
+	SUITE_ADD_TEST( suite, test_dl_policy_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	curl_global_init(CURL_GLOBAL_ALL);
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	curl_global_cleanup();
+	exit(suite->failCount);
+}
@@ -0,0 +1,123 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_frontier.c
+ *
+ *    Description:  tests the two level frontier in frontier.c
+ *
+ *        Version:  1.0
+ *        Created:  26/10/2026 21:22:36
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/frontier.h>
+#include <testuri.h>
+
+void
+test_fr_pop_1( CuTest *tc)
+{
+	frontier_t fr;
+	fr_url_t  *u;
+	uriobj_t  *a = test_uri("a.com", NULL),
+	          *b = test_uri("b.com", NULL),
+	          *c = test_uri("c.com", NULL),
+	          *d = test_uri("d.com", NULL);
+	/* with one back queue the front queues decide the order */
+	CuAssertIntEquals(tc, 0, fr_init(&fr, 1, 1));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, a, 3, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, b, 0, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, c, 3, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, d, 0, NULL));
+	CuAssertIntEquals(tc, 1, fr.fr_active);
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertPtrEquals(tc, a, u->fu_uri);
+	/* the only back queue is busy */
+	CuAssertIntEquals(tc, EAGAIN, fr_pop(&fr, false, &u));
+	fr_done(&fr, u);
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertPtrEquals(tc, b, u->fu_uri);
+	fr_done(&fr, u);
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertPtrEquals(tc, d, u->fu_uri);
+	fr_done(&fr, u);
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertPtrEquals(tc, c, u->fu_uri);
+	fr_done(&fr, u);
+	CuAssertIntEquals(tc, 0, fr.fr_active);
+	CuAssertIntEquals(tc, 0, (int) fr.fr_queued);
+	fr_destroy(&fr);
+	free_uriobj(a);
+	free_uriobj(b);
+	free_uriobj(c);
+	free_uriobj(d);
+}
+
+void
+test_fr_pop_2( CuTest *tc)
+{
+	frontier_t fr;
+	fr_url_t  *u,
+	          *v;
+	uriobj_t  *a1 = test_uri("a.com", NULL),
+	          *a2 = test_uri("a.com", NULL),
+	          *b  = test_uri("b.com", NULL);
+	uint64_t   start;
+	CuAssertIntEquals(tc, 0, fr_init(&fr, 50, 0));
+	CuAssertIntEquals(tc, 0, fr_set_host(&fr, "b.com", 200));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, a1, 0, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, a2, 1, NULL));
+	CuAssertIntEquals(tc, 0, fr_push(&fr, b, 2, NULL));
+	CuAssertIntEquals(tc, 2, fr.fr_active);
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, false, &u));
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, false, &v));
+	CuAssertTrue(tc, u->fu_back != v->fu_back);
+	if( u->fu_uri == b ) {
+		fr_url_t *t = u;
+		u = v;
+		v = t;
+	}
+	CuAssertPtrEquals(tc, a1, u->fu_uri);
+	fr_done(&fr, u);
+	fr_done(&fr, v);
+	/* a.com's second URI waits out its delay */
+	start = pl_now();
+	CuAssertIntEquals(tc, EAGAIN, fr_pop(&fr, false, &u));
+	CuAssertIntEquals(tc, 0, fr_pop(&fr, true, &u));
+	CuAssertPtrEquals(tc, a2, u->fu_uri);
+	CuAssertTrue(tc, pl_now() - start >= 40);
+	fr_done(&fr, u);
+	fr_close(&fr);
+	CuAssertIntEquals(tc, ECANCELED, fr_pop(&fr, true, &u));
+	fr_destroy(&fr);
+	free_uriobj(a1);
+	free_uriobj(a2);
+	free_uriobj(b);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_fr_pop_1);
+	SUITE_ADD_TEST( suite, test_fr_pop_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
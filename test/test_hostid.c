@@ -0,0 +1,122 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_hostid.c
+ *
+ *    Description:  tests the host interning table in hostid.c
+ *
+ *        Version:  1.0
+ *        Created:  29/10/2026 20:41:09
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/hostid.h>
+
+#define THREADS 4
+#define HOSTS   20000
+
+static uint32_t ids[THREADS][HOSTS];
+
+static void *
+intern_all( void *arg)
+{
+	uint32_t *out = (uint32_t *) arg;
+	char      host[32];
+	int       i   = 0;
+	for(; i < HOSTS; i ++){
+		snprintf(host, sizeof(host), "host%d.example.com", i);
+		out[i] = hi_intern(host, strlen(host));
+	}
+	return NULL;
+}
+
+void
+test_hi_intern_1( CuTest *tc)
+{
+	uint32_t a = hi_intern("example.com", 11),
+	         b = hi_intern("www.example.com", 15);
+	CuAssertTrue(tc, a != HI_NONE);
+	CuAssertTrue(tc, b != HI_NONE && b != a);
+	/* only the len bytes given are the host */
+	CuAssertIntEquals(tc, a, hi_intern("example.com:80", 11));
+	CuAssertIntEquals(tc, a, hi_lookup("example.com", 11));
+	CuAssertIntEquals(tc, HI_NONE, hi_lookup("example.org", 11));
+	CuAssertIntEquals(tc, HI_NONE, hi_intern("", 0));
+	CuAssertStrEquals(tc, "example.com", hi_name(a));
+	/* one shared copy of the name */
+	CuAssertPtrEquals(tc, (void *) hi_name(a), (void *) hi_name(hi_intern("example.com", 11)));
+	CuAssertPtrEquals(tc, NULL, (void *) hi_name(HI_NONE));
+	CuAssertPtrEquals(tc, NULL, (void *) hi_name(hi_count() + 1));
+}
+
+void
+test_hi_intern_2( CuTest *tc)
+{
+	pthread_t th[THREADS];
+	uint32_t  before = hi_count();
+	char      host[32];
+	int       i      = 0,
+	          j;
+	for(; i < THREADS; i ++){
+		pthread_create(&th[i], NULL, intern_all, ids[i]);
+	}
+	for(i = 0; i < THREADS; i ++){
+		pthread_join(th[i], NULL);
+	}
+	/* every thread got the same id for a host and each host was added once */
+	CuAssertIntEquals(tc, before + HOSTS, hi_count());
+	for(i = 0; i < HOSTS; i ++){
+		CuAssertTrue(tc, ids[0][i] != HI_NONE);
+		for(j = 1; j < THREADS; j ++){
+			CuAssertIntEquals(tc, ids[0][i], ids[j][i]);
+		}
+		snprintf(host, sizeof(host), "host%d.example.com", i);
+		CuAssertStrEquals(tc, host, hi_name(ids[0][i]));
+	}
+}
+
+void
+test_hi_uri_1( CuTest *tc)
+{
+	uriobj_t *uri = (uriobj_t *) malloc(sizeof(uriobj_t));
+	init_uriobj_str(uri);
+	*(uri->uri_host) = strdup("example.com");
+	*(uri->uri_ip)   = strdup("192.0.2.1");
+	uri->uri_flags   = URI_REGNAME;
+	CuAssertIntEquals(tc, hi_lookup("example.com", 11), hi_uri(uri));
+	CuAssertIntEquals(tc, uri->uri_hostid, hi_uri(uri));
+	/* a IP literal is keyed on the address */
+	uri->uri_hostid = 0;
+	uri->uri_flags  = URI_IP;
+	CuAssertStrEquals(tc, "192.0.2.1", hi_name(hi_uri(uri)));
+	free_uriobj(uri);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_hi_intern_1);
+	SUITE_ADD_TEST( suite, test_hi_intern_2);
+	SUITE_ADD_TEST( suite, test_hi_uri_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
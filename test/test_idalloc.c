@@ -0,0 +1,224 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_idalloc.c
+ *
+ *    Description:  tests the uri_id allocator in idalloc.c.  Without a database ranges
+ *                  are added by hand and the requests for more fail,  with
+ *                  AZZMOS_TEST_PG set to a conninfo ranges are reserved from a
+ *                  sequence on that database.
+ *
+ *        Version:  1.0
+ *        Created:  04/11/2026 20:05:13
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/idalloc.h>
+#include <unistd.h>
+
+#define NO_SERVER  "host=/nonexistent port=1 connect_timeout=1"
+#define THREADS    4
+#define IDS        1000
+
+struct taker_s {
+	idalloc_t *ia;
+	bool       wait;
+	int64_t    ids[IDS];
+	int        err;
+} typedef taker_t;
+
+static void *
+take( void *arg)
+{
+	taker_t *t = (taker_t *) arg;
+	int      i;
+	for(i = 0; i < IDS && ! t->err; i ++){
+		t->err = ia_next(t->ia, t->wait, &t->ids[i]);
+	}
+	return NULL;
+}
+
+static int
+cmp_id( const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a,
+	        y = *(const int64_t *) b;
+	return (x > y) - (x < y);
+}
+
+/* 
+ * every id taken by the threads is distinct and in [first, end)
+ */
+static void
+check_ids( CuTest *tc, taker_t *t, int64_t first, int64_t end)
+{
+	int64_t *all = (int64_t *) malloc(THREADS * IDS * sizeof(int64_t));
+	int      i;
+	for(i = 0; i < THREADS; i ++){
+		CuAssertIntEquals(tc, 0, t[i].err);
+		memcpy(all + i * IDS, t[i].ids, IDS * sizeof(int64_t));
+	}
+	qsort(all, THREADS * IDS, sizeof(int64_t), cmp_id);
+	CuAssertTrue(tc, all[0] >= first);
+	CuAssertTrue(tc, all[THREADS * IDS - 1] < end);
+	for(i = 1; i < THREADS * IDS; i ++){
+		CuAssertTrue(tc, all[i - 1] < all[i]);
+	}
+	free(all);
+}
+
+void
+test_ia_next_1( CuTest *tc)
+{
+	dbwriter_t dw;
+	idalloc_t  ia;
+	taker_t    t[THREADS];
+	pthread_t  th[THREADS];
+	int64_t    id;
+	int        i,
+	           err;
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 0, 0));
+	/* fail statements at once rather than hold them for a server that is not there */
+	dw.dw_hold_ms = 0;
+	CuAssertIntEquals(tc, 0, ia_init(&ia, &dw, NULL));
+	/* the request made by ia_init fails and there is nothing to wait for */
+	CuAssertIntEquals(tc, ENOTCONN, ia_next(&ia, true, &id));
+	CuAssertIntEquals(tc, EINVAL, ia_add_range(&ia, 1, 0));
+	CuAssertIntEquals(tc, 0, ia_add_range(&ia, 100, 10000));
+	/* threads take ids from their own caches */
+	bzero(t, sizeof(t));
+	for(i = 0; i < THREADS; i ++){
+		t[i].ia = &ia;
+		pthread_create(&th[i], NULL, take, &t[i]);
+	}
+	for(i = 0; i < THREADS; i ++){
+		pthread_join(th[i], NULL);
+	}
+	check_ids(tc, t, 100, 10100);
+	/* one range waits behind the current one */
+	CuAssertIntEquals(tc, 0, ia_add_range(&ia, 50000, 10));
+	CuAssertIntEquals(tc, EBUSY, ia_add_range(&ia, 60000, 10));
+	CuAssertIntEquals(tc, 2, (int) ia.ia_ranges);
+	/* the current range runs out,  then the spare */
+	while( ! (err = ia_next(&ia, false, &id)) && id < 50000 );
+	CuAssertIntEquals(tc, 0, err);
+	CuAssertIntEquals(tc, 50000, (int) id);
+	for(i = 1; i < 10; i ++){
+		CuAssertIntEquals(tc, 0, ia_next(&ia, false, &id));
+		CuAssertIntEquals(tc, 50000 + i, (int) id);
+	}
+	CuAssertIntEquals(tc, ENOTCONN, ia_next(&ia, true, &id));
+	ia_free(&ia);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+}
+
+void
+test_ia_next_2( CuTest *tc)
+{
+	dbwriter_t  dw;
+	idalloc_t   ia;
+	taker_t     t[THREADS];
+	pthread_t   th[THREADS];
+	PGconn     *conn;
+	PGresult   *res;
+	int64_t     first;
+	const char *conninfo = getenv("AZZMOS_TEST_PG");
+	int         i;
+	if( ! conninfo ) {
+		return;
+	}
+	conn = PQconnectdb(conninfo);
+	CuAssertIntEquals(tc, CONNECTION_OK, PQstatus(conn));
+	PQclear(PQexec(conn, "DROP SEQUENCE IF EXISTS idalloc_test_seq"));
+	PQclear(PQexec(conn, "CREATE SEQUENCE idalloc_test_seq INCREMENT BY 500"));
+	res   = PQexec(conn, "SELECT nextval('idalloc_test_seq')");
+	first = strtoll(PQgetvalue(res, 0, 0), NULL, 10) + 500;
+	PQclear(res);
+	CuAssertIntEquals(tc, 0, dw_init(&dw, conninfo, 1, 0, 0));
+	CuAssertIntEquals(tc, 0, ia_init(&ia, &dw, "idalloc_test_seq"));
+	/* several ranges are needed,  waiting when the next has not arrived */
+	bzero(t, sizeof(t));
+	for(i = 0; i < THREADS; i ++){
+		t[i].ia   = &ia;
+		t[i].wait = true;
+		pthread_create(&th[i], NULL, take, &t[i]);
+	}
+	for(i = 0; i < THREADS; i ++){
+		pthread_join(th[i], NULL);
+	}
+	check_ids(tc, t, first, first + 500 * ia.ia_ranges);
+	CuAssertTrue(tc, ia.ia_ranges >= THREADS * IDS / 500);
+	ia_free(&ia);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	PQclear(PQexec(conn, "DROP SEQUENCE idalloc_test_seq"));
+	PQfinish(conn);
+}
+
+static void
+ignore( void *arg, PGresult *res, int err)
+{
+}
+
+static void *
+add_later( void *arg)
+{
+	usleep(50000);
+	ia_add_range((idalloc_t *) arg, 700, 10);
+	return NULL;
+}
+
+void
+test_ia_next_3( CuTest *tc)
+{
+	dbwriter_t dw;
+	idalloc_t  ia;
+	pthread_t  th;
+	int64_t    id;
+	int        i;
+	/* the writer holds what it takes until it gives up on the server,  fill it */
+	CuAssertIntEquals(tc, 0, dw_init(&dw, NO_SERVER, 1, 0, 2));
+	for(i = 0; i < 20; i ++){
+		while( dw_submit(&dw, "SELECT 1", 0, NULL, NULL, NULL, ignore, NULL) == 0 );
+		usleep(5000);
+	}
+	/* the request made by ia_init found no room,  that is not a failure */
+	CuAssertIntEquals(tc, 0, ia_init(&ia, &dw, NULL));
+	CuAssertIntEquals(tc, EAGAIN, ia_next(&ia, false, &id));
+	CuAssertIntEquals(tc, EAGAIN, ia.ia_err);
+	/* a waiter keeps asking until a range turns up */
+	pthread_create(&th, NULL, add_later, &ia);
+	CuAssertIntEquals(tc, 0, ia_next(&ia, true, &id));
+	CuAssertIntEquals(tc, 700, (int) id);
+	pthread_join(th, NULL);
+	CuAssertIntEquals(tc, 0, dw_close(&dw));
+	ia_free(&ia);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_ia_next_1);
+	SUITE_ADD_TEST( suite, test_ia_next_2);
+	SUITE_ADD_TEST( suite, test_ia_next_3);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
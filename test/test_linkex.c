@@ -0,0 +1,172 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_linkex.c
+ *
+ *    Description:  tests the incremental link extractor in linkex.c
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 21:40:12
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/linkex.h>
+
+#define PAGE "<html><head><!-- <a href=\"/comment\"> -->" \
+	     "<script>var s = '<a href=\"/script\">';</script>" \
+	     "<link rel=stylesheet HREF='/style.css'></head>" \
+	     "<body><a class=x href = \"/a/b c\" >one</a>" \
+	     "<a href=/unquoted>two</a><img src=\"/img.png\">" \
+	     "<a name=anchor>three</a><A HREF=\"  http://www.example.com/  \">" \
+	     "</body></html>"
+
+char links[8][64];
+char tags[8][16];
+int  nlinks;
+
+static int
+collect( const char *tag, const char *value, size_t len, void *arg)
+{
+	if( nlinks < 8 ) {
+		snprintf(tags[nlinks], 16, "%s", tag);
+		snprintf(links[nlinks ++], 64, "%.*s", (int) len, value);
+	}
+	return 0;
+}
+
+static void
+check_links( CuTest *tc)
+{
+	CuAssertIntEquals(tc, 5, nlinks);
+	CuAssertStrEquals(tc, "/style.css", links[0]);
+	CuAssertStrEquals(tc, "/a/b c", links[1]);
+	CuAssertStrEquals(tc, "/unquoted", links[2]);
+	CuAssertStrEquals(tc, "/img.png", links[3]);
+	CuAssertStrEquals(tc, "img", tags[3]);
+	CuAssertStrEquals(tc, "http://www.example.com/", links[4]);
+}
+
+void
+test_lx_feed_1( CuTest *tc)
+{
+	linkex_t lx;
+	nlinks = 0;
+	lx_init(&lx, collect, NULL);
+	lx_feed(&lx, PAGE, strlen(PAGE));
+	check_links(tc);
+}
+
+void
+test_lx_feed_2( CuTest *tc)
+{
+	linkex_t lx;
+	char    *page = PAGE;
+	int      i = 0,
+	         len = strlen(PAGE);
+	nlinks = 0;
+	lx_init(&lx, collect, NULL);
+	for(; i < len; i ++){
+		lx_feed(&lx, page + i, 1);
+	}
+	check_links(tc);
+}
+
+void
+test_lx_feed_3( CuTest *tc)
+{
+	linkex_t lx;
+	char     *page = (char *) malloc(LX_VALUE_MAX + 64);
+	nlinks = 0;
+	strcpy(page, "<a href=\"");
+	memset(page + 9, 'x', LX_VALUE_MAX + 1);
+	strcpy(page + 10 + LX_VALUE_MAX, "\"><a href=\"/ok\">");
+	lx_init(&lx, collect, NULL);
+	lx_feed(&lx, page, strlen(page));
+	CuAssertIntEquals(tc, 1, nlinks);
+	CuAssertIntEquals(tc, 1, lx.lx_dropped);
+	CuAssertStrEquals(tc, "/ok", links[0]);
+}
+
+#define PAGE4 "<html><head><base href=\"http://example.com/dir/\"></head>" \
+	      "<div title='a > b' data-x=\"<a href=/no>\">" \
+	      "<p class=\"href=/no\"><a href=\"/q?a=1&amp;b=2&copy=3\">" \
+	      "<form method=post action=/submit><a href='/caf&#xE9;&#233;'>" \
+	      "<iframe src=\"/frame\"></iframe>"
+
+void
+test_lx_feed_4( CuTest *tc)
+{
+	linkex_t lx;
+	int      i,
+	         len = strlen(PAGE4);
+	for(i = 1; i <= len; i *= 3){
+		int j = 0;
+		nlinks = 0;
+		lx_init(&lx, collect, NULL);
+		for(; j < len; j += i){
+			lx_feed(&lx, PAGE4 + j, (len - j < i) ? len - j : i);
+		}
+		CuAssertIntEquals(tc, 5, nlinks);
+		CuAssertStrEquals(tc, "base", tags[0]);
+		CuAssertStrEquals(tc, "http://example.com/dir/", links[0]);
+		CuAssertStrEquals(tc, "/q?a=1&b=2&copy=3", links[1]);
+		CuAssertStrEquals(tc, "form", tags[2]);
+		CuAssertStrEquals(tc, "/submit", links[2]);
+		CuAssertStrEquals(tc, "/caf\xC3\xA9\xC3\xA9", links[3]);
+		CuAssertStrEquals(tc, "/frame", links[4]);
+	}
+}
+
+#define PAGE5 "<p title=it's>x</p><a href=\"/a\">y</a><p>z</p>" \
+	      "<div x\"y data-v = 'c>d' class=e\"f>g</div><a href='/b'>w</a>"
+
+void
+test_lx_feed_5( CuTest *tc)
+{
+	linkex_t lx;
+	int      i,
+	         len = strlen(PAGE5);
+	/* a quote that does not follow '=' must not hide the links after it */
+	for(i = 1; i <= len; i *= 3){
+		int j = 0;
+		nlinks = 0;
+		lx_init(&lx, collect, NULL);
+		for(; j < len; j += i){
+			lx_feed(&lx, PAGE5 + j, (len - j < i) ? len - j : i);
+		}
+		CuAssertIntEquals(tc, 2, nlinks);
+		CuAssertStrEquals(tc, "/a", links[0]);
+		CuAssertStrEquals(tc, "/b", links[1]);
+	}
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_lx_feed_1);
+	SUITE_ADD_TEST( suite, test_lx_feed_2);
+	SUITE_ADD_TEST( suite, test_lx_feed_3);
+	SUITE_ADD_TEST( suite, test_lx_feed_4);
+	SUITE_ADD_TEST( suite, test_lx_feed_5);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
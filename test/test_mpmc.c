@@ -0,0 +1,129 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_mpmc.c
+ *
+ *    Description:  tests the lock free queue in mpmc.c
+ *
+ *        Version:  1.0
+ *        Created:  27/10/2026 21:03:55
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/mpmc.h>
+
+#define THREADS 4
+#define ITEMS   200000
+
+static mpmc_t mq;
+
+static void *
+producer( void *arg)
+{
+	void  *batch[8];
+	long   base = (long) arg * ITEMS,
+	       i    = 0;
+	int    j;
+	for(; i < ITEMS; i += 8){
+		for(j = 0; j < 8; j ++){
+			batch[j] = (void *) (base + i + j + 1);
+		}
+		mq_push_n(&mq, batch, 8, true);
+	}
+	return NULL;
+}
+
+static void *
+consumer( void *arg)
+{
+	void *batch[16];
+	long  sum = 0;
+	int   n,
+	      j;
+	while( (n = mq_pop_n(&mq, batch, 16, true)) ) {
+		for(j = 0; j < n; j ++){
+			sum += (long) batch[j];
+		}
+	}
+	*(long *) arg = sum;
+	return NULL;
+}
+
+void
+test_mq_push_1( CuTest *tc)
+{
+	void *items[5] = { (void *) 1, (void *) 2, (void *) 3, (void *) 4, (void *) 5 },
+	     *out[5];
+	CuAssertIntEquals(tc, EINVAL, mq_init(&mq, 1));
+	CuAssertIntEquals(tc, 0, mq_init(&mq, 3));
+	CuAssertIntEquals(tc, 3, (int) mq.mq_mask);
+	/* only the room there is is taken */
+	CuAssertIntEquals(tc, 4, mq_push_n(&mq, items, 5, false));
+	CuAssertIntEquals(tc, EAGAIN, mq_push(&mq, items[4], false));
+	CuAssertIntEquals(tc, 2, mq_pop_n(&mq, out, 2, false));
+	CuAssertPtrEquals(tc, items[0], out[0]);
+	CuAssertPtrEquals(tc, items[1], out[1]);
+	CuAssertIntEquals(tc, 0, mq_push(&mq, items[4], false));
+	CuAssertIntEquals(tc, 3, mq_pop_n(&mq, out, 5, false));
+	CuAssertPtrEquals(tc, items[2], out[0]);
+	CuAssertPtrEquals(tc, items[4], out[2]);
+	CuAssertIntEquals(tc, EAGAIN, mq_pop(&mq, out, false));
+	mq_close(&mq);
+	CuAssertIntEquals(tc, ECANCELED, mq_pop(&mq, out, true));
+	mq_destroy(&mq);
+}
+
+void
+test_mq_push_2( CuTest *tc)
+{
+	pthread_t p[THREADS],
+	          c[THREADS];
+	long      sums[THREADS],
+	          sum  = 0,
+	          want = (long) THREADS * ITEMS * (THREADS * ITEMS + 1) / 2;
+	long      i    = 0;
+	/* a small ring so both sides block */
+	CuAssertIntEquals(tc, 0, mq_init(&mq, 64));
+	for(; i < THREADS; i ++){
+		pthread_create(&c[i], NULL, consumer, &sums[i]);
+		pthread_create(&p[i], NULL, producer, (void *) i);
+	}
+	for(i = 0; i < THREADS; i ++){
+		pthread_join(p[i], NULL);
+	}
+	mq_close(&mq);
+	for(i = 0; i < THREADS; i ++){
+		pthread_join(c[i], NULL);
+		sum += sums[i];
+	}
+	CuAssertTrue(tc, sum == want);
+	mq_destroy(&mq);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_mq_push_1);
+	SUITE_ADD_TEST( suite, test_mq_push_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,179 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_pathtree.c
+ *
+ *    Description:  tests the per host path trees in pathtree.c
+ *
+ *        Version:  1.0
+ *        Created:  30/10/2026 20:37:18
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/pathtree.h>
+
+struct collect_s {
+	char   paths[8][64];
+	int    count;
+	size_t bytes;
+	char   last[64];
+	bool   sorted;
+} typedef collect_t;
+
+static int
+collect( void *arg, const char *path, size_t len)
+{
+	collect_t *c = (collect_t *) arg;
+	if( c->count < 8 ) {
+		strcpy(c->paths[c->count], path);
+	}
+	if( c->count && strcmp(c->last, path) >= 0 ) {
+		c->sorted = false;
+	}
+	strcpy(c->last, path);
+	c->bytes += len;
+	c->count ++;
+	return 0;
+}
+
+static int
+stop_at_two( void *arg, const char *path, size_t len)
+{
+	return ++ *(int *) arg == 2 ? EINTR : 0;
+}
+
+void
+test_pt_insert_1( CuTest *tc)
+{
+	pathtree_t pt;
+	collect_t  c;
+	uriobj_t  *uri;
+	uint32_t   h     = hi_intern("example.com", 11),
+	           other = hi_intern("example.org", 11);
+	int        n     = 0;
+	CuAssertIntEquals(tc, 0, pt_init(&pt));
+	CuAssertIntEquals(tc, 0, pt_insert(&pt, h, "/a/c"));
+	CuAssertIntEquals(tc, 0, pt_insert(&pt, h, "/a"));
+	CuAssertIntEquals(tc, 0, pt_insert(&pt, h, "/a/b"));
+	CuAssertIntEquals(tc, 0, pt_insert(&pt, h, "/b"));
+	CuAssertIntEquals(tc, EEXIST, pt_insert(&pt, h, "/a"));
+	CuAssertIntEquals(tc, EINVAL, pt_insert(&pt, HI_NONE, "/a"));
+	CuAssertIntEquals(tc, 0, pt_insert(&pt, other, "/a"));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/a"));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/a/b"));
+	CuAssertTrue(tc, ! pt_lookup(&pt, h, "/a/"));
+	CuAssertTrue(tc, ! pt_lookup(&pt, h, "/a/b/c"));
+	CuAssertTrue(tc, ! pt_lookup(&pt, other, "/b"));
+	CuAssertIntEquals(tc, 4, (int) pt_count(&pt, h, ""));
+	CuAssertIntEquals(tc, 3, (int) pt_count(&pt, h, "/a"));
+	CuAssertIntEquals(tc, 2, (int) pt_count(&pt, h, "/a/"));
+	CuAssertIntEquals(tc, 0, (int) pt_count(&pt, h, "/c"));
+	CuAssertIntEquals(tc, 1, (int) pt_count(&pt, other, "/"));
+	bzero(&c, sizeof(collect_t));
+	c.sorted = true;
+	CuAssertIntEquals(tc, 0, pt_iter(&pt, h, "/a", collect, &c));
+	CuAssertIntEquals(tc, 3, c.count);
+	CuAssertStrEquals(tc, "/a", c.paths[0]);
+	CuAssertStrEquals(tc, "/a/b", c.paths[1]);
+	CuAssertStrEquals(tc, "/a/c", c.paths[2]);
+	/* a non zero return stops the walk */
+	CuAssertIntEquals(tc, EINTR, pt_iter(&pt, h, "", stop_at_two, &n));
+	CuAssertIntEquals(tc, 2, n);
+	/* a URI goes in as its path and query */
+	uri = (uriobj_t *) malloc(sizeof(uriobj_t));
+	init_uriobj_str(uri);
+	*(uri->uri_host)  = strdup("example.com");
+	*(uri->uri_path)  = strdup("/search");
+	*(uri->uri_query) = strdup("q=x");
+	uri->uri_flags    = URI_REGNAME;
+	CuAssertIntEquals(tc, 0, pt_insert_uri(&pt, uri));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/search?q=x"));
+	free_uriobj(uri);
+	pt_destroy(&pt);
+}
+
+void
+test_pt_insert_2( CuTest *tc)
+{
+	pathtree_t pt;
+	collect_t  c;
+	uint32_t   h    = hi_intern("example.com", 11);
+	char       path[64];
+	size_t     flat = 0;
+	int        paths = 0,
+	           y,
+	           m,
+	           d;
+	CuAssertIntEquals(tc, 0, pt_init(&pt));
+	for(y = 2000; y < 2030; y ++){
+		for(m = 1; m <= 12; m ++){
+			for(d = 1; d <= 28; d ++){
+				sprintf(path, "/calendar/%04d/%02d/%02d/", y, m, d);
+				CuAssertIntEquals(tc, 0, pt_insert(&pt, h, path));
+				flat += strlen(path) + 1;
+				paths ++;
+			}
+		}
+	}
+	/* wide nodes,  every byte after /w/ and 40 of them after /m/ */
+	for(d = 1; d < 256; d ++){
+		sprintf(path, "/w/%c", d);
+		CuAssertIntEquals(tc, 0, pt_insert(&pt, h, path));
+		flat += strlen(path) + 1;
+		paths ++;
+		if( d >= 'A' && d < 'A' + 40 ) {
+			sprintf(path, "/m/%c/index.html", d);
+			CuAssertIntEquals(tc, 0, pt_insert(&pt, h, path));
+			flat += strlen(path) + 1;
+			paths ++;
+		}
+	}
+	CuAssertIntEquals(tc, paths, (int) pt_count(&pt, h, ""));
+	CuAssertIntEquals(tc, 12 * 28, (int) pt_count(&pt, h, "/calendar/2010/"));
+	CuAssertIntEquals(tc, 10 * 12 * 28, (int) pt_count(&pt, h, "/calendar/201"));
+	CuAssertIntEquals(tc, 255, (int) pt_count(&pt, h, "/w/"));
+	CuAssertIntEquals(tc, 40, (int) pt_count(&pt, h, "/m/"));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/w/\377"));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/m/A/index.html"));
+	CuAssertTrue(tc, ! pt_lookup(&pt, h, "/m/A/index.htm"));
+	CuAssertTrue(tc, pt_lookup(&pt, h, "/calendar/2029/12/28/"));
+	CuAssertTrue(tc, ! pt_lookup(&pt, h, "/calendar/2029/12/29/"));
+	bzero(&c, sizeof(collect_t));
+	c.sorted = true;
+	CuAssertIntEquals(tc, 0, pt_iter(&pt, h, "", collect, &c));
+	CuAssertIntEquals(tc, paths, c.count);
+	CuAssertTrue(tc, c.sorted);
+	CuAssertTrue(tc, c.bytes + paths == flat);
+	/* the shared prefixes are stored once */
+	CuAssertTrue(tc, pt.pt_bytes < flat * 3 / 4);
+	pt_destroy(&pt);
+	CuAssertTrue(tc, pt.pt_bytes == 0);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_pt_insert_1);
+	SUITE_ADD_TEST( suite, test_pt_insert_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
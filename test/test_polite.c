@@ -0,0 +1,267 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_polite.c
+ *
+ *    Description:  tests the politeness scheduler in polite.c and the timer wheel it
+ *                  is built on.
+ *
+ *        Version:  1.0
+ *        Created:  21/10/2026 21:12:03
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/polite.h>
+#include <testuri.h>
+
+void
+test_tw_advance_1( CuTest *tc)
+{
+	twheel_t         tw;
+	tw_timer_t       a,
+	                 b,
+	                 c;
+	struct list_head expired;
+	INIT_LIST_HEAD(&expired);
+	tw_init(&tw, 100);
+	tw_timer_init(&a);
+	tw_timer_init(&b);
+	tw_timer_init(&c);
+	tw_add(&tw, &a, 105);
+	tw_add(&tw, &b, 100 + TW_SIZE * 3 + 7);
+	tw_add(&tw, &c, 100 + TW_SIZE * TW_SIZE * 2);
+	CuAssertIntEquals(tc, 0, tw_advance(&tw, 104, &expired));
+	CuAssertIntEquals(tc, 1, tw_advance(&tw, 105, &expired));
+	CuAssertPtrEquals(tc, &a.tt_list, expired.next);
+	INIT_LIST_HEAD(&expired);
+	CuAssertIntEquals(tc, 0, tw_advance(&tw, 100 + TW_SIZE * 3 + 6, &expired));
+	CuAssertIntEquals(tc, 1, tw_advance(&tw, 100 + TW_SIZE * 3 + 7, &expired));
+	INIT_LIST_HEAD(&expired);
+	CuAssertIntEquals(tc, 0, tw_advance(&tw, 100 + TW_SIZE * TW_SIZE * 2 - 1, &expired));
+	CuAssertIntEquals(tc, 1, tw_advance(&tw, 100 + TW_SIZE * TW_SIZE * 2, &expired));
+	CuAssertIntEquals(tc, 0, tw.tw_count);
+}
+
+void
+test_pl_pop_1( CuTest *tc)
+{
+	polite_t  pl;
+	pl_url_t *u1,
+	         *u2,
+	         *u3;
+	uriobj_t *a1 = test_uri("a.example.com", NULL),
+	         *a2 = test_uri("a.example.com", NULL),
+	         *b1 = test_uri("b.example.com", NULL);
+	pl_init(&pl, 50, 1);
+	pl_push(&pl, a1, NULL);
+	pl_push(&pl, a2, NULL);
+	pl_push(&pl, b1, NULL);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u1));
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u2));
+	CuAssertPtrEquals(tc, a1, u1->pu_uri);
+	CuAssertPtrEquals(tc, b1, u2->pu_uri);
+	/* a is at its cap and inside its delay */
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u3));
+	pl_done(&pl, u1);
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u3));
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, true, &u3));
+	CuAssertPtrEquals(tc, a2, u3->pu_uri);
+	pl_done(&pl, u2);
+	pl_done(&pl, u3);
+	pl_destroy(&pl);
+	free_uriobj(a1);
+	free_uriobj(a2);
+	free_uriobj(b1);
+}
+
+void
+test_pl_ipgroup_1( CuTest *tc)
+{
+	polite_t  pl;
+	pl_url_t *u1,
+	         *u2,
+	         *u3;
+	uriobj_t *a1 = test_uri("a.example.com", NULL),
+	         *b1 = test_uri("b.example.com", NULL),
+	         *c1 = test_uri("c.example.net", NULL);
+	CuAssertIntEquals(tc, 0, test_uri_addr(a1, "192.0.2.10"));
+	CuAssertIntEquals(tc, 0, test_uri_addr(b1, "192.0.2.20"));
+	CuAssertIntEquals(tc, 0, test_uri_addr(c1, "198.51.100.1"));
+	pl_init(&pl, 50, 1);
+	pl_set_ipgroup(&pl, 24, 64, 0, 1);
+	pl_push(&pl, a1, NULL);
+	pl_push(&pl, b1, NULL);
+	pl_push(&pl, c1, NULL);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u1));
+	CuAssertPtrEquals(tc, a1, u1->pu_uri);
+	/* b shares a's /24 which is at its cap,  c is on another network */
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u2));
+	CuAssertPtrEquals(tc, c1, u2->pu_uri);
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u3));
+	pl_done(&pl, u1);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u3));
+	CuAssertPtrEquals(tc, b1, u3->pu_uri);
+	pl_done(&pl, u2);
+	pl_done(&pl, u3);
+	pl_destroy(&pl);
+	free_uriobj(a1);
+	free_uriobj(b1);
+	free_uriobj(c1);
+}
+
+void
+test_pl_ipgroup_2( CuTest *tc)
+{
+	polite_t    pl;
+	pl_url_t   *u1,
+	           *u2;
+	pl_ipgrp_t *g;
+	uriobj_t   *a1 = test_uri("a.example.com", NULL),
+	           *a2 = test_uri("a.example.com", NULL);
+	CuAssertIntEquals(tc, 0, test_uri_addr(a2, "192.0.2.1"));
+	pl_init(&pl, 1000, 2);
+	pl_set_host(&pl, "a.example.com", 0, -1);
+	pl_set_ipgroup(&pl, 32, 128, 0, 1);
+	/* the host joins its IP group while a URI taken before that is in flight */
+	pl_push(&pl, a1, NULL);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u1));
+	pl_push(&pl, a2, NULL);
+	g = u1->pu_host->ph_ip;
+	CuAssertPtrNotNull(tc, g);
+	CuAssertIntEquals(tc, 0, g->pg_active);
+	/* only what pl_pop charged is given back */
+	pl_done(&pl, u1);
+	CuAssertIntEquals(tc, 0, g->pg_active);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u2));
+	CuAssertIntEquals(tc, 1, g->pg_active);
+	pl_done(&pl, u2);
+	CuAssertIntEquals(tc, 0, g->pg_active);
+	pl_destroy(&pl);
+	free_uriobj(a1);
+	free_uriobj(a2);
+}
+
+void
+test_pl_finish_1( CuTest *tc)
+{
+	polite_t   pl;
+	pl_url_t  *u[8];
+	uriobj_t  *uris[8];
+	pl_host_t *h;
+	int        i,
+	           n;
+	pl_init(&pl, 1000, 1);
+	pl_set_adaptive(&pl, 4);
+	pl_set_host(&pl, "a.example.com", 0, -1);
+	for(i = 0; i < 8; i ++){
+		uris[i] = test_uri("a.example.com", NULL);
+		pl_push(&pl, uris[i], NULL);
+	}
+	/* the window starts at one request */
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u[0]));
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u[1]));
+	h = u[0]->pu_host;
+	pl_finish(&pl, u[0], 200, 100);
+	CuAssertDblEquals(tc, 2.0, h->ph_window, 0.001);
+	/* two good responses at steady latency grow it by one more */
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u[0]));
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u[1]));
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u[2]));
+	pl_finish(&pl, u[0], 200, 100);
+	pl_finish(&pl, u[1], 200, 100);
+	CuAssertTrue(tc, h->ph_window > 2.8 && h->ph_window < 3.0);
+	for(n = 0; n < 3 && pl_pop(&pl, false, &u[n]) == 0; n ++);
+	CuAssertIntEquals(tc, 2, n);
+	/* a 503 halves the window,  the second overload in the same round trip does not */
+	pl_finish(&pl, u[0], 503, 100);
+	pl_finish(&pl, u[1], PL_S_TIMEOUT, -1);
+	CuAssertTrue(tc, h->ph_window > 1.4 && h->ph_window < 1.5);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u[0]));
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u[1]));
+	pl_done(&pl, u[0]);
+	pl_destroy(&pl);
+	for(i = 0; i < 8; i ++){
+		free_uriobj(uris[i]);
+	}
+}
+
+void
+test_pl_breaker_1( CuTest *tc)
+{
+	polite_t   pl;
+	pl_url_t  *u,
+	          *v;
+	uriobj_t  *uris[PL_CB_FAILS + 4];
+	pl_host_t *h;
+	int        i;
+	pl_init(&pl, 1000, 2);
+	pl_set_host(&pl, "dead.example.com", 0, -1);
+	for(i = 0; i < PL_CB_FAILS + 4; i ++){
+		uris[i] = test_uri("dead.example.com", NULL);
+		pl_push(&pl, uris[i], NULL);
+	}
+	for(i = 0; i < PL_CB_FAILS; i ++){
+		CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u));
+		h = u->pu_host;
+		pl_finish(&pl, u, i % 2 ? PL_S_TIMEOUT : PL_S_FAILED, -1);
+	}
+	/* open,  the remaining URIs are held */
+	CuAssertIntEquals(tc, PL_CB_OPEN, h->ph_breaker);
+	CuAssertIntEquals(tc, PL_WAIT, h->ph_state);
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &u));
+	/* end the cooldown early,  a single probe is let through */
+	h->ph_open = pl_now();
+	tw_add(&pl.pl_wheel, &h->ph_timer, pl.pl_wheel.tw_now);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, true, &u));
+	CuAssertIntEquals(tc, PL_CB_HALF, h->ph_breaker);
+	CuAssertIntEquals(tc, EAGAIN, pl_pop(&pl, false, &v));
+	/* the probe fails and the cooldown doubles */
+	pl_finish(&pl, u, PL_S_FAILED, -1);
+	CuAssertIntEquals(tc, PL_CB_OPEN, h->ph_breaker);
+	CuAssertIntEquals(tc, PL_CB_COOLDOWN_MS * 2, h->ph_cooldown);
+	h->ph_open = pl_now();
+	tw_add(&pl.pl_wheel, &h->ph_timer, pl.pl_wheel.tw_now);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, true, &u));
+	pl_finish(&pl, u, 404, 20);
+	CuAssertIntEquals(tc, PL_CB_CLOSED, h->ph_breaker);
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &u));
+	CuAssertIntEquals(tc, 0, pl_pop(&pl, false, &v));
+	pl_done(&pl, u);
+	pl_done(&pl, v);
+	pl_destroy(&pl);
+	for(i = 0; i < PL_CB_FAILS + 4; i ++){
+		free_uriobj(uris[i]);
+	}
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_tw_advance_1);
+	SUITE_ADD_TEST( suite, test_pl_pop_1);
+	SUITE_ADD_TEST( suite, test_pl_ipgroup_1);
+	SUITE_ADD_TEST( suite, test_pl_ipgroup_2);
+	SUITE_ADD_TEST( suite, test_pl_finish_1);
+	SUITE_ADD_TEST( suite, test_pl_breaker_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -35,10 +35,71 @@ test_uri_resolve_1( CuTest *tc )
 	CuAssertIntEquals(tc, gai_error, 0);	
 }
 
-GetSuite()
+void
+test_rf_resolve_1( CuTest *tc )
+{
+	rf_batch_t  rf;
+	rf_ref_t    out[16];
+	uriobj_t    base;
+	int         n = 0,
+	            i = 0;
+	/* the normal examples of RFC3986 section 5.4.1 and a few of our own */
+	const char *refs[][2] = {
+		{ "g",             "http://a/b/c/g" },
+		{ "./g",           "http://a/b/c/g" },
+		{ "g/",            "http://a/b/c/g/" },
+		{ "/g",            "http://a/g" },
+		{ "//g",           "http://g/" },
+		{ "?y",            "http://a/b/c/d;p?y" },
+		{ "g?y#s",         "http://a/b/c/g?y" },
+		{ "",              "http://a/b/c/d;p?q" },
+		{ "../..",         "http://a/" },
+		{ "../../../g",    "http://a/g" },
+		{ "/./g/../h",     "http://a/h" },
+		{ "HTTPS://Ex.COM", "https://ex.com/" },
+		{ " a b ",         "http://a/b/c/a%20b" }
+	};
+	rf_span_t spans[sizeof(refs) / sizeof(refs[0]) + 3];
+	init_uriobj_str(&base);
+	*(base.uri_scheme) = "http";
+	*(base.uri_auth)   = "a";
+	*(base.uri_path)   = "/b/c/d;p";
+	*(base.uri_query)  = "q";
+	CuAssertIntEquals(tc, 0, rf_init(&rf, &base, false));
+	for(; i < (int) (sizeof(refs) / sizeof(refs[0])); i ++){
+		spans[0].rs_ptr = refs[i][0];
+		spans[0].rs_len = strlen(refs[i][0]);
+		rf_reset(&rf);
+		CuAssertIntEquals(tc, 0, rf_resolve(&rf, spans, 1, out, &n));
+		CuAssertIntEquals(tc, 1, n);
+		CuAssertStrEquals(tc, refs[i][1], out[0].rr_uri);
+	}
+	/* repeats on the page and other schemes are dropped */
+	rf_reset(&rf);
+	spans[0].rs_ptr = "g";            spans[0].rs_len = 1;
+	spans[1].rs_ptr = "mailto:x@a";   spans[1].rs_len = 10;
+	spans[2].rs_ptr = "./g#top";      spans[2].rs_len = 7;
+	spans[3].rs_ptr = "/b/c/h";       spans[3].rs_len = 6;
+	CuAssertIntEquals(tc, 0, rf_resolve(&rf, spans, 4, out, &n));
+	CuAssertIntEquals(tc, 2, n);
+	CuAssertStrEquals(tc, "http://a/b/c/h", out[1].rr_uri);
+	CuAssertIntEquals(tc, 1, rf.rf_dups);
+	CuAssertIntEquals(tc, 1, rf.rf_skipped);
+	/* a <base href> moves the links after it */
+	CuAssertIntEquals(tc, 0, rf_rebase(&rf, "../x/", 5));
+	spans[0].rs_ptr = "g";
+	CuAssertIntEquals(tc, 0, rf_resolve(&rf, spans, 1, out, &n));
+	CuAssertStrEquals(tc, "http://a/b/x/g", out[0].rr_uri);
+	rf_free(&rf);
+}
+
+static CuSuite *
+GetSuite( void)
 {
 	CuSuite *suite = CuSuiteNew();
 	SUITE_ADD_TEST( suite, test_uri_resolve_1);
+	SUITE_ADD_TEST( suite, test_rf_resolve_1);
+	return suite;
 }
 
 int 
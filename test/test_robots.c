@@ -0,0 +1,170 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_robots.c
+ *
+ *    Description:  tests the robots.txt matcher and cache in robots.c
+ *
+ *        Version:  1.0
+ *        Created:  22/10/2026 21:02:45
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/robots.h>
+#include <testuri.h>
+
+static const char *robots_txt =
+	"# example\n"
+	"User-agent: *\n"
+	"Disallow: /\n"
+	"\n"
+	"User-agent: otherbot\n"
+	"User-agent: Azzmos/1.0\n"
+	"Disallow: /private\n"
+	"Allow: /private/pub\n"
+	"Disallow: /*.php$\n"
+	"Disallow: /search?*q=\n"
+	"Allow: /p\n"
+	"Crawl-delay: 2.5\n"
+	"Sitemap: http://example.com/sitemap.xml\n";
+
+void
+test_rb_rules_match_1( CuTest *tc)
+{
+	rb_rules_t rr;
+	CuAssertIntEquals(tc, 0, rb_rules_init(&rr));
+	CuAssertIntEquals(tc, 0, rb_rules_parse(&rr, "azzmos", robots_txt, strlen(robots_txt)));
+	CuAssertIntEquals(tc, 2500, rr.rr_delay);
+	CuAssertTrue(tc, rb_rules_match(&rr, "/", NULL));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/private/x", NULL));
+	/* the longer Allow beats the Disallow */
+	CuAssertTrue(tc, rb_rules_match(&rr, "/private/pub/x", NULL));
+	CuAssertTrue(tc, rb_rules_match(&rr, "/pri", NULL));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/a/b/index.php", NULL));
+	CuAssertTrue(tc, rb_rules_match(&rr, "/a/b/index.php5", NULL));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/search", "lang=en&q=x"));
+	CuAssertTrue(tc, rb_rules_match(&rr, "/search", "lang=en"));
+	rb_rules_free(&rr);
+	/* no group names the agent,  the * group applies */
+	CuAssertIntEquals(tc, 0, rb_rules_init(&rr));
+	CuAssertIntEquals(tc, 0, rb_rules_parse(&rr, "somebot", robots_txt, strlen(robots_txt)));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/anything", NULL));
+	CuAssertIntEquals(tc, -1, rr.rr_delay);
+	rb_rules_free(&rr);
+}
+
+void
+test_rb_rules_match_2( CuTest *tc)
+{
+	rb_rules_t  rr;
+	const char *txt = "User-agent: *\r\nDisallow: /a%2fb\r\nDisallow: /x*y*z\r\n"
+	                  "Disallow: /tie\r\nAllow: /tie\r\n";
+	CuAssertIntEquals(tc, 0, rb_rules_init(&rr));
+	CuAssertIntEquals(tc, 0, rb_rules_parse(&rr, "azzmos", txt, strlen(txt)));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/a%2Fb", NULL));
+	CuAssertTrue(tc, ! rb_rules_match(&rr, "/x1y2z3", NULL));
+	CuAssertTrue(tc, rb_rules_match(&rr, "/x1z2y", NULL));
+	/* a Allow and Disallow of the same length,  the Allow wins */
+	CuAssertTrue(tc, rb_rules_match(&rr, "/tie/x", NULL));
+	rb_rules_free(&rr);
+}
+
+void
+test_rb_check_1( CuTest *tc)
+{
+	robots_t   rc;
+	polite_t   pl;
+	pl_host_t *h;
+	bool       allowed = false;
+	uriobj_t  *a = test_uri("example.com", "/private/x"),
+	          *b = test_uri("example.com", "/index.html"),
+	          *c = test_uri("down.example.com", "/");
+	char      *url = rb_url(a);
+	CuAssertStrEquals(tc, "http://example.com/robots.txt", url);
+	free(url);
+	pl_init(&pl, 1000, 1);
+	rb_init(&rc, "azzmos", 0, &pl);
+	/* the first check fetches,  the rest wait for it */
+	CuAssertIntEquals(tc, EINPROGRESS, rb_check(&rc, a, false, &allowed));
+	CuAssertIntEquals(tc, EAGAIN, rb_check(&rc, b, false, &allowed));
+	CuAssertIntEquals(tc, 0, rb_store(&rc, "example.com", 200, robots_txt, strlen(robots_txt)));
+	CuAssertIntEquals(tc, 0, rb_check(&rc, a, false, &allowed));
+	CuAssertTrue(tc, ! allowed);
+	CuAssertIntEquals(tc, 0, rb_check(&rc, b, false, &allowed));
+	CuAssertTrue(tc, allowed);
+	/* the Crawl-delay is longer than the default and is passed on */
+	h = list_entry(pl.pl_table[hi_lookup("example.com", 11) % PL_HOST_BUCKETS].next,
+			pl_host_t, ph_hash);
+	CuAssertIntEquals(tc, 2500, h->ph_delay);
+	/* a server error disallows the whole host */
+	CuAssertIntEquals(tc, EINPROGRESS, rb_check(&rc, c, false, &allowed));
+	CuAssertIntEquals(tc, 0, rb_store(&rc, "down.example.com", 503, NULL, 0));
+	CuAssertIntEquals(tc, 0, rb_check(&rc, c, false, &allowed));
+	CuAssertTrue(tc, ! allowed);
+	CuAssertIntEquals(tc, 0, rb_expire(&rc));
+	rb_destroy(&rc);
+	pl_destroy(&pl);
+	free_uriobj(a);
+	free_uriobj(b);
+	free_uriobj(c);
+}
+
+void
+test_rb_check_2( CuTest *tc)
+{
+	robots_t    rc;
+	rb_entry_t *e;
+	bool        allowed = false;
+	uint64_t    start;
+	uriobj_t   *a = test_uri("example.com", "/"),
+	           *b = test_uri("example.com", "/x");
+	rb_init(&rc, "azzmos", 0, NULL);
+	CuAssertIntEquals(tc, EINPROGRESS, rb_check(&rc, a, false, &allowed));
+	CuAssertIntEquals(tc, EAGAIN, rb_check(&rc, b, false, &allowed));
+	e = list_entry(rc.rc_table[hi_uri(a) % RB_BUCKETS].next, rb_entry_t, re_hash);
+	/* the fetch is never stored,  a waiter takes it over at the deadline */
+	e->re_started = pl_now() - RB_FETCH_MS + 100;
+	start = pl_now();
+	CuAssertIntEquals(tc, EINPROGRESS, rb_check(&rc, b, true, &allowed));
+	CuAssertTrue(tc, pl_now() - start >= 90);
+	CuAssertIntEquals(tc, EAGAIN, rb_check(&rc, a, false, &allowed));
+	/* so does the next caller once it has timed out again */
+	e->re_started -= RB_FETCH_MS;
+	CuAssertIntEquals(tc, EINPROGRESS, rb_check(&rc, a, false, &allowed));
+	CuAssertIntEquals(tc, 0, rb_store(&rc, "example.com", 404, NULL, 0));
+	CuAssertIntEquals(tc, 0, rb_check(&rc, b, false, &allowed));
+	CuAssertTrue(tc, allowed);
+	rb_destroy(&rc);
+	free_uriobj(a);
+	free_uriobj(b);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_rb_rules_match_1);
+	SUITE_ADD_TEST( suite, test_rb_rules_match_2);
+	SUITE_ADD_TEST( suite, test_rb_check_1);
+	SUITE_ADD_TEST( suite, test_rb_check_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,115 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_seen.c
+ *
+ *    Description:  tests the URL seen filter in seen.c
+ *
+ *        Version:  1.0
+ *        Created:  24/10/2026 21:10:04
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/seen.h>
+#include <azzmos/utils.h>
+#include <unistd.h>
+
+#define N 100000
+
+void
+test_sn_insert_1( CuTest *tc)
+{
+	seen_t   sn;
+	uint64_t i   = 0;
+	long     fps = 0;
+	CuAssertIntEquals(tc, 0, sn_init(&sn, N, 0.01));
+	/* a new key can be a false positive as the filter fills */
+	for(; i < N; i ++){
+		fps += sn_insert(&sn, mem_hash64(&i, sizeof(i)));
+	}
+	CuAssertTrue(tc, fps < N / 100);
+	CuAssertIntEquals(tc, N - fps, (int) sn.sn_count);
+	for(i = 0; i < N; i ++){
+		CuAssertTrue(tc, sn_insert(&sn, mem_hash64(&i, sizeof(i))));
+		CuAssertTrue(tc, sn_test(&sn, mem_hash64(&i, sizeof(i))));
+	}
+	/* keys never inserted,  allow twice the rate asked for */
+	for(fps = 0; i < 2 * N; i ++){
+		fps += sn_test(&sn, mem_hash64(&i, sizeof(i)));
+	}
+	CuAssertTrue(tc, fps < N / 50);
+	sn_free(&sn);
+	CuAssertIntEquals(tc, EINVAL, sn_init(&sn, N, 1.5));
+}
+
+void
+test_sn_save_1( CuTest *tc)
+{
+	seen_t   sn;
+	uint64_t i = 0;
+	char     path[] = "/tmp/test_seen.XXXXXX";
+	int      fd = mkstemp(path);
+	CuAssertTrue(tc, fd != -1);
+	close(fd);
+	CuAssertIntEquals(tc, 0, sn_init(&sn, 1000, 0.001));
+	for(; i < 1000; i ++){
+		sn_insert(&sn, mem_hash64(&i, sizeof(i)));
+	}
+	CuAssertIntEquals(tc, 0, sn_save(&sn, path));
+	sn_free(&sn);
+	CuAssertIntEquals(tc, 0, sn_load(&sn, path));
+	CuAssertIntEquals(tc, 1000, (int) sn.sn_count);
+	for(i = 0; i < 1000; i ++){
+		CuAssertTrue(tc, sn_test(&sn, mem_hash64(&i, sizeof(i))));
+	}
+	/* the loaded filter takes inserts */
+	CuAssertTrue(tc, ! sn_insert(&sn, 42424242));
+	CuAssertTrue(tc, sn_test(&sn, 42424242));
+	sn_free(&sn);
+	/* a truncated file is refused */
+	CuAssertIntEquals(tc, 0, truncate(path, 100));
+	CuAssertIntEquals(tc, EINVAL, sn_load(&sn, path));
+	unlink(path);
+}
+
+void
+test_sn_fingerprint_1( CuTest *tc)
+{
+	uriobj_t uri;
+	char     *s = "http://example.com/a?b";
+	init_uriobj_str(&uri);
+	*(uri.uri_scheme) = "http";
+	*(uri.uri_auth)   = "example.com";
+	*(uri.uri_path)   = "/a";
+	*(uri.uri_query)  = "b";
+	CuAssertTrue(tc, sn_fingerprint(&uri) == mem_hash64(s, strlen(s)));
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_sn_insert_1);
+	SUITE_ADD_TEST( suite, test_sn_save_1);
+	SUITE_ADD_TEST( suite, test_sn_fingerprint_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,130 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_segq.c
+ *
+ *    Description:  tests the disk backed queues in segq.c
+ *
+ *        Version:  1.0
+ *        Created:  25/10/2026 21:40:17
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/segq.h>
+#include <unistd.h>
+
+#define QUEUES  16
+#define RECORDS 20000
+
+void
+test_sq_pop_1( CuTest *tc)
+{
+	segq_t      sq;
+	sq_queue_t  q[QUEUES];
+	char        dir[] = "/tmp/test_segq.XXXXXX",
+	            rec[64];
+	const char *data;
+	size_t      len;
+	int         i = 0,
+	            j,
+	            segs;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	/* a small budget and segments so most records go to disk */
+	CuAssertIntEquals(tc, 0, sq_init(&sq, dir, 4 * SQ_PAGE_SIZE, 4 * SQ_TAIL_MIN));
+	for(; i < QUEUES; i ++){
+		CuAssertIntEquals(tc, 0, sq_queue_init(&q[i], "example.com"));
+	}
+	for(j = 0; j < RECORDS; j ++){
+		len = sprintf(rec, "record %d", j);
+		CuAssertIntEquals(tc, 0, sq_push(&sq, &q[j % QUEUES], rec, len));
+		CuAssertTrue(tc, sq.sq_mem <= 4 * SQ_TAIL_MIN + 2 * SQ_PAGE_SIZE);
+	}
+	CuAssertTrue(tc, sq.sq_spills > 0);
+	segs = sq.sq_nsegs;
+	/* each queue comes back in the order it was pushed */
+	for(j = 0; j < RECORDS; j ++){
+		len = sprintf(rec, "record %d", j);
+		CuAssertIntEquals(tc, 0, sq_pop(&sq, &q[j % QUEUES], &data, &len));
+		CuAssertIntEquals(tc, (int) strlen(rec), (int) len);
+		CuAssertTrue(tc, memcmp(rec, data, len) == 0);
+	}
+	for(i = 0; i < QUEUES; i ++){
+		CuAssertIntEquals(tc, ENOENT, sq_pop(&sq, &q[i], &data, &len));
+		CuAssertIntEquals(tc, 0, (int) q[i].sq_count);
+	}
+	/* read segments are reused rather than new ones created */
+	for(j = 0; j < RECORDS; j ++){
+		CuAssertIntEquals(tc, 0, sq_push(&sq, &q[j % QUEUES], "again", 5));
+	}
+	CuAssertIntEquals(tc, segs, sq.sq_nsegs);
+	CuAssertIntEquals(tc, EINVAL, sq_push(&sq, &q[0], rec, SQ_RECORD_MAX + 1));
+	for(i = 0; i < QUEUES; i ++){
+		sq_queue_free(&sq, &q[i]);
+	}
+	CuAssertIntEquals(tc, 0, (int) sq.sq_mem);
+	sq_destroy(&sq);
+	CuAssertIntEquals(tc, 0, rmdir(dir));
+}
+
+void
+test_sq_pop_uri_1( CuTest *tc)
+{
+	segq_t     sq;
+	sq_queue_t q;
+	uriobj_t   uri;
+	char       dir[] = "/tmp/test_segq.XXXXXX",
+	          *url;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	CuAssertIntEquals(tc, 0, sq_init(&sq, dir, 0, 0));
+	CuAssertIntEquals(tc, 0, sq_queue_init(&q, "example.com"));
+	init_uriobj_str(&uri);
+	*(uri.uri_scheme) = "https";
+	*(uri.uri_auth)   = "example.com";
+	*(uri.uri_path)   = "/a/b";
+	*(uri.uri_query)  = "x=1";
+	CuAssertIntEquals(tc, 0, sq_push_uri(&sq, &q, &uri));
+	*(uri.uri_scheme) = "http";
+	*(uri.uri_auth)   = "example.com:8080";
+	*(uri.uri_path)   = "";
+	*(uri.uri_query)  = NULL;
+	CuAssertIntEquals(tc, 0, sq_push_uri(&sq, &q, &uri));
+	*(uri.uri_scheme) = "ftp";
+	CuAssertIntEquals(tc, EINVAL, sq_push_uri(&sq, &q, &uri));
+	CuAssertIntEquals(tc, 0, sq_pop_uri(&sq, &q, &url));
+	CuAssertStrEquals(tc, "https://example.com/a/b?x=1", url);
+	free(url);
+	CuAssertIntEquals(tc, 0, sq_pop_uri(&sq, &q, &url));
+	CuAssertStrEquals(tc, "http://example.com:8080/", url);
+	free(url);
+	sq_queue_free(&sq, &q);
+	sq_destroy(&sq);
+	rmdir(dir);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_sq_pop_1);
+	SUITE_ADD_TEST( suite, test_sq_pop_uri_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,308 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_urlrun.c
+ *
+ *    Description:  tests the sorted URL runs and store in urlrun.c
+ *
+ *        Version:  1.0
+ *        Created:  31/10/2026 21:12:40
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/urlrun.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define URLS  20000
+
+struct store_arg_s {
+	ur_store_t *sa_us;
+	int         sa_from;
+	int         sa_err;
+	int         sa_done;
+} typedef store_arg_t;
+
+static size_t
+make_url( char *url, int i)
+{
+	return sprintf(url, "http://host%03d.example.com/path/%06d.html", i % 100, i);
+}
+
+static void
+remove_runs( const char *dir)
+{
+	char path[256];
+	int  i = 0;
+	for(; i < 256; i ++){
+		sprintf(path, "%s/run.%d", dir, i);
+		unlink(path);
+	}
+	rmdir(dir);
+}
+
+void
+test_ur_contains_1( CuTest *tc)
+{
+	ur_writer_t uw;
+	ur_run_t    run;
+	ur_iter_t   it;
+	char        dir[] = "/tmp/test_urlrun.XXXXXX",
+	            path[64],
+	            url[64],
+	            last[64] = "";
+	const char *u;
+	size_t      len;
+	int         i = 0;
+	struct stat st;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	sprintf(path, "%s/run.0", dir);
+	CuAssertIntEquals(tc, 0, ur_write_open(&uw, path));
+	/* the even URLs in order,  a repeat is dropped and a earlier one refused */
+	for(; i < URLS; i += 2){
+		sprintf(url, "http://example.com/page/%06d", i);
+		CuAssertIntEquals(tc, 0, ur_write_add(&uw, url, strlen(url)));
+	}
+	CuAssertIntEquals(tc, 0, ur_write_add(&uw, url, strlen(url)));
+	CuAssertIntEquals(tc, EINVAL, ur_write_add(&uw, "http://a", 8));
+	CuAssertIntEquals(tc, 0, ur_write_close(&uw));
+	CuAssertIntEquals(tc, 0, ur_open(&run, path));
+	CuAssertIntEquals(tc, URLS / 2, (int) run.ur_count);
+	CuAssertTrue(tc, run.ur_blocks > 1);
+	/* the front coding and compression leave a small fraction of the URLs' bytes */
+	CuAssertIntEquals(tc, 0, stat(path, &st));
+	CuAssertTrue(tc, (size_t) st.st_size < strlen(url) * URLS / 2 / 8);
+	for(i = 0; i < URLS; i ++){
+		sprintf(url, "http://example.com/page/%06d", i);
+		CuAssertIntEquals(tc, (i % 2) ? ENOENT : 0, ur_contains(&run, url, strlen(url)));
+	}
+	CuAssertIntEquals(tc, ENOENT, ur_contains(&run, "http://a", 8));
+	CuAssertIntEquals(tc, ENOENT, ur_contains(&run, "http://example.com/page/", 24));
+	CuAssertIntEquals(tc, ENOENT, ur_contains(&run, "http://example.com/page/0000000", 31));
+	CuAssertIntEquals(tc, ENOENT, ur_contains(&run, "zzz", 3));
+	/* iteration gives them all back in order */
+	CuAssertIntEquals(tc, 0, ur_iter_init(&it, &run));
+	for(i = 0; ur_iter_next(&it, &u, &len) == 0; i ++){
+		CuAssertTrue(tc, strcmp(last, u) < 0);
+		CuAssertIntEquals(tc, (int) strlen(u), (int) len);
+		strcpy(last, u);
+	}
+	CuAssertIntEquals(tc, URLS / 2, i);
+	ur_iter_free(&it);
+	ur_close(&run);
+	/* a damaged run is refused */
+	CuAssertIntEquals(tc, 0, truncate(path, st.st_size - 1));
+	CuAssertIntEquals(tc, EINVAL, ur_open(&run, path));
+	remove_runs(dir);
+}
+
+void
+test_ur_contains_2( CuTest *tc)
+{
+	ur_writer_t uw;
+	ur_run_t    run;
+	char        dir[] = "/tmp/test_urlrun.XXXXXX",
+	            path[64],
+	            url[64];
+	int         inflated = 0,
+	            i        = 0;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	sprintf(path, "%s/run.0", dir);
+	CuAssertIntEquals(tc, 0, ur_write_open(&uw, path));
+	for(; i < URLS; i += 2){
+		sprintf(url, "http://example.com/page/%06d", i);
+		CuAssertIntEquals(tc, 0, ur_write_add(&uw, url, strlen(url)));
+	}
+	CuAssertIntEquals(tc, 0, ur_write_close(&uw));
+	CuAssertIntEquals(tc, 0, ur_open(&run, path));
+	CuAssertTrue(tc, run.ur_bbits >= URLS / 2 * UR_BLOOM_BITS);
+	/* the bloom filter answers nearly every miss without inflating a block */
+	for(i = 1; i < URLS; i += 2){
+		sprintf(url, "http://example.com/page/%06d", i);
+		run.ur_cached = -1;
+		CuAssertIntEquals(tc, ENOENT, ur_contains(&run, url, strlen(url)));
+		if( run.ur_cached != -1 ) {
+			inflated ++;
+		}
+	}
+	CuAssertTrue(tc, inflated < URLS / 2 / 50);
+	ur_close(&run);
+	remove_runs(dir);
+}
+
+static void *
+store_insert( void *arg)
+{
+	store_arg_t *sa = (store_arg_t *) arg;
+	char         url[64];
+	size_t       len;
+	int          i  = sa->sa_from;
+	for(; ! sa->sa_err && i < sa->sa_from + URLS; i ++){
+		len = make_url(url, i);
+		sa->sa_err = ur_store_insert(sa->sa_us, url, len);
+	}
+	__atomic_store_n(&sa->sa_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+void
+test_ur_store_insert_2( CuTest *tc)
+{
+	ur_store_t  us;
+	store_arg_t sa[2];
+	pthread_t   th[2];
+	char        dir[] = "/tmp/test_urlrun.XXXXXX",
+	            url[64];
+	size_t      len;
+	int         merging = 0,
+	            i;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	CuAssertIntEquals(tc, 0, ur_store_open(&us, dir, 64 * 1024));
+	for(i = 0; i < 2; i ++){
+		sa[i].sa_us   = &us;
+		sa[i].sa_from = i * URLS;
+		sa[i].sa_err  = 0;
+		sa[i].sa_done = 0;
+		CuAssertIntEquals(tc, 0, pthread_create(&th[i], NULL, store_insert, &sa[i]));
+	}
+	/* the store's lock can be taken while a merge is being written */
+	while( ! __atomic_load_n(&sa[0].sa_done, __ATOMIC_ACQUIRE)
+			|| ! __atomic_load_n(&sa[1].sa_done, __ATOMIC_ACQUIRE) ) {
+		pthread_mutex_lock(&us.us_lock);
+		if( us.us_compacting ) {
+			merging ++;
+		}
+		pthread_mutex_unlock(&us.us_lock);
+	}
+	for(i = 0; i < 2; i ++){
+		pthread_join(th[i], NULL);
+	}
+	CuAssertTrue(tc, merging > 0);
+	CuAssertIntEquals(tc, 0, sa[0].sa_err);
+	CuAssertIntEquals(tc, 0, sa[1].sa_err);
+	for(i = 0; i < 2 * URLS; i ++){
+		len = make_url(url, i);
+		CuAssertIntEquals(tc, 0, ur_store_contains(&us, url, len));
+	}
+	CuAssertIntEquals(tc, ENOENT, ur_store_contains(&us, "http://x", 8));
+	CuAssertIntEquals(tc, 0, ur_store_close(&us));
+	remove_runs(dir);
+}
+
+void
+test_ur_merge_1( CuTest *tc)
+{
+	ur_writer_t uw;
+	ur_run_t    runs[3],
+	           *rp[3],
+	            merged;
+	char        dir[] = "/tmp/test_urlrun.XXXXXX",
+	            path[64],
+	            url[64];
+	int         i,
+	            r;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	/* three runs of every 2nd,  3rd and 5th URL,  overlapping */
+	for(r = 0; r < 3; r ++){
+		sprintf(path, "%s/run.%d", dir, r);
+		CuAssertIntEquals(tc, 0, ur_write_open(&uw, path));
+		for(i = 0; i < 3000; i ++){
+			if( i % (r == 0 ? 2 : r == 1 ? 3 : 5) == 0 ) {
+				sprintf(url, "http://example.com/%05d", i);
+				CuAssertIntEquals(tc, 0, ur_write_add(&uw, url, strlen(url)));
+			}
+		}
+		CuAssertIntEquals(tc, 0, ur_write_close(&uw));
+		CuAssertIntEquals(tc, 0, ur_open(&runs[r], path));
+		rp[r] = &runs[r];
+	}
+	sprintf(path, "%s/run.3", dir);
+	CuAssertIntEquals(tc, 0, ur_merge(rp, 3, path));
+	CuAssertIntEquals(tc, 0, ur_open(&merged, path));
+	/* 1500 + 1000 + 600 - 500 - 300 - 200 + 100 */
+	CuAssertIntEquals(tc, 2200, (int) merged.ur_count);
+	for(i = 0; i < 3000; i ++){
+		sprintf(url, "http://example.com/%05d", i);
+		CuAssertIntEquals(tc, (i % 2 && i % 3 && i % 5) ? ENOENT : 0,
+				ur_contains(&merged, url, strlen(url)));
+	}
+	ur_close(&merged);
+	for(r = 0; r < 3; r ++){
+		ur_close(&runs[r]);
+	}
+	remove_runs(dir);
+}
+
+void
+test_ur_store_insert_1( CuTest *tc)
+{
+	ur_store_t us;
+	char       dir[] = "/tmp/test_urlrun.XXXXXX",
+	           path[64],
+	           url[64];
+	size_t     len;
+	int        i = 0;
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+	/* a small budget so the store flushes and merges many times */
+	CuAssertIntEquals(tc, 0, ur_store_open(&us, dir, 16 * 1024));
+	for(; i < URLS; i ++){
+		len = make_url(url, i);
+		CuAssertIntEquals(tc, 0, ur_store_insert(&us, url, len));
+		if( i % 7 == 0 ) {
+			len = make_url(url, i / 2);
+			CuAssertIntEquals(tc, EEXIST, ur_store_insert(&us, url, len));
+		}
+	}
+	/* the runs grow geometrically so there are few of them */
+	CuAssertTrue(tc, us.us_nruns > 1 && us.us_nruns < 12);
+	for(i = 1; i < us.us_nruns; i ++){
+		CuAssertTrue(tc, us.us_runs[i]->ur_count > UR_RATIO * us.us_runs[i - 1]->ur_count);
+	}
+	CuAssertIntEquals(tc, ENOENT, ur_store_contains(&us, "http://x", 8));
+	CuAssertIntEquals(tc, 0, ur_store_close(&us));
+	/* a leftover partial run is removed when the store is opened again */
+	sprintf(path, "%s/run.999.tmp", dir);
+	close(open(path, O_WRONLY | O_CREAT, 0644));
+	CuAssertIntEquals(tc, 0, ur_store_open(&us, dir, 0));
+	CuAssertIntEquals(tc, -1, access(path, F_OK));
+	for(i = 0; i < URLS; i ++){
+		len = make_url(url, i);
+		CuAssertIntEquals(tc, 0, ur_store_contains(&us, url, len));
+	}
+	CuAssertIntEquals(tc, EEXIST, ur_store_insert(&us, url, len));
+	CuAssertIntEquals(tc, 0, ur_store_insert(&us, "http://x", 8));
+	CuAssertIntEquals(tc, 0, ur_store_close(&us));
+	remove_runs(dir);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_ur_contains_1);
+	SUITE_ADD_TEST( suite, test_ur_contains_2);
+	SUITE_ADD_TEST( suite, test_ur_merge_1);
+	SUITE_ADD_TEST( suite, test_ur_store_insert_1);
+	SUITE_ADD_TEST( suite, test_ur_store_insert_2);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,102 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  test_wsched.c
+ *
+ *    Description:  tests the work stealing scheduler in wsched.c
+ *
+ *        Version:  1.0
+ *        Created:  28/10/2026 21:15:27
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <CuTest.h>
+#include <azzmos/wsched.h>
+
+#define WORKERS 4
+#define PAGES   50
+#define LINKS   2000
+
+struct job_s {
+	ws_task_t   jb_task;
+	int         jb_links;   /* links the page yields,  0 for a link */
+} typedef job_t;
+
+static wsched_t ws;
+static long     ran;
+static long     per_worker[WORKERS];
+
+static void
+link_task( ws_task_t *task)
+{
+	job_t *jb = list_entry(task, job_t, jb_task);
+	__atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&per_worker[ws_worker(&ws)], 1, __ATOMIC_RELAXED);
+	free(jb);
+}
+
+static void
+page_task( ws_task_t *task)
+{
+	job_t *jb = list_entry(task, job_t, jb_task),
+	      *ln;
+	int    i  = 0;
+	/* a burst of links,  more than a deque starts with room for */
+	for(; i < jb->jb_links; i ++){
+		ln = (job_t *) malloc(sizeof(job_t));
+		ws_task_init(&ln->jb_task, link_task);
+		ln->jb_links = 0;
+		ws_spawn(&ws, &ln->jb_task);
+	}
+	__atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+	free(jb);
+}
+
+void
+test_ws_spawn_1( CuTest *tc)
+{
+	job_t *jb;
+	long   total = 0;
+	int    i     = 0;
+	CuAssertIntEquals(tc, 0, ws_init(&ws, WORKERS));
+	CuAssertIntEquals(tc, -1, ws_worker(&ws));
+	for(; i < PAGES; i ++){
+		jb = (job_t *) malloc(sizeof(job_t));
+		ws_task_init(&jb->jb_task, page_task);
+		jb->jb_links = LINKS;
+		CuAssertIntEquals(tc, 0, ws_spawn(&ws, &jb->jb_task));
+	}
+	ws_wait(&ws);
+	CuAssertTrue(tc, ran == PAGES + (long) PAGES * LINKS);
+	for(i = 0; i < WORKERS; i ++){
+		total += per_worker[i];
+	}
+	CuAssertTrue(tc, total == (long) PAGES * LINKS);
+	ws_destroy(&ws);
+}
+
+CuSuite *
+GetSuite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST( suite, test_ws_spawn_1);
+	return suite;
+}
+
+int
+main()
+{
+	CuSuite  *suite  = CuSuiteNew();
+	CuString *output = CuStringNew();
+	CuSuiteAddSuite( suite, GetSuite());
+	CuSuiteRun(suite);
+	CuSuiteSummary( suite, output);
+	fprintf( stdout, "%s\n", output->buffer);
+	exit(suite->failCount);
+}
@@ -0,0 +1,65 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  testuri.c
+ *
+ *    Description:  uri objects built by hand for the tests,  without going through
+ *                  the parser.  They are released with free_uriobj.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 20:41:07
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:  
+ *
+ * =====================================================================================
+ */
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#include <testuri.h>
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  test_uri
+ *  Description:  Build http://host/path as a registered name.  path may be NULL for
+ *                the tests that only look at the host.
+ * =====================================================================================
+ */
+extern uriobj_t *
+test_uri( const char *host, const char *path)
+{
+	uriobj_t *uri = (uriobj_t *) malloc(sizeof(uriobj_t));
+	init_uriobj_str(uri);
+	*(uri->uri_scheme) = strdup("http");
+	*(uri->uri_auth)   = strdup(host);
+	*(uri->uri_host)   = strdup(host);
+	*(uri->uri_path)   = path ? strdup(path) : NULL;
+	uri->uri_flags     = URI_REGNAME;
+	return uri;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  test_uri_addr
+ *  Description:  Give uri the numeric address ip as if it had been resolved.  The
+ *                addrinfo comes from getaddrinfo so free_uriobj can release it.
+ * =====================================================================================
+ */
+extern int
+test_uri_addr( uriobj_t *uri, const char *ip)
+{
+	struct addrinfo hints;
+	bzero(&hints, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags    = AI_NUMERICHOST;
+	if( *(uri->uri_addr) ) {
+		freeaddrinfo(*(uri->uri_addr));
+		*(uri->uri_addr) = NULL;
+	}
+	return getaddrinfo(ip, NULL, &hints, uri->uri_addr);
+}
@@ -0,0 +1,32 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  testuri.h
+ *
+ *    Description:  uri objects built by hand for the tests,  without going through
+ *                  the parser.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 20:41:07
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Aaron Spiteri
+ *        Company:  
+ *
+ * =====================================================================================
+ */
+
+
+/* #####   HEADER FILE INCLUDES   ################################################### */
+#define __AZZMOS_TESTURI_H__
+#ifndef __AZZMOS_COMMON_H__
+#include <azzmos/common.h>
+#endif
+#ifndef __AZZMOS_URIOBJ_H__
+#include <azzmos/uriobj.h>
+#endif
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+extern uriobj_t *test_uri( const char *host, const char *path);
+extern int       test_uri_addr( uriobj_t *uri, const char *ip);